@@ -30,7 +30,7 @@
 @set ENDIANNESS_DEF=invalid,unknown=-1;littleEndian=0;bigEndian,networkByteOrder=1
 
 @set FILETYPEFLAGS_GEN_FLAGS=        --enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,flags,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL% %FLAGENUM_EXTRA%
-@set FILETYPEFLAGS_DEF=invalid=-1;normalFile=0;directory=1;deviceFile=2
+@set FILETYPEFLAGS_DEF=invalid=-1;normalFile=0;directory=1;deviceFile=2;symlink=4
 
 @set ERRORCODE_GEN_FLAGS=--enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL%
 @rem set ERRORCODE_DEF=invalid,unknown=-1;ok=0;genericError=1;notFound=2;notExist=3;alreadyExist=4;accessDenied=5;invalidName;notSupported;invalidMountPoint;invalidMountTarget;notDirectory
@@ -47,6 +47,18 @@
 @set FILEMASKFLAGS_GEN_FLAGS=       --enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,flags,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL% %FLAGENUM_EXTRA% %HEX4%
 @set FILEMASKFLAGS_DEF=invalid,unknown=-1;none,matchSimple=0;useAnchors=1;matchRegex=2;matchExtOnly=4
 
+@set OPENMODE_GEN_FLAGS=       --enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,flags,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL% %FLAGENUM_EXTRA% %HEX4%
+@set OPENMODE_DEF=invalid,unknown=-1;none=0;read=1;write=2;readWrite=3;create=4;truncate=8;exclusive=16
+
+@set SEEKORIGIN_GEN_FLAGS=--enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL%
+@set SEEKORIGIN_DEF=invalid,unknown=-1;begin=0;current=1;end=2
+
+@set WALKTREEFLAGS_GEN_FLAGS=       --enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,flags,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL% %FLAGENUM_EXTRA% %HEX4%
+@set WALKTREEFLAGS_DEF=invalid,unknown=-1;none,unsorted=0;sorted=1;followSymlinks=2
+
+@set ENTRYFIELDFLAGS_GEN_FLAGS=       --enum-flags=0 --enum-flags=type-decl,serialize,deserialize,lowercase,enum-class,flags,fmt-hex %VALUES_CAMEL% %SERIALIZE_PASCAL% %FLAGENUM_EXTRA% %HEX4%
+@set ENTRYFIELDFLAGS_DEF=invalid,unknown=-1;none=0;name=1;ext=2;type=4;size=8;times=16;path=32;all=63
+
 
 umba-enum-gen %GEN_OPTS% %HEX2% %TPL_OVERRIDE% ^
 %ERRORCODE_GEN_FLAGS%                   %UINT32% -E=ErrorCode                         -F=@error_code.txt                ^
@@ -56,5 +68,9 @@ umba-enum-gen %GEN_OPTS% %HEX2% %TPL_OVERRIDE% ^
 %SORTFLAGS_GEN_FLAGS%                   %UINT32% -E=SortFlags                         -F=%SORTFLAGS_DEF%                ^
 %ENUMERATEFLAGS_GEN_FLAGS%              %UINT32% -E=EnumerateFlags                    -F=%ENUMERATEFLAGS_DEF%           ^
 %FILEMASKFLAGS_GEN_FLAGS%               %UINT32% -E=FileMaskFlags                     -F=%FILEMASKFLAGS_DEF%            ^
+%OPENMODE_GEN_FLAGS%                    %UINT32% -E=OpenMode                          -F=%OPENMODE_DEF%                 ^
+%SEEKORIGIN_GEN_FLAGS%                  %UINT32% -E=SeekOrigin                        -F=%SEEKORIGIN_DEF%               ^
+%WALKTREEFLAGS_GEN_FLAGS%               %UINT32% -E=WalkTreeFlags                     -F=%WALKTREEFLAGS_DEF%            ^
+%ENTRYFIELDFLAGS_GEN_FLAGS%             %UINT32% -E=EntryFieldFlags                   -F=%ENTRYFIELDFLAGS_DEF%          ^
 ..\vfs_enums.h
 
@@ -0,0 +1,249 @@
+/*! \file
+    \brief Reusable data buffers pool for reading files without allocation on each read
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Интерфейс пула буферов
+/*! Размер (size()) буферов, которые хранит пул - это размер уже выделенной и проинициализированной памяти,
+    поэтому повторное использование буфера не требует ни аллокации, ни заполнения нулями.
+    Реализация должна быть потокобезопасной.
+ */
+struct IDataBufferPool
+{
+    virtual ~IDataBufferPool() {}
+
+    //! Возвращает буфер размером не менее minSize
+    virtual std::vector<std::uint8_t> acquireBuffer(std::size_t minSize) = 0;
+
+    //! Возвращает буфер в пул. Пул может его и не взять, тогда память освобождается
+    virtual void releaseBuffer(std::vector<std::uint8_t> &&buf) = 0;
+
+}; // struct IDataBufferPool
+
+
+
+//! Буфер, взятый из пула. При уничтожении возвращается в пул
+class PooledDataBuffer
+{
+
+protected:
+
+    std::shared_ptr<IDataBufferPool>  m_pPool    ;
+    std::vector<std::uint8_t>         m_buf      ; // m_buf.size() - выделенная память, а не размер данных
+    std::size_t                       m_dataSize = 0;
+
+public:
+
+    PooledDataBuffer()                                     = default;
+    PooledDataBuffer(const PooledDataBuffer &)             = delete;
+    PooledDataBuffer& operator=(const PooledDataBuffer &)  = delete;
+
+    PooledDataBuffer(PooledDataBuffer &&other)
+    : m_pPool(std::move(other.m_pPool)), m_buf(std::move(other.m_buf)), m_dataSize(other.m_dataSize)
+    {
+        other.m_dataSize = 0;
+    }
+
+    PooledDataBuffer& operator=(PooledDataBuffer &&other)
+    {
+        if (this!=&other)
+        {
+            release();
+            m_pPool          = std::move(other.m_pPool);
+            m_buf            = std::move(other.m_buf);
+            m_dataSize       = other.m_dataSize;
+            other.m_dataSize = 0;
+        }
+
+        return *this;
+    }
+
+    explicit PooledDataBuffer(std::shared_ptr<IDataBufferPool> pPool) : m_pPool(pPool) {}
+
+    ~PooledDataBuffer()
+    {
+        release();
+    }
+
+    //! Подготавливает буфер под dataSize байт данных и возвращает указатель на него.
+    /*! Если текущей ёмкости не хватает, буфер меняется на более подходящий из пула.
+        Содержимое буфера при этом не сохраняется.
+     */
+    std::uint8_t* prepare(std::size_t dataSize)
+    {
+        if (m_buf.size()<dataSize)
+        {
+            if (m_pPool)
+            {
+                if (!m_buf.empty())
+                {
+                    m_pPool->releaseBuffer(std::move(m_buf));
+                }
+
+                m_buf = m_pPool->acquireBuffer(dataSize);
+            }
+
+            if (m_buf.size()<dataSize) // Пул мог вернуть что угодно
+            {
+                m_buf.resize(dataSize);
+            }
+        }
+
+        m_dataSize = dataSize;
+
+        return m_buf.data();
+    }
+
+    //! Уменьшает размер данных (например, если прочитали меньше, чем ожидали)
+    void setSize(std::size_t dataSize)
+    {
+        if (dataSize<=m_buf.size())
+        {
+            m_dataSize = dataSize;
+        }
+    }
+
+    //! Возвращает буфер в пул
+    void release()
+    {
+        m_dataSize = 0;
+
+        if (m_pPool && !m_buf.empty())
+        {
+            m_pPool->releaseBuffer(std::move(m_buf));
+        }
+
+        m_buf = std::vector<std::uint8_t>();
+    }
+
+    void setPool(std::shared_ptr<IDataBufferPool> pPool)
+    {
+        if (m_pPool!=pPool)
+        {
+            release();
+            m_pPool = pPool;
+        }
+    }
+
+    std::shared_ptr<IDataBufferPool> getPool() const { return m_pPool; }
+
+    const std::uint8_t* data() const { return m_buf.data(); }
+    std::uint8_t*       data()       { return m_buf.data(); }
+    std::size_t         size() const { return m_dataSize; }
+    bool                empty() const { return m_dataSize==0; }
+    std::size_t         capacity() const { return m_buf.size(); }
+
+    const std::uint8_t* begin() const { return m_buf.data(); }
+    const std::uint8_t* end()   const { return m_buf.data()+m_dataSize; }
+
+}; // class PooledDataBuffer
+
+
+
+//! Простой потокобезопасный пул буферов
+class DataBufferPoolImpl : public IDataBufferPool
+{
+
+protected:
+
+    std::mutex                                 m_mutex        ;
+    std::vector< std::vector<std::uint8_t> >   m_freeBuffers  ;
+    std::size_t                                m_maxBuffers    = 64;
+    std::size_t                                m_maxBufferSize = 16u*1024u*1024u; // Большие буферы в пуле не держим
+
+public:
+
+    DataBufferPoolImpl() = default;
+
+    DataBufferPoolImpl(std::size_t maxBuffers, std::size_t maxBufferSize)
+    : m_maxBuffers(maxBuffers), m_maxBufferSize(maxBufferSize)
+    {}
+
+    DataBufferPoolImpl(const DataBufferPoolImpl &)            = delete;
+    DataBufferPoolImpl& operator=(const DataBufferPoolImpl &) = delete;
+
+
+    virtual std::vector<std::uint8_t> acquireBuffer(std::size_t minSize) override
+    {
+        std::vector<std::uint8_t> buf;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Ищем наименьший подходящий буфер, если такого нет - берём самый большой и доращиваем его
+            std::size_t bestIdx = m_freeBuffers.size();
+            std::size_t maxIdx  = m_freeBuffers.size();
+
+            for(std::size_t i=0; i!=m_freeBuffers.size(); ++i)
+            {
+                std::size_t sz = m_freeBuffers[i].size();
+
+                if (sz>=minSize && (bestIdx==m_freeBuffers.size() || sz<m_freeBuffers[bestIdx].size()))
+                {
+                    bestIdx = i;
+                }
+
+                if (maxIdx==m_freeBuffers.size() || sz>m_freeBuffers[maxIdx].size())
+                {
+                    maxIdx = i;
+                }
+            }
+
+            std::size_t takeIdx = bestIdx!=m_freeBuffers.size() ? bestIdx : maxIdx;
+            if (takeIdx!=m_freeBuffers.size())
+            {
+                buf = std::move(m_freeBuffers[takeIdx]);
+                m_freeBuffers[takeIdx] = std::move(m_freeBuffers.back());
+                m_freeBuffers.pop_back();
+            }
+        }
+
+        if (buf.size()<minSize)
+        {
+            buf.resize(minSize);
+        }
+
+        return buf;
+    }
+
+    virtual void releaseBuffer(std::vector<std::uint8_t> &&buf) override
+    {
+        if (buf.empty() || buf.size()>m_maxBufferSize)
+        {
+            return;
+        }
+
+        std::vector<std::uint8_t> tmp = std::move(buf);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeBuffers.size()<m_maxBuffers)
+        {
+            m_freeBuffers.emplace_back(std::move(tmp));
+        }
+    }
+
+}; // class DataBufferPoolImpl
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
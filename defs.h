@@ -41,3 +41,29 @@
     #error "MARTY_VFS_ARCH_LITTLE_ENDIAN macro conficts with MARTY_VFS_ARCH_BIG_ENDIAN macro"
 
 #endif
+
+//----------------------------------------------------------------------------
+// Перегрузки IFileSystem/IVirtualFs, принимающие std::string_view/std::wstring_view - только для C++17 и выше.
+// Отключаются макросом MARTY_VFS_DISABLE_STRING_VIEW
+
+#if !defined(MARTY_VFS_DISABLE_STRING_VIEW) && !defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+    #if defined(_MSVC_LANG)
+        #define MARTY_VFS_CPLUSPLUS_VERSION _MSVC_LANG
+    #else
+        #define MARTY_VFS_CPLUSPLUS_VERSION __cplusplus
+    #endif
+
+    #if MARTY_VFS_CPLUSPLUS_VERSION>=201703L
+
+        #if defined(__has_include)
+            #if __has_include(<string_view>)
+                #define MARTY_VFS_STRING_VIEW_AVAILABLE
+            #endif
+        #else
+            #define MARTY_VFS_STRING_VIEW_AVAILABLE
+        #endif
+
+    #endif
+
+#endif
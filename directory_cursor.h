@@ -0,0 +1,432 @@
+/*! \file
+    \brief Paginated, resumable directory enumeration cursor
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+#include "vfs_types.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Курсор постраничного обзора каталога
+/*! Открывается через IFileSystem::openDirectoryCursor - каталог (или виртуальный корень со списком точек монтирования)
+    читается, отбирается по маскам и сортируется один раз, дальше next отдаёт страницы из этого снимка.
+    Копии курсора разделяют снимок, но позиция у каждой своя.
+
+    serialize сохраняет в строку параметры обзора и последнюю отданную запись (снимок не сохраняется).
+    IFileSystem::restoreDirectoryCursor по такой строке заново читает каталог и продолжает с первой записи,
+    которая при той же сортировке идёт после сохранённой - так что файлы, добавленные или удалённые
+    между страницами, не сбивают позицию.
+
+    Восстановление - не O(размер страницы): каталог заново читается целиком. Записи, которые идут не после
+    сохранённой, отбрасываются по мере чтения (acceptAfterResumeEntry) и не хранятся и не сортируются,
+    а остаток сортируется и становится снимком восстановленного курсора.
+ */
+template<typename StringType>
+class DirectoryCursorT
+{
+
+public:
+
+    typedef typename StringType::value_type    CharType;
+    typedef DirectoryEntryInfoT<StringType>    EntryType;
+    typedef FileMaskInfoT<StringType>          FileMaskInfoType;
+
+
+protected:
+
+    StringType                                      m_dirPath        ;
+    EnumerateFlags                                  m_enumerateFlags = EnumerateFlags::none;
+    SortFlags                                       m_sortFlags      = SortFlags::none;
+    std::vector<FileMaskInfoType>                   m_masks          ;
+
+    std::shared_ptr<const std::vector<EntryType> >  m_pSnapshot      ;
+    std::size_t                                     m_position       = 0;
+
+    // Запись, после которой продолжать (из разобранного состояния), снимок тогда начинается после неё
+    bool                                            m_bHasResumeEntry = false;
+    EntryType                                       m_resumeEntry     ;
+    bool                                            m_bResumeNameSeen = false; // При отборе уже встретилась запись с именем m_resumeEntry
+
+
+    static const char* stateSignature()
+    {
+        return "MVFSDC1";
+    }
+
+    static void appendNumber(std::string &out, std::uint64_t v)
+    {
+        out.append(std::to_string(v));
+        out.append(1, ';');
+    }
+
+    //! Строка - длина и коды символов в hex, фиксированной ширины
+    static void appendString(std::string &out, const StringType &str)
+    {
+        static const char hexDigits[] = "0123456789ABCDEF";
+
+        out.append(std::to_string(str.size()));
+        out.append(1, ':');
+
+        for(auto ch : str)
+        {
+            std::uint64_t code = (std::uint64_t)(typename std::make_unsigned<CharType>::type)ch;
+            for(std::size_t i=sizeof(CharType)*2; i!=0; --i)
+            {
+                out.append(1, hexDigits[(code>>((i-1)*4))&0xF]);
+            }
+        }
+
+        out.append(1, ';');
+    }
+
+    // Десятичное число до разделителя sep. Не помещается в 64 бита - ошибка
+    static bool parseDecimal(const std::string &state, std::size_t &pos, char sep, std::uint64_t &v)
+    {
+        const std::uint64_t maxVal   = (std::uint64_t)-1;
+        std::size_t         startPos = pos;
+
+        v = 0;
+        while(pos<state.size() && state[pos]>='0' && state[pos]<='9')
+        {
+            std::uint64_t d = (std::uint64_t)(state[pos]-'0');
+            if (v>(maxVal-d)/10)
+            {
+                return false;
+            }
+
+            v = v*10 + d;
+            ++pos;
+        }
+
+        if (pos==startPos || pos>=state.size() || state[pos]!=sep)
+        {
+            return false;
+        }
+
+        ++pos;
+        return true;
+    }
+
+    static bool parseNumber(const std::string &state, std::size_t &pos, std::uint64_t &v)
+    {
+        return parseDecimal(state, pos, ';', v);
+    }
+
+    static bool parseString(const std::string &state, std::size_t &pos, StringType &str)
+    {
+        std::uint64_t len = 0;
+        if (!parseDecimal(state, pos, ':', len))
+        {
+            return false;
+        }
+
+        const std::size_t charDigits = sizeof(CharType)*2;
+        if ((state.size()-pos)/charDigits < len)
+        {
+            return false;
+        }
+
+        str.clear();
+        str.reserve((std::size_t)len);
+
+        for(std::uint64_t n=0; n!=len; ++n)
+        {
+            std::uint64_t code = 0;
+            for(std::size_t i=0; i!=charDigits; ++i, ++pos)
+            {
+                char ch = state[pos];
+                int  d  = (ch>='0' && ch<='9') ? ch-'0' : ((ch>='A' && ch<='F') ? ch-'A'+10 : -1);
+                if (d<0)
+                {
+                    return false;
+                }
+
+                code = (code<<4) | (std::uint64_t)d;
+            }
+
+            str.append(1, (CharType)code);
+        }
+
+        if (pos>=state.size() || state[pos]!=';')
+        {
+            return false;
+        }
+
+        ++pos;
+        return true;
+    }
+
+
+public:
+
+    DirectoryCursorT() = default;
+
+    bool isOpen() const
+    {
+        return m_pSnapshot!=0;
+    }
+
+    //! Все записи отданы (или курсор не открыт)
+    bool isAtEnd() const
+    {
+        return !m_pSnapshot || m_position>=m_pSnapshot->size();
+    }
+
+    //! Сколько записей снимка уже отдано (снимок восстановленного курсора начинается после сохранённой записи)
+    std::size_t getPosition() const
+    {
+        return m_position;
+    }
+
+    //! Записей в снимке
+    std::size_t size() const
+    {
+        return m_pSnapshot ? m_pSnapshot->size() : 0;
+    }
+
+    const StringType& getDirPath() const                       { return m_dirPath; }
+    EnumerateFlags getEnumerateFlags() const                    { return m_enumerateFlags; }
+    SortFlags getSortFlags() const                              { return m_sortFlags; }
+    const std::vector<FileMaskInfoType>& getMasks() const       { return m_masks; }
+
+
+    //! Следующая страница - не более batchSize записей. Пустая страница - записи кончились
+    ErrorCode next(std::size_t batchSize, std::vector<EntryType> &entries)
+    {
+        entries.clear();
+
+        if (!m_pSnapshot)
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        const auto &snapshot = *m_pSnapshot;
+
+        std::size_t endPos = m_position + std::min(batchSize, snapshot.size()-std::min(m_position, snapshot.size()));
+
+        entries.reserve(endPos-m_position);
+        for(; m_position<endPos; ++m_position)
+        {
+            entries.emplace_back(snapshot[m_position]);
+        }
+
+        return ErrorCode::ok;
+    }
+
+    //! Состояние курсора - параметры обзора и последняя отданная запись, строкой из ASCII-символов
+    std::string serialize() const
+    {
+        std::string res = stateSignature();
+        res.append(1, ';');
+
+        appendString(res, m_dirPath);
+        appendNumber(res, (std::uint64_t)m_enumerateFlags);
+        appendNumber(res, (std::uint64_t)m_sortFlags);
+
+        appendNumber(res, m_masks.size());
+        for(const auto &m : m_masks)
+        {
+            appendNumber(res, (std::uint64_t)m.fileMaskFlags);
+            appendString(res, m.mask);
+        }
+
+        const EntryType *pLast = 0;
+        if (m_pSnapshot && m_position>0)
+        {
+            pLast = &(*m_pSnapshot)[std::min(m_position, m_pSnapshot->size())-1];
+        }
+        else if (m_bHasResumeEntry) // После восстановления ещё ничего не отдали
+        {
+            pLast = &m_resumeEntry;
+        }
+
+        appendNumber(res, pLast ? 1 : 0);
+        if (pLast)
+        {
+            appendString(res, pLast->entryName);
+            appendString(res, pLast->entryExt);
+            appendNumber(res, (std::uint64_t)pLast->fileTypeFlags);
+            appendNumber(res, (std::uint64_t)pLast->fileSize);
+            appendNumber(res, (std::uint64_t)pLast->timeCreation);
+            appendNumber(res, (std::uint64_t)pLast->timeLastModified);
+            appendNumber(res, (std::uint64_t)pLast->timeLastAccess);
+        }
+
+        return res;
+    }
+
+
+    // Для реализаций IFileSystem
+
+    //! Курсор на начало свежего снимка
+    void open(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoType> &masks, std::vector<EntryType> &&snapshot)
+    {
+        m_dirPath         = dirPath;
+        m_enumerateFlags  = enumerateFlags;
+        m_sortFlags       = sortFlags;
+        m_masks           = masks;
+        m_pSnapshot       = std::make_shared<const std::vector<EntryType> >(std::move(snapshot));
+        m_position        = 0;
+        m_bHasResumeEntry = false;
+        m_resumeEntry     = EntryType();
+        m_bResumeNameSeen = false;
+    }
+
+    //! Разбирает сохранённое состояние. Снимок сбрасывается - его надо задать через resume
+    bool parseState(const std::string &state)
+    {
+        std::string sig = std::string(stateSignature()) + ";";
+        if (state.compare(0, sig.size(), sig)!=0)
+        {
+            return false;
+        }
+
+        std::size_t    pos = sig.size();
+        std::uint64_t  v   = 0;
+
+        DirectoryCursorT restored;
+
+        if (!parseString(state, pos, restored.m_dirPath))
+        {
+            return false;
+        }
+
+        if (!parseNumber(state, pos, v))
+        {
+            return false;
+        }
+        restored.m_enumerateFlags = (EnumerateFlags)v;
+
+        if (!parseNumber(state, pos, v))
+        {
+            return false;
+        }
+        restored.m_sortFlags = (SortFlags)v;
+
+        std::uint64_t nMasks = 0;
+        if (!parseNumber(state, pos, nMasks) || nMasks>state.size())
+        {
+            return false;
+        }
+
+        for(std::uint64_t i=0; i!=nMasks; ++i)
+        {
+            FileMaskInfoType m;
+            if (!parseNumber(state, pos, v))
+            {
+                return false;
+            }
+            m.fileMaskFlags = (FileMaskFlags)v;
+
+            if (!parseString(state, pos, m.mask))
+            {
+                return false;
+            }
+
+            restored.m_masks.emplace_back(m);
+        }
+
+        if (!parseNumber(state, pos, v))
+        {
+            return false;
+        }
+
+        restored.m_bHasResumeEntry = v!=0;
+        if (restored.m_bHasResumeEntry)
+        {
+            EntryType &e = restored.m_resumeEntry;
+
+            if (!parseString(state, pos, e.entryName) || !parseString(state, pos, e.entryExt))
+            {
+                return false;
+            }
+
+            if (!parseNumber(state, pos, v)) return false;
+            e.fileTypeFlags = (FileTypeFlags)v;
+            if (!parseNumber(state, pos, v)) return false;
+            e.fileSize = (FileSize)v;
+            if (!parseNumber(state, pos, v)) return false;
+            e.timeCreation = (FileTime)v;
+            if (!parseNumber(state, pos, v)) return false;
+            e.timeLastModified = (FileTime)v;
+            if (!parseNumber(state, pos, v)) return false;
+            e.timeLastAccess = (FileTime)v;
+        }
+
+        if (pos!=state.size())
+        {
+            return false;
+        }
+
+        *this = std::move(restored);
+        return true;
+    }
+
+    //! После parseState - отбор записей при повторном чтении каталога: true - запись идёт после сохранённой
+    /*! Записи подаются в порядке чтения каталога, уже отобранные по типу и маскам.
+        compare(e1, e2) - как IFileSystem::compareDirectoryEntries с флагами сортировки курсора.
+        Из записей, равных сохранённой при сравнении (например, имена, различающиеся только регистром,
+        при ignoreCase), берутся прочитанные после записи с точно таким же именем - как при устойчивой
+        сортировке всего каталога. Если такой записи больше нет, равные не берутся
+     */
+    template<typename Compare>
+    bool acceptAfterResumeEntry(const EntryType &e, Compare compare)
+    {
+        if (!m_bHasResumeEntry)
+        {
+            return true;
+        }
+
+        int cmpRes = compare(e, m_resumeEntry);
+        if (cmpRes!=0)
+        {
+            return cmpRes>0;
+        }
+
+        if (!m_bResumeNameSeen && e.entryName==m_resumeEntry.entryName)
+        {
+            m_bResumeNameSeen = true;
+            return false;
+        }
+
+        return m_bResumeNameSeen;
+    }
+
+    //! После отбора - задаёт снимок из отобранных и отсортированных записей, курсор - на его начале
+    void resume(std::vector<EntryType> &&remainder)
+    {
+        m_pSnapshot       = std::make_shared<const std::vector<EntryType> >(std::move(remainder));
+        m_position        = 0;
+        m_bResumeNameSeen = false;
+    }
+
+}; // class DirectoryCursorT
+
+//------------------------------
+typedef DirectoryCursorT<std::string>   DirectoryCursorA;
+typedef DirectoryCursorT<std::wstring>  DirectoryCursorW;
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
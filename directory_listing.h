@@ -0,0 +1,363 @@
+/*! \file
+    \brief Compact columnar directory listing - shared path, names in a single arena
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+#include "entry_sorter.h"
+#include "vfs_types.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Результат перечисления каталога в компактном виде
+/*! Путь каталога хранится один раз на весь список (std::shared_ptr - его можно раздать без копирования),
+    имена и расширения всех записей лежат подряд в одной строке-арене, записи хранят только смещения.
+    Расширение обычно является хвостом имени - тогда отдельно не хранится.
+
+    Атрибуты хранятся по столбцам (отдельные массивы типов, размеров, времён, смещений имён), так что
+    отбор по размеру или времени - это проход по непрерывному массиву 64-битных значений.
+    Сортировка и отбор список не меняют, а возвращают перестановку - вектор индексов записей.
+    Сортирует DirectoryEntrySorterT по ключам ФС, так что порядок тот же, что у enumerateDirectoryEx.
+
+    На больших каталогах это миллион строк-путей и два миллиона строк-имён вместо одной строки и одного вектора.
+    Для совместимости список можно развернуть в привычный std::vector<DirectoryEntryInfoT> (toEntries).
+ */
+template<typename StringType>
+class DirectoryListingT
+{
+
+public:
+
+    typedef typename StringType::value_type    CharType;
+    typedef DirectoryEntryInfoT<StringType>    EntryType;
+    typedef std::vector<std::size_t>           IndexVector;
+
+
+protected:
+
+    std::shared_ptr<const StringType>   m_pPath             ;
+    StringType                          m_names             ; // Арена имён и расширений
+
+    // Столбцы, по элементу на запись
+    std::vector<std::size_t>            m_nameOffsets       ;
+    std::vector<std::size_t>            m_nameLens          ;
+    std::vector<std::size_t>            m_extOffsets        ;
+    std::vector<std::size_t>            m_extLens           ;
+    std::vector<FileTypeFlags>          m_fileTypeFlags     ;
+    std::vector<FileSize>               m_fileSizes         ;
+    std::vector<FileTime>               m_timesCreation     ;
+    std::vector<FileTime>               m_timesLastModified ;
+    std::vector<FileTime>               m_timesLastAccess   ;
+    std::vector<EntryFieldFlags>        m_validFields       ;
+
+
+public:
+
+    DirectoryListingT() : m_pPath(std::make_shared<const StringType>()) {}
+
+    explicit DirectoryListingT(const StringType &path) : m_pPath(std::make_shared<const StringType>(path)) {}
+
+    void clear()
+    {
+        m_names.clear();
+        m_nameOffsets.clear();
+        m_nameLens.clear();
+        m_extOffsets.clear();
+        m_extLens.clear();
+        m_fileTypeFlags.clear();
+        m_fileSizes.clear();
+        m_timesCreation.clear();
+        m_timesLastModified.clear();
+        m_timesLastAccess.clear();
+        m_validFields.clear();
+    }
+
+    //! nameChars - ожидаемая суммарная длина имён
+    void reserve(std::size_t nEntries, std::size_t nameChars = 0)
+    {
+        m_nameOffsets.reserve(nEntries);
+        m_nameLens.reserve(nEntries);
+        m_extOffsets.reserve(nEntries);
+        m_extLens.reserve(nEntries);
+        m_fileTypeFlags.reserve(nEntries);
+        m_fileSizes.reserve(nEntries);
+        m_timesCreation.reserve(nEntries);
+        m_timesLastModified.reserve(nEntries);
+        m_timesLastAccess.reserve(nEntries);
+        m_validFields.reserve(nEntries);
+        m_names.reserve(nameChars);
+    }
+
+    std::size_t size() const
+    {
+        return m_nameOffsets.size();
+    }
+
+    bool empty() const
+    {
+        return m_nameOffsets.empty();
+    }
+
+    void setPath(const StringType &path)
+    {
+        m_pPath = std::make_shared<const StringType>(path);
+    }
+
+    const StringType& getPath() const
+    {
+        return *m_pPath;
+    }
+
+    //! Путь, общий для всех записей, без копирования
+    std::shared_ptr<const StringType> getSharedPath() const
+    {
+        return m_pPath;
+    }
+
+    //! Добавляет запись, путь записи не сохраняется - у всех записей списка он общий
+    void append(const EntryType &e)
+    {
+        std::size_t nameOffset = m_names.size();
+        std::size_t nameLen    = e.entryName.size();
+        m_names.append(e.entryName);
+
+        std::size_t extLen     = e.entryExt.size();
+        std::size_t extOffset  = 0;
+        if (extLen<=nameLen && m_names.compare(nameOffset+nameLen-extLen, extLen, e.entryExt)==0)
+        {
+            extOffset = nameOffset + nameLen - extLen;
+        }
+        else
+        {
+            extOffset = m_names.size();
+            m_names.append(e.entryExt);
+        }
+
+        m_nameOffsets      .emplace_back(nameOffset);
+        m_nameLens         .emplace_back(nameLen);
+        m_extOffsets       .emplace_back(extOffset);
+        m_extLens          .emplace_back(extLen);
+        m_fileTypeFlags    .emplace_back(e.fileTypeFlags);
+        m_fileSizes        .emplace_back(e.fileSize);
+        m_timesCreation    .emplace_back(e.timeCreation);
+        m_timesLastModified.emplace_back(e.timeLastModified);
+        m_timesLastAccess  .emplace_back(e.timeLastAccess);
+        m_validFields      .emplace_back(e.validFields | EntryFieldFlags::path);
+    }
+
+    //! Указатель на имя в арене, без завершающего нуля
+    const CharType* getNameData(std::size_t idx) const
+    {
+        return m_names.data() + m_nameOffsets[idx];
+    }
+
+    std::size_t getNameLength(std::size_t idx) const
+    {
+        return m_nameLens[idx];
+    }
+
+    const CharType* getExtData(std::size_t idx) const
+    {
+        return m_names.data() + m_extOffsets[idx];
+    }
+
+    std::size_t getExtLength(std::size_t idx) const
+    {
+        return m_extLens[idx];
+    }
+
+    StringType getName(std::size_t idx) const
+    {
+        return StringType(getNameData(idx), getNameLength(idx));
+    }
+
+    StringType getExt(std::size_t idx) const
+    {
+        return StringType(getExtData(idx), getExtLength(idx));
+    }
+
+    FileTypeFlags   getFileTypeFlags   (std::size_t idx) const { return m_fileTypeFlags[idx]    ; }
+    FileSize        getFileSize        (std::size_t idx) const { return m_fileSizes[idx]        ; }
+    FileTime        getTimeCreation    (std::size_t idx) const { return m_timesCreation[idx]    ; }
+    FileTime        getTimeLastModified(std::size_t idx) const { return m_timesLastModified[idx]; }
+    FileTime        getTimeLastAccess  (std::size_t idx) const { return m_timesLastAccess[idx]  ; }
+    EntryFieldFlags getValidFields     (std::size_t idx) const { return m_validFields[idx]      ; }
+
+    //! Столбцы целиком - для своих проходов по данным
+    const std::vector<FileTypeFlags>& getFileTypeFlagsColumn   () const { return m_fileTypeFlags    ; }
+    const std::vector<FileSize>&      getFileSizeColumn        () const { return m_fileSizes        ; }
+    const std::vector<FileTime>&      getTimeCreationColumn    () const { return m_timesCreation    ; }
+    const std::vector<FileTime>&      getTimeLastModifiedColumn() const { return m_timesLastModified; }
+    const std::vector<FileTime>&      getTimeLastAccessColumn  () const { return m_timesLastAccess  ; }
+
+    bool isDirectory(std::size_t idx) const
+    {
+        return (m_fileTypeFlags[idx]&FileTypeFlags::directory)!=0;
+    }
+
+    //! Разворачивает запись в DirectoryEntryInfoT (с копированием строк)
+    EntryType getEntry(std::size_t idx) const
+    {
+        EntryType e;
+        e.fileTypeFlags    = m_fileTypeFlags[idx]    ;
+        e.fileSize         = m_fileSizes[idx]        ;
+        e.timeCreation     = m_timesCreation[idx]    ;
+        e.timeLastModified = m_timesLastModified[idx];
+        e.timeLastAccess   = m_timesLastAccess[idx]  ;
+        e.entryName        = getName(idx);
+        e.entryExt         = getExt(idx);
+        e.path             = *m_pPath;
+        e.validFields      = m_validFields[idx];
+
+        return e;
+    }
+
+    //! Разворачивает весь список в вектор записей
+    void toEntries(std::vector<EntryType> &entries) const
+    {
+        entries.clear();
+        entries.reserve(size());
+        for(std::size_t i=0; i!=size(); ++i)
+        {
+            entries.emplace_back(getEntry(i));
+        }
+    }
+
+    std::vector<EntryType> toEntries() const
+    {
+        std::vector<EntryType> entries;
+        toEntries(entries);
+        return entries;
+    }
+
+    //! Разворачивает записи в порядке перестановки order (результат sort/filter)
+    void toEntries(const IndexVector &order, std::vector<EntryType> &entries) const
+    {
+        entries.clear();
+        entries.reserve(order.size());
+        for(auto idx : order)
+        {
+            entries.emplace_back(getEntry(idx));
+        }
+    }
+
+
+    //------------------------------
+    //! Тождественная перестановка - все записи в исходном порядке
+    IndexVector getIdentityOrder() const
+    {
+        IndexVector order(size());
+        for(std::size_t i=0; i!=order.size(); ++i)
+        {
+            order[i] = i;
+        }
+
+        return order;
+    }
+
+    //! Отбор записей из order по предикату pred(idx), порядок сохраняется
+    template<typename Pred>
+    IndexVector filter(const IndexVector &order, Pred pred) const
+    {
+        IndexVector res;
+        res.reserve(order.size());
+        for(auto idx : order)
+        {
+            if (pred(idx))
+            {
+                res.emplace_back(idx);
+            }
+        }
+
+        return res;
+    }
+
+    //! Отбор по типу - как при перечислении, EnumerateFlags::none - всё
+    IndexVector filterByType(const IndexVector &order, EnumerateFlags enumerateFlags) const
+    {
+        const bool bAll   = (enumerateFlags&EnumerateFlags::enumerateAll)==0;
+        const bool bFiles = bAll || (enumerateFlags&EnumerateFlags::enumerateFiles      )!=0;
+        const bool bDirs  = bAll || (enumerateFlags&EnumerateFlags::enumerateDirectories)!=0;
+
+        return filter(order, [&](std::size_t idx) { return isDirectory(idx) ? bDirs : bFiles; });
+    }
+
+    //! Отбор по размеру, [minSize, maxSize]
+    IndexVector filterBySize(const IndexVector &order, FileSize minSize, FileSize maxSize) const
+    {
+        const FileSize *pSizes = m_fileSizes.data();
+        return filter(order, [&](std::size_t idx) { return pSizes[idx]>=minSize && pSizes[idx]<=maxSize; });
+    }
+
+    //! Отбор по времени последней модификации, [timeFrom, timeTo]
+    IndexVector filterByTimeLastModified(const IndexVector &order, FileTime timeFrom, FileTime timeTo) const
+    {
+        const FileTime *pTimes = m_timesLastModified.data();
+        return filter(order, [&](std::size_t idx) { return pTimes[idx]>=timeFrom && pTimes[idx]<=timeTo; });
+    }
+
+    //! Устойчивая сортировка перестановки order, порядок - как у IFileSystem::compareDirectoryEntries
+    /*! Сортирует DirectoryEntrySorterT - те же ключи, что и у enumerateDirectoryEx.
+        keyMaker(const StringType &name, SortFlags flags) -> std::string - ключ сортировки имени, обычно
+        IFileSystem::getFilenameSortKey той ФС, из которой получен список. Записи не разворачиваются -
+        для построения ключей используется одна временная запись.
+     */
+    template<typename KeyMaker>
+    void sort(IndexVector &order, SortFlags sortFlags, KeyMaker keyMaker) const
+    {
+        EntryType tmp;
+
+        DirectoryEntrySorterT<StringType> sorter(sortFlags);
+        sorter.sortOrder( order, size()
+                        , [&](std::size_t idx) -> const EntryType&
+                          {
+                              tmp.entryName.assign(getNameData(idx), getNameLength(idx));
+                              tmp.entryExt .assign(getExtData(idx) , getExtLength(idx));
+                              tmp.fileTypeFlags    = m_fileTypeFlags[idx]    ;
+                              tmp.fileSize         = m_fileSizes[idx]        ;
+                              tmp.timeCreation     = m_timesCreation[idx]    ;
+                              tmp.timeLastModified = m_timesLastModified[idx];
+                              tmp.timeLastAccess   = m_timesLastAccess[idx]  ;
+                              return tmp;
+                          }
+                        , keyMaker
+                        );
+    }
+
+    //! Устойчиво отсортированная перестановка всех записей
+    template<typename KeyMaker>
+    IndexVector getSortedOrder(SortFlags sortFlags, KeyMaker keyMaker) const
+    {
+        IndexVector order = getIdentityOrder();
+        sort(order, sortFlags, keyMaker);
+        return order;
+    }
+
+}; // class DirectoryListingT
+
+//------------------------------
+typedef DirectoryListingT<std::string>   DirectoryListingA;
+typedef DirectoryListingT<std::wstring>  DirectoryListingW;
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
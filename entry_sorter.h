@@ -0,0 +1,657 @@
+/*! \file
+    \brief Directory entries sorting on precomputed keys, radix sort for fixed-width keys, top-K selection
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//
+#include "parallel_sort.h"
+#include "vfs_types.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Числовое поле записи как беззнаковый ключ с тем же порядком
+template<typename ValueType> inline
+std::uint64_t toOrderedSortKey(ValueType v)
+{
+    std::uint64_t k = (std::uint64_t)v;
+    if (std::is_signed<ValueType>::value)
+    {
+        k ^= (std::uint64_t)1 << 63; // Отрицательные - раньше положительных
+    }
+
+    return k;
+}
+
+//! Сортировка записей каталога по заранее построенным ключам
+/*! Порядок - тот же, что даёт IFileSystem::compareDirectoryEntries (устойчивая сортировка),
+    но ключи строятся один раз на запись, а не на каждое сравнение:
+    - ранг каталог/файл (directoriesFirst/directoriesLast);
+    - ключ расширения и ключ имени - байтовые строки из keyMaker (IFileSystem::getFilenameSortKey),
+      их побайтовое сравнение эквивалентно compareFilenames; все ключи лежат в одной арене;
+    - размер и времена - как беззнаковые 64-битные числа (для orderDescending - инвертированные).
+
+    Если числовой ключ не больше одного и сортировки по типу нет, записи сначала сортируются по ключу имени,
+    а затем устойчивой поразрядной (LSD radix) сортировкой по числовому ключу и рангу каталога.
+    Иначе - одна сортировка сравнением с memcmp по ключам.
+
+    Сортировки сравнением для больших списков (от порога, заданного setParallelSort) идут
+    параллельной устойчивой сортировкой слиянием - порядок от этого не меняется.
+ */
+template<typename StringType>
+class DirectoryEntrySorterT
+{
+
+public:
+
+    typedef DirectoryEntryInfoT<StringType>    EntryType;
+    typedef std::vector<std::size_t>           IndexVector;
+
+    //! Меньше записей - поразрядная сортировка не окупается
+    static const std::size_t radixSortThreshold = 256;
+
+    //! Порог параллельной сортировки, который ставят реализации ФС по умолчанию
+    static const std::size_t defaultParallelThreshold = 65536;
+
+
+protected:
+
+    enum NumericKeyIndex
+    {
+        numKeySize = 0,
+        numKeyTimeCreation,
+        numKeyTimeLastModified,
+        numKeyTimeLastAccess,
+        numKeysTotal
+    };
+
+    SortFlags                                   m_sortFlags       = SortFlags::none;
+    bool                                        m_bDescending     = false;
+    bool                                        m_bDirRank        = false;
+    bool                                        m_bByType         = false;
+    std::array<bool, numKeysTotal>              m_numKeyUsed      = {{false, false, false, false}};
+
+    std::string                                 m_keyArena        ; // Ключи имён и расширений
+    std::vector<std::size_t>                    m_nameKeyOffsets  ;
+    std::vector<std::size_t>                    m_nameKeyLens     ;
+    std::vector<std::size_t>                    m_extKeyOffsets   ;
+    std::vector<std::size_t>                    m_extKeyLens      ;
+    std::vector<std::uint8_t>                   m_dirRanks        ;
+    std::array<std::vector<std::uint64_t>, numKeysTotal>  m_numKeys;
+
+    std::size_t                                 m_parallelThreshold = 0; // 0 - не параллелим
+    std::size_t                                 m_maxConcurrency    = 0; // 0 - по числу ядер
+    std::shared_ptr<WorkStealingThreadPool>     m_pPool             ; // Пустой - общий пул по умолчанию
+
+
+    int compareArenaKeys(std::size_t offs1, std::size_t len1, std::size_t offs2, std::size_t len2) const
+    {
+        std::size_t n   = len1<len2 ? len1 : len2;
+        int         res = n ? std::memcmp(m_keyArena.data()+offs1, m_keyArena.data()+offs2, n) : 0;
+        if (res)
+        {
+            return res<0 ? -1 : 1;
+        }
+
+        return len1==len2 ? 0 : (len1<len2 ? -1 : 1);
+    }
+
+    int compareNameKeys(std::size_t i1, std::size_t i2) const
+    {
+        return compareArenaKeys(m_nameKeyOffsets[i1], m_nameKeyLens[i1], m_nameKeyOffsets[i2], m_nameKeyLens[i2]);
+    }
+
+    // Числовые ключи уже инвертированы для orderDescending, ключи строк - нет
+    int compareKeys(std::size_t i1, std::size_t i2) const
+    {
+        if (m_bDirRank && m_dirRanks[i1]!=m_dirRanks[i2])
+        {
+            return m_dirRanks[i1]<m_dirRanks[i2] ? -1 : 1;
+        }
+
+        if (m_bByType)
+        {
+            int cmpRes = compareArenaKeys(m_extKeyOffsets[i1], m_extKeyLens[i1], m_extKeyOffsets[i2], m_extKeyLens[i2]);
+            if (cmpRes)
+            {
+                return m_bDescending ? -cmpRes : cmpRes;
+            }
+        }
+
+        for(std::size_t k=0; k!=numKeysTotal; ++k)
+        {
+            if (m_numKeyUsed[k] && m_numKeys[k][i1]!=m_numKeys[k][i2])
+            {
+                return m_numKeys[k][i1]<m_numKeys[k][i2] ? -1 : 1;
+            }
+        }
+
+        int cmpRes = compareNameKeys(i1, i2);
+        return m_bDescending ? -cmpRes : cmpRes;
+    }
+
+    template<typename Compare>
+    void stableSortOrder(IndexVector &order, Compare comp) const
+    {
+        if (m_parallelThreshold && order.size()>=m_parallelThreshold)
+        {
+            if (m_pPool)
+            {
+                parallelStableSort(order, comp, *m_pPool, m_maxConcurrency);
+            }
+            else
+            {
+                parallelStableSort(order, comp, m_maxConcurrency);
+            }
+        }
+        else
+        {
+            std::stable_sort(order.begin(), order.end(), comp);
+        }
+    }
+
+    template<typename KeyMaker>
+    void appendKey(KeyMaker &keyMaker, const StringType &str, SortFlags flags, std::vector<std::size_t> &offsets, std::vector<std::size_t> &lens)
+    {
+        std::string key = keyMaker(str, flags);
+        offsets.emplace_back(m_keyArena.size());
+        lens   .emplace_back(key.size());
+        m_keyArena.append(key);
+    }
+
+    // getEntry(idx) -> const EntryType& - запись с индексом idx из [0, n)
+    template<typename EntryGetter, typename KeyMaker>
+    void buildKeys(std::size_t n, EntryGetter &getEntry, KeyMaker &keyMaker)
+    {
+        m_keyArena.clear();
+        m_nameKeyOffsets.clear(); m_nameKeyOffsets.reserve(n);
+        m_nameKeyLens   .clear(); m_nameKeyLens   .reserve(n);
+        m_extKeyOffsets .clear();
+        m_extKeyLens    .clear();
+        m_dirRanks      .clear();
+        for(auto &v : m_numKeys)
+        {
+            v.clear();
+        }
+
+        // Флаги для compareFilenames - orderDescending проверяем сами
+        const SortFlags nameFlags = m_sortFlags & ~SortFlags::orderDescending;
+        const SortFlags extFlags  = nameFlags | SortFlags::ignoreCase;
+
+        const std::uint8_t dirRank  = (m_sortFlags&SortFlags::directoriesLast)!=0 ? 1 : 0;
+        const std::uint8_t fileRank = (std::uint8_t)(1 - dirRank);
+
+        if (m_bByType)
+        {
+            m_extKeyOffsets.reserve(n);
+            m_extKeyLens   .reserve(n);
+        }
+
+        if (m_bDirRank)
+        {
+            m_dirRanks.reserve(n);
+        }
+
+        for(std::size_t k=0; k!=numKeysTotal; ++k)
+        {
+            if (m_numKeyUsed[k])
+            {
+                m_numKeys[k].reserve(n);
+            }
+        }
+
+        const std::uint64_t invertMask = m_bDescending ? ~(std::uint64_t)0 : 0;
+
+        for(std::size_t idx=0; idx!=n; ++idx)
+        {
+            const EntryType &e = getEntry(idx);
+
+            appendKey(keyMaker, e.entryName, nameFlags, m_nameKeyOffsets, m_nameKeyLens);
+
+            if (m_bByType)
+            {
+                appendKey(keyMaker, e.entryExt, extFlags, m_extKeyOffsets, m_extKeyLens);
+            }
+
+            if (m_bDirRank)
+            {
+                m_dirRanks.emplace_back((e.fileTypeFlags&FileTypeFlags::directory)!=0 ? dirRank : fileRank);
+            }
+
+            if (m_numKeyUsed[numKeySize            ]) m_numKeys[numKeySize            ].emplace_back(toOrderedSortKey(e.fileSize        ) ^ invertMask);
+            if (m_numKeyUsed[numKeyTimeCreation    ]) m_numKeys[numKeyTimeCreation    ].emplace_back(toOrderedSortKey(e.timeCreation    ) ^ invertMask);
+            if (m_numKeyUsed[numKeyTimeLastModified]) m_numKeys[numKeyTimeLastModified].emplace_back(toOrderedSortKey(e.timeLastModified) ^ invertMask);
+            if (m_numKeyUsed[numKeyTimeLastAccess  ]) m_numKeys[numKeyTimeLastAccess  ].emplace_back(toOrderedSortKey(e.timeLastAccess  ) ^ invertMask);
+        }
+    }
+
+    //! Устойчивая LSD radix сортировка перестановки order по ключам keys[idx], младшие байты - первыми
+    template<typename KeyType>
+    static void radixSort(IndexVector &order, const std::vector<KeyType> &keys)
+    {
+        const std::size_t n = order.size();
+
+        std::vector<KeyType>     curKeys(n);
+        std::vector<KeyType>     tmpKeys(n);
+        IndexVector              tmpOrder(n);
+
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            curKeys[i] = keys[order[i]];
+        }
+
+        for(unsigned shift=0; shift!=sizeof(KeyType)*8; shift+=8)
+        {
+            std::array<std::size_t, 256> counts;
+            counts.fill(0);
+
+            for(std::size_t i=0; i!=n; ++i)
+            {
+                ++counts[(std::size_t)((curKeys[i]>>shift)&0xFF)];
+            }
+
+            if (counts[(std::size_t)((curKeys[0]>>shift)&0xFF)]==n)
+            {
+                continue; // Во всех ключах этот байт одинаковый
+            }
+
+            std::size_t pos = 0;
+            for(auto &c : counts)
+            {
+                std::size_t cnt = c;
+                c    = pos;
+                pos += cnt;
+            }
+
+            for(std::size_t i=0; i!=n; ++i)
+            {
+                std::size_t dst = counts[(std::size_t)((curKeys[i]>>shift)&0xFF)]++;
+                tmpKeys [dst] = curKeys[i];
+                tmpOrder[dst] = order[i];
+            }
+
+            curKeys.swap(tmpKeys);
+            order  .swap(tmpOrder);
+        }
+    }
+
+
+public:
+
+    explicit DirectoryEntrySorterT(SortFlags sortFlags)
+    : m_sortFlags(sortFlags)
+    , m_bDescending((sortFlags&SortFlags::orderDescending)!=0)
+    , m_bDirRank((sortFlags&(SortFlags::directoriesFirst|SortFlags::directoriesLast))!=0)
+    , m_bByType((sortFlags&SortFlags::byType)!=0)
+    {
+        m_numKeyUsed[numKeySize            ] = (sortFlags&SortFlags::bySize            )!=0;
+        m_numKeyUsed[numKeyTimeCreation    ] = (sortFlags&SortFlags::byTimeCreation    )!=0;
+        m_numKeyUsed[numKeyTimeLastModified] = (sortFlags&SortFlags::byTimeLastModified)!=0;
+        m_numKeyUsed[numKeyTimeLastAccess  ] = (sortFlags&SortFlags::byTimeLastAccess  )!=0;
+    }
+
+    //! Списки от threshold записей сортируются параллельно (threshold==0 - никогда), maxConcurrency==0 - по числу ядер
+    /*! pPool - пул, в котором идёт сортировка (обычно пул рабочих потоков ФС), пустой - общий пул по умолчанию
+     */
+    void setParallelSort(std::size_t threshold, std::size_t maxConcurrency = 0, std::shared_ptr<WorkStealingThreadPool> pPool = std::shared_ptr<WorkStealingThreadPool>())
+    {
+        m_parallelThreshold = threshold;
+        m_maxConcurrency    = maxConcurrency;
+        m_pPool             = std::move(pPool);
+    }
+
+    //! Устойчиво сортирует перестановку order (все или часть индексов из [0, n)) по записям getEntry(idx)
+    /*! getEntry(idx) -> const EntryType& - запись с индексом idx; ссылка нужна только до следующего вызова,
+        так что источник может заполнять одну и ту же временную запись (см. DirectoryListingT::sort).
+        keyMaker(const StringType &name, SortFlags flags) -> std::string - ключ сортировки имени
+     */
+    template<typename EntryGetter, typename KeyMaker>
+    void sortOrder(IndexVector &order, std::size_t n, EntryGetter getEntry, KeyMaker keyMaker)
+    {
+        if (order.size()<2)
+        {
+            return;
+        }
+
+        buildKeys(n, getEntry, keyMaker);
+
+        std::size_t numKeysCount = 0;
+        std::size_t numKeyIdx    = 0;
+        for(std::size_t k=0; k!=numKeysTotal; ++k)
+        {
+            if (m_numKeyUsed[k])
+            {
+                ++numKeysCount;
+                numKeyIdx = k;
+            }
+        }
+
+        if (!m_bByType && numKeysCount<=1 && order.size()>=radixSortThreshold)
+        {
+            // Младший ключ - имя, сравнением; старшие - поразрядно, устойчиво
+            stableSortOrder( order
+                           , [&](std::size_t i1, std::size_t i2)
+                             {
+                                 int cmpRes = compareNameKeys(i1, i2);
+                                 return m_bDescending ? cmpRes>0 : cmpRes<0;
+                             }
+                           );
+
+            if (numKeysCount)
+            {
+                radixSort(order, m_numKeys[numKeyIdx]);
+            }
+
+            if (m_bDirRank)
+            {
+                radixSort(order, m_dirRanks);
+            }
+
+            return;
+        }
+
+        stableSortOrder( order
+                       , [&](std::size_t i1, std::size_t i2)
+                         {
+                             return compareKeys(i1, i2)<0;
+                         }
+                       );
+    }
+
+    //! Возвращает перестановку - order[i] - индекс записи, которая должна стоять на i-м месте
+    /*! keyMaker(const StringType &name, SortFlags flags) -> std::string - ключ сортировки имени
+     */
+    template<typename KeyMaker>
+    IndexVector getSortedOrder(const std::vector<EntryType> &entries, KeyMaker keyMaker)
+    {
+        const std::size_t n = entries.size();
+
+        IndexVector order(n);
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            order[i] = i;
+        }
+
+        sortOrder(order, n, [&](std::size_t idx) -> const EntryType& { return entries[idx]; }, keyMaker);
+
+        return order;
+    }
+
+    //! Сортирует записи на месте
+    template<typename KeyMaker>
+    void sort(std::vector<EntryType> &entries, KeyMaker keyMaker)
+    {
+        if (entries.size()<2)
+        {
+            return;
+        }
+
+        IndexVector order = getSortedOrder(entries, keyMaker);
+
+        std::vector<EntryType> sorted;
+        sorted.reserve(entries.size());
+        for(auto idx : order)
+        {
+            sorted.emplace_back(std::move(entries[idx]));
+        }
+
+        entries.swap(sorted);
+    }
+
+}; // class DirectoryEntrySorterT
+
+
+//! Отбор записей [offset, offset+limit) из отсортированного (как у DirectoryEntrySorterT) списка без сортировки всего списка
+/*! Записи подаются по одной (push), в памяти держится куча не более чем из offset+limit записей
+    с их ключами, в вершине - худшая. Новая запись сначала сравнивается с худшей по рангу каталога
+    и числовым ключам - ключи имён (keyMaker) строятся, только если так решить не удалось.
+    Равные записи упорядочиваются по порядку поступления, так что результат совпадает с соответствующим
+    куском устойчиво отсортированного полного списка. O(n log k) по времени и O(k) по памяти.
+ */
+template<typename StringType>
+class DirectoryEntryTopSelectorT
+{
+
+public:
+
+    typedef DirectoryEntryInfoT<StringType>    EntryType;
+
+
+protected:
+
+    enum NumericKeyIndex
+    {
+        numKeySize = 0,
+        numKeyTimeCreation,
+        numKeyTimeLastModified,
+        numKeyTimeLastAccess,
+        numKeysTotal
+    };
+
+    struct Item
+    {
+        EntryType                                   entry   ;
+        std::string                                 nameKey ;
+        std::string                                 extKey  ;
+        std::uint8_t                                dirRank = 0;
+        std::array<std::uint64_t, numKeysTotal>     numKeys = {{0, 0, 0, 0}};
+        std::size_t                                 seq     = 0; // Порядковый номер поступления
+    };
+
+    SortFlags                                   m_sortFlags       = SortFlags::none;
+    bool                                        m_bDescending     = false;
+    bool                                        m_bDirRank        = false;
+    bool                                        m_bByType         = false;
+    std::array<bool, numKeysTotal>              m_numKeyUsed      = {{false, false, false, false}};
+
+    std::size_t                                 m_offset          = 0;
+    std::size_t                                 m_capacity        = 0; // offset+limit
+    std::size_t                                 m_seq             = 0;
+
+    std::vector<Item>                           m_heap            ;
+    Item                                        m_candidate       ; // Буферы ключей переиспользуются между push
+
+
+    static int compareStrKeys(const std::string &k1, const std::string &k2)
+    {
+        int res = k1.compare(k2); // Побайтово, как memcmp, при равенстве - короче меньше
+        return res<0 ? -1 : (res>0 ? 1 : 0);
+    }
+
+    //! Сравнение по рангу каталога и числовым ключам (если они в порядке сравнения идут до строковых)
+    int comparePrefix(const Item &i1, const Item &i2) const
+    {
+        if (m_bDirRank && i1.dirRank!=i2.dirRank)
+        {
+            return i1.dirRank<i2.dirRank ? -1 : 1;
+        }
+
+        if (m_bByType)
+        {
+            return 0; // Дальше - расширение
+        }
+
+        for(std::size_t k=0; k!=numKeysTotal; ++k)
+        {
+            if (m_numKeyUsed[k] && i1.numKeys[k]!=i2.numKeys[k])
+            {
+                return i1.numKeys[k]<i2.numKeys[k] ? -1 : 1;
+            }
+        }
+
+        return 0;
+    }
+
+    //! Полное сравнение без учёта порядка поступления. Числовые ключи уже инвертированы для orderDescending, ключи строк - нет
+    int compareKeys(const Item &i1, const Item &i2) const
+    {
+        if (m_bDirRank && i1.dirRank!=i2.dirRank)
+        {
+            return i1.dirRank<i2.dirRank ? -1 : 1;
+        }
+
+        if (m_bByType)
+        {
+            int cmpRes = compareStrKeys(i1.extKey, i2.extKey);
+            if (cmpRes)
+            {
+                return m_bDescending ? -cmpRes : cmpRes;
+            }
+        }
+
+        for(std::size_t k=0; k!=numKeysTotal; ++k)
+        {
+            if (m_numKeyUsed[k] && i1.numKeys[k]!=i2.numKeys[k])
+            {
+                return i1.numKeys[k]<i2.numKeys[k] ? -1 : 1;
+            }
+        }
+
+        int cmpRes = compareStrKeys(i1.nameKey, i2.nameKey);
+        return m_bDescending ? -cmpRes : cmpRes;
+    }
+
+    bool lessItems(const Item &i1, const Item &i2) const
+    {
+        int cmpRes = compareKeys(i1, i2);
+        return cmpRes ? cmpRes<0 : i1.seq<i2.seq;
+    }
+
+    void fillNumericKeys(Item &item, const EntryType &e) const
+    {
+        const std::uint64_t invertMask = m_bDescending ? ~(std::uint64_t)0 : 0;
+
+        if (m_bDirRank)
+        {
+            const std::uint8_t dirRank  = (m_sortFlags&SortFlags::directoriesLast)!=0 ? 1 : 0;
+            item.dirRank = (e.fileTypeFlags&FileTypeFlags::directory)!=0 ? dirRank : (std::uint8_t)(1 - dirRank);
+        }
+
+        if (m_numKeyUsed[numKeySize            ]) item.numKeys[numKeySize            ] = toOrderedSortKey(e.fileSize        ) ^ invertMask;
+        if (m_numKeyUsed[numKeyTimeCreation    ]) item.numKeys[numKeyTimeCreation    ] = toOrderedSortKey(e.timeCreation    ) ^ invertMask;
+        if (m_numKeyUsed[numKeyTimeLastModified]) item.numKeys[numKeyTimeLastModified] = toOrderedSortKey(e.timeLastModified) ^ invertMask;
+        if (m_numKeyUsed[numKeyTimeLastAccess  ]) item.numKeys[numKeyTimeLastAccess  ] = toOrderedSortKey(e.timeLastAccess  ) ^ invertMask;
+    }
+
+    template<typename KeyMaker>
+    void fillStringKeys(Item &item, const EntryType &e, KeyMaker &keyMaker) const
+    {
+        // Флаги для compareFilenames - orderDescending проверяем сами
+        const SortFlags nameFlags = m_sortFlags & ~SortFlags::orderDescending;
+
+        item.nameKey = keyMaker(e.entryName, nameFlags);
+
+        if (m_bByType)
+        {
+            item.extKey = keyMaker(e.entryExt, nameFlags | SortFlags::ignoreCase);
+        }
+    }
+
+
+public:
+
+    //! limit==0 - ничего не отбирается
+    DirectoryEntryTopSelectorT(SortFlags sortFlags, std::size_t offset, std::size_t limit)
+    : m_sortFlags(sortFlags)
+    , m_bDescending((sortFlags&SortFlags::orderDescending)!=0)
+    , m_bDirRank((sortFlags&(SortFlags::directoriesFirst|SortFlags::directoriesLast))!=0)
+    , m_bByType((sortFlags&SortFlags::byType)!=0)
+    , m_offset(offset)
+    , m_capacity(limit ? (offset+limit<offset ? (std::size_t)-1 : offset+limit) : 0)
+    {
+        m_numKeyUsed[numKeySize            ] = (sortFlags&SortFlags::bySize            )!=0;
+        m_numKeyUsed[numKeyTimeCreation    ] = (sortFlags&SortFlags::byTimeCreation    )!=0;
+        m_numKeyUsed[numKeyTimeLastModified] = (sortFlags&SortFlags::byTimeLastModified)!=0;
+        m_numKeyUsed[numKeyTimeLastAccess  ] = (sortFlags&SortFlags::byTimeLastAccess  )!=0;
+    }
+
+    //! Предлагает очередную запись. keyMaker - как у DirectoryEntrySorterT::getSortedOrder
+    template<typename KeyMaker>
+    void push(const EntryType &e, KeyMaker &keyMaker)
+    {
+        if (!m_capacity)
+        {
+            return;
+        }
+
+        auto less = [this](const Item &i1, const Item &i2) { return lessItems(i1, i2); };
+
+        Item &cand = m_candidate;
+        cand.seq   = m_seq++;
+        fillNumericKeys(cand, e);
+
+        if (m_heap.size()==m_capacity)
+        {
+            int cmpRes = comparePrefix(cand, m_heap.front());
+            if (cmpRes>0)
+            {
+                return; // Хуже худшей из отобранных, ключи имён не нужны
+            }
+
+            fillStringKeys(cand, e, keyMaker);
+
+            if (!cmpRes && compareKeys(cand, m_heap.front())>=0)
+            {
+                return; // При равенстве выигрывает поступившая раньше
+            }
+
+            std::pop_heap(m_heap.begin(), m_heap.end(), less);
+            std::swap(m_heap.back(), cand);
+        }
+        else
+        {
+            fillStringKeys(cand, e, keyMaker);
+            m_heap.emplace_back();
+            std::swap(m_heap.back(), cand);
+        }
+
+        m_heap.back().entry = e;
+        std::push_heap(m_heap.begin(), m_heap.end(), less);
+    }
+
+    //! Отобранные записи в порядке сортировки, без первых offset. Селектор после этого пуст
+    void getResult(std::vector<EntryType> &entries)
+    {
+        entries.clear();
+
+        std::sort_heap(m_heap.begin(), m_heap.end(), [this](const Item &i1, const Item &i2) { return lessItems(i1, i2); });
+
+        if (m_heap.size()>m_offset)
+        {
+            entries.reserve(m_heap.size()-m_offset);
+            for(std::size_t i=m_offset; i!=m_heap.size(); ++i)
+            {
+                entries.emplace_back(std::move(m_heap[i].entry));
+            }
+        }
+
+        m_heap.clear();
+        m_seq = 0;
+    }
+
+}; // class DirectoryEntryTopSelectorT
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
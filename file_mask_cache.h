@@ -0,0 +1,227 @@
+/*! \file
+    \brief Bounded thread-safe cache of compiled file masks
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+#include "vfs_types.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Кэш скомпилированных масок
+/*! Сборка std::basic_regex - дорогая операция, а одни и те же маски используются постоянно.
+    Ключ - (флаги, маска). Когда кэш заполнен, вытесняется давно не использовавшаяся маска.
+    Маски, которые не удалось скомпилировать, тоже кэшируются - чтобы не пытаться собирать их снова и снова.
+ */
+template<typename StringType>
+class CompiledFileMaskCacheT
+{
+
+public:
+
+    typedef CompiledFileMaskInfoT<StringType>     CompiledFileMaskInfoType;
+    typedef FileMaskInfoT<StringType>             FileMaskInfoType;
+
+
+protected:
+
+    typedef std::pair<FileMaskFlags, StringType>  KeyType;
+    typedef std::list<KeyType>                    LruList;
+
+    struct CacheItem
+    {
+        std::shared_ptr<const CompiledFileMaskInfoType>   pCompiled; // Нулевой - маска корявая
+        typename LruList::iterator                        lruIt    ;
+    };
+
+    mutable std::mutex                  m_mutex    ;
+    std::map<KeyType, CacheItem>        m_items    ;
+    LruList                             m_lru      ; // Начало - самые свежие
+    std::size_t                         m_capacity = 256;
+
+
+    void shrinkToCapacity()
+    {
+        while(m_items.size()>m_capacity && !m_lru.empty())
+        {
+            m_items.erase(m_lru.back());
+            m_lru.pop_back();
+        }
+    }
+
+
+public:
+
+    CompiledFileMaskCacheT() = default;
+
+    explicit CompiledFileMaskCacheT(std::size_t capacity) : m_capacity(capacity) {}
+
+    CompiledFileMaskCacheT(const CompiledFileMaskCacheT &)            = delete;
+    CompiledFileMaskCacheT& operator=(const CompiledFileMaskCacheT &) = delete;
+
+
+    //! Общий для всех кэш
+    static CompiledFileMaskCacheT& instance()
+    {
+        static CompiledFileMaskCacheT cache;
+        return cache;
+    }
+
+    void setCapacity(std::size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = capacity;
+        shrinkToCapacity();
+    }
+
+    std::size_t getCapacity() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_capacity;
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_items.clear();
+        m_lru.clear();
+    }
+
+    //! Возвращает скомпилированную маску или нулевой указатель, если маска не компилируется
+    std::shared_ptr<const CompiledFileMaskInfoType> getCompiled(const FileMaskInfoType &mask)
+    {
+        if (mask.fileMaskFlags==FileMaskFlags::invalid)
+        {
+            return std::shared_ptr<const CompiledFileMaskInfoType>();
+        }
+
+        KeyType key = KeyType(mask.fileMaskFlags, mask.mask);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_items.find(key);
+            if (it!=m_items.end())
+            {
+                m_lru.splice(m_lru.begin(), m_lru, it->second.lruIt);
+                return it->second.pCompiled;
+            }
+        }
+
+        // Компилируем без блокировки - это долго
+        std::shared_ptr<const CompiledFileMaskInfoType> pCompiled;
+        try
+        {
+            pCompiled = std::make_shared<const CompiledFileMaskInfoType>(mask.compile());
+        }
+        catch(...)
+        {
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_items.find(key);
+        if (it!=m_items.end()) // Другой поток успел раньше
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruIt);
+            return it->second.pCompiled;
+        }
+
+        if (!m_capacity)
+        {
+            return pCompiled;
+        }
+
+        m_lru.emplace_front(key);
+
+        CacheItem item;
+        item.pCompiled = pCompiled;
+        item.lruIt     = m_lru.begin();
+        m_items.emplace(std::move(key), item);
+
+        shrinkToCapacity();
+
+        return pCompiled;
+    }
+
+    //! Ошибка - ErrorCode::invalidFormat (корявый regex) или ErrorCode::invalidArgument (невалидные флаги)
+    ErrorCode getCompiled(const FileMaskInfoType &mask, CompiledFileMaskInfoType &compiledMask)
+    {
+        if (mask.fileMaskFlags==FileMaskFlags::invalid)
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        std::shared_ptr<const CompiledFileMaskInfoType> pCompiled = getCompiled(mask);
+        if (!pCompiled)
+        {
+            return ErrorCode::invalidFormat;
+        }
+
+        compiledMask = *pCompiled;
+
+        return ErrorCode::ok;
+    }
+
+}; // class CompiledFileMaskCacheT
+
+//------------------------------
+typedef CompiledFileMaskCacheT<std::string>   CompiledFileMaskCacheA;
+typedef CompiledFileMaskCacheT<std::wstring>  CompiledFileMaskCacheW;
+
+//------------------------------
+//! Компиляция маски через общий кэш
+template<typename StringType> inline
+ErrorCode compileFileMaskCached(const FileMaskInfoT<StringType> &mask, CompiledFileMaskInfoT<StringType> &compiledMask)
+{
+    return CompiledFileMaskCacheT<StringType>::instance().getCompiled(mask, compiledMask);
+}
+
+//------------------------------
+//! Компиляция списка масок через общий кэш, корявые маски пропускаются
+template<typename StringType> inline
+std::vector< CompiledFileMaskInfoT<StringType> > compileFileMasksCached(const std::vector< FileMaskInfoT<StringType> > &masks)
+{
+    std::vector< CompiledFileMaskInfoT<StringType> > compiledMasks;
+    compiledMasks.reserve(masks.size());
+
+    for(const auto &m : masks)
+    {
+        std::shared_ptr<const CompiledFileMaskInfoT<StringType> > pCompiled = CompiledFileMaskCacheT<StringType>::instance().getCompiled(m);
+        if (pCompiled)
+        {
+            compiledMasks.emplace_back(*pCompiled);
+        }
+    }
+
+    return compiledMasks;
+}
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
@@ -0,0 +1,361 @@
+/*! \file
+    \brief Set of file masks matched against a name in one pass
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+#include "file_mask_cache.h"
+#include "vfs_types.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Автомат Ахо-Корасик - поиск всех шаблонов из набора за один проход по строке
+template<typename StringType>
+class AhoCorasickMatcherT
+{
+
+public:
+
+    typedef typename StringType::value_type  CharType;
+
+
+protected:
+
+    struct Node
+    {
+        std::vector< std::pair<CharType, std::uint32_t> >  edges  ; // Отсортированы по символу
+        std::uint32_t                                      fail   = 0;
+        std::vector<std::uint32_t>                         outputs; // Идентификаторы шаблонов, заканчивающихся тут (включая суффиксные)
+    };
+
+    std::vector<Node>   m_nodes;
+
+
+    std::uint32_t findEdge(std::uint32_t nodeIdx, CharType ch) const
+    {
+        const auto &edges = m_nodes[nodeIdx].edges;
+        auto it = std::lower_bound( edges.begin(), edges.end(), ch
+                                  , [](const std::pair<CharType, std::uint32_t> &e, CharType c) { return e.first<c; }
+                                  );
+        return (it!=edges.end() && it->first==ch) ? it->second : 0;
+    }
+
+    std::uint32_t step(std::uint32_t nodeIdx, CharType ch) const
+    {
+        for(;;)
+        {
+            std::uint32_t next = findEdge(nodeIdx, ch);
+            if (next)
+            {
+                return next;
+            }
+
+            if (!nodeIdx)
+            {
+                return 0;
+            }
+
+            nodeIdx = m_nodes[nodeIdx].fail;
+        }
+    }
+
+
+public:
+
+    AhoCorasickMatcherT() : m_nodes(1) {}
+
+    bool empty() const
+    {
+        return m_nodes.size()==1;
+    }
+
+    void addPattern(const StringType &pattern, std::uint32_t id)
+    {
+        std::uint32_t cur = 0;
+        for(auto ch : pattern)
+        {
+            std::uint32_t next = findEdge(cur, ch);
+            if (!next)
+            {
+                next = (std::uint32_t)m_nodes.size();
+                m_nodes.emplace_back();
+
+                auto &edges = m_nodes[cur].edges;
+                auto it = std::lower_bound( edges.begin(), edges.end(), ch
+                                          , [](const std::pair<CharType, std::uint32_t> &e, CharType c) { return e.first<c; }
+                                          );
+                edges.insert(it, std::make_pair(ch, next));
+            }
+
+            cur = next;
+        }
+
+        m_nodes[cur].outputs.emplace_back(id);
+    }
+
+    //! Строит ссылки неудач (обход в ширину)
+    void build()
+    {
+        std::vector<std::uint32_t> queue;
+        queue.reserve(m_nodes.size());
+
+        for(const auto &e : m_nodes[0].edges)
+        {
+            m_nodes[e.second].fail = 0;
+            queue.emplace_back(e.second);
+        }
+
+        for(std::size_t qi=0; qi!=queue.size(); ++qi)
+        {
+            std::uint32_t nodeIdx = queue[qi];
+
+            for(const auto &e : m_nodes[nodeIdx].edges)
+            {
+                std::uint32_t child = e.second;
+                std::uint32_t fail  = step(m_nodes[nodeIdx].fail, e.first);
+                if (fail==child)
+                {
+                    fail = 0;
+                }
+
+                m_nodes[child].fail = fail;
+
+                const auto &failOutputs = m_nodes[fail].outputs;
+                m_nodes[child].outputs.insert(m_nodes[child].outputs.end(), failOutputs.begin(), failOutputs.end());
+
+                queue.emplace_back(child);
+            }
+        }
+    }
+
+    //! Для каждого найденного шаблона вызывает handler(id). Один и тот же id может прийти несколько раз
+    template<typename Handler>
+    void scan(const CharType *pText, std::size_t textLen, Handler handler) const
+    {
+        std::uint32_t cur = 0;
+        for(std::size_t i=0; i!=textLen; ++i)
+        {
+            cur = step(cur, pText[i]);
+            for(auto id : m_nodes[cur].outputs)
+            {
+                handler(id);
+            }
+        }
+    }
+
+}; // class AhoCorasickMatcherT
+
+
+
+//! Набор масок, проверяемый за один проход
+/*! Для каждой простой маски берётся её самый длинный литеральный кусок - без него совпадение невозможно.
+    Куски всех масок объединяются в автомат Ахо-Корасик (отдельно для масок по имени и по расширению).
+    Имя сканируется один раз, маски, чьи куски нашлись (плюс маски без литералов и regex-маски),
+    проверяются полностью в порядке их индексов - так находится первая совпавшая маска.
+ */
+template<typename StringType>
+class CompiledFileMaskSetT
+{
+
+public:
+
+    typedef CompiledFileMaskInfoT<StringType>     CompiledFileMaskInfoType;
+    typedef FileMaskInfoT<StringType>             FileMaskInfoType;
+    typedef DirectoryEntryInfoT<StringType>       DirectoryEntryInfoType;
+
+
+protected:
+
+    typedef std::uint64_t  WordType;
+    static const std::size_t wordBits = 64;
+
+    std::vector< std::shared_ptr<const CompiledFileMaskInfoType> >  m_masks        ; // Нулевой - маска не компилируется
+    std::vector<WordType>                                           m_alwaysCheck  ; // Маски, которые проверяются всегда
+    std::vector<std::uint32_t>                                      m_invalidMasks ; // Индексы корявых масок
+    bool                                                            m_needExt      = false; // Есть маски по расширению
+    AhoCorasickMatcherT<StringType>                                 m_nameMatcher  ;
+    AhoCorasickMatcherT<StringType>                                 m_extMatcher   ;
+
+
+    static void setBit(WordType *pWords, std::size_t idx)
+    {
+        pWords[idx/wordBits] |= (WordType)1 << (idx%wordBits);
+    }
+
+    static unsigned countTrailingZeros(WordType w)
+    {
+    #if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_ctzll(w);
+    #else
+        unsigned n = 0;
+        while((w&1)==0)
+        {
+            w >>= 1;
+            ++n;
+        }
+        return n;
+    #endif
+    }
+
+    void build()
+    {
+        std::size_t nWords = (m_masks.size()+wordBits-1)/wordBits;
+        m_alwaysCheck.assign(nWords, 0);
+        m_invalidMasks.clear();
+        m_needExt = false;
+
+        for(std::size_t i=0; i!=m_masks.size(); ++i)
+        {
+            const auto &pMask = m_masks[i];
+            if (!pMask)
+            {
+                m_invalidMasks.emplace_back((std::uint32_t)i);
+                continue;
+            }
+
+            if ((pMask->fileMaskFlags&FileMaskFlags::matchExtOnly)!=0)
+            {
+                m_needExt = true;
+            }
+
+            StringType literal;
+            if (pMask->useSimpleMatcher)
+            {
+                literal = pMask->simpleMatcher.getLongestLiteral();
+            }
+
+            if (literal.empty())
+            {
+                setBit(m_alwaysCheck.data(), i);
+                continue;
+            }
+
+            if ((pMask->fileMaskFlags&FileMaskFlags::matchExtOnly)!=0)
+            {
+                m_extMatcher.addPattern(literal, (std::uint32_t)i);
+            }
+            else
+            {
+                m_nameMatcher.addPattern(literal, (std::uint32_t)i);
+            }
+        }
+
+        m_nameMatcher.build();
+        m_extMatcher.build();
+    }
+
+    int findFirstMatchImpl(const DirectoryEntryInfoType &entry, WordType *pCandidates, std::size_t nWords) const
+    {
+        std::copy(m_alwaysCheck.begin(), m_alwaysCheck.end(), pCandidates);
+
+        m_nameMatcher.scan(entry.entryName.data(), entry.entryName.size(), [&](std::uint32_t id) { setBit(pCandidates, id); });
+        m_extMatcher .scan(entry.entryExt .data(), entry.entryExt .size(), [&](std::uint32_t id) { setBit(pCandidates, id); });
+
+        for(std::size_t w=0; w!=nWords; ++w)
+        {
+            WordType bits = pCandidates[w];
+            while(bits)
+            {
+                std::size_t idx = w*wordBits + countTrailingZeros(bits);
+                bits &= bits-1;
+
+                if (m_masks[idx]->matchEntry(entry))
+                {
+                    return (int)idx + 1;
+                }
+            }
+        }
+
+        return m_invalidMasks.empty() ? 0 : -((int)m_invalidMasks.front() + 1);
+    }
+
+
+public:
+
+    CompiledFileMaskSetT() = default;
+
+    //! Маски компилируются через общий кэш
+    explicit CompiledFileMaskSetT(const std::vector<FileMaskInfoType> &masks)
+    {
+        m_masks.reserve(masks.size());
+        for(const auto &m : masks)
+        {
+            m_masks.emplace_back(CompiledFileMaskCacheT<StringType>::instance().getCompiled(m));
+        }
+
+        build();
+    }
+
+    explicit CompiledFileMaskSetT(const std::vector<CompiledFileMaskInfoType> &compiledMasks)
+    {
+        m_masks.reserve(compiledMasks.size());
+        for(const auto &cm : compiledMasks)
+        {
+            m_masks.emplace_back(std::make_shared<const CompiledFileMaskInfoType>(cm));
+        }
+
+        build();
+    }
+
+    std::size_t size() const
+    {
+        return m_masks.size();
+    }
+
+    bool empty() const
+    {
+        return m_masks.empty();
+    }
+
+    //! Поля записи, по которым проверяются маски
+    EntryFieldFlags getRequiredEntryFields() const
+    {
+        return m_needExt ? (EntryFieldFlags::name|EntryFieldFlags::ext) : EntryFieldFlags::name;
+    }
+
+    //! Возвращает 0, если совпадения не найдено, >0 - индекс (с единицы) первой совпавшей маски,
+    //! <0 - индекс (с единицы) первой маски, которую не удалось скомпилировать, если ни одна маска не совпала
+    int findFirstMatch(const DirectoryEntryInfoType &entry) const
+    {
+        std::size_t nWords = m_alwaysCheck.size();
+
+        // Обычно масок немного - обходимся буфером на стеке
+        std::array<WordType, 8> localWords;
+        if (nWords<=localWords.size())
+        {
+            return findFirstMatchImpl(entry, localWords.data(), nWords);
+        }
+
+        std::vector<WordType> words(nWords);
+        return findFirstMatchImpl(entry, words.data(), nWords);
+    }
+
+}; // class CompiledFileMaskSetT
+
+//------------------------------
+typedef CompiledFileMaskSetT<std::string>   CompiledFileMaskSetA;
+typedef CompiledFileMaskSetT<std::wstring>  CompiledFileMaskSetW;
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
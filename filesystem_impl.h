@@ -10,13 +10,26 @@
 #include "umba/regex_helpers.h"
 
 // 
+#include "entry_sorter.h"
+#include "file_mask_cache.h"
+#include "file_mask_set.h"
 #include "filedata_encoder_impl.h"
 #include "filename_encoder_impl.h"
 #include "i_filesystem.h"
+#include "io_engine.h"
+#include "native_dir_reader.h"
+#include "native_file_handle_impl.h"
+#include "natural_compare.h"
+#include "path_normalizer.h"
+#include "tree_walker.h"
 #include "virtual_fs_impl.h"
+#include "work_stealing_thread_pool.h"
 
 //
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 
 namespace marty_virtual_fs {
@@ -29,6 +42,16 @@ class FileSystemImpl : public         IFileSystem
 
 protected:
 
+    // Движок пакетного ввода/вывода, создаётся при первом использовании
+    mutable std::shared_ptr<IIoEngine>   m_pIoEngine;
+
+    // Пул потоков для readDataFilesParallel, создаётся при первом использовании
+    mutable std::shared_ptr<WorkStealingThreadPool>  m_pWorkerPool;
+
+    // Порог и число потоков параллельной сортировки списков каталогов
+    std::size_t                          m_parallelSortThreshold   = DirectoryEntrySorterT<std::string>::defaultParallelThreshold;
+    std::size_t                          m_parallelSortConcurrency = 0;
+
 public:
 
     FileSystemImpl()                                  = default;
@@ -38,6 +61,71 @@ public:
     FileSystemImpl& operator=(FileSystemImpl &&)      = default;
 
 
+    //! Задаёт движок для readDataFiles/writeDataFiles. Если не задан, то используется createDefaultIoEngine()
+    void setIoEngine(std::shared_ptr<IIoEngine> pIoEngine)
+    {
+        std::atomic_store(&m_pIoEngine, pIoEngine);
+    }
+
+    std::shared_ptr<IIoEngine> getIoEngine() const
+    {
+        std::shared_ptr<IIoEngine> pIoEngine = std::atomic_load(&m_pIoEngine);
+        if (pIoEngine)
+        {
+            return pIoEngine;
+        }
+
+        std::shared_ptr<IIoEngine> pNewIoEngine = createDefaultIoEngine();
+        if (std::atomic_compare_exchange_strong(&m_pIoEngine, &pIoEngine, pNewIoEngine))
+        {
+            return pNewIoEngine;
+        }
+
+        return pIoEngine; // Кто-то успел раньше
+    }
+
+    //! Задаёт пул потоков для readDataFilesParallel, walkTree и параллельной сортировки. Если не задан, то создаётся пул по числу ядер
+    void setWorkerPool(std::shared_ptr<WorkStealingThreadPool> pPool)
+    {
+        std::atomic_store(&m_pWorkerPool, pPool);
+    }
+
+    std::shared_ptr<WorkStealingThreadPool> getWorkerPool() const
+    {
+        std::shared_ptr<WorkStealingThreadPool> pPool = std::atomic_load(&m_pWorkerPool);
+        if (pPool)
+        {
+            return pPool;
+        }
+
+        std::shared_ptr<WorkStealingThreadPool> pNewPool = std::make_shared<WorkStealingThreadPool>();
+        if (std::atomic_compare_exchange_strong(&m_pWorkerPool, &pPool, pNewPool))
+        {
+            return pNewPool;
+        }
+
+        return pPool; // Кто-то успел раньше
+    }
+
+    //! Списки от threshold записей enumerateDirectoryEx сортирует параллельно (0 - всегда в одном потоке).
+    //! maxConcurrency==0 - по числу ядер. Настраивается до начала использования ФС
+    void setParallelSort(std::size_t threshold, std::size_t maxConcurrency = 0)
+    {
+        m_parallelSortThreshold   = threshold;
+        m_parallelSortConcurrency = maxConcurrency;
+    }
+
+    std::size_t getParallelSortThreshold() const
+    {
+        return m_parallelSortThreshold;
+    }
+
+    std::size_t getParallelSortConcurrency() const
+    {
+        return m_parallelSortConcurrency;
+    }
+
+
     // virtual std::string  encodeFilename( const std::wstring &str ) const override
     // virtual std::wstring decodeFilename( const std::string  &str ) const override
 
@@ -130,24 +218,18 @@ protected:
     template<typename StringType>
     StringType normalizeFilenameImpl(StringType fname) const
     {
-        typedef typename StringType::value_type CharType;
-
-        // Хвостовой слэш не должен нас путать, но только если он не единственный символ, а то скушаем корневой слэш
-        if (fname.size()>1)
-        {
-            umba::filename::stripLastPathSep(fname);
-        }
-
-        return umba::filename::makeCanonicalSimple(fname, StringType(1, (CharType)'.'), StringType(2, (CharType)'.'), (CharType)'/');
+        // Разделители, "."/".." (выше корня не поднимаемся) и хвостовой слэш (кроме единственного корневого) -
+        // за один проход, на месте, см. PathNormalizerT
+        normalizePathInPlace(fname);
+        return fname;
     }
 
+    // Путь уже нормализован
     template<typename StringType>
-    bool isVirtualRoot(StringType p) const
+    static bool isNormalizedVirtualRoot(const StringType &p)
     {
         typedef typename StringType::value_type CharType;
 
-        p = normalizeFilenameImpl(p);
-
         if (p.empty())
         {
             return true;
@@ -162,24 +244,82 @@ protected:
     }
 
 
+    // Нормализация, поиск точки монтирования и построение родного пути - один раз на путь.
+    // Путь нормализуется прямо из [pPath, pPath+len) во внутренний буфер нормализатора, без промежуточных строк.
+    // bKeepVirtualPath==false - разовое разрешение внутри операции над путём-строкой: нормализованный
+    // виртуальный путь не сохраняется, и память выделяется только под родной путь
+    template<typename CharType>
+    ErrorCode resolvePathImpl(const CharType *pPath, std::size_t len, ResolvedPathT< std::basic_string<CharType> > &resolvedPath, bool bKeepVirtualPath) const
+    {
+        typedef std::basic_string<CharType>                           StringType;
+        typedef typename ResolvedPathT<StringType>::NativeStringType  NativeStringType;
+
+        resolvedPath = ResolvedPathT<StringType>();
+
+        PathNormalizerT<CharType> vpNormalizer;
+        vpNormalizer.normalize(pPath, len);
+
+        NativeStringType nativePath;
+        bool bVirtualRoot = vpNormalizer.isRoot();
+        if (!bVirtualRoot)
+        {
+            ErrorCode err = mapNormalizedVirtualPathImpl(vpNormalizer, nativePath);
+            if (err!=ErrorCode::ok)
+            {
+                return err;
+            }
+        }
+
+        resolvedPath.assign( this, getMountGeneration()
+                           , bKeepVirtualPath ? vpNormalizer.template str<StringType>() : StringType()
+                           , std::move(nativePath), bVirtualRoot
+                           );
+
+        return ErrorCode::ok;
+    }
+
+    //! Для resolvePath - виртуальный путь сохраняется в ResolvedPath
+    template<typename StringType>
+    ErrorCode resolvePathImpl(const StringType &vPath, ResolvedPathT< std::basic_string<typename StringType::value_type> > &resolvedPath) const
+    {
+        return resolvePathImpl(vPath.data(), vPath.size(), resolvedPath, true);
+    }
+
+    //! Разовое разрешение пути внутри операции. StringType - std::basic_string или (C++17) std::basic_string_view
     template<typename StringType>
-    ErrorCode readDataFileImpl2(StringType fName, std::vector<std::uint8_t> &fData) const
+    ErrorCode resolvePathTransientImpl(const StringType &vPath, ResolvedPathT< std::basic_string<typename StringType::value_type> > &resolvedPath) const
     {
-        fName = normalizeFilenameImpl(fName);
+        return resolvePathImpl(vPath.data(), vPath.size(), resolvedPath, false);
+    }
 
-        if (isVirtualRoot(fName))
+    // Разрешённый путь должен быть получен от этой ФС, и таблица монтирования с тех пор не должна меняться
+    template<typename StringType>
+    ErrorCode checkResolvedPathImpl(const ResolvedPathT<StringType> &resolvedPath) const
+    {
+        if (!resolvedPath.isResolvedBy(this, getMountGeneration()))
         {
-            return ErrorCode::notFound;
+            return ErrorCode::invalidMountPoint;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        return ErrorCode::ok;
+    }
+
+
+    template<typename StringType>
+    ErrorCode readDataFileImpl2(const ResolvedPathT<StringType> &resolvedPath, std::vector<std::uint8_t> &fData) const
+    {
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        if (!umba::filesys::readFile(nativePath, fData))
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
+
+        if (!umba::filesys::readFile(resolvedPath.getNativePath(), fData))
         {
             return ErrorCode::genericError;
         }
@@ -187,26 +327,36 @@ protected:
         return ErrorCode::ok;
     }
 
-
     template<typename StringType>
-    ErrorCode readTextFileImpl2(StringType fName, std::wstring &fText) const
+    ErrorCode readDataFileImpl2(const StringType &fName, std::vector<std::uint8_t> &fData) const
     {
-        fName = normalizeFilenameImpl(fName);
-
-        if (isVirtualRoot(fName))
+        ResolvedPathT< std::basic_string<typename StringType::value_type> > resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            return ErrorCode::notFound;
+            return err;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        return readDataFileImpl2(resolvedPath, fData);
+    }
+
+
+    template<typename StringType>
+    ErrorCode readTextFileImpl2(const ResolvedPathT<StringType> &resolvedPath, std::wstring &fText) const
+    {
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
+
         std::string tmpStr;
-        if (!umba::filesys::readFile(nativePath, tmpStr))
+        if (!umba::filesys::readFile(resolvedPath.getNativePath(), tmpStr))
         {
             return ErrorCode::genericError;
         }
@@ -217,7 +367,21 @@ protected:
     }
 
     template<typename StringType>
-    ErrorCode readTextFileImpl2(StringType fName, std::string &fText) const
+    ErrorCode readTextFileImpl2(const StringType &fName, std::wstring &fText) const
+    {
+        ResolvedPathT< std::basic_string<typename StringType::value_type> > resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return readTextFileImpl2(resolvedPath, fText);
+    }
+
+    // fName - виртуальное имя или ResolvedPathT
+    template<typename StringType>
+    ErrorCode readTextFileImpl2(const StringType &fName, std::string &fText) const
     {
         std::wstring wText;
         ErrorCode e = readTextFileImpl2(fName, wText);
@@ -232,27 +396,26 @@ protected:
     }
 
     template<typename StringType>
-    ErrorCode writeTextFileImpl2(StringType fName, const std::string &fText, WriteFileFlags writeFlags) const
+    ErrorCode writeTextFileImpl2(const ResolvedPathT<StringType> &resolvedPath, const std::string &fText, WriteFileFlags writeFlags) const
     {
         if (getVfsGlobalReadonly())
         {
             return ErrorCode::accessDenied;
         }
 
-        fName = normalizeFilenameImpl(fName);
-
-        if (isVirtualRoot(fName))
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            return ErrorCode::notFound;
+            return err;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
-        if (err!=ErrorCode::ok)
+        if (resolvedPath.isVirtualRoot())
         {
-            return err;
+            return ErrorCode::notFound;
         }
 
+        const auto &nativePath = resolvedPath.getNativePath();
+
         if ((writeFlags&WriteFileFlags::forceCreateDir)!=0)
         {
             auto path = umba::filename::getPath(nativePath);
@@ -270,33 +433,51 @@ protected:
     }
 
     template<typename StringType>
-    ErrorCode writeTextFileImpl2(StringType fName, const std::wstring &fText, WriteFileFlags writeFlags) const
+    ErrorCode writeTextFileImpl2(const StringType &fName, const std::string &fText, WriteFileFlags writeFlags) const
+    {
+        if (getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        ResolvedPathT< std::basic_string<typename StringType::value_type> > resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return writeTextFileImpl2(resolvedPath, fText, writeFlags);
+    }
+
+    // fName - виртуальное имя или ResolvedPathT
+    template<typename StringType>
+    ErrorCode writeTextFileImpl2(const StringType &fName, const std::wstring &fText, WriteFileFlags writeFlags) const
     {
-        return writeTextFileImpl(fName, encodeText(fText), writeFlags);
+        return writeTextFileImpl2(fName, encodeText(fText), writeFlags);
     }
 
     template<typename StringType>
-    ErrorCode writeDataFileImpl2(StringType fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
+    ErrorCode writeDataFileImpl2(const ResolvedPathT<StringType> &resolvedPath, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
     {
         if (getVfsGlobalReadonly())
         {
             return ErrorCode::accessDenied;
         }
 
-        fName = normalizeFilenameImpl(fName);
-
-        if (isVirtualRoot(fName))
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            return ErrorCode::notFound;
+            return err;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
-        if (err!=ErrorCode::ok)
+        if (resolvedPath.isVirtualRoot())
         {
-            return err;
+            return ErrorCode::notFound;
         }
 
+        const auto &nativePath = resolvedPath.getNativePath();
+
         if ((writeFlags&WriteFileFlags::forceCreateDir)!=0)
         {
             auto path = umba::filename::getPath(nativePath);
@@ -324,230 +505,825 @@ protected:
         return ErrorCode::ok;
     }
 
+    template<typename StringType>
+    ErrorCode writeDataFileImpl2(const StringType &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
+    {
+        if (getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
 
-#if defined(WIN32) || defined(_WIN32)
+        ResolvedPathT< std::basic_string<typename StringType::value_type> > resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-    // Под виндой юникодное апи первично
+        return writeDataFileImpl2(resolvedPath, fData, writeFlags);
+    }
 
-    ErrorCode enumerateNativeDirectoryImpl(const std::wstring &vPath, const std::wstring &path, std::vector< DirectoryEntryInfoW > &entries) const
+    template<typename StringType>
+    bool isFileExistAndReadableImpl(const ResolvedPathT<StringType> &resolvedPath) const
     {
-        if (!umba::filesys::enumerateDirectory( path
-                                              , [&](const std::wstring &name, const umba::filesys::FileStat &fileStat)
-                                                {
-                                                    DirectoryEntryInfoW e;
-                                                    e.entryName     = name;
-                                                    e.entryExt      = getExt(name);
-                                                    e.path          = vPath;
-                                                    fillDirectoryEntryInfoFromUmbaFilesysFileStat(fileStat, e);
-                                                    entries.emplace_back(e);
-                                                    return true;
-                                                }
-                                              )
-           )
+        if (checkResolvedPathImpl(resolvedPath)!=ErrorCode::ok || resolvedPath.isVirtualRoot())
         {
-            return ErrorCode::genericError;
+            return false;
         }
 
-        return ErrorCode::ok;
+        return umba::filesys::isFileReadable(resolvedPath.getNativePath());
     }
 
-    ErrorCode enumerateNativeDirectoryImpl(const std::string &vPath, const std::string &path, std::vector< DirectoryEntryInfoA > &entries) const
+    template<typename StringType>
+    bool isDirectoryImpl(const ResolvedPathT<StringType> &resolvedPath) const
     {
-        std::vector< DirectoryEntryInfoW > entriesW;
-        ErrorCode e = enumerateNativeDirectoryImpl(decodeFilename(vPath), decodeFilename(path), entriesW);
-        if (e!=ErrorCode::ok)
+        if (checkResolvedPathImpl(resolvedPath)!=ErrorCode::ok)
         {
-            return e;
+            return false;
         }
 
-        for(const auto& ew: entriesW)
+        if (resolvedPath.isVirtualRoot())
         {
-            DirectoryEntryInfoA ea = fromOppositeDirectoryEntryInfo(ew);
-            ea.entryName           = encodeFilename(ew.entryName);
-            ea.entryExt            = encodeFilename(ew.entryExt);
-            ea.path                = encodeFilename(ew.path);
-            entries.emplace_back(ea);
+            return true;
         }
 
-        return e;
+        return umba::filesys::isPathDirectory(resolvedPath.getNativePath());
     }
 
-    bool isFileExistAndReadableImpl(std::wstring fName) const
+    template<typename StringType>
+    ErrorCode createDirectoryImpl(const ResolvedPathT<StringType> &resolvedPath, bool bForce) const
     {
-        fName = normalizeFilenameImpl(fName);
-
-        if (isVirtualRoot(fName))
+        if (getVfsGlobalReadonly())
         {
-            return false;
+            return ErrorCode::accessDenied;
         }
 
-        std::wstring nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
         if (err!=ErrorCode::ok)
         {
-            return false;
+            return err;
         }
 
-        return umba::filesys::isFileReadable(nativePath);
-    }
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::accessDenied;
+        }
 
-    bool isFileExistAndReadableImpl(std::string fName) const
-    {
-        return isFileExistAndReadableImpl(decodeFilename(fName));
+        return umba::filesys::createDirectoryEx(resolvedPath.getNativePath(), bForce) ? ErrorCode::ok : ErrorCode::accessDenied;
     }
 
-    bool isDirectoryImpl(std::wstring dName) const
+    // Открывает нативный файл по разрешённому пути
+    template<typename StringType>
+    ErrorCode openNativeFileImpl(const ResolvedPathT<StringType> &resolvedPath, OpenMode openMode, NativeFileHandleImpl &nativeFileHandle) const
     {
-        dName = normalizeFilenameImpl(dName);
-
-        if (isVirtualRoot(dName))
+        if ((openMode&(OpenMode::write|OpenMode::create|OpenMode::truncate))!=0 && getVfsGlobalReadonly())
         {
-            return true;
+            return ErrorCode::accessDenied;
         }
 
-        std::wstring nativePath;
-        ErrorCode err = toNativePathName(dName, nativePath);
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
         if (err!=ErrorCode::ok)
         {
-            return false;
+            return err;
         }
 
-        return umba::filesys::isPathDirectory(nativePath);
-    }
-
-    bool isDirectoryImpl(std::string dName) const
-    {
-        return isDirectoryImpl(decodeFilename(dName));
-    }
-
-    bool forceCreateDirectory(const std::wstring &dirname) const
-    {
-        return umba::filesys::createDirectoryEx(dirname, true);
-    }
-
-    bool forceCreateDirectory(const std::string &dirname) const
-    {
-        // перекодируем локальным местечковым энкодером в юникодное имя
-        return forceCreateDirectory(decodeFilename(dirname));
-    }
-
-    ErrorCode createDirectoryImpl(std::wstring dirPath, bool bForce ) const
-    {
-        if (getVfsGlobalReadonly())
+        if (resolvedPath.isVirtualRoot())
         {
-            return ErrorCode::accessDenied;
+            return ErrorCode::notFound;
         }
 
-        dirPath = normalizeFilenameImpl(dirPath);
+        return nativeFileHandle.open(resolvedPath.getNativePath(), openMode);
+    }
 
-        if (isVirtualRoot(dirPath))
+    // Разрешает виртуальное имя и открывает нативный файл.
+    // Функции ниже, открывающие файл через openNativeFileImpl, принимают и виртуальное имя, и ResolvedPathT
+    template<typename StringType>
+    ErrorCode openNativeFileImpl(const StringType &fName, OpenMode openMode, NativeFileHandleImpl &nativeFileHandle) const
+    {
+        if ((openMode&(OpenMode::write|OpenMode::create|OpenMode::truncate))!=0 && getVfsGlobalReadonly())
         {
             return ErrorCode::accessDenied;
         }
 
-        std::wstring nativePath;
-        ErrorCode err = toNativePathName(dirPath, nativePath);
+        ResolvedPathT< std::basic_string<typename StringType::value_type> > resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(fName, resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        return umba::filesys::createDirectoryEx(nativePath, bForce) ? ErrorCode::ok : ErrorCode::accessDenied;
-    }
-
-    ErrorCode createDirectoryImpl(std::string dirPath, bool bForce ) const
-    {
-        return createDirectoryImpl(decodeFilename(dirPath), bForce);
+        return openNativeFileImpl(resolvedPath, openMode, nativeFileHandle);
     }
 
-
-#else // Generic POSIX - Linups etc
-
-    ErrorCode enumerateNativeDirectoryImpl(const std::string &vPath, const std::string &path, std::vector< DirectoryEntryInfoA > &entries) const
+    template<typename StringType>
+    ErrorCode openFileImpl2(const StringType &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
     {
-        if (!umba::filesys::enumerateDirectory( path
-                                              , [&](const std::string &name, const umba::filesys::FileStat &fileStat)
-                                                {
-                                                    DirectoryEntryInfoA e;
-                                                    e.entryName     = name;
-                                                    e.entryExt      = getExt(name);
-                                                    e.path          = vPath;
-                                                    fillDirectoryEntryInfoFromUmbaFilesysFileStat(fileStat, e);
-                                                    entries.emplace_back(e);
-                                                    return true;
-                                                }
-                                              )
-           )
+        auto pNativeFileHandle = std::make_shared<NativeFileHandleImpl>();
+        ErrorCode err = openNativeFileImpl(fName, openMode, *pNativeFileHandle);
+        if (err!=ErrorCode::ok)
         {
-            return ErrorCode::genericError;
+            return err;
         }
 
+        pFileHandle = pNativeFileHandle;
+
         return ErrorCode::ok;
-    
     }
 
-    ErrorCode enumerateNativeDirectoryImpl(const std::wstring &vPath, const std::wstring &path, std::vector< DirectoryEntryInfoW > &entries) const
+    template<typename StringType>
+    ErrorCode mapDataFileImpl2(const StringType &fName, MappedView &mappedView) const
     {
-        std::vector< DirectoryEntryInfoA > entriesA;
-        ErrorCode e = enumerateNativeDirectoryImpl(decodeFilename(path), entriesA);
-        if (e!=ErrorCode::ok)
-        {
-            return e;
-        }
-
-        for(const auto& ea: entriesA)
+        NativeFileHandleImpl nativeFileHandle;
+        ErrorCode err = openNativeFileImpl(fName, OpenMode::read, nativeFileHandle);
+        if (err!=ErrorCode::ok)
         {
-            DirectoryEntryInfoW ew = fromOppositeDirectoryEntryInfo(ea);
-            ew.entryName           = encodeFilename(ea.entryName);
-            ew.entryExt            = encodeFilename(ea.entryExt);
-            ew.path                = encodeFilename(ea.path);
-            entries.emplace_back(ew);
+            return err;
         }
 
-        return e;
+        return nativeFileHandle.mapView(mappedView);
     }
 
-    bool isFileExistAndReadableImpl(std::string fName) const
+    template<typename StringType>
+    ErrorCode readDataFileImpl2(const StringType &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
     {
-        fName = normalizeFilenameImpl(fName);
-
-        if (isVirtualRoot(fName))
+        if (pDataSize)
         {
-            return false;
+            *pDataSize = 0;
         }
 
-        std::string nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        NativeFileHandleImpl nativeFileHandle;
+        ErrorCode err = openNativeFileImpl(fName, OpenMode::read, nativeFileHandle);
         if (err!=ErrorCode::ok)
         {
-            return false;
+            return err;
         }
 
-        return umba::filesys::isFileReadable(nativePath);
-    }
+        FileSize fileSize = 0;
+        err = nativeFileHandle.getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-    bool isFileExistAndReadableImpl(std::wstring fName) const
+        if (fileSize>(FileSize)bufSize)
+        {
+            // Буфер мал - сообщаем, сколько нужно
+            if (pDataSize)
+            {
+                *pDataSize = fileSize>(FileSize)SIZE_MAX ? SIZE_MAX : (std::size_t)fileSize;
+            }
+
+            return ErrorCode::outOfRange;
+        }
+
+        return nativeFileHandle.readAt(0, pBuf, (std::size_t)fileSize, pDataSize);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileImpl2(const StringType &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
     {
-        return isFileExistAndReadableImpl(encodeFilename(fName));
+        fData.setPool(pPool);
+        fData.setSize(0);
+
+        NativeFileHandleImpl nativeFileHandle;
+        ErrorCode err = openNativeFileImpl(fName, OpenMode::read, nativeFileHandle);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        FileSize fileSize = 0;
+        err = nativeFileHandle.getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (fileSize>(FileSize)SIZE_MAX)
+        {
+            return ErrorCode::outOfRange;
+        }
+
+        std::size_t numRead = 0;
+        err = nativeFileHandle.readAt(0, fData.prepare((std::size_t)fileSize), (std::size_t)fileSize, &numRead);
+        fData.setSize(numRead);
+
+        return err;
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileRangeImpl2(const StringType &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        fData.clear();
+
+        NativeFileHandleImpl nativeFileHandle;
+        ErrorCode err = openNativeFileImpl(fName, OpenMode::read, nativeFileHandle);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        FileSize fileSize = 0;
+        err = nativeFileHandle.getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (offset>=fileSize)
+        {
+            return ErrorCode::ok;
+        }
+
+        if ((FileSize)length>fileSize-offset)
+        {
+            length = (std::size_t)(fileSize-offset);
+        }
+
+        fData.resize(length);
+
+        std::size_t numRead = 0;
+        err = nativeFileHandle.readAt(offset, fData.data(), length, &numRead);
+        fData.resize(numRead);
+
+        return err;
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileRangesImpl2(const StringType &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        rangesData.clear();
+        rangesData.resize(ranges.size());
+
+        if (ranges.empty())
+        {
+            return ErrorCode::ok;
+        }
+
+        NativeFileHandleImpl nativeFileHandle;
+        ErrorCode err = openNativeFileImpl(fName, OpenMode::read, nativeFileHandle);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        FileSize fileSize = 0;
+        err = nativeFileHandle.getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        // Упорядочиваем диапазоны по смещению, исходные не трогаем
+        std::vector<std::size_t> order; order.reserve(ranges.size());
+        for(std::size_t i=0; i!=ranges.size(); ++i)
+        {
+            if (ranges[i].length!=0 && ranges[i].offset<fileSize)
+            {
+                order.emplace_back(i);
+            }
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t i1, std::size_t i2) { return ranges[i1].offset<ranges[i2].offset; });
+
+        auto rangeEnd = [&](std::size_t i)
+        {
+            FileSize e = ranges[i].offset + (FileSize)ranges[i].length;
+            return (e<ranges[i].offset || e>fileSize) ? fileSize : e; // Переполнение или выход за конец файла
+        };
+
+        std::vector<std::uint8_t> groupBuf;
+
+        std::size_t groupFirst = 0;
+        while(groupFirst!=order.size())
+        {
+            // Собираем группу смежных/перекрывающихся диапазонов
+            FileSize    groupStart = ranges[order[groupFirst]].offset;
+            FileSize    groupEnd   = rangeEnd(order[groupFirst]);
+            std::size_t groupLast  = groupFirst+1;
+            for(; groupLast!=order.size() && ranges[order[groupLast]].offset<=groupEnd; ++groupLast)
+            {
+                groupEnd = std::max(groupEnd, rangeEnd(order[groupLast]));
+            }
+
+            if (groupEnd-groupStart>(FileSize)SIZE_MAX)
+            {
+                return ErrorCode::outOfRange;
+            }
+
+            std::size_t groupSize = (std::size_t)(groupEnd-groupStart);
+            std::size_t numRead   = 0;
+
+            if (groupLast-groupFirst==1)
+            {
+                // Одиночный диапазон читаем сразу на место
+                std::vector<std::uint8_t> &fData = rangesData[order[groupFirst]];
+                fData.resize(groupSize);
+                err = nativeFileHandle.readAt(groupStart, fData.data(), groupSize, &numRead);
+                fData.resize(numRead);
+                if (err!=ErrorCode::ok)
+                {
+                    return err;
+                }
+            }
+            else
+            {
+                groupBuf.resize(groupSize);
+                err = nativeFileHandle.readAt(groupStart, groupBuf.data(), groupSize, &numRead);
+                if (err!=ErrorCode::ok)
+                {
+                    return err;
+                }
+
+                for(std::size_t i=groupFirst; i!=groupLast; ++i)
+                {
+                    std::size_t rangeIdx = order[i];
+                    std::size_t b = (std::size_t)(ranges[rangeIdx].offset-groupStart);
+                    std::size_t e = (std::size_t)(rangeEnd(rangeIdx)-groupStart);
+                    b = std::min(b, numRead);
+                    e = std::min(e, numRead);
+                    rangesData[rangeIdx].assign(groupBuf.begin()+(std::ptrdiff_t)b, groupBuf.begin()+(std::ptrdiff_t)e);
+                }
+            }
+
+            groupFirst = groupLast;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    // Первая ошибка из списка или ErrorCode::ok
+    static ErrorCode getFirstError(const std::vector<ErrorCode> &errors)
+    {
+        for(auto err : errors)
+        {
+            if (err!=ErrorCode::ok)
+            {
+                return err;
+            }
+        }
+
+        return ErrorCode::ok;
+    }
+
+    // Для пакетных операций - имена, которые удалось отобразить, и их индексы в исходном списке
+    template<typename StringType>
+    void toNativePathNames(const std::vector<StringType> &fNames, std::vector<StringType> &nativeNames, std::vector<std::size_t> &nativeIdx, std::vector<ErrorCode> &errors) const
+    {
+        nativeNames.clear(); nativeNames.reserve(fNames.size());
+        nativeIdx  .clear(); nativeIdx  .reserve(fNames.size());
+
+        for(std::size_t i=0; i!=fNames.size(); ++i)
+        {
+            StringType fName = normalizeFilenameImpl(fNames[i]);
+
+            if (isNormalizedVirtualRoot(fName))
+            {
+                errors[i] = ErrorCode::notFound;
+                continue;
+            }
+
+            StringType nativePath;
+            errors[i] = toNativePathName(fName, nativePath);
+            if (errors[i]==ErrorCode::ok)
+            {
+                nativeNames.emplace_back(nativePath);
+                nativeIdx  .emplace_back(i);
+            }
+        }
+    }
+
+    // fNames - виртуальные пути. StringType - строка того же типа, что и родные имена (NativePathString),
+    // в родные пути их отображает toNativePathNames
+    template<typename StringType>
+    ErrorCode readDataFilesImpl2(const std::vector<StringType> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const
+    {
+        fData.clear();
+        fData.resize(fNames.size());
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        std::vector<StringType>   nativeNames;
+        std::vector<std::size_t>  nativeIdx  ;
+        toNativePathNames(fNames, nativeNames, nativeIdx, errors);
+
+        std::vector< std::vector<std::uint8_t> > nativeData;
+        std::vector<ErrorCode>                   nativeErrors;
+        getIoEngine()->readFiles(nativeNames, nativeData, nativeErrors);
+
+        for(std::size_t i=0; i!=nativeIdx.size(); ++i)
+        {
+            errors[nativeIdx[i]] = nativeErrors[i];
+            fData [nativeIdx[i]] = std::move(nativeData[i]);
+        }
+
+        return getFirstError(errors);
+    }
+
+    template<typename StringType>
+    ErrorCode writeDataFilesImpl2(const std::vector<StringType> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const
+    {
+        if (fNames.size()!=fData.size())
+        {
+            errors.assign(fNames.size(), ErrorCode::invalidArgument);
+            return ErrorCode::invalidArgument;
+        }
+
+        if (getVfsGlobalReadonly())
+        {
+            errors.assign(fNames.size(), ErrorCode::accessDenied);
+            return fNames.empty() ? ErrorCode::ok : ErrorCode::accessDenied;
+        }
+
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        std::vector<StringType>   nativeNames;
+        std::vector<std::size_t>  nativeIdx  ;
+        toNativePathNames(fNames, nativeNames, nativeIdx, errors);
+
+        if ((writeFlags&WriteFileFlags::forceCreateDir)!=0)
+        {
+            for(const auto &nativePath : nativeNames)
+            {
+                auto path = umba::filename::getPath(nativePath);
+                forceCreateDirectory(path);
+            }
+        }
+
+        // Движку нужен вектор данных, соответствующий вектору имён
+        std::vector< std::vector<std::uint8_t> > nativeDataTmp;
+        const std::vector< std::vector<std::uint8_t> > *pNativeData = &fData;
+        if (nativeIdx.size()!=fNames.size())
+        {
+            nativeDataTmp.reserve(nativeIdx.size());
+            for(auto idx : nativeIdx)
+            {
+                nativeDataTmp.emplace_back(fData[idx]);
+            }
+
+            pNativeData = &nativeDataTmp;
+        }
+
+        std::vector<ErrorCode> nativeErrors;
+        getIoEngine()->writeFiles(nativeNames, *pNativeData, (writeFlags&WriteFileFlags::forceOverwrite)!=0, nativeErrors);
+
+        for(std::size_t i=0; i!=nativeIdx.size(); ++i)
+        {
+            errors[nativeIdx[i]] = nativeErrors[i];
+        }
+
+        return getFirstError(errors);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFilesParallelImpl(const std::vector<StringType> &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackT<StringType> &callback) const
+    {
+        std::vector<ErrorCode> errors(fNames.size(), ErrorCode::ok);
+        std::mutex             callbackMutex; // Файлы читаются параллельно, а callback вызывается по одному, как visitor в walkTree
+
+        auto readOne = [&](std::size_t idx)
+        {
+            std::vector<std::uint8_t> fData;
+            errors[idx] = readDataFileImpl(fNames[idx], fData);
+            if (callback)
+            {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                callback(idx, fNames[idx], errors[idx], fData);
+            }
+        };
+
+        if (maxConcurrency==1 || fNames.size()<=1)
+        {
+            parallelForEachIndex(fNames.size(), 1, readOne); // В вызывающем потоке, пул не нужен
+        }
+        else
+        {
+            parallelForEachIndex(*getWorkerPool(), fNames.size(), maxConcurrency, readOne);
+        }
+
+        return getFirstError(errors);
+    }
+
+
+#if defined(WIN32) || defined(_WIN32)
+
+    // Под виндой юникодное апи первично
+
+    // visitor(entry) вызывается для каждой записи по мере чтения каталога, false - прекратить перечисление.
+    // entryFields - какие поля нужны. Тип, размер и времена FindFirstFile/FindNextFile отдают сразу,
+    // экономим только на расширении и пути
+    template<typename Visitor>
+    ErrorCode enumerateNativeDirectoryImpl(const std::wstring &vPath, const std::wstring &path, Visitor visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
+    {
+        const bool bNeedExt  = (entryFields&EntryFieldFlags::ext )!=0;
+        const bool bNeedPath = (entryFields&EntryFieldFlags::path)!=0;
+        const EntryFieldFlags validFields = (entryFields&(EntryFieldFlags::ext|EntryFieldFlags::path))
+                                          | EntryFieldFlags::name | EntryFieldFlags::type | EntryFieldFlags::size | EntryFieldFlags::times;
+
+        bool bStopped = false;
+
+        if (!umba::filesys::enumerateDirectory( path
+                                              , [&](const std::wstring &name, const umba::filesys::FileStat &fileStat)
+                                                {
+                                                    DirectoryEntryInfoW e;
+                                                    e.entryName     = name;
+                                                    if (bNeedExt)
+                                                    {
+                                                        e.entryExt  = getExt(name);
+                                                    }
+                                                    if (bNeedPath)
+                                                    {
+                                                        e.path      = vPath;
+                                                    }
+                                                    fillDirectoryEntryInfoFromUmbaFilesysFileStat(fileStat, e);
+                                                    e.validFields   = validFields;
+                                                    if (!visitor(e))
+                                                    {
+                                                        bStopped = true;
+                                                        return false;
+                                                    }
+                                                    return true;
+                                                }
+                                              )
+            && !bStopped
+           )
+        {
+            return ErrorCode::genericError;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    template<typename Visitor>
+    ErrorCode enumerateNativeDirectoryImpl(const std::string &vPath, const std::string &path, Visitor visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
+    {
+        return enumerateNativeDirectoryImpl( decodeFilename(vPath), decodeFilename(path)
+                                           , [&](const DirectoryEntryInfoW &ew)
+                                             {
+                                                 DirectoryEntryInfoA ea = fromOppositeDirectoryEntryInfo(ew);
+                                                 ea.entryName           = encodeFilename(ew.entryName);
+                                                 if ((ew.validFields&EntryFieldFlags::ext)!=0)
+                                                 {
+                                                     ea.entryExt        = encodeFilename(ew.entryExt);
+                                                 }
+                                                 if ((ew.validFields&EntryFieldFlags::path)!=0)
+                                                 {
+                                                     ea.path            = vPath;
+                                                 }
+                                                 return visitor(ea);
+                                             }
+                                           , entryFields
+                                           );
+    }
+
+    // Идентификатор каталога для защиты обхода дерева от циклов (FindFirstFile симлинки и junction'ы не помечает)
+    bool getNativeDirectoryId(const std::wstring &path, std::pair<std::uint64_t, std::uint64_t> &id) const
+    {
+        HANDLE hDir = CreateFileW( path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE
+                                 , 0 // lpSecurityAttributes
+                                 , OPEN_EXISTING
+                                 , FILE_FLAG_BACKUP_SEMANTICS // Без него каталог не открыть
+                                 , 0 // hTemplateFile
+                                 );
+        if (hDir==INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        BY_HANDLE_FILE_INFORMATION info;
+        BOOL bOk = GetFileInformationByHandle(hDir, &info);
+        CloseHandle(hDir);
+
+        if (!bOk)
+        {
+            return false;
+        }
+
+        id.first  = (std::uint64_t)info.dwVolumeSerialNumber;
+        id.second = ((std::uint64_t)info.nFileIndexHigh<<32) | (std::uint64_t)info.nFileIndexLow;
+
+        return true;
+    }
+
+    bool getNativeDirectoryId(const std::string &path, std::pair<std::uint64_t, std::uint64_t> &id) const
+    {
+        return getNativeDirectoryId(decodeFilename(path), id);
+    }
+
+    bool isFileExistAndReadableImpl(const std::wstring &fName) const
+    {
+        ResolvedPathT<std::wstring> resolvedPath;
+        if (resolvePathTransientImpl(fName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isFileExistAndReadableImpl(resolvedPath);
+    }
+
+    bool isFileExistAndReadableImpl(std::string fName) const
+    {
+        return isFileExistAndReadableImpl(decodeFilename(fName));
+    }
+
+    bool isDirectoryImpl(const std::wstring &dName) const
+    {
+        ResolvedPathT<std::wstring> resolvedPath;
+        if (resolvePathTransientImpl(dName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isDirectoryImpl(resolvedPath);
     }
 
     bool isDirectoryImpl(std::string dName) const
     {
-        dName = normalizeFilenameImpl(dName);
+        return isDirectoryImpl(decodeFilename(dName));
+    }
+
+    bool forceCreateDirectory(const std::wstring &dirname) const
+    {
+        return umba::filesys::createDirectoryEx(dirname, true);
+    }
+
+    bool forceCreateDirectory(const std::string &dirname) const
+    {
+        // перекодируем локальным местечковым энкодером в юникодное имя
+        return forceCreateDirectory(decodeFilename(dirname));
+    }
 
-        if (isVirtualRoot(dName))
+    ErrorCode createDirectoryImpl(const std::wstring &dirPath, bool bForce ) const
+    {
+        if (getVfsGlobalReadonly())
         {
-            return true;
+            return ErrorCode::accessDenied;
         }
 
-        std::string nativePath;
-        ErrorCode err = toNativePathName(dName, nativePath);
+        ResolvedPathT<std::wstring> resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(dirPath, resolvedPath);
         if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return createDirectoryImpl(resolvedPath, bForce);
+    }
+
+    ErrorCode createDirectoryImpl(std::string dirPath, bool bForce ) const
+    {
+        return createDirectoryImpl(decodeFilename(dirPath), bForce);
+    }
+
+
+#else // Generic POSIX - Linups etc
+
+    // visitor(entry) вызывается для каждой записи по мере чтения каталога, false - прекратить перечисление.
+    // entryFields - какие поля нужны. Без размеров и времён stat делается, только если тип не известен из d_type
+    template<typename Visitor>
+    ErrorCode enumerateNativeDirectoryImpl(const std::string &vPath, const std::string &path, Visitor visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
+    {
+        const bool bNeedExt  = (entryFields&EntryFieldFlags::ext )!=0;
+        const bool bNeedPath = (entryFields&EntryFieldFlags::path)!=0;
+        const EntryFieldFlags requestedFields = (entryFields&(EntryFieldFlags::ext|EntryFieldFlags::path)) | EntryFieldFlags::name;
+
+    #if defined(MARTY_VFS_GETDENTS_AVAILABLE)
+
+        const bool bNeedStat = (entryFields&(EntryFieldFlags::size|EntryFieldFlags::times))!=0;
+        const bool bNeedType = (entryFields&EntryFieldFlags::type)!=0;
+
+        return NativeDirectoryReader::enumerate( path, bNeedStat, bNeedType
+                                               , [&](const char *pName, std::size_t nameLen, FileTypeFlags typeFlags, bool bTypeKnown, const struct stat *pStat)
+                                                 {
+                                                     DirectoryEntryInfoA e;
+                                                     e.entryName     = std::string(pName, nameLen);
+                                                     if (bNeedExt)
+                                                     {
+                                                         e.entryExt  = getExt(e.entryName);
+                                                     }
+                                                     if (bNeedPath)
+                                                     {
+                                                         e.path      = vPath;
+                                                     }
+                                                     e.validFields   = requestedFields;
+                                                     if (bTypeKnown)
+                                                     {
+                                                         e.validFields |= EntryFieldFlags::type;
+                                                     }
+                                                     if (pStat)
+                                                     {
+                                                         NativeDirectoryReader::fillDirectoryEntryInfoFromStat(*pStat, e);
+                                                         e.validFields |= EntryFieldFlags::type | EntryFieldFlags::size | EntryFieldFlags::times;
+                                                     }
+                                                     e.fileTypeFlags = typeFlags; // После stat - чтобы не потерять FileTypeFlags::symlink
+                                                     return visitor(e);
+                                                 }
+                                               );
+
+    #else
+
+        bool bStopped = false;
+
+        if (!umba::filesys::enumerateDirectory( path
+                                              , [&](const std::string &name, const umba::filesys::FileStat &fileStat)
+                                                {
+                                                    DirectoryEntryInfoA e;
+                                                    e.entryName     = name;
+                                                    if (bNeedExt)
+                                                    {
+                                                        e.entryExt  = getExt(name);
+                                                    }
+                                                    if (bNeedPath)
+                                                    {
+                                                        e.path      = vPath;
+                                                    }
+                                                    fillDirectoryEntryInfoFromUmbaFilesysFileStat(fileStat, e);
+                                                    e.validFields   = requestedFields | EntryFieldFlags::type | EntryFieldFlags::size | EntryFieldFlags::times;
+                                                    if (!visitor(e))
+                                                    {
+                                                        bStopped = true;
+                                                        return false;
+                                                    }
+                                                    return true;
+                                                }
+                                              )
+            && !bStopped
+           )
+        {
+            return ErrorCode::genericError;
+        }
+
+        return ErrorCode::ok;
+
+    #endif
+    }
+
+    template<typename Visitor>
+    ErrorCode enumerateNativeDirectoryImpl(const std::wstring &vPath, const std::wstring &path, Visitor visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
+    {
+        return enumerateNativeDirectoryImpl( encodeFilename(vPath), encodeFilename(path)
+                                           , [&](const DirectoryEntryInfoA &ea)
+                                             {
+                                                 DirectoryEntryInfoW ew = fromOppositeDirectoryEntryInfo(ea);
+                                                 ew.entryName           = decodeFilename(ea.entryName);
+                                                 if ((ea.validFields&EntryFieldFlags::ext)!=0)
+                                                 {
+                                                     ew.entryExt        = decodeFilename(ea.entryExt);
+                                                 }
+                                                 if ((ea.validFields&EntryFieldFlags::path)!=0)
+                                                 {
+                                                     ew.path            = vPath;
+                                                 }
+                                                 return visitor(ew);
+                                             }
+                                           , entryFields
+                                           );
+    }
+
+    // Идентификатор каталога для защиты обхода дерева от циклов
+    bool getNativeDirectoryId(const std::string &path, std::pair<std::uint64_t, std::uint64_t> &id) const
+    {
+        struct stat st;
+        if (::stat(path.c_str(), &st)!=0)
+        {
+            return false;
+        }
+
+        id.first  = (std::uint64_t)st.st_dev;
+        id.second = (std::uint64_t)st.st_ino;
+
+        return true;
+    }
+
+    bool getNativeDirectoryId(const std::wstring &path, std::pair<std::uint64_t, std::uint64_t> &id) const
+    {
+        return getNativeDirectoryId(encodeFilename(path), id);
+    }
+
+    bool isFileExistAndReadableImpl(const std::string &fName) const
+    {
+        ResolvedPathT<std::string> resolvedPath;
+        if (resolvePathTransientImpl(fName, resolvedPath)!=ErrorCode::ok)
         {
             return false;
         }
 
-        return umba::filesys::isPathDirectory(nativePath);
+        return isFileExistAndReadableImpl(resolvedPath);
+    }
+
+    bool isFileExistAndReadableImpl(std::wstring fName) const
+    {
+        return isFileExistAndReadableImpl(encodeFilename(fName));
+    }
+
+    bool isDirectoryImpl(const std::string &dName) const
+    {
+        ResolvedPathT<std::string> resolvedPath;
+        if (resolvePathTransientImpl(dName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isDirectoryImpl(resolvedPath);
     }
 
     bool isDirectoryImpl(std::wstring dName) const
@@ -567,28 +1343,21 @@ protected:
         return umba::filesys::createDirectoryEx(dirname, true);
     }
 
-    ErrorCode createDirectoryImpl(std::string dirPath, bool bForce ) const
+    ErrorCode createDirectoryImpl(const std::string &dirPath, bool bForce ) const
     {
         if (getVfsGlobalReadonly())
         {
             return ErrorCode::accessDenied;
         }
 
-        dirPath = normalizeFilenameImpl(dirPath);
-
-        if (isVirtualRoot(dirPath))
-        {
-            return ErrorCode::accessDenied;
-        }
-
-        std::string nativePath;
-        ErrorCode err = toNativePathName(dirPath, nativePath);
+        ResolvedPathT<std::string> resolvedPath;
+        ErrorCode err = resolvePathTransientImpl(dirPath, resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        return umba::filesys::createDirectoryEx(nativePath, bForce) ? ErrorCode::ok : ErrorCode::accessDenied;
+        return createDirectoryImpl(resolvedPath, bForce);
     }
 
     ErrorCode createDirectoryImpl(std::wstring dirPath, bool bForce ) const
@@ -627,6 +1396,99 @@ protected:
         return readDataFileImpl2(decodeFilename(fName), fData);
     }
 
+    ErrorCode readDataFileImpl(const std::wstring &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        return readDataFileImpl2(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFileImpl(const std::string  &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        return readDataFileImpl2(decodeFilename(fName), pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFileImpl(const std::wstring &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        return readDataFileImpl2(fName, pPool, fData);
+    }
+
+    ErrorCode readDataFileImpl(const std::string  &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        return readDataFileImpl2(decodeFilename(fName), pPool, fData);
+    }
+
+    ErrorCode readDataFileRangeImpl(const std::wstring &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileRangeImpl2(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRangeImpl(const std::string  &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileRangeImpl2(decodeFilename(fName), offset, length, fData);
+    }
+
+    ErrorCode readDataFileRangesImpl(const std::wstring &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        return readDataFileRangesImpl2(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFileRangesImpl(const std::string  &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        return readDataFileRangesImpl2(decodeFilename(fName), ranges, rangesData);
+    }
+
+    std::vector<std::wstring> decodeFilenames(const std::vector<std::string> &fNames) const
+    {
+        std::vector<std::wstring> res; res.reserve(fNames.size());
+        for(const auto &fName : fNames)
+        {
+            res.emplace_back(decodeFilename(fName));
+        }
+
+        return res;
+    }
+
+    ErrorCode readDataFilesImpl(const std::vector<std::wstring> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const
+    {
+        return readDataFilesImpl2(fNames, fData, errors);
+    }
+
+    ErrorCode readDataFilesImpl(const std::vector<std::string>  &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const
+    {
+        return readDataFilesImpl2(decodeFilenames(fNames), fData, errors);
+    }
+
+    ErrorCode writeDataFilesImpl(const std::vector<std::wstring> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const
+    {
+        return writeDataFilesImpl2(fNames, fData, writeFlags, errors);
+    }
+
+    ErrorCode writeDataFilesImpl(const std::vector<std::string>  &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const
+    {
+        return writeDataFilesImpl2(decodeFilenames(fNames), fData, writeFlags, errors);
+    }
+
+    //------------------------------
+    ErrorCode openFileImpl(const std::wstring &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        return openFileImpl2(fName, openMode, pFileHandle);
+    }
+
+    ErrorCode openFileImpl(const std::string  &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        return openFileImpl2(decodeFilename(fName), openMode, pFileHandle);
+    }
+
+    //------------------------------
+    ErrorCode mapDataFileImpl(const std::wstring &fName, MappedView &mappedView) const
+    {
+        return mapDataFileImpl2(fName, mappedView);
+    }
+
+    ErrorCode mapDataFileImpl(const std::string  &fName, MappedView &mappedView) const
+    {
+        return mapDataFileImpl2(decodeFilename(fName), mappedView);
+    }
+
     //------------------------------
     
     //------------------------------
@@ -742,9 +1604,8 @@ protected:
     
 
 
-    // https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-comparestringw
-    // https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-comparestringex
-    virtual int compareFilenames(const std::wstring &n1, const std::wstring &n2, SortFlags sortFlags) const override
+    // Флаги для CompareStringW/LCMapStringW
+    static DWORD getCompareStringFlags(SortFlags sortFlags)
     {
         DWORD dwCmpFlags = 0;
 
@@ -773,9 +1634,43 @@ protected:
 
         }
 
-        int cmpRes = ::CompareStringW(LOCALE_USER_DEFAULT, dwCmpFlags, n1.data(), (int)n1.size(), n2.data(), (int)n2.size());
+        return dwCmpFlags;
+    }
+
+    // https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-comparestringw
+    // https://learn.microsoft.com/en-us/windows/win32/api/stringapiset/nf-stringapiset-comparestringex
+    virtual int compareFilenames(const std::wstring &n1, const std::wstring &n2, SortFlags sortFlags) const override
+    {
+        int res = ::CompareStringW(LOCALE_USER_DEFAULT, getCompareStringFlags(sortFlags), n1.data(), (int)n1.size(), n2.data(), (int)n2.size());
+
+        // CompareStringW возвращает CSTR_LESS_THAN/CSTR_EQUAL/CSTR_GREATER_THAN (1/2/3), а не знак
+        int cmpRes = (res==CSTR_LESS_THAN) ? -1 : (res==CSTR_GREATER_THAN ? 1 : 0);
+
+        return compareDescendingChecker(cmpRes, sortFlags);
+    }
+
+    // https://learn.microsoft.com/en-us/windows/win32/api/winnls/nf-winnls-lcmapstringw
+    // Ключи LCMAP_SORTKEY сравниваются побайтово с тем же результатом, что и CompareStringW с теми же флагами
+    virtual std::string getFilenameSortKey(const std::wstring &name, SortFlags sortFlags) const override
+    {
+        DWORD dwMapFlags = LCMAP_SORTKEY | getCompareStringFlags(sortFlags);
+
+        int keySize = ::LCMapStringW(LOCALE_USER_DEFAULT, dwMapFlags, name.data(), (int)name.size(), 0, 0);
+        if (keySize<=0)
+        {
+            return std::string();
+        }
+
+        std::string key((std::size_t)keySize, '\0');
+        keySize = ::LCMapStringW(LOCALE_USER_DEFAULT, dwMapFlags, name.data(), (int)name.size(), (LPWSTR)&key[0], keySize); // Для LCMAP_SORTKEY размер - в байтах
+        key.resize(keySize>0 ? (std::size_t)keySize : 0);
+
+        return key;
+    }
 
-        return compareDescendingChecker(cmpRes, sortFlags); // CSTR_GREATER_THAN case
+    virtual std::string getFilenameSortKey(const std::string  &name, SortFlags sortFlags) const override
+    {
+        return getFilenameSortKey(decodeFilename(name), sortFlags);
     }
 
 
@@ -785,12 +1680,103 @@ protected:
 
     ErrorCode readDataFileImpl(const std::string &fName, std::vector<std::uint8_t> &fData) const
     {
-        return readDataFileImpl2(fName, fData)
+        return readDataFileImpl2(fName, fData);
     }
 
     ErrorCode readDataFileImpl(const std::wstring &fName, std::vector<std::uint8_t> &fData) const
     {
-        return readDataFileImpl2(encodeFilename(fName), fData)
+        return readDataFileImpl2(encodeFilename(fName), fData);
+    }
+
+    ErrorCode readDataFileImpl(const std::string &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        return readDataFileImpl2(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFileImpl(const std::wstring &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        return readDataFileImpl2(encodeFilename(fName), pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFileImpl(const std::string &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        return readDataFileImpl2(fName, pPool, fData);
+    }
+
+    ErrorCode readDataFileImpl(const std::wstring &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        return readDataFileImpl2(encodeFilename(fName), pPool, fData);
+    }
+
+    ErrorCode readDataFileRangeImpl(const std::string &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileRangeImpl2(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRangeImpl(const std::wstring &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileRangeImpl2(encodeFilename(fName), offset, length, fData);
+    }
+
+    ErrorCode readDataFileRangesImpl(const std::string &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        return readDataFileRangesImpl2(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFileRangesImpl(const std::wstring &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        return readDataFileRangesImpl2(encodeFilename(fName), ranges, rangesData);
+    }
+
+    std::vector<std::string> encodeFilenames(const std::vector<std::wstring> &fNames) const
+    {
+        std::vector<std::string> res; res.reserve(fNames.size());
+        for(const auto &fName : fNames)
+        {
+            res.emplace_back(encodeFilename(fName));
+        }
+
+        return res;
+    }
+
+    ErrorCode readDataFilesImpl(const std::vector<std::string> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const
+    {
+        return readDataFilesImpl2(fNames, fData, errors);
+    }
+
+    ErrorCode readDataFilesImpl(const std::vector<std::wstring> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const
+    {
+        return readDataFilesImpl2(encodeFilenames(fNames), fData, errors);
+    }
+
+    ErrorCode writeDataFilesImpl(const std::vector<std::string> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const
+    {
+        return writeDataFilesImpl2(fNames, fData, writeFlags, errors);
+    }
+
+    ErrorCode writeDataFilesImpl(const std::vector<std::wstring> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const
+    {
+        return writeDataFilesImpl2(encodeFilenames(fNames), fData, writeFlags, errors);
+    }
+
+    ErrorCode openFileImpl(const std::string &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        return openFileImpl2(fName, openMode, pFileHandle);
+    }
+
+    ErrorCode openFileImpl(const std::wstring &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        return openFileImpl2(encodeFilename(fName), openMode, pFileHandle);
+    }
+
+    ErrorCode mapDataFileImpl(const std::string &fName, MappedView &mappedView) const
+    {
+        return mapDataFileImpl2(fName, mappedView);
+    }
+
+    ErrorCode mapDataFileImpl(const std::wstring &fName, MappedView &mappedView) const
+    {
+        return mapDataFileImpl2(encodeFilename(fName), mappedView);
     }
 
     ErrorCode readTextFileImpl(const std::string &fName, std::wstring &fText) const
@@ -806,12 +1792,12 @@ protected:
 
     ErrorCode readTextFileImpl(const std::string &fName, std::string &fText) const
     {
-        readTextFileImpl2(fName, fText);
+        return readTextFileImpl2(fName, fText);
     }
 
     ErrorCode readTextFileImpl(const std::wstring &fName, std::string &fText) const
     {
-        readTextFileImpl2(encodeFilename(fName), fText);
+        return readTextFileImpl2(encodeFilename(fName), fText);
     }
 
 
@@ -839,39 +1825,62 @@ protected:
 
     ErrorCode writeDataFileImpl(const std::string  &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
     {
-        return writeTextFileImpl2(fName, fData, writeFlags);
+        return writeDataFileImpl2(fName, fData, writeFlags);
     }
 
     ErrorCode writeDataFileImpl(const std::wstring &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
     {
-        return writeTextFileImpl2(encodeFilename(fName), fData, writeFlags);
+        return writeDataFileImpl2(encodeFilename(fName), fData, writeFlags);
     }
 
     virtual int compareFilenames(const std::string  &n1, const std::string  &n2, SortFlags sortFlags) const override
     {
-        std::string N1 = n1
-        std::string N2 = n2;
+        int cmpRes = 0;
 
         if ((sortFlags&SortFlags::ignoreCase)!=0)
         {
+            std::string N1 = n1;
+            std::string N2 = n2;
             umba::string_plus::toupper(N1);
             umba::string_plus::toupper(N2);
-        }
-
-        // Под линупсом не поддерживается
-        // if ((sortFlags&SortFlags::digitsAsNumber)!=0)
-        // {
-        //     dwCmpFlags |= SORT_DIGITSASNUMBERS;
-        // }
 
-        int cmpRes = N1.compare(N2);
+            cmpRes = (sortFlags&SortFlags::digitsAsNumber)!=0 ? naturalCompare(N1, N2) : N1.compare(N2);
+        }
+        else
+        {
+            cmpRes = (sortFlags&SortFlags::digitsAsNumber)!=0 ? naturalCompare(n1, n2) : n1.compare(n2);
+        }
 
         return compareDescendingChecker(cmpRes, sortFlags);
     }
 
     virtual int compareFilenames(const std::wstring &n1, const std::wstring &n2, SortFlags sortFlags) const override
     {
-        return compareFilenames(encodeFilename(n1), encodeFilename(n1), sortFlags);
+        return compareFilenames(encodeFilename(n1), encodeFilename(n2), sortFlags);
+    }
+
+    // compareFilenames сравнивает std::string::compare - побайтово, так что ключ - само имя,
+    // для digitsAsNumber - ключ естественного порядка (makeNaturalSortKey)
+    virtual std::string getFilenameSortKey(const std::string  &name, SortFlags sortFlags) const override
+    {
+        std::string key = name;
+
+        if ((sortFlags&SortFlags::ignoreCase)!=0)
+        {
+            umba::string_plus::toupper(key);
+        }
+
+        if ((sortFlags&SortFlags::digitsAsNumber)!=0)
+        {
+            return makeNaturalSortKey(key);
+        }
+
+        return key;
+    }
+
+    virtual std::string getFilenameSortKey(const std::wstring &name, SortFlags sortFlags) const override
+    {
+        return getFilenameSortKey(encodeFilename(name), sortFlags);
     }
 
 
@@ -974,14 +1983,14 @@ protected:
     }
 
 
-    template<typename StringType>
-    ErrorCode enumerateDirectoryImpl(StringType dirPath, std::vector< DirectoryEntryInfoT<StringType> > &entries) const
+    //! visitor(entry) вызывается для каждой записи по мере чтения каталога, false - прекратить перечисление
+    //! entryFields - какие поля записей нужны, какие реально заполнены - см. DirectoryEntryInfoT::validFields
+    template<typename StringType, typename Visitor>
+    ErrorCode enumerateDirectoryVisitImpl(StringType dirPath, Visitor visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
     {
-        entries.clear();
-
         dirPath = normalizeFilenameImpl(dirPath);
 
-        if (isVirtualRoot(dirPath)) // Корень
+        if (isNormalizedVirtualRoot(dirPath)) // Корень
         {
             // Перечисляем mount points
 
@@ -990,9 +1999,22 @@ protected:
             {
                 DirectoryEntryInfoT<StringType> dirEntryInfo;
                 dirEntryInfo.entryName     = filenameToStringType<StringType, std::wstring>(mit->second.name);
-                dirEntryInfo.path          = dirPath;
                 dirEntryInfo.fileTypeFlags = mit->second.flags;
-                entries.emplace_back(dirEntryInfo);
+                dirEntryInfo.validFields   = EntryFieldFlags::name | EntryFieldFlags::type;
+                if ((entryFields&EntryFieldFlags::ext)!=0)
+                {
+                    dirEntryInfo.entryExt     = getExt(dirEntryInfo.entryName);
+                    dirEntryInfo.validFields |= EntryFieldFlags::ext;
+                }
+                if ((entryFields&EntryFieldFlags::path)!=0)
+                {
+                    dirEntryInfo.path         = dirPath;
+                    dirEntryInfo.validFields |= EntryFieldFlags::path;
+                }
+                if (!visitor(dirEntryInfo))
+                {
+                    break;
+                }
             }
 
             return ErrorCode::ok;
@@ -1012,114 +2034,344 @@ protected:
         }
 
         // enumerate native directory
-        return enumerateNativeDirectoryImpl(dirPath, nativePath, entries);
+        return enumerateNativeDirectoryImpl(dirPath, nativePath, visitor, entryFields);
 
     }
 
+    template<typename StringType>
+    ErrorCode enumerateDirectoryImpl(const StringType &dirPath, std::vector< DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        entries.clear();
+
+        return enumerateDirectoryVisitImpl( dirPath
+                                          , [&](const DirectoryEntryInfoT<StringType> &e)
+                                            {
+                                                entries.emplace_back(e);
+                                                return true;
+                                            }
+                                          );
+    }
+
+    //! Записи отбираются по типу и маскам сразу по мере чтения каталога
+    //! entryFields - поля, нужные вызывающему, поля для отбора добавляются сами
+    template<typename StringType, typename Visitor>
+    ErrorCode enumerateDirectoryFilteredImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetT<StringType> &maskSet, Visitor visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
+    {
+        entryFields |= maskSet.getRequiredEntryFields() | getEntryFieldsRequiredForTypeFilter(enumerateFlags);
+
+        return enumerateDirectoryVisitImpl( dirPath
+                                          , [&](const DirectoryEntryInfoT<StringType> &e)
+                                            {
+                                                if (!isDirectoryEntryTypeMatch(enumerateFlags, e) || maskSet.findFirstMatch(e)<=0)
+                                                {
+                                                    return true; // Пропускаем
+                                                }
+
+                                                return visitor(e);
+                                            }
+                                          , entryFields
+                                          );
+    }
 
     template<typename StringType>
-    bool testMaskMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const FileMaskInfoT<StringType> &mask) const
+    ErrorCode enumerateDirectoryStreamImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, const DirectoryEntryVisitorT<StringType> &visitor) const
     {
-        if (mask.fileMaskFlags==FileMaskFlags::invalid)
+        if (!visitor)
         {
-            return false;
+            return ErrorCode::invalidArgument;
         }
 
-        try
+        return enumerateDirectoryFilteredImpl(dirPath, enumerateFlags, maskSet, visitor, entryFields);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryStreamImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetT<StringType> &maskSet, const DirectoryEntryVisitorT<StringType> &visitor) const
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, EntryFieldFlags::all, maskSet, visitor);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryStreamImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoT<StringType> > &masks, const DirectoryEntryVisitorT<StringType> &visitor) const
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, EntryFieldFlags::all, CompiledFileMaskSetT<StringType>(masks), visitor);
+    }
+
+    //! Путь каталога - один на весь список, поэтому в записях его не заполняем
+    template<typename StringType>
+    ErrorCode enumerateDirectoryListingImpl(StringType dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, DirectoryListingT<StringType> &listing) const
+    {
+        dirPath = normalizeFilenameImpl(dirPath);
+
+        listing.clear();
+        listing.setPath(dirPath);
+
+        ErrorCode err = enumerateDirectoryFilteredImpl( dirPath, enumerateFlags, maskSet
+                                                      , [&](const DirectoryEntryInfoT<StringType> &e)
+                                                        {
+                                                            listing.append(e);
+                                                            return true;
+                                                        }
+                                                      , entryFields & ~EntryFieldFlags::path
+                                                      );
+        if (err!=ErrorCode::ok)
         {
-            CompiledFileMaskInfoT<StringType>  compiledFileMaskInfo = mask.compileRegex();
-            return umba::regex_helpers::regexMatch( ((compiledFileMaskInfo.fileMaskFlags&FileMaskFlags::matchExtOnly)!=0) ? entry.entryExt : entry.entryName
-                                                  , compiledFileMaskInfo.compiledMask
-                                                  , std::regex_constants::match_default
-                                                  );
+            listing.clear();
         }
-        catch(...)
+
+        return err;
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryListingImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, DirectoryListingT<StringType> &listing) const
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), listing);
+    }
+
+    //! Рекурсивный обход, каталоги читаются параллельно (см. TreeWalkerT)
+    template<typename StringType>
+    ErrorCode walkTreeImpl(StringType rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorT<StringType> &visitor, const WalkTreePrunerT<StringType> &pruner, WalkTreeFlags walkFlags, std::size_t maxConcurrency) const
+    {
+        rootPath = normalizeFilenameImpl(rootPath);
+
+        // Симлинки помечаются только при чтении каталогов через getdents, иначе каталоги проверяем на повтор всегда
+    #if defined(MARTY_VFS_GETDENTS_AVAILABLE)
+        const bool bCheckDirIds = (walkFlags&WalkTreeFlags::followSymlinks)!=0;
+    #else
+        const bool bCheckDirIds = true;
+    #endif
+
+        typename TreeWalkerT<StringType>::DirectoryIdGetterType dirIdGetter;
+        if (bCheckDirIds)
         {
-            return false;
+            dirIdGetter = [this](const StringType &dirPath, typename TreeWalkerT<StringType>::DirectoryId &id)
+                          {
+                              StringType nativePath;
+                              return toNativePathName(dirPath, nativePath)==ErrorCode::ok && getNativeDirectoryId(nativePath, id);
+                          };
         }
 
+        // Имя и тип нужны обходчику всегда (тип - чтобы спускаться в каталоги), остальное - только то, что просили и что нужно маскам
+        const EntryFieldFlags listFields = entryFields | EntryFieldFlags::name | EntryFieldFlags::type | maskSet.getRequiredEntryFields();
+
+        TreeWalkerT<StringType> walker( [this, listFields](const StringType &dirPath, const DirectoryEntryVisitorT<StringType> &dirVisitor)
+                                        {
+                                            return enumerateDirectoryVisitImpl(dirPath, dirVisitor, listFields);
+                                        }
+                                      , enumerateFlags, maskSet, maxDepth, pruner, walkFlags, maxConcurrency, dirIdGetter
+                                      , getWorkerPool()
+                                      );
+
+        return walker.walk(rootPath, visitor);
+    }
+
+    template<typename StringType>
+    ErrorCode walkTreeImpl(const StringType &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, std::size_t maxDepth, const DirectoryEntryVisitorT<StringType> &visitor, const WalkTreePrunerT<StringType> &pruner, WalkTreeFlags walkFlags, std::size_t maxConcurrency) const
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+
+    template<typename StringType>
+    bool testMaskMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const FileMaskInfoT<StringType> &mask) const
+    {
+        // Маски компилируются один раз и берутся из кэша
+        std::shared_ptr<const CompiledFileMaskInfoT<StringType> > pCompiled = CompiledFileMaskCacheT<StringType>::instance().getCompiled(mask);
+        return pCompiled ? pCompiled->matchEntry(entry) : false;
+    }
+
+    template<typename StringType>
+    bool testMaskMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const CompiledFileMaskInfoT<StringType> &mask) const
+    {
+        return mask.matchEntry(entry);
+    }
+
+    template<typename StringType>
+    int testMasksMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const std::vector<FileMaskInfoT<StringType> > &masks) const
+    {
+        return CompiledFileMaskSetT<StringType>(masks).findFirstMatch(entry);
     }
 
+    template<typename StringType>
+    int testMasksMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const CompiledFileMaskSetT<StringType> &maskSet) const
+    {
+        return maskSet.findFirstMatch(entry);
+    }
+
+
+    //! Ключи сортировки строятся один раз на запись (см. DirectoryEntrySorterT), порядок - как у compareDirectoryEntries
+    template<typename StringType>
+    void sortDirectoryEntriesImpl(std::vector<DirectoryEntryInfoT<StringType> > &entries, SortFlags sortFlags) const
+    {
+        DirectoryEntrySorterT<StringType> sorter(sortFlags);
+        if (m_parallelSortThreshold && entries.size()>=m_parallelSortThreshold)
+        {
+            sorter.setParallelSort(m_parallelSortThreshold, m_parallelSortConcurrency, getWorkerPool()); // Пул создаём, только если он нужен
+        }
+        sorter.sort( entries
+                   , [this](const StringType &name, SortFlags flags)
+                     {
+                         return getFilenameSortKey(name, flags);
+                     }
+                   );
+    }
 
     template<typename StringType>
     ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
     {
-        std::vector< DirectoryEntryInfoT<StringType> > entriesTmp;
-        ErrorCode err = enumerateDirectoryImpl(dirPath, entriesTmp);
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, CompiledFileMaskSetT<StringType>(masks), entries);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoT<StringType> > &compiledMasks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, CompiledFileMaskSetT<StringType>(compiledMasks), entries);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const CompiledFileMaskSetT<StringType> &maskSet, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, EntryFieldFlags::all, maskSet, entries);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), entries);
+    }
+
+    // Все маски проверяются за один проход по имени.
+    // Заполняются только запрошенные поля и поля, нужные для отбора и сортировки
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        entries.clear();
+
+        ErrorCode err = enumerateDirectoryFilteredImpl( dirPath, enumerateFlags, maskSet
+                                                      , [&](const DirectoryEntryInfoT<StringType> &e)
+                                                        {
+                                                            entries.emplace_back(e);
+                                                            return true;
+                                                        }
+                                                      , entryFields | getEntryFieldsRequiredForSort(sortFlags)
+                                                      );
         if (err!=ErrorCode::ok)
         {
+            entries.clear();
             return err;
         }
 
-        std::vector< CompiledFileMaskInfoT<StringType> > compiledMasks;
-        for(const auto &m: masks)
+        sortDirectoryEntriesImpl(entries, sortFlags);
+
+        return ErrorCode::ok;
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), offset, limit, entries);
+    }
+
+    // Кусок [offset, offset+limit) отсортированного списка, limit==0 - до конца списка.
+    // При заданном limit полный список не собирается и не сортируется - лучшие offset+limit записей отбираются кучей
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        if (!limit)
         {
-            try
-            {
-                compiledMasks.emplace_back(m.compileRegex());
-            }
-            catch(...)
+            ErrorCode err = enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, entries);
+            if (err!=ErrorCode::ok)
             {
+                return err;
             }
+
+            entries.erase(entries.begin(), entries.begin() + (std::ptrdiff_t)std::min(offset, entries.size()));
+            return ErrorCode::ok;
         }
 
         entries.clear();
 
+        DirectoryEntryTopSelectorT<StringType> selector(sortFlags, offset, limit);
+        auto keyMaker = [this](const StringType &name, SortFlags flags)
+                        {
+                            return getFilenameSortKey(name, flags);
+                        };
+
+        ErrorCode err = enumerateDirectoryFilteredImpl( dirPath, enumerateFlags, maskSet
+                                                      , [&](const DirectoryEntryInfoT<StringType> &e)
+                                                        {
+                                                            selector.push(e, keyMaker);
+                                                            return true;
+                                                        }
+                                                      , entryFields | getEntryFieldsRequiredForSort(sortFlags)
+                                                      );
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        selector.getResult(entries);
+
+        return ErrorCode::ok;
+    }
 
-        for(const auto &e : entriesTmp)
+    template<typename StringType>
+    ErrorCode openDirectoryCursorImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, DirectoryCursorT<StringType> &cursor) const
+    {
+        std::vector<DirectoryEntryInfoT<StringType> > entries;
+        ErrorCode err = enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+        if (err!=ErrorCode::ok)
         {
-            if ((enumerateFlags&EnumerateFlags::enumerateFiles)!=0) // Перечисляем файлы
-            {
-                if ((e.fileTypeFlags&FileTypeFlags::directory)!=0) 
-                {
-                    // Найден каталог - пропускаем
-                    continue;
-                }
-            }
+            return err;
+        }
 
-            if ((enumerateFlags&EnumerateFlags::enumerateDirectories)!=0) // Перечисляем каталоги
-            {
-                if ((e.fileTypeFlags&FileTypeFlags::directory)==0) 
-                {
-                    // Найден файл - пропускаем
-                    continue;
-                }
-            }
+        cursor.open(dirPath, enumerateFlags, sortFlags, masks, std::move(entries));
 
+        return ErrorCode::ok;
+    }
 
-            for(const auto &cm: compiledMasks)
-            {
-                try
-                {
-                    if (umba::regex_helpers::regexMatch( ((cm.fileMaskFlags&FileMaskFlags::matchExtOnly)!=0) ? e.entryExt : e.entryName
-                                                       , cm.compiledMask
-                                                       , std::regex_constants::match_default
-                                                       ))
-                    {
-                        entries.emplace_back(e);
-                        break; // маска сработала, продолжать не нужно
-                    }
-                }
-                catch(...)
-                {
-                }
-            }
+    //! Каталог перечитывается один раз. Записи до сохранённой отбрасываются по мере чтения, сортируется только остаток
+    template<typename StringType>
+    ErrorCode restoreDirectoryCursorImpl(const std::string &state, DirectoryCursorT<StringType> &cursor) const
+    {
+        DirectoryCursorT<StringType> restored;
+        if (!restored.parseState(state))
+        {
+            return ErrorCode::invalidFormat;
+        }
+
+        const SortFlags sortFlags = restored.getSortFlags();
+        auto compare = [this, sortFlags](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2)
+                       {
+                           return compareDirectoryEntriesImpl(e1, e2, sortFlags);
+                       };
+
+        std::vector<DirectoryEntryInfoT<StringType> > entries;
+        ErrorCode err = enumerateDirectoryFilteredImpl( restored.getDirPath(), restored.getEnumerateFlags(), CompiledFileMaskSetT<StringType>(restored.getMasks())
+                                                      , [&](const DirectoryEntryInfoT<StringType> &e)
+                                                        {
+                                                            if (restored.acceptAfterResumeEntry(e, compare))
+                                                            {
+                                                                entries.emplace_back(e);
+                                                            }
+                                                            return true;
+                                                        }
+                                                      );
+        if (err!=ErrorCode::ok)
+        {
+            return err;
         }
-        //entries
 
-        std::stable_sort( entries.begin(), entries.end()
-                        , [&](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2)
-                          {
-                              return compareDirectoryEntries(e1, e2, sortFlags) > 0;
-                          }
-                        );
+        sortDirectoryEntriesImpl(entries, sortFlags);
+        restored.resume(std::move(entries));
+
+        cursor = std::move(restored);
 
         return ErrorCode::ok;
     }
 
 
-    template<typename StringType>
-    std::vector<DirectoryEntryInfoT<StringType> > enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, ErrorCode *pErr = 0) const
+    template<typename StringType, typename MaskInfoType>
+    std::vector<DirectoryEntryInfoT<StringType> > enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<MaskInfoType> &masks, ErrorCode *pErr = 0) const
     {
         std::vector<DirectoryEntryInfoT<StringType> > entries;
 
@@ -1412,6 +2664,76 @@ public:
         return readDataFileImpl(fName, fData);
     }
 
+    ErrorCode readDataFile(const std::string  &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const override
+    {
+        return readDataFileImpl(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFile(const std::wstring &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const override
+    {
+        return readDataFileImpl(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFile(const std::string  &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const override
+    {
+        return readDataFileImpl(fName, pPool, fData);
+    }
+
+    ErrorCode readDataFile(const std::wstring &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const override
+    {
+        return readDataFileImpl(fName, pPool, fData);
+    }
+
+    ErrorCode mapDataFile(const std::string  &fName, MappedView &mappedView) const override
+    {
+        return mapDataFileImpl(fName, mappedView);
+    }
+
+    ErrorCode mapDataFile(const std::wstring &fName, MappedView &mappedView) const override
+    {
+        return mapDataFileImpl(fName, mappedView);
+    }
+
+    ErrorCode readDataFileRange(const std::string  &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileRangeImpl(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRange(const std::wstring &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileRangeImpl(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRanges(const std::string  &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const override
+    {
+        return readDataFileRangesImpl(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFileRanges(const std::wstring &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const override
+    {
+        return readDataFileRangesImpl(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFiles(const std::vector<std::string>  &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const override
+    {
+        return readDataFilesImpl(fNames, fData, errors);
+    }
+
+    ErrorCode readDataFiles(const std::vector<std::wstring> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const override
+    {
+        return readDataFilesImpl(fNames, fData, errors);
+    }
+
+    ErrorCode readDataFilesParallel(const std::vector<std::string>  &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackA &callback) const override
+    {
+        return readDataFilesParallelImpl(fNames, maxConcurrency, callback);
+    }
+
+    ErrorCode readDataFilesParallel(const std::vector<std::wstring> &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackW &callback) const override
+    {
+        return readDataFilesParallelImpl(fNames, maxConcurrency, callback);
+    }
+
 
     ErrorCode writeTextFile(const std::string  &fName, const std::string  &fText, WriteFileFlags writeFlags) const override
     {
@@ -1444,6 +2766,145 @@ public:
         return writeDataFileImpl(fName, fData, writeFlags);
     }
 
+    ErrorCode writeDataFiles(const std::vector<std::string>  &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const override
+    {
+        return writeDataFilesImpl(fNames, fData, writeFlags, errors);
+    }
+
+    ErrorCode writeDataFiles(const std::vector<std::wstring> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const override
+    {
+        return writeDataFilesImpl(fNames, fData, writeFlags, errors);
+    }
+
+
+    ErrorCode openFile(const std::string  &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const override
+    {
+        return openFileImpl(fName, openMode, pFileHandle);
+    }
+
+    ErrorCode openFile(const std::wstring &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const override
+    {
+        return openFileImpl(fName, openMode, pFileHandle);
+    }
+
+
+    // Разрешённые пути.
+    // using - чтобы не были скрыты обёртки IFileSystem для остальных операций с ResolvedPath (и для const char*/const wchar_t*)
+    using IFileSystem::resolvePath;
+    using IFileSystem::isFileExistAndReadable;
+    using IFileSystem::isDirectory;
+    using IFileSystem::createDirectory;
+    using IFileSystem::readTextFile;
+    using IFileSystem::readDataFile;
+    using IFileSystem::mapDataFile;
+    using IFileSystem::readDataFileRange;
+    using IFileSystem::readDataFileRanges;
+    using IFileSystem::writeTextFile;
+    using IFileSystem::writeDataFile;
+    using IFileSystem::openFile;
+
+    ErrorCode checkResolvedPath(const ResolvedPathA &resolvedPath) const override
+    {
+        return checkResolvedPathImpl(resolvedPath);
+    }
+
+    ErrorCode checkResolvedPath(const ResolvedPathW &resolvedPath) const override
+    {
+        return checkResolvedPathImpl(resolvedPath);
+    }
+
+    ErrorCode resolvePath(const std::string  &vPath, ResolvedPathA &resolvedPath) const override
+    {
+        return resolvePathImpl(vPath, resolvedPath);
+    }
+
+    ErrorCode resolvePath(const std::wstring &vPath, ResolvedPathW &resolvedPath) const override
+    {
+        return resolvePathImpl(vPath, resolvedPath);
+    }
+
+    bool isFileExistAndReadable(const ResolvedPathA &fName) const override
+    {
+        return isFileExistAndReadableImpl(fName);
+    }
+
+    bool isFileExistAndReadable(const ResolvedPathW &fName) const override
+    {
+        return isFileExistAndReadableImpl(fName);
+    }
+
+    bool isDirectory(const ResolvedPathA &dName) const override
+    {
+        return isDirectoryImpl(dName);
+    }
+
+    bool isDirectory(const ResolvedPathW &dName) const override
+    {
+        return isDirectoryImpl(dName);
+    }
+
+    ErrorCode readDataFile(const ResolvedPathA &fName, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileImpl2(fName, fData);
+    }
+
+    ErrorCode readDataFile(const ResolvedPathW &fName, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileImpl2(fName, fData);
+    }
+
+    ErrorCode writeDataFile(const ResolvedPathA &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const override
+    {
+        return writeDataFileImpl2(fName, fData, writeFlags);
+    }
+
+    ErrorCode writeDataFile(const ResolvedPathW &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const override
+    {
+        return writeDataFileImpl2(fName, fData, writeFlags);
+    }
+
+
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+    // Пути в виде string_view - разрешаются сразу из переданного диапазона, без копирования в std::string.
+    // Остальные перегрузки для string_view - обёртки IFileSystem
+    // using IFileSystem::mapVirtualPath - чтобы не были скрыты перегрузки IFileSystem для const char*/const wchar_t*
+    using IFileSystem::mapVirtualPath;
+
+    ErrorCode mapVirtualPath(std::string_view  vPath, std::string &realPath) const override
+    {
+        return VirtualFsImpl::mapVirtualPath(vPath, realPath);
+    }
+
+    ErrorCode mapVirtualPath(std::wstring_view vPath, std::wstring &realPath) const override
+    {
+        return VirtualFsImpl::mapVirtualPath(vPath, realPath);
+    }
+
+    bool isFileExistAndReadable(std::string_view  fName) const override
+    {
+        ResolvedPathA resolvedPath;
+        if (resolvePathTransientImpl(fName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isFileExistAndReadableImpl(resolvedPath);
+    }
+
+    bool isFileExistAndReadable(std::wstring_view fName) const override
+    {
+        ResolvedPathW resolvedPath;
+        if (resolvePathTransientImpl(fName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isFileExistAndReadableImpl(resolvedPath);
+    }
+
+#endif // MARTY_VFS_STRING_VIEW_AVAILABLE
+
 
     // std::string formatFiletime<std::string>( filetime_t t, const std::string &fmt )
     // Описание форматной строки тут - https://man7.org/linux/man-pages/man3/strftime.3.html
@@ -1479,10 +2940,9 @@ public:
     }
 
 
-    // Возвращает 0, если совпадения не найдено, >0 - индекс маски, по которой найдено совпадение, <0 - индекс маски, на которой произошла какая-то ошибка (например, корявый regex)
     virtual bool testMaskMatch(const DirectoryEntryInfoA &entry, const FileMaskInfoA &mask) const override
     {
-        return testMaskMatch(entry, mask);
+        return testMaskMatchImpl(entry, mask);
     }
 
     virtual bool testMaskMatch(const DirectoryEntryInfoW &entry, const FileMaskInfoW &mask) const override
@@ -1490,6 +2950,48 @@ public:
         return testMaskMatchImpl(entry, mask);
     }
 
+    virtual bool testMaskMatch(const DirectoryEntryInfoA &entry, const CompiledFileMaskInfoA &mask) const override
+    {
+        return testMaskMatchImpl(entry, mask);
+    }
+
+    virtual bool testMaskMatch(const DirectoryEntryInfoW &entry, const CompiledFileMaskInfoW &mask) const override
+    {
+        return testMaskMatchImpl(entry, mask);
+    }
+
+    // Возвращает 0, если совпадения не найдено, >0 - индекс маски, по которой найдено совпадение, <0 - индекс маски, на которой произошла какая-то ошибка (например, корявый regex)
+    // Индексы считаются с единицы
+    virtual int testMasksMatch(const DirectoryEntryInfoA &entry, const std::vector<FileMaskInfoA> &masks) const override
+    {
+        return testMasksMatchImpl(entry, masks);
+    }
+
+    virtual int testMasksMatch(const DirectoryEntryInfoW &entry, const std::vector<FileMaskInfoW> &masks) const override
+    {
+        return testMasksMatchImpl(entry, masks);
+    }
+
+    virtual int testMasksMatch(const DirectoryEntryInfoA &entry, const CompiledFileMaskSetA &maskSet) const override
+    {
+        return testMasksMatchImpl(entry, maskSet);
+    }
+
+    virtual int testMasksMatch(const DirectoryEntryInfoW &entry, const CompiledFileMaskSetW &maskSet) const override
+    {
+        return testMasksMatchImpl(entry, maskSet);
+    }
+
+    virtual ErrorCode compileFileMask(const FileMaskInfoA &mask, CompiledFileMaskInfoA &compiledMask) const override
+    {
+        return compileFileMaskCached(mask, compiledMask);
+    }
+
+    virtual ErrorCode compileFileMask(const FileMaskInfoW &mask, CompiledFileMaskInfoW &compiledMask) const override
+    {
+        return compileFileMaskCached(mask, compiledMask);
+    }
+
 
     // Нерекурсивный обзор содержимого каталога, расширенная версия
     virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const override
@@ -1513,6 +3015,159 @@ public:
         return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, pErr);
     }
 
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+    }
+
+    virtual std::vector<DirectoryEntryInfoA> enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoA> &masks, ErrorCode *pErr = 0) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, pErr);
+    }
+
+    virtual std::vector<DirectoryEntryInfoW> enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoW> &masks, ErrorCode *pErr = 0) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, pErr);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, offset, limit, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, offset, limit, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, offset, limit, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, offset, limit, entries);
+    }
+
+    // Постраничный обзор каталога через курсор
+    virtual ErrorCode openDirectoryCursor(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, DirectoryCursorA &cursor) const override
+    {
+        return openDirectoryCursorImpl(dirPath, enumerateFlags, sortFlags, masks, cursor);
+    }
+
+    virtual ErrorCode openDirectoryCursor(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoW> &masks, DirectoryCursorW &cursor) const override
+    {
+        return openDirectoryCursorImpl(dirPath, enumerateFlags, sortFlags, masks, cursor);
+    }
+
+    virtual ErrorCode restoreDirectoryCursor(const std::string &state, DirectoryCursorA &cursor) const override
+    {
+        return restoreDirectoryCursorImpl(state, cursor);
+    }
+
+    virtual ErrorCode restoreDirectoryCursor(const std::string &state, DirectoryCursorW &cursor) const override
+    {
+        return restoreDirectoryCursorImpl(state, cursor);
+    }
+
+    // Потоковый нерекурсивный обзор каталога, без сортировки
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoA> &masks, const DirectoryEntryVisitorA &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, masks, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoW> &masks, const DirectoryEntryVisitorW &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, masks, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetA &maskSet, const DirectoryEntryVisitorA &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetW &maskSet, const DirectoryEntryVisitorW &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, const DirectoryEntryVisitorA &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, entryFields, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, const DirectoryEntryVisitorW &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, entryFields, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, DirectoryListingA &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, masks, listing);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, DirectoryListingW &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, masks, listing);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, DirectoryListingA &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, maskSet, listing);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, DirectoryListingW &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, maskSet, listing);
+    }
+
+    // Рекурсивный обход дерева каталогов
+    virtual ErrorCode walkTree(const std::string  &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::size_t maxDepth, const DirectoryEntryVisitorA &visitor, const WalkTreePrunerA &pruner = WalkTreePrunerA(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, masks, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    virtual ErrorCode walkTree(const std::wstring &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::size_t maxDepth, const DirectoryEntryVisitorW &visitor, const WalkTreePrunerW &pruner = WalkTreePrunerW(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, masks, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    virtual ErrorCode walkTree(const std::string  &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorA &visitor, const WalkTreePrunerA &pruner = WalkTreePrunerA(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, maskSet, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    virtual ErrorCode walkTree(const std::wstring &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorW &visitor, const WalkTreePrunerW &pruner = WalkTreePrunerW(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, maskSet, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
 
 
 }; // struct FileSystemImpl
@@ -0,0 +1,59 @@
+/*! \file
+    \brief Interface for opened file access
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//
+#include "vfs_types.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Открытый файл
+/*! Позволяет читать/писать файл частями, не загружая его целиком в память.
+    Позиционные операции (readAt/writeAt) не меняют текущую позицию и могут
+    вызываться из разных потоков одновременно.
+ */
+struct IFileHandle
+{
+    virtual ~IFileHandle() {}
+
+    virtual bool      isOpened() const = 0;
+    virtual OpenMode  getOpenMode() const = 0;
+
+    // Чтение/запись с текущей позиции, текущая позиция сдвигается на количество прочитанных/записанных байт.
+    // Если достигнут конец файла, то возвращается ErrorCode::ok, а *pNumRead меньше bufSize
+    virtual ErrorCode read (void *pBuf, std::size_t bufSize, std::size_t *pNumRead = 0) = 0;
+    virtual ErrorCode write(const void *pData, std::size_t dataSize, std::size_t *pNumWritten = 0) = 0;
+
+    // pread/pwrite
+    virtual ErrorCode readAt (FileSize offset, void *pBuf, std::size_t bufSize, std::size_t *pNumRead = 0) const = 0;
+    virtual ErrorCode writeAt(FileSize offset, const void *pData, std::size_t dataSize, std::size_t *pNumWritten = 0) const = 0;
+
+    virtual ErrorCode seek(FileOffset offset, SeekOrigin origin, FileSize *pNewPos = 0) = 0;
+    virtual ErrorCode tell(FileSize &pos) const = 0;
+
+    virtual ErrorCode getSize(FileSize &fileSize) const = 0;
+
+    // Вызывается также из деструктора
+    virtual ErrorCode close() = 0;
+
+}; // struct IFileHandle
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
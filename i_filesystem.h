@@ -5,12 +5,25 @@
 #pragma once
 
 
+#include <memory>
 #include <string>
 #include <vector>
 
 //
+#include "data_buffer_pool.h"
+#include "directory_cursor.h"
+#include "directory_listing.h"
+#include "file_mask_set.h"
+#include "i_file_handle.h"
+#include "mapped_view.h"
+#include "resolved_path.h"
 #include "vfs_types.h"
 
+// defs.h (через vfs_types.h) определяет MARTY_VFS_STRING_VIEW_AVAILABLE
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+    #include <string_view>
+#endif
+
 //
 #include "warnings_disable.h"
 
@@ -111,17 +124,108 @@ struct IFileSystem
     virtual std::vector<DirectoryEntryInfoW> enumerateDirectory(const std::wstring &dirPath, ErrorCode *pErr = 0) const = 0;
 
 
-    // Возвращает 0, если совпадения не найдено, >0 - индекс маски, по которой найдено совпадение, <0 - индекс маски, на которой произошла какая-то ошибка (например, корявый regex)
+    // Проверка одной маски
     virtual bool testMaskMatch(const DirectoryEntryInfoA &entry, const FileMaskInfoA &mask) const = 0;
     virtual bool testMaskMatch(const DirectoryEntryInfoW &entry, const FileMaskInfoW &mask) const = 0;
 
-    // Нерекурсивный обзор содержимого каталога, расширенная версия
+    // Маску можно скомпилировать один раз и дальше использовать скомпилированную. Корявый regex - ErrorCode::invalidFormat
+    virtual ErrorCode compileFileMask(const FileMaskInfoA &mask, CompiledFileMaskInfoA &compiledMask) const = 0;
+    virtual ErrorCode compileFileMask(const FileMaskInfoW &mask, CompiledFileMaskInfoW &compiledMask) const = 0;
+
+    virtual bool testMaskMatch(const DirectoryEntryInfoA &entry, const CompiledFileMaskInfoA &mask) const = 0;
+    virtual bool testMaskMatch(const DirectoryEntryInfoW &entry, const CompiledFileMaskInfoW &mask) const = 0;
+
+    // Проверка сразу по набору масок, за один проход по имени (см. CompiledFileMaskSetT).
+    // Возвращает 0, если совпадения не найдено, >0 - индекс маски, по которой найдено совпадение, <0 - индекс маски, на которой произошла какая-то ошибка (например, корявый regex)
+    // Индексы считаются с единицы, ошибка возвращается, только если ни одна маска не совпала
+    virtual int testMasksMatch(const DirectoryEntryInfoA &entry, const std::vector<FileMaskInfoA> &masks) const = 0;
+    virtual int testMasksMatch(const DirectoryEntryInfoW &entry, const std::vector<FileMaskInfoW> &masks) const = 0;
+
+    // Набор масок лучше собрать один раз
+    virtual int testMasksMatch(const DirectoryEntryInfoA &entry, const CompiledFileMaskSetA &maskSet) const = 0;
+    virtual int testMasksMatch(const DirectoryEntryInfoW &entry, const CompiledFileMaskSetW &maskSet) const = 0;
+
+    // Нерекурсивный обзор содержимого каталога, расширенная версия.
+    // Записи упорядочены по возрастанию compareDirectoryEntries с sortFlags (устойчиво - равные остаются в порядке чтения)
     virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const = 0;
     virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const = 0;
 
     virtual std::vector<DirectoryEntryInfoA> enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, ErrorCode *pErr = 0) const = 0;
     virtual std::vector<DirectoryEntryInfoW> enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoW> &masks, ErrorCode *pErr = 0) const = 0;
 
+    // То же самое, но с заранее скомпилированными масками
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const = 0;
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const = 0;
+
+    virtual std::vector<DirectoryEntryInfoA> enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoA> &masks, ErrorCode *pErr = 0) const = 0;
+    virtual std::vector<DirectoryEntryInfoW> enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoW> &masks, ErrorCode *pErr = 0) const = 0;
+
+    // entryFields - какие поля записей нужны. Бэкенд может не заполнять остальные (не делать stat, не выделять расширение,
+    // не копировать путь), поля, нужные для отбора и сортировки, заполняются всегда. Заполненные поля - в DirectoryEntryInfo::validFields
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const = 0;
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const = 0;
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::vector<DirectoryEntryInfoA> &entries) const = 0;
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::vector<DirectoryEntryInfoW> &entries) const = 0;
+
+    // Только записи [offset, offset+limit) отсортированного списка (limit==0 - до конца списка).
+    // Полный список при заданном limit не сортируется и не хранится - O(n log k) по времени и O(k) по памяти, k = offset+limit
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoA> &entries) const = 0;
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoW> &entries) const = 0;
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoA> &entries) const = 0;
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoW> &entries) const = 0;
+
+    // Постраничный обзор каталога (и виртуального корня). Каталог читается и сортируется один раз при открытии курсора,
+    // DirectoryCursor::next отдаёт страницы из этого снимка. Курсор не должен переживать файловую систему.
+    // Сохранённое DirectoryCursor::serialize состояние восстанавливается restoreDirectoryCursor - каталог перечитывается,
+    // и обзор продолжается после последней отданной записи. Испорченное состояние - ErrorCode::invalidFormat.
+    // Восстановление читает весь каталог (O(n) по времени), но хранит и сортирует только записи после сохранённой -
+    // чем ближе к концу списка остановились, тем дешевле. Каждое восстановление - это новое чтение каталога
+    virtual ErrorCode openDirectoryCursor(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, DirectoryCursorA &cursor) const = 0;
+    virtual ErrorCode openDirectoryCursor(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoW> &masks, DirectoryCursorW &cursor) const = 0;
+
+    virtual ErrorCode restoreDirectoryCursor(const std::string &state, DirectoryCursorA &cursor) const = 0;
+    virtual ErrorCode restoreDirectoryCursor(const std::string &state, DirectoryCursorW &cursor) const = 0;
+
+    // Потоковый нерекурсивный обзор каталога. Записи отбираются по типу и маскам и отдаются visitor'у по мере чтения каталога,
+    // без сортировки и без накопления в памяти. visitor возвращает false, чтобы прекратить перечисление (это не ошибка)
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoA> &masks, const DirectoryEntryVisitorA &visitor) const = 0;
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoW> &masks, const DirectoryEntryVisitorW &visitor) const = 0;
+
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetA &maskSet, const DirectoryEntryVisitorA &visitor) const = 0;
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetW &maskSet, const DirectoryEntryVisitorW &visitor) const = 0;
+
+    // С выбором заполняемых полей (см. enumerateDirectoryEx)
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, const DirectoryEntryVisitorA &visitor) const = 0;
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, const DirectoryEntryVisitorW &visitor) const = 0;
+
+    // Нерекурсивный обзор каталога в компактный список - путь хранится один раз на весь список, имена - в общей арене.
+    // Записи отбираются по типу и маскам, порядок - как отдаёт ФС
+    virtual ErrorCode enumerateDirectoryListing(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, DirectoryListingA &listing) const = 0;
+    virtual ErrorCode enumerateDirectoryListing(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, DirectoryListingW &listing) const = 0;
+
+    virtual ErrorCode enumerateDirectoryListing(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, DirectoryListingA &listing) const = 0;
+    virtual ErrorCode enumerateDirectoryListing(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, DirectoryListingW &listing) const = 0;
+
+    // Рекурсивный обход дерева каталогов, подкаталоги читаются параллельно (maxConcurrency потоков, 0 - по числу ядер).
+    // Работает и через точки монтирования, и от виртуального корня.
+    // maxDepth - глубина спуска (записи стартового каталога - глубина 1), 0 - без ограничений.
+    // entryFields - какие поля записей нужны visitor'у и pruner'у (см. enumerateDirectoryEx). Имя и тип заполняются всегда,
+    // для остального (размер, времена) нужен stat каждой записи - просите только то, что используете.
+    // pruner возвращает true для каталога, в который спускаться не нужно.
+    // WalkTreeFlags::unsorted - записи отдаются по мере чтения, WalkTreeFlags::sorted - в детерминированном порядке
+    // (прямой обход, в каталоге - по имени), но дерево сначала целиком читается в память.
+    // В каталоги-симлинки спускаемся только с WalkTreeFlags::followSymlinks. Нативная ФС при этом не заходит в каталог,
+    // который уже есть среди предков (по устройству и inode), в остальных от циклов по ссылкам защищает только maxDepth.
+    // visitor и pruner не вызываются одновременно из разных потоков, visitor возвращает false, чтобы прекратить обход.
+    // Ошибки чтения подкаталогов обход не прерывают, возвращается первая из них
+    virtual ErrorCode walkTree(const std::string  &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::size_t maxDepth, const DirectoryEntryVisitorA &visitor, const WalkTreePrunerA &pruner = WalkTreePrunerA(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const = 0;
+    virtual ErrorCode walkTree(const std::wstring &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::size_t maxDepth, const DirectoryEntryVisitorW &visitor, const WalkTreePrunerW &pruner = WalkTreePrunerW(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const = 0;
+
+    virtual ErrorCode walkTree(const std::string  &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorA &visitor, const WalkTreePrunerA &pruner = WalkTreePrunerA(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const = 0;
+    virtual ErrorCode walkTree(const std::wstring &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorW &visitor, const WalkTreePrunerW &pruner = WalkTreePrunerW(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const = 0;
+
 
     // std::string formatFiletime<std::string>( filetime_t t, const std::string &fmt )
     // Описание форматной строки тут - https://man7.org/linux/man-pages/man3/strftime.3.html
@@ -136,6 +240,11 @@ struct IFileSystem
     virtual int compareFilenames(const std::string  &n1, const std::string  &n2, SortFlags sortFlags) const = 0;
     virtual int compareFilenames(const std::wstring &n1, const std::wstring &n2, SortFlags sortFlags) const = 0;
 
+    // Ключ сортировки имени - побайтовое сравнение ключей (memcmp, при равенстве - короче меньше) даёт тот же порядок,
+    // что и compareFilenames с теми же флагами. orderDescending не учитывается
+    virtual std::string getFilenameSortKey(const std::string  &name, SortFlags sortFlags) const = 0;
+    virtual std::string getFilenameSortKey(const std::wstring &name, SortFlags sortFlags) const = 0;
+
     virtual int compareDirectoryEntries(const DirectoryEntryInfoA &e1, const DirectoryEntryInfoA &e2, SortFlags sortFlags) const = 0;
     virtual int compareDirectoryEntries(const DirectoryEntryInfoW &e1, const DirectoryEntryInfoW &e2, SortFlags sortFlags) const = 0;
 
@@ -164,6 +273,41 @@ struct IFileSystem
     virtual ErrorCode readDataFile(const std::string  &fName, std::vector<std::uint8_t> &fData) const = 0;
     virtual ErrorCode readDataFile(const std::wstring &fName, std::vector<std::uint8_t> &fData) const = 0;
 
+    // Чтение в буфер вызывающей стороны. В *pDataSize возвращается количество прочитанных байт.
+    // Если буфер мал - ничего не читается, возвращается ErrorCode::outOfRange, а в *pDataSize - требуемый размер буфера
+    virtual ErrorCode readDataFile(const std::string  &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const = 0;
+    virtual ErrorCode readDataFile(const std::wstring &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const = 0;
+
+    // Чтение в буфер из пула. Память, ранее выделенная в fData, используется повторно. pPool может быть нулевым
+    virtual ErrorCode readDataFile(const std::string  &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const = 0;
+    virtual ErrorCode readDataFile(const std::wstring &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const = 0;
+
+    // Отображение файла в память только для чтения, без копирования
+    // Если файловая система не умеет отображать файлы, то данные могут быть прочитаны в кучу (MappedView::isMapped() вернёт false)
+    virtual ErrorCode mapDataFile(const std::string  &fName, MappedView &mappedView) const = 0;
+    virtual ErrorCode mapDataFile(const std::wstring &fName, MappedView &mappedView) const = 0;
+
+    // Чтение части файла - [offset, offset+length). Если диапазон выходит за конец файла, то читается то, что есть
+    virtual ErrorCode readDataFileRange(const std::string  &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const = 0;
+    virtual ErrorCode readDataFileRange(const std::wstring &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const = 0;
+
+    // Чтение нескольких частей файла за один вызов, rangesData[i] соответствует ranges[i].
+    // Смежные и перекрывающиеся диапазоны читаются одной операцией
+    virtual ErrorCode readDataFileRanges(const std::string  &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const = 0;
+    virtual ErrorCode readDataFileRanges(const std::wstring &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const = 0;
+
+    // Пакетное чтение/запись файлов. fData[i] и errors[i] соответствуют fNames[i].
+    // Возвращается ErrorCode::ok, если все файлы обработаны успешно, иначе - первая из ошибок
+    virtual ErrorCode readDataFiles(const std::vector<std::string>  &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const = 0;
+    virtual ErrorCode readDataFiles(const std::vector<std::wstring> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const = 0;
+
+    // Параллельное чтение, не более maxConcurrency потоков (0 - по числу ядер).
+    // Каждый файл отдаётся в callback по мере готовности, порядок вызовов не определён.
+    // callback вызывается из рабочих потоков, но не одновременно - вызовы сериализованы, синхронизация в нём не нужна.
+    // Возвращается ErrorCode::ok, если все файлы прочитаны успешно, иначе - ошибка первого (по индексу) из непрочитанных
+    virtual ErrorCode readDataFilesParallel(const std::vector<std::string>  &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackA &callback) const = 0;
+    virtual ErrorCode readDataFilesParallel(const std::vector<std::wstring> &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackW &callback) const = 0;
+
 
     virtual ErrorCode writeTextFile(const std::string  &fName, const std::string  &fText, WriteFileFlags writeFlags) const = 0;
     virtual ErrorCode writeTextFile(const std::string  &fName, const std::wstring &fText, WriteFileFlags writeFlags) const = 0;
@@ -173,6 +317,217 @@ struct IFileSystem
     virtual ErrorCode writeDataFile(const std::string  &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const = 0;
     virtual ErrorCode writeDataFile(const std::wstring &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const = 0;
 
+    virtual ErrorCode writeDataFiles(const std::vector<std::string>  &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const = 0;
+    virtual ErrorCode writeDataFiles(const std::vector<std::wstring> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const = 0;
+
+
+    // Открытие файла для чтения/записи по частям, без загрузки его целиком в память
+    // Для записи (OpenMode::write/create/truncate) учитывается флаг VFS "только для чтения"
+    // OpenMode::create|OpenMode::exclusive - только создание нового файла, если файл существует - ErrorCode::alreadyExist
+    virtual ErrorCode openFile(const std::string  &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const = 0;
+    virtual ErrorCode openFile(const std::wstring &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const = 0;
+
+
+    // Разрешение пути - нормализация, поиск точки монтирования и построение родного пути делаются один раз.
+    // Для путей, с которыми работают многократно, дальше используются перегрузки операций, принимающие ResolvedPath.
+    // После изменения таблицы монтирования такие операции возвращают ErrorCode::invalidMountPoint - путь надо разрешить заново
+    virtual ErrorCode resolvePath(const std::string  &vPath, ResolvedPathA &resolvedPath) const = 0;
+    virtual ErrorCode resolvePath(const std::wstring &vPath, ResolvedPathW &resolvedPath) const = 0;
+
+    // Путь выдан этой ФС, и таблица монтирования с тех пор не менялась - ErrorCode::ok, иначе - ErrorCode::invalidMountPoint
+    virtual ErrorCode checkResolvedPath(const ResolvedPathA &resolvedPath) const = 0;
+    virtual ErrorCode checkResolvedPath(const ResolvedPathW &resolvedPath) const = 0;
+
+    // Частые операции - сразу по готовому родному пути
+    virtual bool isFileExistAndReadable(const ResolvedPathA &fName) const = 0;
+    virtual bool isFileExistAndReadable(const ResolvedPathW &fName) const = 0;
+
+    virtual bool isDirectory(const ResolvedPathA &dName) const = 0;
+    virtual bool isDirectory(const ResolvedPathW &dName) const = 0;
+
+    virtual ErrorCode readDataFile(const ResolvedPathA &fName, std::vector<std::uint8_t> &fData) const = 0;
+    virtual ErrorCode readDataFile(const ResolvedPathW &fName, std::vector<std::uint8_t> &fData) const = 0;
+
+    virtual ErrorCode writeDataFile(const ResolvedPathA &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const = 0;
+    virtual ErrorCode writeDataFile(const ResolvedPathW &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const = 0;
+
+    // Остальные операции с разрешённым путём - обёртки: проверяют путь и вызывают операцию по его виртуальному имени.
+    // Реализации должны добавить using IFileSystem::имяМетода, иначе обёртки будут скрыты
+
+    template<typename StringType>
+    ErrorCode createDirectory(const ResolvedPathT<StringType> &dirPath, bool bForce) const
+    {
+        ErrorCode err = checkResolvedPath(dirPath);
+        return err!=ErrorCode::ok ? err : createDirectory(dirPath.getVirtualPath(), bForce);
+    }
+
+    template<typename StringType>
+    ErrorCode readTextFile(const ResolvedPathT<StringType> &fName, std::string  &fText) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : readTextFile(fName.getVirtualPath(), fText);
+    }
+
+    template<typename StringType>
+    ErrorCode readTextFile(const ResolvedPathT<StringType> &fName, std::wstring &fText) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : readTextFile(fName.getVirtualPath(), fText);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFile(const ResolvedPathT<StringType> &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : readDataFile(fName.getVirtualPath(), pBuf, bufSize, pDataSize);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFile(const ResolvedPathT<StringType> &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : readDataFile(fName.getVirtualPath(), pPool, fData);
+    }
+
+    template<typename StringType>
+    ErrorCode mapDataFile(const ResolvedPathT<StringType> &fName, MappedView &mappedView) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : mapDataFile(fName.getVirtualPath(), mappedView);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileRange(const ResolvedPathT<StringType> &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : readDataFileRange(fName.getVirtualPath(), offset, length, fData);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileRanges(const ResolvedPathT<StringType> &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : readDataFileRanges(fName.getVirtualPath(), ranges, rangesData);
+    }
+
+    template<typename StringType>
+    ErrorCode writeTextFile(const ResolvedPathT<StringType> &fName, const std::string  &fText, WriteFileFlags writeFlags) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : writeTextFile(fName.getVirtualPath(), fText, writeFlags);
+    }
+
+    template<typename StringType>
+    ErrorCode writeTextFile(const ResolvedPathT<StringType> &fName, const std::wstring &fText, WriteFileFlags writeFlags) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : writeTextFile(fName.getVirtualPath(), fText, writeFlags);
+    }
+
+    template<typename StringType>
+    ErrorCode openFile(const ResolvedPathT<StringType> &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        ErrorCode err = checkResolvedPath(fName);
+        return err!=ErrorCode::ok ? err : openFile(fName.getVirtualPath(), openMode, pFileHandle);
+    }
+
+
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+    // Перегрузки для путей в виде std::string_view/std::wstring_view.
+    // Виртуальные - mapVirtualPath и isFileExistAndReadable: в них путь не копируется в std::string,
+    // нормализация и построение родного пути идут прямо по переданному диапазону символов.
+    // Остальные - обёртки, копирующие путь в строку и вызывающие обычную перегрузку.
+    // Перегрузки для const char*/const wchar_t* - чтобы вызовы со строковыми литералами не были неоднозначными.
+    // Реализации должны добавить using IFileSystem::имяМетода, иначе обёртки будут скрыты
+
+    ErrorCode resolvePath(std::string_view  vPath, ResolvedPathA &resolvedPath) const { return resolvePath(std::string(vPath), resolvedPath); }
+    ErrorCode resolvePath(std::wstring_view vPath, ResolvedPathW &resolvedPath) const { return resolvePath(std::wstring(vPath), resolvedPath); }
+    ErrorCode resolvePath(const char    *vPath, ResolvedPathA &resolvedPath) const { return resolvePath(std::string_view(vPath), resolvedPath); }
+    ErrorCode resolvePath(const wchar_t *vPath, ResolvedPathW &resolvedPath) const { return resolvePath(std::wstring_view(vPath), resolvedPath); }
+
+    virtual ErrorCode mapVirtualPath(std::string_view  vPath, std::string &realPath) const = 0;
+    virtual ErrorCode mapVirtualPath(std::wstring_view vPath, std::wstring &realPath) const = 0;
+    ErrorCode mapVirtualPath(const char    *vPath, std::string &realPath) const { return mapVirtualPath(std::string_view(vPath), realPath); }
+    ErrorCode mapVirtualPath(const wchar_t *vPath, std::wstring &realPath) const { return mapVirtualPath(std::wstring_view(vPath), realPath); }
+
+    virtual bool isFileExistAndReadable(std::string_view  fName) const = 0;
+    virtual bool isFileExistAndReadable(std::wstring_view fName) const = 0;
+    bool isFileExistAndReadable(const char    *fName) const { return isFileExistAndReadable(std::string_view(fName)); }
+    bool isFileExistAndReadable(const wchar_t *fName) const { return isFileExistAndReadable(std::wstring_view(fName)); }
+
+    bool isDirectory(std::string_view  dName) const { return isDirectory(std::string(dName)); }
+    bool isDirectory(std::wstring_view dName) const { return isDirectory(std::wstring(dName)); }
+    bool isDirectory(const char    *dName) const { return isDirectory(std::string_view(dName)); }
+    bool isDirectory(const wchar_t *dName) const { return isDirectory(std::wstring_view(dName)); }
+
+    ErrorCode createDirectory(std::string_view  dirPath, bool bForce) const { return createDirectory(std::string(dirPath), bForce); }
+    ErrorCode createDirectory(std::wstring_view dirPath, bool bForce) const { return createDirectory(std::wstring(dirPath), bForce); }
+    ErrorCode createDirectory(const char    *dirPath, bool bForce) const { return createDirectory(std::string_view(dirPath), bForce); }
+    ErrorCode createDirectory(const wchar_t *dirPath, bool bForce) const { return createDirectory(std::wstring_view(dirPath), bForce); }
+
+    ErrorCode readTextFile(std::string_view  fName, std::string  &fText) const { return readTextFile(std::string(fName), fText); }
+    ErrorCode readTextFile(std::wstring_view fName, std::string  &fText) const { return readTextFile(std::wstring(fName), fText); }
+    ErrorCode readTextFile(const char    *fName, std::string  &fText) const { return readTextFile(std::string_view(fName), fText); }
+    ErrorCode readTextFile(const wchar_t *fName, std::string  &fText) const { return readTextFile(std::wstring_view(fName), fText); }
+
+    ErrorCode readTextFile(std::string_view  fName, std::wstring &fText) const { return readTextFile(std::string(fName), fText); }
+    ErrorCode readTextFile(std::wstring_view fName, std::wstring &fText) const { return readTextFile(std::wstring(fName), fText); }
+    ErrorCode readTextFile(const char    *fName, std::wstring &fText) const { return readTextFile(std::string_view(fName), fText); }
+    ErrorCode readTextFile(const wchar_t *fName, std::wstring &fText) const { return readTextFile(std::wstring_view(fName), fText); }
+
+    ErrorCode readDataFile(std::string_view  fName, std::vector<std::uint8_t> &fData) const { return readDataFile(std::string(fName), fData); }
+    ErrorCode readDataFile(std::wstring_view fName, std::vector<std::uint8_t> &fData) const { return readDataFile(std::wstring(fName), fData); }
+    ErrorCode readDataFile(const char    *fName, std::vector<std::uint8_t> &fData) const { return readDataFile(std::string_view(fName), fData); }
+    ErrorCode readDataFile(const wchar_t *fName, std::vector<std::uint8_t> &fData) const { return readDataFile(std::wstring_view(fName), fData); }
+
+    ErrorCode readDataFile(std::string_view  fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const { return readDataFile(std::string(fName), pBuf, bufSize, pDataSize); }
+    ErrorCode readDataFile(std::wstring_view fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const { return readDataFile(std::wstring(fName), pBuf, bufSize, pDataSize); }
+    ErrorCode readDataFile(const char    *fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const { return readDataFile(std::string_view(fName), pBuf, bufSize, pDataSize); }
+    ErrorCode readDataFile(const wchar_t *fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const { return readDataFile(std::wstring_view(fName), pBuf, bufSize, pDataSize); }
+
+    ErrorCode readDataFile(std::string_view  fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const { return readDataFile(std::string(fName), pPool, fData); }
+    ErrorCode readDataFile(std::wstring_view fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const { return readDataFile(std::wstring(fName), pPool, fData); }
+    ErrorCode readDataFile(const char    *fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const { return readDataFile(std::string_view(fName), pPool, fData); }
+    ErrorCode readDataFile(const wchar_t *fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const { return readDataFile(std::wstring_view(fName), pPool, fData); }
+
+    ErrorCode mapDataFile(std::string_view  fName, MappedView &mappedView) const { return mapDataFile(std::string(fName), mappedView); }
+    ErrorCode mapDataFile(std::wstring_view fName, MappedView &mappedView) const { return mapDataFile(std::wstring(fName), mappedView); }
+    ErrorCode mapDataFile(const char    *fName, MappedView &mappedView) const { return mapDataFile(std::string_view(fName), mappedView); }
+    ErrorCode mapDataFile(const wchar_t *fName, MappedView &mappedView) const { return mapDataFile(std::wstring_view(fName), mappedView); }
+
+    ErrorCode readDataFileRange(std::string_view  fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const { return readDataFileRange(std::string(fName), offset, length, fData); }
+    ErrorCode readDataFileRange(std::wstring_view fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const { return readDataFileRange(std::wstring(fName), offset, length, fData); }
+    ErrorCode readDataFileRange(const char    *fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const { return readDataFileRange(std::string_view(fName), offset, length, fData); }
+    ErrorCode readDataFileRange(const wchar_t *fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const { return readDataFileRange(std::wstring_view(fName), offset, length, fData); }
+
+    ErrorCode readDataFileRanges(std::string_view  fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const { return readDataFileRanges(std::string(fName), ranges, rangesData); }
+    ErrorCode readDataFileRanges(std::wstring_view fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const { return readDataFileRanges(std::wstring(fName), ranges, rangesData); }
+    ErrorCode readDataFileRanges(const char    *fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const { return readDataFileRanges(std::string_view(fName), ranges, rangesData); }
+    ErrorCode readDataFileRanges(const wchar_t *fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const { return readDataFileRanges(std::wstring_view(fName), ranges, rangesData); }
+
+    ErrorCode writeTextFile(std::string_view  fName, const std::string  &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::string(fName), fText, writeFlags); }
+    ErrorCode writeTextFile(std::wstring_view fName, const std::string  &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::wstring(fName), fText, writeFlags); }
+    ErrorCode writeTextFile(const char    *fName, const std::string  &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::string_view(fName), fText, writeFlags); }
+    ErrorCode writeTextFile(const wchar_t *fName, const std::string  &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::wstring_view(fName), fText, writeFlags); }
+
+    ErrorCode writeTextFile(std::string_view  fName, const std::wstring &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::string(fName), fText, writeFlags); }
+    ErrorCode writeTextFile(std::wstring_view fName, const std::wstring &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::wstring(fName), fText, writeFlags); }
+    ErrorCode writeTextFile(const char    *fName, const std::wstring &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::string_view(fName), fText, writeFlags); }
+    ErrorCode writeTextFile(const wchar_t *fName, const std::wstring &fText, WriteFileFlags writeFlags) const { return writeTextFile(std::wstring_view(fName), fText, writeFlags); }
+
+    ErrorCode writeDataFile(std::string_view  fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const { return writeDataFile(std::string(fName), fData, writeFlags); }
+    ErrorCode writeDataFile(std::wstring_view fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const { return writeDataFile(std::wstring(fName), fData, writeFlags); }
+    ErrorCode writeDataFile(const char    *fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const { return writeDataFile(std::string_view(fName), fData, writeFlags); }
+    ErrorCode writeDataFile(const wchar_t *fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const { return writeDataFile(std::wstring_view(fName), fData, writeFlags); }
+
+    ErrorCode openFile(std::string_view  fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const { return openFile(std::string(fName), openMode, pFileHandle); }
+    ErrorCode openFile(std::wstring_view fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const { return openFile(std::wstring(fName), openMode, pFileHandle); }
+    ErrorCode openFile(const char    *fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const { return openFile(std::string_view(fName), openMode, pFileHandle); }
+    ErrorCode openFile(const wchar_t *fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const { return openFile(std::wstring_view(fName), openMode, pFileHandle); }
+
+#endif // MARTY_VFS_STRING_VIEW_AVAILABLE
+
 
 }; // struct IFileSystem
 
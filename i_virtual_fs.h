@@ -17,6 +17,11 @@
 //
 #include "vfs_types.h"
 
+// defs.h (через vfs_types.h) определяет MARTY_VFS_STRING_VIEW_AVAILABLE
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+    #include <string_view>
+#endif
+
 //
 #include "warnings_disable.h"
 
@@ -96,6 +101,17 @@ struct IVirtualFs
     virtual ErrorCode mapVirtualPath( const std::string  &vPath, std::string  &realPath) const = 0;
     virtual ErrorCode mapVirtualPath( const std::wstring &vPath, std::wstring &realPath) const = 0;
 
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+    // Без копирования пути в std::string. Реализации, переопределяющие эти методы, должны добавить using IVirtualFs::mapVirtualPath
+
+    virtual ErrorCode mapVirtualPath(std::string_view  vPath, std::string &realPath) const = 0;
+    virtual ErrorCode mapVirtualPath(std::wstring_view vPath, std::wstring &realPath) const = 0;
+    ErrorCode mapVirtualPath(const char    *vPath, std::string &realPath) const { return mapVirtualPath(std::string_view(vPath), realPath); }
+    ErrorCode mapVirtualPath(const wchar_t *vPath, std::wstring &realPath) const { return mapVirtualPath(std::wstring_view(vPath), realPath); }
+
+#endif // MARTY_VFS_STRING_VIEW_AVAILABLE
+
     virtual ErrorCode virtualizeRealPath( const std::string  &realPath, std::string  &vPath) const = 0;
     virtual ErrorCode virtualizeRealPath( const std::wstring &realPath, std::wstring &vPath) const = 0;
 
@@ -0,0 +1,822 @@
+/*! \file
+    \brief Batched file I/O engines - synchronous and io_uring based (Linux)
+*/
+
+#pragma once
+
+//
+#include "native_file_handle_impl.h"
+
+//
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if !defined(WIN32) && !defined(_WIN32)
+
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    // io_uring используем напрямую через системные вызовы, без liburing.
+    // Отключить можно, определив MARTY_VFS_DISABLE_IO_URING
+    #if defined(__linux__) && !defined(MARTY_VFS_DISABLE_IO_URING) && defined(__has_include)
+
+        #if __has_include(<linux/io_uring.h>)
+
+            #include <linux/io_uring.h>
+            #include <sys/mman.h>
+            #include <sys/syscall.h>
+
+            // IORING_FEAT_FAST_POLL появился в 5.7, к этому моменту в заголовках уже есть OPENAT/STATX/READ/WRITE/CLOSE и PROBE
+            #if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register) && defined(IORING_FEAT_FAST_POLL) && defined(STATX_SIZE) && defined(AT_EMPTY_PATH)
+
+                #define MARTY_VFS_IO_URING_AVAILABLE
+
+            #endif
+
+        #endif
+
+    #endif
+
+#endif
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+#if defined(WIN32) || defined(_WIN32)
+    typedef std::wstring   NativePathString;
+#else
+    typedef std::string    NativePathString;
+#endif
+
+
+//! Движок пакетного ввода/вывода
+/*! Работает с нативными именами файлов. fData[i]/errors[i] соответствуют fNames[i].
+    Реализация должна быть потокобезопасной.
+ */
+struct IIoEngine
+{
+    virtual ~IIoEngine() {}
+
+    virtual const char* getEngineName() const = 0;
+
+    virtual void readFiles (const std::vector<NativePathString> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) = 0;
+    virtual void writeFiles(const std::vector<NativePathString> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, bool bOverwrite, std::vector<ErrorCode> &errors) = 0;
+
+}; // struct IIoEngine
+
+
+
+//! Синхронный движок - файлы обрабатываются по одному
+class SyncIoEngineImpl : public IIoEngine
+{
+
+public:
+
+    static ErrorCode readFile(const NativePathString &fName, std::vector<std::uint8_t> &fData)
+    {
+        fData.clear();
+
+        NativeFileHandleImpl nativeFileHandle;
+        ErrorCode err = nativeFileHandle.open(fName, OpenMode::read);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        FileSize fileSize = 0;
+        err = nativeFileHandle.getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (fileSize>(FileSize)SIZE_MAX)
+        {
+            return ErrorCode::outOfRange;
+        }
+
+        fData.resize((std::size_t)fileSize);
+
+        std::size_t numRead = 0;
+        err = nativeFileHandle.readAt(0, fData.data(), fData.size(), &numRead);
+        fData.resize(numRead);
+
+        return err;
+    }
+
+    static ErrorCode writeFile(const NativePathString &fName, const std::vector<std::uint8_t> &fData, bool bOverwrite)
+    {
+        NativeFileHandleImpl nativeFileHandle;
+
+        // Без перезаписи - атомарное создание нового файла (O_EXCL/CREATE_NEW), существующий файл не трогаем
+        ErrorCode err = nativeFileHandle.open( fName
+                                             , bOverwrite ? OpenMode::write|OpenMode::create|OpenMode::truncate
+                                                          : OpenMode::write|OpenMode::create|OpenMode::exclusive
+                                             );
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        err = nativeFileHandle.writeAt(0, fData.data(), fData.size());
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return nativeFileHandle.close();
+    }
+
+    virtual const char* getEngineName() const override
+    {
+        return "sync";
+    }
+
+    virtual void readFiles(const std::vector<NativePathString> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) override
+    {
+        fData.clear();
+        fData.resize(fNames.size());
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        for(std::size_t i=0; i!=fNames.size(); ++i)
+        {
+            errors[i] = readFile(fNames[i], fData[i]);
+        }
+    }
+
+    virtual void writeFiles(const std::vector<NativePathString> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, bool bOverwrite, std::vector<ErrorCode> &errors) override
+    {
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        for(std::size_t i=0; i!=fNames.size(); ++i)
+        {
+            errors[i] = i<fData.size() ? writeFile(fNames[i], fData[i], bOverwrite) : ErrorCode::invalidArgument;
+        }
+    }
+
+}; // class SyncIoEngineImpl
+
+
+
+#if defined(MARTY_VFS_IO_URING_AVAILABLE)
+
+//! Движок на io_uring
+/*! Открытие, stat, чтение/запись и закрытие файлов пачки отправляются в кольцо
+    группами, так что на пачку из N файлов приходится несколько системных вызовов, а не ~4*N.
+    Если io_uring недоступен (старое ядро, seccomp, etc), то работает как SyncIoEngineImpl.
+ */
+class IoUringEngineImpl : public IIoEngine
+{
+
+protected:
+
+    std::mutex      m_mutex       ; // Кольцо одно, доступ к нему сериализуем
+
+    int             m_ringFd      = -1;
+    unsigned        m_sqEntries   = 0;
+
+    void           *m_pSqRing     = MAP_FAILED;
+    std::size_t     m_sqRingSize  = 0;
+    void           *m_pCqRing     = MAP_FAILED;
+    std::size_t     m_cqRingSize  = 0;
+    io_uring_sqe   *m_pSqes       = (io_uring_sqe*)MAP_FAILED;
+    std::size_t     m_sqesSize    = 0;
+
+    unsigned       *m_pSqHead     = 0;
+    unsigned       *m_pSqTail     = 0;
+    unsigned       *m_pSqArray    = 0;
+    unsigned        m_sqMask      = 0;
+    unsigned        m_sqTail      = 0; // Локальный хвост, публикуется при отправке
+    unsigned        m_sqPending   = 0;
+
+    unsigned       *m_pCqHead     = 0;
+    unsigned       *m_pCqTail     = 0;
+    io_uring_cqe   *m_pCqes       = 0;
+    unsigned        m_cqMask      = 0;
+
+
+    static int sysIoUringSetup(unsigned entries, io_uring_params *pParams)
+    {
+        return (int)syscall(__NR_io_uring_setup, entries, pParams);
+    }
+
+    static int sysIoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, (void*)0, (std::size_t)0);
+    }
+
+    static int sysIoUringRegister(int fd, unsigned opcode, void *pArg, unsigned nrArgs)
+    {
+        return (int)syscall(__NR_io_uring_register, fd, opcode, pArg, nrArgs);
+    }
+
+    static unsigned loadAcquire(const unsigned *p)
+    {
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    }
+
+    static void storeRelease(unsigned *p, unsigned v)
+    {
+        __atomic_store_n(p, v, __ATOMIC_RELEASE);
+    }
+
+    static ErrorCode errorCodeFromRes(int res)
+    {
+        return NativeFileHandleImpl::errorCodeFromErrno(-res);
+    }
+
+    // Предельный размер одной операции чтения/записи - len в SQE 32х-битный
+    static std::size_t getMaxIoChunkSize()
+    {
+        return 0x40000000u; // 1 Gb
+    }
+
+
+    bool init(unsigned entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        int fd = sysIoUringSetup(entries, &params);
+        if (fd<0)
+        {
+            return false;
+        }
+
+        m_ringFd     = fd;
+        m_sqEntries  = params.sq_entries;
+
+        m_sqRingSize = params.sq_off.array + params.sq_entries*sizeof(unsigned);
+        m_cqRingSize = params.cq_off.cqes  + params.cq_entries*sizeof(io_uring_cqe);
+
+        bool bSingleMmap = (params.features&IORING_FEAT_SINGLE_MMAP)!=0;
+        if (bSingleMmap)
+        {
+            m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+        }
+
+        m_pSqRing = mmap(0, m_sqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (m_pSqRing==MAP_FAILED)
+        {
+            return false;
+        }
+
+        if (bSingleMmap)
+        {
+            m_pCqRing = m_pSqRing;
+        }
+        else
+        {
+            m_pCqRing = mmap(0, m_cqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (m_pCqRing==MAP_FAILED)
+            {
+                return false;
+            }
+        }
+
+        m_sqesSize = params.sq_entries*sizeof(io_uring_sqe);
+        m_pSqes    = (io_uring_sqe*)mmap(0, m_sqesSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+        if ((void*)m_pSqes==MAP_FAILED)
+        {
+            return false;
+        }
+
+        std::uint8_t *pSq = (std::uint8_t*)m_pSqRing;
+        m_pSqHead  = (unsigned*)(pSq + params.sq_off.head);
+        m_pSqTail  = (unsigned*)(pSq + params.sq_off.tail);
+        m_pSqArray = (unsigned*)(pSq + params.sq_off.array);
+        m_sqMask   = *(unsigned*)(pSq + params.sq_off.ring_mask);
+        m_sqTail   = *m_pSqTail;
+
+        std::uint8_t *pCq = (std::uint8_t*)m_pCqRing;
+        m_pCqHead  = (unsigned*)(pCq + params.cq_off.head);
+        m_pCqTail  = (unsigned*)(pCq + params.cq_off.tail);
+        m_pCqes    = (io_uring_cqe*)(pCq + params.cq_off.cqes);
+        m_cqMask   = *(unsigned*)(pCq + params.cq_off.ring_mask);
+
+        return probeOps();
+    }
+
+    // Проверяем, что ядро умеет все нужные нам операции
+    bool probeOps()
+    {
+        const unsigned maxOps = 256;
+        std::vector<std::uint8_t> probeBuf(sizeof(io_uring_probe) + maxOps*sizeof(io_uring_probe_op), 0);
+        io_uring_probe *pProbe = (io_uring_probe*)probeBuf.data();
+
+        if (sysIoUringRegister(m_ringFd, IORING_REGISTER_PROBE, pProbe, maxOps)<0)
+        {
+            return false;
+        }
+
+        const unsigned requiredOps[] = { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE };
+        for(auto op : requiredOps)
+        {
+            if (op>pProbe->last_op || (pProbe->ops[op].flags&IO_URING_OP_SUPPORTED)==0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void cleanup()
+    {
+        if ((void*)m_pSqes!=MAP_FAILED)
+        {
+            munmap((void*)m_pSqes, m_sqesSize);
+        }
+
+        if (m_pCqRing!=MAP_FAILED && m_pCqRing!=m_pSqRing)
+        {
+            munmap(m_pCqRing, m_cqRingSize);
+        }
+
+        if (m_pSqRing!=MAP_FAILED)
+        {
+            munmap(m_pSqRing, m_sqRingSize);
+        }
+
+        if (m_ringFd>=0)
+        {
+            ::close(m_ringFd);
+        }
+
+        m_pSqes   = (io_uring_sqe*)MAP_FAILED;
+        m_pCqRing = MAP_FAILED;
+        m_pSqRing = MAP_FAILED;
+        m_ringFd  = -1;
+    }
+
+    // Кладёт SQE в очередь, отправляется она в runQueued
+    io_uring_sqe* queueSqe(std::uint8_t opcode, int fd, const void *pAddr, unsigned len, std::uint64_t off, std::uint64_t userData)
+    {
+        unsigned idx = m_sqTail & m_sqMask;
+
+        io_uring_sqe *pSqe = &m_pSqes[idx];
+        std::memset(pSqe, 0, sizeof(*pSqe));
+        pSqe->opcode    = opcode;
+        pSqe->fd        = fd;
+        pSqe->addr      = (std::uint64_t)(std::uintptr_t)pAddr;
+        pSqe->len       = len;
+        pSqe->off       = off;
+        pSqe->user_data = userData;
+
+        m_pSqArray[idx] = idx;
+        ++m_sqTail;
+        ++m_sqPending;
+
+        return pSqe;
+    }
+
+    // Отправляет всё, что поставлено в очередь, дожидается всех завершений и для каждого вызывает handler(userData, res).
+    // Число SQE в очереди не должно превышать m_sqEntries
+    template<typename Handler>
+    bool runQueued(Handler handler)
+    {
+        unsigned toComplete = m_sqPending;
+        unsigned toSubmit   = m_sqPending;
+
+        m_sqPending = 0;
+        storeRelease(m_pSqTail, m_sqTail);
+
+        while(toComplete)
+        {
+            // Разбираем то, что уже завершилось
+            unsigned cqHead = *m_pCqHead;
+            unsigned cqTail = loadAcquire(m_pCqTail);
+            for(; cqHead!=cqTail && toComplete; ++cqHead, --toComplete)
+            {
+                const io_uring_cqe &cqe = m_pCqes[cqHead & m_cqMask];
+                handler(cqe.user_data, cqe.res);
+            }
+
+            storeRelease(m_pCqHead, cqHead);
+
+            if (!toComplete && !toSubmit)
+            {
+                break;
+            }
+
+            // Если отправилось не всё, ядро ждать не будет - досылаем на следующем круге
+            int res = sysIoUringEnter(m_ringFd, toSubmit, toComplete, IORING_ENTER_GETEVENTS);
+            if (res<0)
+            {
+                if (errno==EINTR || errno==EAGAIN || errno==EBUSY)
+                {
+                    continue;
+                }
+
+                return false;
+            }
+
+            toSubmit -= std::min(toSubmit, (unsigned)res);
+        }
+
+        return true;
+    }
+
+    // Ошибка самого кольца - дальше работаем синхронно
+    void markBroken()
+    {
+        cleanup();
+    }
+
+    void readFilesChunk(const std::vector<NativePathString> &fNames, std::size_t first, std::size_t count, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors)
+    {
+        std::vector<int>            fds     (count, -1);
+        std::vector<struct statx>   stats   (count);
+        std::vector<std::size_t>    numRead (count, 0);
+        std::vector<char>           pending (count, 0);
+
+        // Открываем все файлы одной пачкой
+        for(std::size_t i=0; i!=count; ++i)
+        {
+            io_uring_sqe *pSqe = queueSqe(IORING_OP_OPENAT, AT_FDCWD, fNames[first+i].c_str(), 0 /* mode */, 0, (std::uint64_t)i);
+            pSqe->open_flags = O_RDONLY|O_CLOEXEC;
+        }
+
+        bool bOk = runQueued([&](std::uint64_t userData, int res)
+        {
+            std::size_t i = (std::size_t)userData;
+            if (res>=0)
+            {
+                fds[i] = res;
+            }
+            else
+            {
+                errors[first+i] = errorCodeFromRes(res);
+            }
+        });
+
+        // Размер берём у открытого дескриптора (AT_EMPTY_PATH), а не по имени - иначе после переименования
+        // между открытием и statx размер мог бы относиться к другому файлу
+        if (bOk)
+        {
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (fds[i]>=0)
+                {
+                    io_uring_sqe *pSqe = queueSqe(IORING_OP_STATX, fds[i], "", STATX_SIZE, (std::uint64_t)(std::uintptr_t)&stats[i], (std::uint64_t)i);
+                    pSqe->statx_flags = AT_EMPTY_PATH;
+                }
+            }
+
+            bOk = runQueued([&](std::uint64_t userData, int res)
+            {
+                std::size_t i = (std::size_t)userData;
+                if (res<0)
+                {
+                    errors[first+i] = errorCodeFromRes(res);
+                }
+            });
+        }
+
+        for(std::size_t i=0; i!=count && bOk; ++i)
+        {
+            if (fds[i]<0 || errors[first+i]!=ErrorCode::ok)
+            {
+                continue;
+            }
+
+            if (stats[i].stx_size>(std::uint64_t)SIZE_MAX)
+            {
+                errors[first+i] = ErrorCode::outOfRange;
+                continue;
+            }
+
+            fData[first+i].resize((std::size_t)stats[i].stx_size);
+            pending[i] = fData[first+i].empty() ? 0 : 1;
+        }
+
+        // Читаем, пока все не дочитаются - короткое чтение просто дочитываем на следующем круге
+        while(bOk)
+        {
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (pending[i])
+                {
+                    std::vector<std::uint8_t> &buf = fData[first+i];
+                    std::size_t toRead = std::min(buf.size()-numRead[i], getMaxIoChunkSize());
+                    queueSqe(IORING_OP_READ, fds[i], buf.data()+numRead[i], (unsigned)toRead, (std::uint64_t)numRead[i], (std::uint64_t)i);
+                }
+            }
+
+            if (!m_sqPending)
+            {
+                break;
+            }
+
+            bOk = runQueued([&](std::uint64_t userData, int res)
+            {
+                std::size_t i = (std::size_t)userData;
+                if (res<0)
+                {
+                    if (res!=-EINTR && res!=-EAGAIN)
+                    {
+                        errors[first+i] = errorCodeFromRes(res);
+                        pending[i]      = 0;
+                    }
+                }
+                else if (res==0)
+                {
+                    // Файл стал короче, чем был при stat
+                    fData[first+i].resize(numRead[i]);
+                    pending[i] = 0;
+                }
+                else
+                {
+                    numRead[i] += (std::size_t)res;
+                    if (numRead[i]==fData[first+i].size())
+                    {
+                        pending[i] = 0;
+                    }
+                }
+            });
+        }
+
+        if (bOk)
+        {
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (fds[i]>=0)
+                {
+                    queueSqe(IORING_OP_CLOSE, fds[i], 0, 0, 0, (std::uint64_t)i);
+                }
+            }
+
+            bOk = runQueued([&](std::uint64_t, int) {});
+        }
+
+        if (!bOk)
+        {
+            // Кольцо сломалось - закрываем то, что успели открыть, и дочитываем синхронно
+            markBroken();
+
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (fds[i]>=0)
+                {
+                    ::close(fds[i]);
+                }
+
+                errors[first+i] = SyncIoEngineImpl::readFile(fNames[first+i], fData[first+i]);
+            }
+        }
+
+        for(std::size_t i=0; i!=count; ++i)
+        {
+            if (errors[first+i]!=ErrorCode::ok)
+            {
+                fData[first+i].clear();
+            }
+        }
+    }
+
+    void writeFilesChunk(const std::vector<NativePathString> &fNames, std::size_t first, std::size_t count, const std::vector< std::vector<std::uint8_t> > &fData, bool bOverwrite, std::vector<ErrorCode> &errors)
+    {
+        std::vector<int>            fds        (count, -1);
+        std::vector<std::size_t>    numWritten (count, 0);
+        std::vector<char>           pending    (count, 0);
+
+        for(std::size_t i=0; i!=count; ++i)
+        {
+            io_uring_sqe *pSqe = queueSqe(IORING_OP_OPENAT, AT_FDCWD, fNames[first+i].c_str(), 0666 /* mode */, 0, (std::uint64_t)i);
+            pSqe->open_flags = O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC|(bOverwrite ? 0 : O_EXCL);
+        }
+
+        bool bOk = runQueued([&](std::uint64_t userData, int res)
+        {
+            std::size_t i = (std::size_t)userData;
+            if (res>=0)
+            {
+                fds[i]     = res;
+                pending[i] = fData[first+i].empty() ? 0 : 1;
+            }
+            else
+            {
+                errors[first+i] = errorCodeFromRes(res);
+            }
+        });
+
+        while(bOk)
+        {
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (pending[i])
+                {
+                    const std::vector<std::uint8_t> &buf = fData[first+i];
+                    std::size_t toWrite = std::min(buf.size()-numWritten[i], getMaxIoChunkSize());
+                    queueSqe(IORING_OP_WRITE, fds[i], buf.data()+numWritten[i], (unsigned)toWrite, (std::uint64_t)numWritten[i], (std::uint64_t)i);
+                }
+            }
+
+            if (!m_sqPending)
+            {
+                break;
+            }
+
+            bOk = runQueued([&](std::uint64_t userData, int res)
+            {
+                std::size_t i = (std::size_t)userData;
+                if (res<0)
+                {
+                    if (res!=-EINTR && res!=-EAGAIN)
+                    {
+                        errors[first+i] = errorCodeFromRes(res);
+                        pending[i]      = 0;
+                    }
+                }
+                else if (res==0)
+                {
+                    errors[first+i] = ErrorCode::genericError;
+                    pending[i]      = 0;
+                }
+                else
+                {
+                    numWritten[i] += (std::size_t)res;
+                    if (numWritten[i]==fData[first+i].size())
+                    {
+                        pending[i] = 0;
+                    }
+                }
+            });
+        }
+
+        if (bOk)
+        {
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (fds[i]>=0)
+                {
+                    queueSqe(IORING_OP_CLOSE, fds[i], 0, 0, 0, (std::uint64_t)i);
+                }
+            }
+
+            // Ошибка при закрытии для записываемого файла - тоже ошибка записи
+            bOk = runQueued([&](std::uint64_t userData, int res)
+            {
+                std::size_t i = (std::size_t)userData;
+                if (res<0 && errors[first+i]==ErrorCode::ok)
+                {
+                    errors[first+i] = errorCodeFromRes(res);
+                }
+            });
+        }
+
+        if (!bOk)
+        {
+            markBroken();
+
+            for(std::size_t i=0; i!=count; ++i)
+            {
+                if (fds[i]>=0)
+                {
+                    ::close(fds[i]);
+                }
+
+                // Файл уже создан нами, поэтому перезаписываем
+                errors[first+i] = SyncIoEngineImpl::writeFile(fNames[first+i], fData[first+i], bOverwrite || fds[i]>=0);
+            }
+        }
+    }
+
+
+public:
+
+    explicit IoUringEngineImpl(unsigned entries = 256)
+    {
+        if (!init(entries))
+        {
+            cleanup();
+        }
+    }
+
+    IoUringEngineImpl(const IoUringEngineImpl &)            = delete;
+    IoUringEngineImpl& operator=(const IoUringEngineImpl &) = delete;
+
+    ~IoUringEngineImpl()
+    {
+        cleanup();
+    }
+
+    bool isAvailable() const
+    {
+        return m_ringFd>=0;
+    }
+
+    virtual const char* getEngineName() const override
+    {
+        return isAvailable() ? "io_uring" : "sync";
+    }
+
+    virtual void readFiles(const std::vector<NativePathString> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!isAvailable())
+        {
+            SyncIoEngineImpl().readFiles(fNames, fData, errors);
+            return;
+        }
+
+        fData.clear();
+        fData.resize(fNames.size());
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        // Открытие, statx, чтение и закрытие идут отдельными пачками, по одному SQE на файл
+        std::size_t chunkSize = std::max((std::size_t)1, (std::size_t)m_sqEntries);
+
+        for(std::size_t first=0; first<fNames.size(); first+=chunkSize)
+        {
+            std::size_t count = std::min(chunkSize, fNames.size()-first);
+
+            if (isAvailable())
+            {
+                readFilesChunk(fNames, first, count, fData, errors);
+            }
+            else
+            {
+                for(std::size_t i=first; i!=first+count; ++i)
+                {
+                    errors[i] = SyncIoEngineImpl::readFile(fNames[i], fData[i]);
+                }
+            }
+        }
+    }
+
+    virtual void writeFiles(const std::vector<NativePathString> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, bool bOverwrite, std::vector<ErrorCode> &errors) override
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!isAvailable() || fData.size()<fNames.size())
+        {
+            SyncIoEngineImpl().writeFiles(fNames, fData, bOverwrite, errors);
+            return;
+        }
+
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        std::size_t chunkSize = std::max((std::size_t)1, (std::size_t)m_sqEntries);
+
+        for(std::size_t first=0; first<fNames.size(); first+=chunkSize)
+        {
+            std::size_t count = std::min(chunkSize, fNames.size()-first);
+
+            if (isAvailable())
+            {
+                writeFilesChunk(fNames, first, count, fData, bOverwrite, errors);
+            }
+            else
+            {
+                for(std::size_t i=first; i!=first+count; ++i)
+                {
+                    errors[i] = SyncIoEngineImpl::writeFile(fNames[i], fData[i], bOverwrite);
+                }
+            }
+        }
+    }
+
+}; // class IoUringEngineImpl
+
+#endif // MARTY_VFS_IO_URING_AVAILABLE
+
+
+
+//! Создаёт движок по умолчанию - io_uring, если он доступен, иначе синхронный
+inline
+std::shared_ptr<IIoEngine> createDefaultIoEngine()
+{
+#if defined(MARTY_VFS_IO_URING_AVAILABLE)
+
+    auto pUring = std::make_shared<IoUringEngineImpl>();
+    if (pUring->isAvailable())
+    {
+        return pUring;
+    }
+
+#endif
+
+    return std::make_shared<SyncIoEngineImpl>();
+}
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
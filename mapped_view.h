@@ -0,0 +1,105 @@
+/*! \file
+    \brief Read-only view of the file data (memory mapped or heap copy)
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Представление содержимого файла только для чтения
+/*! Данные либо отображены в память (mmap/MapViewOfFile), либо это копия в куче,
+    если файловая система не умеет отображать файлы.
+    Копии MappedView разделяют одно и то же отображение, отображение закрывается,
+    когда уничтожается последняя копия.
+ */
+class MappedView
+{
+
+protected:
+
+    const std::uint8_t      *m_pData   = 0;
+    std::size_t              m_size    = 0;
+    bool                     m_mapped  = false;
+    std::shared_ptr<void>    m_pHolder ; // Владеет отображением или буфером в куче
+
+public:
+
+    MappedView()                               = default;
+    MappedView(const MappedView &)             = default;
+    MappedView& operator=(const MappedView &)  = default;
+
+    // Исходное представление после перемещения пусто - иначе оно указывало бы на чужое отображение
+    MappedView(MappedView &&other)
+    : m_pData(other.m_pData), m_size(other.m_size), m_mapped(other.m_mapped), m_pHolder(std::move(other.m_pHolder))
+    {
+        other.m_pData  = 0;
+        other.m_size   = 0;
+        other.m_mapped = false;
+    }
+
+    MappedView& operator=(MappedView &&other)
+    {
+        if (this!=&other)
+        {
+            m_pData        = other.m_pData;
+            m_size         = other.m_size;
+            m_mapped       = other.m_mapped;
+            m_pHolder      = std::move(other.m_pHolder);
+            other.m_pData  = 0;
+            other.m_size   = 0;
+            other.m_mapped = false;
+        }
+
+        return *this;
+    }
+
+    MappedView(const std::uint8_t *pData, std::size_t dataSize, bool bMapped, std::shared_ptr<void> pHolder)
+    : m_pData(pData), m_size(dataSize), m_mapped(bMapped), m_pHolder(pHolder)
+    {}
+
+    //! Создаёт представление, владеющее копией данных в куче
+    static MappedView fromData(std::vector<std::uint8_t> &&fData)
+    {
+        auto pVec = std::make_shared< std::vector<std::uint8_t> >(std::move(fData));
+        return MappedView(pVec->data(), pVec->size(), false, pVec);
+    }
+
+    const std::uint8_t* data() const { return m_pData; }
+    std::size_t         size() const { return m_size;  }
+    bool                empty() const { return m_size==0; }
+
+    const std::uint8_t* begin() const { return m_pData; }
+    const std::uint8_t* end()   const { return m_pData+m_size; }
+
+    //! true - данные отображены в память, false - копия в куче (или пусто)
+    bool isMapped() const { return m_mapped; }
+
+    void reset()
+    {
+        m_pData   = 0;
+        m_size    = 0;
+        m_mapped  = false;
+        m_pHolder.reset();
+    }
+
+}; // class MappedView
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
@@ -0,0 +1,248 @@
+/*! \file
+    \brief Mount point targets indexed by path components - longest prefix lookup
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Дерево по компонентам путей целей точек монтирования
+/*! Узел - компонент пути, дети хранятся отсортированными (поиск двоичный). В узле, где кончается путь цели,
+    лежат ключи точек монтирования (m_mountPoints) с этой целью - в порядке возрастания, как в std::map.
+
+    Пути добавляются и ищутся уже подготовленными для сравнения (канонический вид, регистр - см. prepareVirtualizeCmp).
+    Разделители - '/' и '\\', повторные разделители пропускаются, ведущий разделитель - отдельный пустой компонент,
+    так что абсолютные и относительные пути не смешиваются.
+
+    Поиск - за один проход по пути, находится самая глубокая цель, являющаяся префиксом пути по целым компонентам
+    ("/data/a" не является префиксом "/data/ab").
+ */
+class MountPointTree
+{
+
+protected:
+
+    struct Node
+    {
+        std::vector< std::pair<std::wstring, std::uint32_t> >  children;  // Отсортированы по компоненту
+        std::vector<std::wstring>                              mountKeys; // Отсортированы
+    };
+
+    std::vector<Node>           m_nodes    ;
+    std::vector<std::uint32_t>  m_freeNodes; // Узлы, освободившиеся при удалении
+
+
+    static bool isSep(wchar_t ch)
+    {
+        return ch==L'/' || ch==L'\\';
+    }
+
+    //! Следующий компонент пути начиная с pos. Возвращает false, если компоненты кончились
+    static bool nextComponent(const std::wstring &path, std::size_t &pos, std::size_t &compBegin, std::size_t &compEnd)
+    {
+        if (pos==0 && !path.empty() && isSep(path[0]))
+        {
+            compBegin = compEnd = 0;
+            while(pos<path.size() && isSep(path[pos]))
+            {
+                ++pos;
+            }
+            return true;
+        }
+
+        while(pos<path.size() && isSep(path[pos]))
+        {
+            ++pos;
+        }
+
+        if (pos>=path.size())
+        {
+            return false;
+        }
+
+        compBegin = pos;
+        while(pos<path.size() && !isSep(path[pos]))
+        {
+            ++pos;
+        }
+        compEnd = pos;
+
+        return true;
+    }
+
+    std::uint32_t findChild(std::uint32_t nodeIdx, const wchar_t *pComp, std::size_t compLen) const
+    {
+        const auto &children = m_nodes[nodeIdx].children;
+        auto it = std::lower_bound( children.begin(), children.end(), 0
+                                  , [&](const std::pair<std::wstring, std::uint32_t> &c, int)
+                                    {
+                                        return c.first.compare(0, c.first.size(), pComp, compLen)<0;
+                                    }
+                                  );
+
+        if (it!=children.end() && it->first.compare(0, it->first.size(), pComp, compLen)==0)
+        {
+            return it->second;
+        }
+
+        return 0;
+    }
+
+    std::uint32_t allocNode()
+    {
+        if (!m_freeNodes.empty())
+        {
+            std::uint32_t idx = m_freeNodes.back();
+            m_freeNodes.pop_back();
+            return idx;
+        }
+
+        m_nodes.emplace_back();
+        return (std::uint32_t)(m_nodes.size()-1);
+    }
+
+
+public:
+
+    MountPointTree() : m_nodes(1) {}
+
+    void clear()
+    {
+        m_nodes.assign(1, Node());
+        m_freeNodes.clear();
+    }
+
+    void insert(const std::wstring &cmpTarget, const std::wstring &mountKey)
+    {
+        std::uint32_t cur = 0;
+
+        std::size_t pos = 0, compBegin = 0, compEnd = 0;
+        while(nextComponent(cmpTarget, pos, compBegin, compEnd))
+        {
+            std::uint32_t next = findChild(cur, cmpTarget.data()+compBegin, compEnd-compBegin);
+            if (!next)
+            {
+                next = allocNode();
+
+                std::wstring comp = cmpTarget.substr(compBegin, compEnd-compBegin);
+                auto &children = m_nodes[cur].children;
+                auto it = std::lower_bound( children.begin(), children.end(), comp
+                                          , [](const std::pair<std::wstring, std::uint32_t> &c, const std::wstring &v) { return c.first<v; }
+                                          );
+                children.insert(it, std::make_pair(comp, next));
+            }
+
+            cur = next;
+        }
+
+        auto &keys = m_nodes[cur].mountKeys;
+        auto it = std::lower_bound(keys.begin(), keys.end(), mountKey);
+        if (it==keys.end() || *it!=mountKey)
+        {
+            keys.insert(it, mountKey);
+        }
+    }
+
+    //! Опустевшие узлы удаляются
+    void remove(const std::wstring &cmpTarget, const std::wstring &mountKey)
+    {
+        std::vector<std::uint32_t> pathNodes(1, 0);
+
+        std::size_t pos = 0, compBegin = 0, compEnd = 0;
+        while(nextComponent(cmpTarget, pos, compBegin, compEnd))
+        {
+            std::uint32_t next = findChild(pathNodes.back(), cmpTarget.data()+compBegin, compEnd-compBegin);
+            if (!next)
+            {
+                return;
+            }
+
+            pathNodes.emplace_back(next);
+        }
+
+        auto &keys = m_nodes[pathNodes.back()].mountKeys;
+        auto it = std::lower_bound(keys.begin(), keys.end(), mountKey);
+        if (it==keys.end() || *it!=mountKey)
+        {
+            return;
+        }
+
+        keys.erase(it);
+
+        for(std::size_t i=pathNodes.size()-1; i!=0; --i)
+        {
+            Node &node = m_nodes[pathNodes[i]];
+            if (!node.children.empty() || !node.mountKeys.empty())
+            {
+                break;
+            }
+
+            auto &parentChildren = m_nodes[pathNodes[i-1]].children;
+            parentChildren.erase( std::find_if( parentChildren.begin(), parentChildren.end()
+                                              , [&](const std::pair<std::wstring, std::uint32_t> &c) { return c.second==pathNodes[i]; }
+                                              )
+                                );
+
+            node = Node();
+            m_freeNodes.emplace_back(pathNodes[i]);
+        }
+    }
+
+    //! Ищет самую глубокую цель, являющуюся префиксом cmpPath
+    /*! mountKey - ключ точки монтирования (при нескольких точках с одной целью - наименьший),
+        prefixLen - длина совпавшей части cmpPath (до конца последнего совпавшего компонента)
+     */
+    bool findLongestPrefix(const std::wstring &cmpPath, std::wstring &mountKey, std::size_t &prefixLen) const
+    {
+        std::uint32_t cur   = 0;
+        const Node   *pBest = m_nodes[0].mountKeys.empty() ? 0 : &m_nodes[0];
+
+        prefixLen = 0;
+
+        std::size_t pos = 0, compBegin = 0, compEnd = 0;
+        while(nextComponent(cmpPath, pos, compBegin, compEnd))
+        {
+            cur = findChild(cur, cmpPath.data()+compBegin, compEnd-compBegin);
+            if (!cur)
+            {
+                break;
+            }
+
+            if (!m_nodes[cur].mountKeys.empty())
+            {
+                pBest     = &m_nodes[cur];
+                prefixLen = compBegin==compEnd ? pos : compEnd; // Для корня - вместе с разделителями
+            }
+        }
+
+        if (!pBest)
+        {
+            return false;
+        }
+
+        mountKey = pBest->mountKeys.front();
+        return true;
+    }
+
+}; // class MountPointTree
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
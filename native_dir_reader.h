@@ -0,0 +1,224 @@
+/*! \file
+    \brief Native directory reader on openat/getdents64 (Linux) - stat only when needed
+*/
+
+#pragma once
+
+//
+#include "native_file_handle_impl.h"
+#include "vfs_types.h"
+
+//
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if !defined(WIN32) && !defined(_WIN32)
+
+    // getdents64 вызываем напрямую - readdir не даёт управлять размером буфера.
+    // Отключить можно, определив MARTY_VFS_DISABLE_GETDENTS
+    #if defined(__linux__) && !defined(MARTY_VFS_DISABLE_GETDENTS)
+
+        #include <cerrno>
+        #include <dirent.h>
+        #include <fcntl.h>
+        #include <sys/stat.h>
+        #include <sys/syscall.h>
+        #include <unistd.h>
+
+        #if defined(SYS_getdents64) && defined(DT_DIR) && defined(DT_UNKNOWN) && defined(DT_LNK) && defined(O_DIRECTORY) && defined(AT_SYMLINK_NOFOLLOW)
+
+            #define MARTY_VFS_GETDENTS_AVAILABLE
+
+        #endif
+
+    #endif
+
+#endif
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+#if defined(MARTY_VFS_GETDENTS_AVAILABLE)
+
+//! Чтение каталога через open(O_DIRECTORY) + getdents64
+/*! Тип записи берётся из d_type, так что на весь каталог уходит пара системных вызовов на каждые
+    несколько сотен записей. fstatat (относительно дескриптора каталога, без разбора полного пути)
+    делается только если нужны размер/времена, или если нужен тип, а ФС его не сообщила (DT_UNKNOWN),
+    или запись - символическая ссылка (тип определяется по цели, как и у stat).
+
+    Символические ссылки помечаются FileTypeFlags::symlink, чтобы обход дерева не уходил по ним в цикл.
+    При DT_UNKNOWN сначала делается fstatat(AT_SYMLINK_NOFOLLOW), и только для ссылок - второй fstatat по цели.
+ */
+class NativeDirectoryReader
+{
+
+protected:
+
+    // Заголовок linux_dirent64, d_name идёт сразу за ним
+    struct LinuxDirent64Header
+    {
+        std::uint64_t   d_ino;
+        std::int64_t    d_off;
+        unsigned short  d_reclen;
+        unsigned char   d_type;
+    };
+
+    static const std::size_t direntNameOffset = 19; // offsetof(linux_dirent64, d_name)
+    static const std::size_t readBufSize      = 32768;
+
+    static FileTime fileTimeFromTimeT(time_t t)
+    {
+        return (FileTime)t;
+    }
+
+    class DirFdHolder
+    {
+        int m_fd = -1;
+
+    public:
+
+        explicit DirFdHolder(int fd) : m_fd(fd) {}
+        DirFdHolder(const DirFdHolder &)            = delete;
+        DirFdHolder& operator=(const DirFdHolder &) = delete;
+        ~DirFdHolder()
+        {
+            if (m_fd>=0)
+            {
+                ::close(m_fd);
+            }
+        }
+
+        int get() const { return m_fd; }
+    };
+
+
+public:
+
+    //! Заполняет тип, размер и времена из struct stat
+    template<typename StringType>
+    static void fillDirectoryEntryInfoFromStat(const struct stat &st, DirectoryEntryInfoT<StringType> &dirInfo)
+    {
+        dirInfo.fileTypeFlags    = S_ISDIR(st.st_mode) ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+        dirInfo.fileSize         = S_ISDIR(st.st_mode) ? 0 : (FileSize)st.st_size;
+        dirInfo.timeCreation     = fileTimeFromTimeT(st.st_ctime); // Времени создания в struct stat нет
+        dirInfo.timeLastModified = fileTimeFromTimeT(st.st_mtime);
+        dirInfo.timeLastAccess   = fileTimeFromTimeT(st.st_atime);
+    }
+
+    //! Вызывает handler(name, nameLen, fileTypeFlags, bTypeKnown, pStat) для каждой записи, кроме "." и ".."
+    /*! fileTypeFlags - тип цели, для символических ссылок с флагом FileTypeFlags::symlink.
+        pStat - нулевой, если stat не делался (не нужны размер/времена и тип известен из d_type или не нужен)
+        или не удался (например, битая ссылка - тогда запись считается обычным файлом).
+        bTypeKnown - false, если тип не определён (stat не делался или не удался, а d_type не помог).
+        handler возвращает false, чтобы прекратить чтение.
+     */
+    template<typename Handler>
+    static ErrorCode enumerate(const std::string &path, bool bNeedStat, bool bNeedType, Handler handler)
+    {
+        int fd = -1;
+        do
+        {
+            fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        } while(fd<0 && errno==EINTR);
+
+        if (fd<0)
+        {
+            return (errno==ENOTDIR) ? ErrorCode::notDirectory : NativeFileHandleImpl::errorCodeFromErrno(errno);
+        }
+
+        DirFdHolder dirFd(fd);
+
+        alignas(8) char buf[readBufSize];
+
+        for(;;)
+        {
+            long nRead = (long)::syscall(SYS_getdents64, dirFd.get(), buf, sizeof(buf));
+            if (nRead<0)
+            {
+                if (errno==EINTR)
+                {
+                    continue;
+                }
+
+                return NativeFileHandleImpl::errorCodeFromErrno(errno);
+            }
+
+            if (nRead==0)
+            {
+                break;
+            }
+
+            for(long pos=0; pos<nRead; )
+            {
+                LinuxDirent64Header hdr;
+                std::memcpy(&hdr, buf+pos, sizeof(hdr));
+
+                const char  *pName   = buf + pos + direntNameOffset;
+                std::size_t  nameLen = std::strlen(pName);
+
+                pos += hdr.d_reclen;
+
+                if (pName[0]=='.' && (nameLen==1 || (nameLen==2 && pName[1]=='.')))
+                {
+                    continue;
+                }
+
+                FileTypeFlags  typeFlags  = (hdr.d_type==DT_DIR) ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+                bool           bSymlink   = hdr.d_type==DT_LNK;
+                bool           bTypeKnown = hdr.d_type!=DT_UNKNOWN && !bSymlink;
+                bool           bStat      = bNeedStat || (bNeedType && !bTypeKnown);
+
+                struct stat    st;
+                const struct stat *pStat = 0;
+
+                if (bStat)
+                {
+                    // Про DT_UNKNOWN не знаем, ссылка ли это - смотрим саму запись, по цели идём только для ссылок
+                    int statFlags = (hdr.d_type==DT_UNKNOWN) ? AT_SYMLINK_NOFOLLOW : 0;
+                    bool bStatOk  = ::fstatat(dirFd.get(), pName, &st, statFlags)==0;
+                    if (bStatOk && statFlags!=0 && S_ISLNK(st.st_mode))
+                    {
+                        bSymlink = true;
+                        bStatOk  = ::fstatat(dirFd.get(), pName, &st, 0)==0;
+                    }
+
+                    if (bStatOk)
+                    {
+                        pStat      = &st;
+                        typeFlags  = S_ISDIR(st.st_mode) ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+                        bTypeKnown = true;
+                    }
+                }
+
+                if (bSymlink)
+                {
+                    typeFlags |= FileTypeFlags::symlink;
+                }
+
+                if (!handler(pName, nameLen, typeFlags, bTypeKnown, pStat))
+                {
+                    return ErrorCode::ok;
+                }
+            }
+        }
+
+        return ErrorCode::ok;
+    }
+
+}; // class NativeDirectoryReader
+
+#endif // MARTY_VFS_GETDENTS_AVAILABLE
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
@@ -0,0 +1,712 @@
+/*! \file
+    \brief IFileHandle implementation for native files
+*/
+
+#pragma once
+
+#include "umba/filesys.h"
+
+//
+#include "i_file_handle.h"
+#include "mapped_view.h"
+
+//
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if !defined(WIN32) && !defined(_WIN32)
+
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/types.h>
+    #include <unistd.h>
+
+#endif
+
+
+namespace marty_virtual_fs {
+
+
+class NativeFileHandleImpl : public IFileHandle
+{
+
+protected:
+
+#if defined(WIN32) || defined(_WIN32)
+    HANDLE        m_hFile    = INVALID_HANDLE_VALUE;
+#else
+    int           m_fd       = -1;
+#endif
+
+    OpenMode      m_openMode = OpenMode::none;
+
+    // Текущую позицию ведём сами, все операции ввода/вывода делаются с явным смещением -
+    // так read/write и readAt/writeAt не мешают друг другу
+    FileSize      m_curPos   = 0;
+
+
+    // Ограничиваем размер одного системного вызова - ReadFile/WriteFile принимают DWORD,
+    // да и pread/pwrite не обязаны прочитать всё за раз
+    static std::size_t getMaxIoChunkSize()
+    {
+        return 0x40000000u; // 1 Gb
+    }
+
+
+public:
+
+    // Используются также движками пакетного ввода/вывода
+
+#if defined(WIN32) || defined(_WIN32)
+
+    static ErrorCode errorCodeFromLastError()
+    {
+        switch(GetLastError())
+        {
+            case ERROR_FILE_NOT_FOUND     : [[fallthrough]];
+            case ERROR_PATH_NOT_FOUND     : return ErrorCode::notFound;
+            case ERROR_ACCESS_DENIED      : [[fallthrough]];
+            case ERROR_SHARING_VIOLATION  : [[fallthrough]];
+            case ERROR_WRITE_PROTECT      : return ErrorCode::accessDenied;
+            case ERROR_FILE_EXISTS        : [[fallthrough]];
+            case ERROR_ALREADY_EXISTS     : return ErrorCode::alreadyExist;
+            case ERROR_INVALID_NAME       : return ErrorCode::invalidName;
+            case ERROR_NOT_ENOUGH_MEMORY  : [[fallthrough]];
+            case ERROR_OUTOFMEMORY        : return ErrorCode::noMemory;
+            case ERROR_INVALID_PARAMETER  : return ErrorCode::invalidArgument;
+            default                       : return ErrorCode::genericError;
+        }
+    }
+
+#else // Generic POSIX - Linups etc
+
+    static ErrorCode errorCodeFromErrno(int err)
+    {
+        switch(err)
+        {
+            case ENOENT       : return ErrorCode::notFound;
+            case EACCES       : [[fallthrough]];
+            case EPERM        : [[fallthrough]];
+            case EROFS        : return ErrorCode::accessDenied;
+            case EEXIST       : return ErrorCode::alreadyExist;
+            case ENOTDIR      : return ErrorCode::notDirectory;
+            case ENAMETOOLONG : return ErrorCode::invalidName;
+            case ENOMEM       : return ErrorCode::noMemory;
+            case EINVAL       : return ErrorCode::invalidArgument;
+            case EOVERFLOW    : return ErrorCode::outOfRange;
+            default           : return ErrorCode::genericError;
+        }
+    }
+
+#endif
+
+
+public:
+
+    NativeFileHandleImpl()                                        = default;
+    NativeFileHandleImpl(const NativeFileHandleImpl &)            = delete;
+    NativeFileHandleImpl(NativeFileHandleImpl &&)                 = delete;
+    NativeFileHandleImpl& operator=(const NativeFileHandleImpl &) = delete;
+    NativeFileHandleImpl& operator=(NativeFileHandleImpl &&)      = delete;
+
+    ~NativeFileHandleImpl()
+    {
+        close();
+    }
+
+
+#if defined(WIN32) || defined(_WIN32)
+
+    ErrorCode open(const std::wstring &nativeName, OpenMode openMode)
+    {
+        close();
+
+        DWORD dwAccess = 0;
+        if ((openMode&OpenMode::read)!=0)
+        {
+            dwAccess |= GENERIC_READ;
+        }
+
+        if ((openMode&OpenMode::write)!=0)
+        {
+            dwAccess |= GENERIC_WRITE;
+        }
+
+        if (!dwAccess)
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        bool bCreate   = (openMode&OpenMode::create  )!=0;
+        bool bTruncate = (openMode&OpenMode::truncate)!=0;
+
+        DWORD dwCreationDisposition = OPEN_EXISTING;
+        if (bCreate && (openMode&OpenMode::exclusive)!=0)
+        {
+            dwCreationDisposition = CREATE_NEW; // Существующий файл - ошибка, а не перезапись
+        }
+        else if (bCreate && bTruncate)
+        {
+            dwCreationDisposition = CREATE_ALWAYS;
+        }
+        else if (bCreate)
+        {
+            dwCreationDisposition = OPEN_ALWAYS;
+        }
+        else if (bTruncate)
+        {
+            dwCreationDisposition = TRUNCATE_EXISTING;
+        }
+
+        HANDLE hFile = CreateFileW( nativeName.c_str(), dwAccess
+                                  , FILE_SHARE_READ | ((openMode&OpenMode::write)!=0 ? 0 : FILE_SHARE_WRITE)
+                                  , 0 // lpSecurityAttributes
+                                  , dwCreationDisposition
+                                  , FILE_ATTRIBUTE_NORMAL
+                                  , 0 // hTemplateFile
+                                  );
+        if (hFile==INVALID_HANDLE_VALUE)
+        {
+            return errorCodeFromLastError();
+        }
+
+        m_hFile    = hFile;
+        m_openMode = openMode;
+        m_curPos   = 0;
+
+        return ErrorCode::ok;
+    }
+
+    virtual bool isOpened() const override
+    {
+        return m_hFile!=INVALID_HANDLE_VALUE;
+    }
+
+    virtual ErrorCode close() override
+    {
+        if (m_hFile==INVALID_HANDLE_VALUE)
+        {
+            return ErrorCode::ok;
+        }
+
+        BOOL bRes = CloseHandle(m_hFile);
+        m_hFile    = INVALID_HANDLE_VALUE;
+        m_openMode = OpenMode::none;
+        m_curPos   = 0;
+
+        return bRes ? ErrorCode::ok : ErrorCode::genericError;
+    }
+
+    virtual ErrorCode getSize(FileSize &fileSize) const override
+    {
+        if (!isOpened())
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        LARGE_INTEGER li;
+        if (!GetFileSizeEx(m_hFile, &li))
+        {
+            return errorCodeFromLastError();
+        }
+
+        fileSize = (FileSize)li.QuadPart;
+
+        return ErrorCode::ok;
+    }
+
+    // Хэндл синхронный, поэтому ReadFile/WriteFile с OVERLAPPED отрабатывают синхронно с заданного смещения.
+    // Системный указатель позиции при этом сдвигается, но мы его не используем
+    virtual ErrorCode readAt(FileSize offset, void *pBuf, std::size_t bufSize, std::size_t *pNumRead = 0) const override
+    {
+        if (pNumRead)
+        {
+            *pNumRead = 0;
+        }
+
+        if (!isOpened() || (m_openMode&OpenMode::read)==0)
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        std::uint8_t *pDst      = (std::uint8_t*)pBuf;
+        std::size_t   totalRead = 0;
+
+        while(totalRead<bufSize)
+        {
+            DWORD toRead = (DWORD)std::min(bufSize-totalRead, getMaxIoChunkSize());
+            FileSize curOffset = offset + totalRead;
+
+            OVERLAPPED ov = {0};
+            ov.Offset     = (DWORD)(curOffset&0xFFFFFFFFull);
+            ov.OffsetHigh = (DWORD)(curOffset>>32);
+
+            DWORD numRead = 0;
+            if (!ReadFile(m_hFile, pDst+totalRead, toRead, &numRead, &ov))
+            {
+                if (GetLastError()==ERROR_HANDLE_EOF)
+                {
+                    break;
+                }
+
+                return errorCodeFromLastError();
+            }
+
+            if (!numRead)
+            {
+                break; // EOF
+            }
+
+            totalRead += numRead;
+        }
+
+        if (pNumRead)
+        {
+            *pNumRead = totalRead;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    virtual ErrorCode writeAt(FileSize offset, const void *pData, std::size_t dataSize, std::size_t *pNumWritten = 0) const override
+    {
+        if (pNumWritten)
+        {
+            *pNumWritten = 0;
+        }
+
+        if (!isOpened() || (m_openMode&OpenMode::write)==0)
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        const std::uint8_t *pSrc         = (const std::uint8_t*)pData;
+        std::size_t         totalWritten = 0;
+
+        while(totalWritten<dataSize)
+        {
+            DWORD toWrite = (DWORD)std::min(dataSize-totalWritten, getMaxIoChunkSize());
+            FileSize curOffset = offset + totalWritten;
+
+            OVERLAPPED ov = {0};
+            ov.Offset     = (DWORD)(curOffset&0xFFFFFFFFull);
+            ov.OffsetHigh = (DWORD)(curOffset>>32);
+
+            DWORD numWritten = 0;
+            if (!WriteFile(m_hFile, pSrc+totalWritten, toWrite, &numWritten, &ov))
+            {
+                return errorCodeFromLastError();
+            }
+
+            if (!numWritten)
+            {
+                return ErrorCode::genericError;
+            }
+
+            totalWritten += numWritten;
+        }
+
+        if (pNumWritten)
+        {
+            *pNumWritten = totalWritten;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    //! Отображает файл целиком в память только для чтения
+    ErrorCode mapView(MappedView &mappedView) const
+    {
+        if (!isOpened() || (m_openMode&OpenMode::read)==0)
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        FileSize fileSize = 0;
+        ErrorCode err = getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (!fileSize)
+        {
+            // Пустой файл отобразить нельзя, но и не нужно
+            mappedView = MappedView();
+            return ErrorCode::ok;
+        }
+
+        if (fileSize>(FileSize)SIZE_MAX)
+        {
+            return ErrorCode::outOfRange;
+        }
+
+        HANDLE hMapping = CreateFileMappingW(m_hFile, 0, PAGE_READONLY, 0, 0, 0);
+        if (!hMapping)
+        {
+            return errorCodeFromLastError();
+        }
+
+        void *pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+
+        // Отображение держит объект проекции сам, хэндл больше не нужен
+        CloseHandle(hMapping);
+
+        if (!pView)
+        {
+            return errorCodeFromLastError();
+        }
+
+        std::shared_ptr<void> pHolder(pView, [](void *p) { UnmapViewOfFile(p); });
+        mappedView = MappedView((const std::uint8_t*)pView, (std::size_t)fileSize, true, pHolder);
+
+        return ErrorCode::ok;
+    }
+
+#else // Generic POSIX - Linups etc
+
+    ErrorCode open(const std::string &nativeName, OpenMode openMode)
+    {
+        close();
+
+        int flags = 0;
+
+        bool bRead  = (openMode&OpenMode::read )!=0;
+        bool bWrite = (openMode&OpenMode::write)!=0;
+
+        if (bRead && bWrite)
+        {
+            flags = O_RDWR;
+        }
+        else if (bRead)
+        {
+            flags = O_RDONLY;
+        }
+        else if (bWrite)
+        {
+            flags = O_WRONLY;
+        }
+        else
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        if ((openMode&OpenMode::create)!=0)
+        {
+            flags |= O_CREAT;
+
+            if ((openMode&OpenMode::exclusive)!=0)
+            {
+                flags |= O_EXCL; // Существующий файл - ошибка, а не перезапись
+            }
+        }
+
+        if ((openMode&OpenMode::truncate)!=0)
+        {
+            flags |= O_TRUNC;
+        }
+
+        #if defined(O_CLOEXEC)
+            flags |= O_CLOEXEC;
+        #endif
+
+        int fd = -1;
+        do
+        {
+            fd = ::open(nativeName.c_str(), flags, 0666);
+        } while(fd<0 && errno==EINTR);
+
+        if (fd<0)
+        {
+            return errorCodeFromErrno(errno);
+        }
+
+        m_fd       = fd;
+        m_openMode = openMode;
+        m_curPos   = 0;
+
+        return ErrorCode::ok;
+    }
+
+    virtual bool isOpened() const override
+    {
+        return m_fd>=0;
+    }
+
+    virtual ErrorCode close() override
+    {
+        if (m_fd<0)
+        {
+            return ErrorCode::ok;
+        }
+
+        int res = ::close(m_fd);
+        m_fd       = -1;
+        m_openMode = OpenMode::none;
+        m_curPos   = 0;
+
+        return res==0 ? ErrorCode::ok : ErrorCode::genericError;
+    }
+
+    virtual ErrorCode getSize(FileSize &fileSize) const override
+    {
+        if (!isOpened())
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        struct stat st;
+        if (::fstat(m_fd, &st)!=0)
+        {
+            return errorCodeFromErrno(errno);
+        }
+
+        fileSize = (FileSize)st.st_size;
+
+        return ErrorCode::ok;
+    }
+
+    virtual ErrorCode readAt(FileSize offset, void *pBuf, std::size_t bufSize, std::size_t *pNumRead = 0) const override
+    {
+        if (pNumRead)
+        {
+            *pNumRead = 0;
+        }
+
+        if (!isOpened() || (m_openMode&OpenMode::read)==0)
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        std::uint8_t *pDst      = (std::uint8_t*)pBuf;
+        std::size_t   totalRead = 0;
+
+        while(totalRead<bufSize)
+        {
+            std::size_t toRead = std::min(bufSize-totalRead, getMaxIoChunkSize());
+            ssize_t numRead = ::pread(m_fd, pDst+totalRead, toRead, (off_t)(offset+totalRead));
+            if (numRead<0)
+            {
+                if (errno==EINTR)
+                {
+                    continue;
+                }
+
+                return errorCodeFromErrno(errno);
+            }
+
+            if (!numRead)
+            {
+                break; // EOF
+            }
+
+            totalRead += (std::size_t)numRead;
+        }
+
+        if (pNumRead)
+        {
+            *pNumRead = totalRead;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    virtual ErrorCode writeAt(FileSize offset, const void *pData, std::size_t dataSize, std::size_t *pNumWritten = 0) const override
+    {
+        if (pNumWritten)
+        {
+            *pNumWritten = 0;
+        }
+
+        if (!isOpened() || (m_openMode&OpenMode::write)==0)
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        const std::uint8_t *pSrc         = (const std::uint8_t*)pData;
+        std::size_t         totalWritten = 0;
+
+        while(totalWritten<dataSize)
+        {
+            std::size_t toWrite = std::min(dataSize-totalWritten, getMaxIoChunkSize());
+            ssize_t numWritten = ::pwrite(m_fd, pSrc+totalWritten, toWrite, (off_t)(offset+totalWritten));
+            if (numWritten<0)
+            {
+                if (errno==EINTR)
+                {
+                    continue;
+                }
+
+                return errorCodeFromErrno(errno);
+            }
+
+            if (!numWritten)
+            {
+                return ErrorCode::genericError;
+            }
+
+            totalWritten += (std::size_t)numWritten;
+        }
+
+        if (pNumWritten)
+        {
+            *pNumWritten = totalWritten;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    //! Отображает файл целиком в память только для чтения
+    ErrorCode mapView(MappedView &mappedView) const
+    {
+        if (!isOpened() || (m_openMode&OpenMode::read)==0)
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        FileSize fileSize = 0;
+        ErrorCode err = getSize(fileSize);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (!fileSize)
+        {
+            // Пустой файл отобразить нельзя, но и не нужно
+            mappedView = MappedView();
+            return ErrorCode::ok;
+        }
+
+        if (fileSize>(FileSize)SIZE_MAX)
+        {
+            return ErrorCode::outOfRange;
+        }
+
+        std::size_t mapSize = (std::size_t)fileSize;
+
+        // MAP_SHARED - страницы берутся из page cache и разделяются между процессами
+        void *pView = ::mmap(0, mapSize, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (pView==MAP_FAILED)
+        {
+            return errorCodeFromErrno(errno);
+        }
+
+        // Отображение остаётся валидным и после закрытия дескриптора
+        std::shared_ptr<void> pHolder(pView, [mapSize](void *p) { ::munmap(p, mapSize); });
+        mappedView = MappedView((const std::uint8_t*)pView, mapSize, true, pHolder);
+
+        return ErrorCode::ok;
+    }
+
+#endif
+
+
+    virtual OpenMode getOpenMode() const override
+    {
+        return m_openMode;
+    }
+
+    virtual ErrorCode read(void *pBuf, std::size_t bufSize, std::size_t *pNumRead = 0) override
+    {
+        std::size_t numRead = 0;
+        ErrorCode err = readAt(m_curPos, pBuf, bufSize, &numRead);
+        m_curPos += numRead;
+
+        if (pNumRead)
+        {
+            *pNumRead = numRead;
+        }
+
+        return err;
+    }
+
+    virtual ErrorCode write(const void *pData, std::size_t dataSize, std::size_t *pNumWritten = 0) override
+    {
+        std::size_t numWritten = 0;
+        ErrorCode err = writeAt(m_curPos, pData, dataSize, &numWritten);
+        m_curPos += numWritten;
+
+        if (pNumWritten)
+        {
+            *pNumWritten = numWritten;
+        }
+
+        return err;
+    }
+
+    virtual ErrorCode seek(FileOffset offset, SeekOrigin origin, FileSize *pNewPos = 0) override
+    {
+        if (!isOpened())
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        FileOffset basePos = 0;
+
+        switch(origin)
+        {
+            case SeekOrigin::begin:
+                 basePos = 0;
+                 break;
+
+            case SeekOrigin::current:
+                 basePos = (FileOffset)m_curPos;
+                 break;
+
+            case SeekOrigin::end:
+            {
+                 FileSize fileSize = 0;
+                 ErrorCode err = getSize(fileSize);
+                 if (err!=ErrorCode::ok)
+                 {
+                     return err;
+                 }
+                 basePos = (FileOffset)fileSize;
+                 break;
+            }
+
+            default:
+                 return ErrorCode::invalidArgument;
+        }
+
+        FileOffset newPos = basePos + offset;
+        if (newPos<0)
+        {
+            return ErrorCode::outOfRange;
+        }
+
+        // Как и у lseek/SetFilePointerEx, позиция за концом файла допустима
+        m_curPos = (FileSize)newPos;
+
+        if (pNewPos)
+        {
+            *pNewPos = m_curPos;
+        }
+
+        return ErrorCode::ok;
+    }
+
+    virtual ErrorCode tell(FileSize &pos) const override
+    {
+        if (!isOpened())
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        pos = m_curPos;
+
+        return ErrorCode::ok;
+    }
+
+
+}; // class NativeFileHandleImpl
+
+
+} // namespace marty_virtual_fs
+
@@ -0,0 +1,256 @@
+/*! \file
+    \brief Natural ("digits as number") string comparison and its precomputed sort key
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+/*! Естественный порядок: последовательности десятичных цифр сравниваются как числа любой длины
+    (frame_2 < frame_10), остальные символы - по кодам после mapChar (например, приведения регистра).
+
+    - Ведущие нули на значение числа не влияют: "a01" и "a1" - одно число. Если строки больше ничем
+      не различаются, то раньше идёт та, у которой в первом таком числе меньше ведущих нулей.
+    - Число по отношению к прочим символам ведёт себя как его первая цифра.
+    - Длина числа не ограничена - цифры не переводятся в целое, а сравниваются по длине и поразрядно.
+
+    Сравнение не выделяет памяти. Ключ (makeNaturalSortKey) - байтовая строка, побайтовое сравнение
+    ключей (memcmp, при равенстве - короче меньше) даёт тот же порядок, что и naturalCompare.
+ */
+
+
+template<typename CharType> inline
+bool isNaturalDigit(CharType ch)
+{
+    return ch>=(CharType)'0' && ch<=(CharType)'9';
+}
+
+//! Символы без преобразования
+struct NaturalIdentityCharMapper
+{
+    template<typename CharType>
+    CharType operator()(CharType ch) const
+    {
+        return ch;
+    }
+};
+
+//! Возвращает -1, 0 или 1
+template<typename CharType, typename CharMapper> inline
+int naturalCompare(const CharType *p1, std::size_t len1, const CharType *p2, std::size_t len2, CharMapper mapChar)
+{
+    typedef typename std::make_unsigned<CharType>::type  UCharType;
+
+    const CharType zero = (CharType)'0';
+
+    std::size_t i1        = 0;
+    std::size_t i2        = 0;
+    int         zerosCmp  = 0; // Различие в числе ведущих нулей первого такого числа
+
+    while(i1<len1 && i2<len2)
+    {
+        CharType c1 = p1[i1];
+        CharType c2 = p2[i2];
+
+        if (isNaturalDigit(c1) && isNaturalDigit(c2))
+        {
+            std::size_t z1 = i1;
+            std::size_t z2 = i2;
+            while(z1<len1 && p1[z1]==zero) ++z1;
+            while(z2<len2 && p2[z2]==zero) ++z2;
+
+            std::size_t e1 = z1;
+            std::size_t e2 = z2;
+            while(e1<len1 && isNaturalDigit(p1[e1])) ++e1;
+            while(e2<len2 && isNaturalDigit(p2[e2])) ++e2;
+
+            // Значащих цифр больше - число больше
+            if (e1-z1 != e2-z2)
+            {
+                return (e1-z1)<(e2-z2) ? -1 : 1;
+            }
+
+            for(std::size_t k=0; k!=e1-z1; ++k)
+            {
+                if (p1[z1+k]!=p2[z2+k])
+                {
+                    return p1[z1+k]<p2[z2+k] ? -1 : 1;
+                }
+            }
+
+            if (!zerosCmp && (z1-i1)!=(z2-i2))
+            {
+                zerosCmp = (z1-i1)<(z2-i2) ? -1 : 1;
+            }
+
+            i1 = e1;
+            i2 = e2;
+            continue;
+        }
+
+        UCharType u1 = (UCharType)mapChar(c1);
+        UCharType u2 = (UCharType)mapChar(c2);
+        if (u1!=u2)
+        {
+            return u1<u2 ? -1 : 1;
+        }
+
+        ++i1;
+        ++i2;
+    }
+
+    if (i1<len1)
+    {
+        return 1;
+    }
+
+    if (i2<len2)
+    {
+        return -1;
+    }
+
+    return zerosCmp;
+}
+
+template<typename StringType, typename CharMapper> inline
+int naturalCompare(const StringType &s1, const StringType &s2, CharMapper mapChar)
+{
+    return naturalCompare(s1.data(), s1.size(), s2.data(), s2.size(), mapChar);
+}
+
+template<typename StringType> inline
+int naturalCompare(const StringType &s1, const StringType &s2)
+{
+    return naturalCompare(s1.data(), s1.size(), s2.data(), s2.size(), NaturalIdentityCharMapper());
+}
+
+
+namespace natural_compare_impl {
+
+//! Код символа - sizeof(CharType) байт, старшие первыми
+template<typename CharType> inline
+void appendCharCode(std::string &key, CharType ch)
+{
+    typedef typename std::make_unsigned<CharType>::type  UCharType;
+
+    std::uint64_t code = (std::uint64_t)(UCharType)ch;
+    for(std::size_t i=sizeof(CharType); i!=0; --i)
+    {
+        key.append(1, (char)(unsigned char)((code>>((i-1)*8))&0xFF));
+    }
+}
+
+//! Длина, сохраняющая порядок: до 254 - один байт, больше - 0xFF и 8 байт, старшие первыми
+inline
+void appendLength(std::string &key, std::size_t len)
+{
+    if (len<0xFF)
+    {
+        key.append(1, (char)(unsigned char)len);
+        return;
+    }
+
+    key.append(1, (char)(unsigned char)0xFF);
+    for(std::size_t i=8; i!=0; --i)
+    {
+        key.append(1, (char)(unsigned char)(((std::uint64_t)len>>((i-1)*8))&0xFF));
+    }
+}
+
+} // namespace natural_compare_impl
+
+
+//! Ключ естественного порядка
+/*! Каждый символ - его код (после mapChar) в sizeof(CharType) байт. Число - код символа '0',
+    число значащих цифр и сами значащие цифры. В конце - нулевой код (он меньше кода любого символа имени,
+    так что более короткое имя остаётся раньше) и числа ведущих нулей всех чисел по порядку.
+ */
+template<typename CharType, typename CharMapper> inline
+void makeNaturalSortKey(const CharType *p, std::size_t len, CharMapper mapChar, std::string &key)
+{
+    key.clear();
+    key.reserve(len*sizeof(CharType) + 8);
+
+    const CharType zero = (CharType)'0';
+
+    std::size_t nNumbers = 0;
+
+    for(std::size_t i=0; i<len; )
+    {
+        if (!isNaturalDigit(p[i]))
+        {
+            natural_compare_impl::appendCharCode(key, mapChar(p[i]));
+            ++i;
+            continue;
+        }
+
+        std::size_t z = i;
+        while(z<len && p[z]==zero) ++z;
+
+        std::size_t e = z;
+        while(e<len && isNaturalDigit(p[e])) ++e;
+
+        natural_compare_impl::appendCharCode(key, zero);
+        natural_compare_impl::appendLength(key, e-z);
+        for(std::size_t k=z; k!=e; ++k)
+        {
+            key.append(1, (char)(unsigned char)(p[k]-zero));
+        }
+
+        ++nNumbers;
+        i = e;
+    }
+
+    natural_compare_impl::appendCharCode(key, (CharType)0);
+
+    // Ведущие нули - последний критерий
+    for(std::size_t i=0; i<len && nNumbers; )
+    {
+        if (!isNaturalDigit(p[i]))
+        {
+            ++i;
+            continue;
+        }
+
+        std::size_t z = i;
+        while(z<len && p[z]==zero) ++z;
+
+        natural_compare_impl::appendLength(key, z-i);
+
+        while(z<len && isNaturalDigit(p[z])) ++z;
+        i = z;
+    }
+}
+
+template<typename StringType, typename CharMapper> inline
+std::string makeNaturalSortKey(const StringType &str, CharMapper mapChar)
+{
+    std::string key;
+    makeNaturalSortKey(str.data(), str.size(), mapChar, key);
+    return key;
+}
+
+template<typename StringType> inline
+std::string makeNaturalSortKey(const StringType &str)
+{
+    return makeNaturalSortKey(str, NaturalIdentityCharMapper());
+}
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
@@ -0,0 +1,196 @@
+/*! \file
+    \brief Parallel stable merge sort
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+//
+#include "work_stealing_thread_pool.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Для слияния [a, a+nA) и [b, b+nB): сколько элементов первого диапазона попадает в первые d элементов результата
+/*! Слияние устойчивое - при равенстве первым идёт элемент из первого диапазона, как в std::merge
+ */
+template<typename RandomIt, typename Compare> inline
+std::size_t mergePathSplit(RandomIt a, std::size_t nA, RandomIt b, std::size_t nB, std::size_t d, Compare &comp)
+{
+    std::size_t lo = d>nB ? d-nB : 0;
+    std::size_t hi = d<nA ? d    : nA;
+
+    while(lo<hi)
+    {
+        std::size_t mid = lo + (hi-lo)/2;
+        std::size_t j   = d - mid;
+
+        if (j>0 && !comp(b[j-1], a[mid])) // a[mid] должен попасть раньше b[j-1]
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+//! Устойчивая параллельная сортировка слиянием
+/*! Вектор режется на куски по числу потоков, куски сортируются std::stable_sort параллельно,
+    затем сливаются попарно. Каждое слияние тоже режется на части (разбиение по "диагоналям"
+    слияния двоичным поиском), так что и последние слияния идут во все потоки.
+    Порядок равных элементов - как у std::stable_sort.
+
+    Задачи ставятся в переданный пул группой (ThreadPoolTaskGroup), вызывающий поток тоже участвует,
+    поэтому вызывать можно и из задачи этого же пула.
+    maxConcurrency==0 - по числу потоков пула. Маленькие векторы сортируются в вызывающем потоке.
+ */
+template<typename ValueType, typename Compare> inline
+void parallelStableSort(std::vector<ValueType> &v, Compare comp, WorkStealingThreadPool &pool, std::size_t maxConcurrency = 0)
+{
+    const std::size_t minChunkSize = 4096; // Меньше - потоки не окупаются
+
+    const std::size_t n = v.size();
+
+    if (!maxConcurrency)
+    {
+        maxConcurrency = pool.getThreadsCount();
+    }
+
+    std::size_t nChunks = std::min(maxConcurrency, n/minChunkSize);
+    if (nChunks<2)
+    {
+        std::stable_sort(v.begin(), v.end(), comp);
+        return;
+    }
+
+    // Границы отсортированных серий
+    std::vector<std::size_t> bounds(nChunks+1);
+    for(std::size_t k=0; k<=nChunks; ++k)
+    {
+        bounds[k] = n*k/nChunks;
+    }
+
+    ThreadPoolTaskGroup group(pool, nChunks);
+
+    for(std::size_t k=0; k!=nChunks; ++k)
+    {
+        group.submit([&v, &bounds, &comp, k]()
+                    {
+                        std::stable_sort(v.begin()+(std::ptrdiff_t)bounds[k], v.begin()+(std::ptrdiff_t)bounds[k+1], comp);
+                    }
+                   );
+    }
+
+    group.wait();
+
+    std::vector<ValueType>  buf(n);
+    std::vector<ValueType> *pSrc = &v;
+    std::vector<ValueType> *pDst = &buf;
+
+    while(bounds.size()>2)
+    {
+        const std::size_t nRuns  = bounds.size()-1;
+        const std::size_t nPairs = nRuns/2;
+        const std::size_t nParts = std::max<std::size_t>(1, nChunks/nPairs); // Частей на одно слияние
+
+        for(std::size_t p=0; p!=nPairs; ++p)
+        {
+            for(std::size_t part=0; part!=nParts; ++part)
+            {
+                group.submit([pSrc, pDst, &bounds, &comp, p, part, nParts]()
+                            {
+                                auto  src = pSrc->begin();
+                                auto  dst = pDst->begin();
+
+                                std::size_t aBegin = bounds[2*p], bBegin = bounds[2*p+1], bEnd = bounds[2*p+2];
+                                std::size_t nA     = bBegin - aBegin;
+                                std::size_t nB     = bEnd   - bBegin;
+                                std::size_t total  = nA + nB;
+
+                                std::size_t d1 = total*part/nParts;
+                                std::size_t d2 = total*(part+1)/nParts;
+
+                                std::size_t i1 = mergePathSplit(src+(std::ptrdiff_t)aBegin, nA, src+(std::ptrdiff_t)bBegin, nB, d1, comp);
+                                std::size_t i2 = mergePathSplit(src+(std::ptrdiff_t)aBegin, nA, src+(std::ptrdiff_t)bBegin, nB, d2, comp);
+
+                                std::merge( std::make_move_iterator(src+(std::ptrdiff_t)(aBegin+i1)), std::make_move_iterator(src+(std::ptrdiff_t)(aBegin+i2))
+                                          , std::make_move_iterator(src+(std::ptrdiff_t)(bBegin+d1-i1)), std::make_move_iterator(src+(std::ptrdiff_t)(bBegin+d2-i2))
+                                          , dst+(std::ptrdiff_t)(aBegin+d1)
+                                          , comp
+                                          );
+                            }
+                           );
+            }
+        }
+
+        if (nRuns%2) // Последняя серия без пары - просто переносим
+        {
+            std::size_t lastBegin = bounds[nRuns-1];
+            std::move(pSrc->begin()+(std::ptrdiff_t)lastBegin, pSrc->end(), pDst->begin()+(std::ptrdiff_t)lastBegin);
+        }
+
+        group.wait();
+
+        std::vector<std::size_t> newBounds;
+        newBounds.reserve(nPairs+2);
+        for(std::size_t k=0; k<bounds.size(); k+=2)
+        {
+            newBounds.emplace_back(bounds[k]);
+        }
+
+        if (newBounds.back()!=n)
+        {
+            newBounds.emplace_back(n);
+        }
+
+        bounds.swap(newBounds);
+        std::swap(pSrc, pDst);
+    }
+
+    if (pSrc!=&v)
+    {
+        v.swap(buf);
+    }
+}
+
+//! То же на общем пуле (WorkStealingThreadPool::getDefaultPool()), maxConcurrency==0 - по числу ядер
+template<typename ValueType, typename Compare> inline
+void parallelStableSort(std::vector<ValueType> &v, Compare comp, std::size_t maxConcurrency = 0)
+{
+    const std::size_t minChunkSize = 4096;
+
+    if (!maxConcurrency)
+    {
+        maxConcurrency = WorkStealingThreadPool::getDefaultThreadsCount();
+    }
+
+    if (maxConcurrency<2 || v.size()<2*minChunkSize)
+    {
+        std::stable_sort(v.begin(), v.end(), comp); // Пул не трогаем
+        return;
+    }
+
+    parallelStableSort(v, comp, *WorkStealingThreadPool::getDefaultPool(), maxConcurrency);
+}
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
@@ -0,0 +1,278 @@
+/*! \file
+    \brief Single-pass virtual path normalizer with inline storage and component offsets
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Компонент нормализованного пути - смещение и длина в буфере нормализатора
+struct PathComponent
+{
+    std::size_t  offset = 0;
+    std::size_t  length = 0;
+};
+
+
+//! Нормализатор виртуальных путей за один проход
+/*! Правила - те же, что у normalizeFilename:
+
+    - разделители - '/' и '\\', в результате - '/', повторные разделители схлопываются;
+    - ведущий разделитель сохраняется (абсолютный путь остаётся абсолютным);
+    - "." выбрасывается, ".." удаляет предыдущий компонент, а на корне просто выбрасывается -
+      за пределы песочницы путь не выходит;
+    - хвостовой разделитель удаляется, если путь - не один только корень.
+
+    Результат никогда не длиннее исходного пути, поэтому запись идёт следом за чтением
+    и нормализовать можно на месте (normalizeTo с pDst==pSrc, normalizePathInPlace).
+
+    Пути до InlineChars символов и до InlineComponents компонентов обрабатываются без выделения памяти,
+    для более длинных буферы выделяются в куче (и переиспользуются при повторных вызовах normalize).
+ */
+template<typename CharType, std::size_t InlineChars = 260, std::size_t InlineComponents = 32>
+class PathNormalizerT
+{
+
+protected:
+
+    CharType                    m_inlineChars[InlineChars];
+    std::vector<CharType>       m_heapChars;
+    const CharType             *m_pData = m_inlineChars;
+    std::size_t                 m_size  = 0;
+    bool                        m_bAbsolute = false;
+
+    PathComponent               m_inlineComponents[InlineComponents];
+    std::vector<PathComponent>  m_heapComponents;
+    std::size_t                 m_numComponents = 0;
+
+
+    static bool isSep(CharType ch)
+    {
+        return ch==(CharType)'/' || ch==(CharType)'\\';
+    }
+
+    PathComponent* componentsData()
+    {
+        return m_heapComponents.empty() ? m_inlineComponents : m_heapComponents.data();
+    }
+
+    const PathComponent* componentsData() const
+    {
+        return m_heapComponents.empty() ? m_inlineComponents : m_heapComponents.data();
+    }
+
+    void pushComponent(std::size_t offset, std::size_t length)
+    {
+        if (m_numComponents==InlineComponents && m_heapComponents.empty())
+        {
+            m_heapComponents.assign(m_inlineComponents, m_inlineComponents+InlineComponents);
+        }
+
+        if (!m_heapComponents.empty())
+        {
+            if (m_numComponents==m_heapComponents.size())
+            {
+                m_heapComponents.emplace_back();
+            }
+        }
+
+        PathComponent &c = componentsData()[m_numComponents++];
+        c.offset = offset;
+        c.length = length;
+    }
+
+
+public:
+
+    PathNormalizerT() = default;
+
+    // Указывает на собственный буфер - копирование не имеет смысла
+    PathNormalizerT(const PathNormalizerT &) = delete;
+    PathNormalizerT& operator=(const PathNormalizerT &) = delete;
+
+
+    //! Нормализует [pSrc, pSrc+len) в pDst (не менее len символов, может совпадать с pSrc). Возвращает длину результата
+    /*! Компоненты результата доступны через getComponentsCount/getComponent, data() этот вызов не меняет
+     */
+    std::size_t normalizeTo(const CharType *pSrc, std::size_t len, CharType *pDst)
+    {
+        m_numComponents = 0;
+        m_bAbsolute     = len>0 && isSep(pSrc[0]);
+
+        std::size_t w = 0; // Позиция записи, всегда не больше позиции чтения
+        if (m_bAbsolute)
+        {
+            pDst[w++] = (CharType)'/';
+        }
+
+        const std::size_t rootLen = w;
+
+        std::size_t r = 0;
+        while(r<len)
+        {
+            while(r<len && isSep(pSrc[r]))
+            {
+                ++r;
+            }
+
+            std::size_t b = r;
+            while(r<len && !isSep(pSrc[r]))
+            {
+                ++r;
+            }
+
+            std::size_t compLen = r-b;
+            if (compLen==0)
+            {
+                break;
+            }
+
+            if (compLen==1 && pSrc[b]==(CharType)'.')
+            {
+                continue;
+            }
+
+            if (compLen==2 && pSrc[b]==(CharType)'.' && pSrc[b+1]==(CharType)'.')
+            {
+                if (m_numComponents) // На корне ".." просто выбрасывается
+                {
+                    --m_numComponents;
+                    if (m_numComponents)
+                    {
+                        const PathComponent &prev = componentsData()[m_numComponents-1];
+                        w = prev.offset + prev.length;
+                    }
+                    else
+                    {
+                        w = rootLen;
+                    }
+                }
+
+                continue;
+            }
+
+            if (w!=rootLen)
+            {
+                pDst[w++] = (CharType)'/';
+            }
+
+            pushComponent(w, compLen);
+
+            for(std::size_t i=0; i!=compLen; ++i)
+            {
+                pDst[w++] = pSrc[b+i];
+            }
+        }
+
+        return w;
+    }
+
+    //! Нормализует путь во внутренний буфер
+    void normalize(const CharType *p, std::size_t len)
+    {
+        CharType *pBuf = m_inlineChars;
+        if (len>InlineChars)
+        {
+            if (m_heapChars.size()<len)
+            {
+                m_heapChars.resize(len);
+            }
+
+            pBuf = m_heapChars.data();
+        }
+
+        m_size  = normalizeTo(p, len, pBuf);
+        m_pData = pBuf;
+    }
+
+    template<typename StringType>
+    void normalize(const StringType &str)
+    {
+        normalize(str.data(), str.size());
+    }
+
+
+    const CharType* data() const     { return m_pData; }
+    std::size_t size() const         { return m_size; }
+    bool empty() const               { return m_size==0; }
+
+    //! Путь начинается с разделителя
+    bool isAbsolute() const          { return m_bAbsolute; }
+
+    //! Виртуальный корень - пустой путь или "/"
+    bool isRoot() const              { return m_numComponents==0; }
+
+    std::size_t getComponentsCount() const
+    {
+        return m_numComponents;
+    }
+
+    //! Компонент по индексу, смещение - от data()
+    PathComponent getComponent(std::size_t idx) const
+    {
+        return componentsData()[idx];
+    }
+
+    template<typename StringType>
+    StringType getComponentString(std::size_t idx) const
+    {
+        const PathComponent &c = componentsData()[idx];
+        return StringType(m_pData+c.offset, c.length);
+    }
+
+    //! Часть пути начиная с компонента idx (без ведущего разделителя). idx==getComponentsCount() - пустая строка
+    template<typename StringType>
+    StringType getTailString(std::size_t idx) const
+    {
+        if (idx>=m_numComponents)
+        {
+            return StringType();
+        }
+
+        std::size_t offset = componentsData()[idx].offset;
+        return StringType(m_pData+offset, m_size-offset);
+    }
+
+    template<typename StringType>
+    StringType str() const
+    {
+        return StringType(m_pData, m_size);
+    }
+
+}; // class PathNormalizerT
+
+//------------------------------
+typedef PathNormalizerT<char>     PathNormalizerA;
+typedef PathNormalizerT<wchar_t>  PathNormalizerW;
+
+
+//! Нормализация строки на месте - память под строку не выделяется
+template<typename StringType> inline
+void normalizePathInPlace(StringType &str)
+{
+    if (str.empty())
+    {
+        return;
+    }
+
+    PathNormalizerT<typename StringType::value_type> normalizer;
+    str.resize(normalizer.normalizeTo(str.data(), str.size(), &str[0]));
+}
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
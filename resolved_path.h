@@ -0,0 +1,115 @@
+/*! \file
+    \brief Resolved virtual path handle - normalized virtual path and native path, computed once
+*/
+
+#pragma once
+
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Разрешённый виртуальный путь
+/*! Получается через IFileSystem::resolvePath - нормализация имени, поиск точки монтирования
+    и построение родного пути выполняются один раз. Перегрузки файловых операций, принимающие
+    ResolvedPath, работают сразу с родным путём.
+
+    Разрешённый путь привязан к файловой системе, которая его выдала, и к состоянию её таблицы
+    монтирования. После добавления/удаления точек монтирования (или при передаче другой ФС)
+    операции с ним возвращают ErrorCode::invalidMountPoint - путь надо разрешить заново.
+
+    Для виртуального корня родной путь пустой, isVirtualRoot() возвращает true.
+ */
+template<typename StringType>
+class ResolvedPathT
+{
+
+public:
+
+#if defined(WIN32) || defined(_WIN32)
+    typedef std::wstring  NativeStringType; // Под виндой юникодное апи первично
+#else
+    typedef std::string   NativeStringType;
+#endif
+
+
+protected:
+
+    StringType        m_virtualPath    ; // Нормализованный виртуальный путь
+    StringType        m_mountPointName ; // Первый компонент виртуального пути
+    NativeStringType  m_nativePath     ;
+    bool              m_bVirtualRoot    = false;
+
+    const void       *m_pOwner          = 0;
+    std::uint64_t     m_mountGeneration = 0;
+
+
+public:
+
+    ResolvedPathT() = default;
+
+    //! Путь был разрешён (может быть уже устаревшим - это проверяет ФС)
+    bool isValid() const
+    {
+        return m_pOwner!=0;
+    }
+
+    bool isVirtualRoot() const
+    {
+        return m_bVirtualRoot;
+    }
+
+    const StringType& getVirtualPath() const          { return m_virtualPath; }
+    const StringType& getMountPointName() const       { return m_mountPointName; }
+    const NativeStringType& getNativePath() const     { return m_nativePath; }
+    std::uint64_t getMountGeneration() const          { return m_mountGeneration; }
+
+
+    // Для реализаций IFileSystem
+
+    void assign(const void *pOwner, std::uint64_t mountGeneration, StringType &&virtualPath, NativeStringType &&nativePath, bool bVirtualRoot)
+    {
+        typedef typename StringType::value_type CharType;
+
+        m_virtualPath     = std::move(virtualPath);
+        m_nativePath      = std::move(nativePath);
+        m_bVirtualRoot    = bVirtualRoot;
+        m_pOwner          = pOwner;
+        m_mountGeneration = mountGeneration;
+
+        std::size_t b = 0;
+        while(b<m_virtualPath.size() && m_virtualPath[b]==(CharType)'/')
+        {
+            ++b;
+        }
+
+        std::size_t e = m_virtualPath.find((CharType)'/', b);
+        m_mountPointName.assign(m_virtualPath, b, e==m_virtualPath.npos ? m_virtualPath.npos : e-b);
+    }
+
+    //! Путь выдан ФС pOwner при текущем состоянии её таблицы монтирования
+    bool isResolvedBy(const void *pOwner, std::uint64_t mountGeneration) const
+    {
+        return m_pOwner!=0 && m_pOwner==pOwner && m_mountGeneration==mountGeneration;
+    }
+
+}; // class ResolvedPathT
+
+//------------------------------
+typedef ResolvedPathT<std::string>   ResolvedPathA;
+typedef ResolvedPathT<std::wstring>  ResolvedPathW;
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
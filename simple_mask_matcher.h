@@ -0,0 +1,334 @@
+/*! \file
+    \brief Wildcard matcher for simple file masks ('*' and '?') without regexes
+*/
+
+#pragma once
+
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Сопоставление с простой маской ('*' - любое количество любых символов, '?' - любой символ)
+/*! Даёт тот же результат, что и regex, полученный через umba::regex_helpers::expandSimpleMaskToEcmaRegex,
+    при поиске через regex_search:
+    - с якорями маска должна совпасть со всей строкой, без якорей - с любой её подстрокой;
+    - '*' и '?', как и '.' в ECMAScript regex, не совпадают с '\n' и '\r'.
+
+    Маска разбивается звёздочками на сегменты, сегменты ищутся слева направо, каждый - в самой левой
+    возможной позиции. Возвратов нет, время линейное по длине имени (с множителем на длину сегмента
+    только при ложных срабатываниях первого символа).
+    Поиск первого литерального символа сегмента делается через std::char_traits::find (memchr/wmemchr),
+    которые в стандартной библиотеке векторизованы.
+ */
+template<typename StringType>
+class SimpleMaskMatcherT
+{
+
+public:
+
+    typedef typename StringType::value_type  CharType;
+    typedef std::char_traits<CharType>       TraitsType;
+
+
+protected:
+
+    struct Segment
+    {
+        std::size_t   pos          = 0; // Позиция в m_pattern
+        std::size_t   len          = 0;
+        std::size_t   firstLiteral = 0; // Индекс первого символа, не являющегося '?', len - таких нет
+    };
+
+    StringType              m_pattern     ; // Маска без звёздочек
+    std::vector<Segment>    m_segments    ;
+    bool                    m_anchored    = false;
+    bool                    m_leadingStar = false;
+    bool                    m_trailingStar= false;
+    std::size_t             m_minLen      = 0;
+
+
+    static bool isLineTerminator(CharType ch)
+    {
+        return ch==(CharType)'\n' || ch==(CharType)'\r';
+    }
+
+    bool matchSegmentAt(const CharType *pName, const Segment &seg) const
+    {
+        const CharType *pSeg = m_pattern.data() + seg.pos;
+        for(std::size_t i=0; i!=seg.len; ++i)
+        {
+            if (pSeg[i]!=(CharType)'?' && pSeg[i]!=pName[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Ищет самое левое вхождение сегмента в [from, to), возвращает позицию или StringType::npos
+    std::size_t findSegment(const CharType *pName, std::size_t from, std::size_t to, const Segment &seg) const
+    {
+        if (to<from || to-from<seg.len)
+        {
+            return StringType::npos;
+        }
+
+        std::size_t lastStart = to - seg.len; // Включительно
+
+        if (seg.firstLiteral==seg.len) // Одни '?'
+        {
+            return from;
+        }
+
+        const CharType  ch  = m_pattern[seg.pos+seg.firstLiteral];
+        std::size_t     cur = from;
+
+        while(cur<=lastStart)
+        {
+            const CharType *pFound = TraitsType::find(pName+cur+seg.firstLiteral, lastStart-cur+1, ch);
+            if (!pFound)
+            {
+                return StringType::npos;
+            }
+
+            std::size_t start = (std::size_t)(pFound-pName) - seg.firstLiteral;
+            if (matchSegmentAt(pName+start, seg))
+            {
+                return start;
+            }
+
+            cur = start + 1;
+        }
+
+        return StringType::npos;
+    }
+
+    // Имя без переводов строк
+    bool matchAnchored(const CharType *pName, std::size_t nameLen) const
+    {
+        if (nameLen<m_minLen)
+        {
+            return false;
+        }
+
+        std::size_t nSegs = m_segments.size();
+        if (!nSegs)
+        {
+            return m_leadingStar || nameLen==0;
+        }
+
+        if (!m_leadingStar && !m_trailingStar && nSegs==1)
+        {
+            return nameLen==m_segments[0].len && matchSegmentAt(pName, m_segments[0]);
+        }
+
+        std::size_t pos      = 0;
+        std::size_t endLimit = nameLen;
+        std::size_t first    = 0;
+        std::size_t last     = nSegs; // Не включительно
+
+        if (!m_leadingStar) // Префикс
+        {
+            if (!matchSegmentAt(pName, m_segments[0]))
+            {
+                return false;
+            }
+
+            pos   = m_segments[0].len;
+            first = 1;
+        }
+
+        if (!m_trailingStar) // Суффикс
+        {
+            const Segment &seg = m_segments[nSegs-1];
+            endLimit = nameLen - seg.len;
+            if (endLimit<pos || !matchSegmentAt(pName+endLimit, seg))
+            {
+                return false;
+            }
+
+            last = nSegs-1;
+        }
+
+        for(std::size_t i=first; i<last; ++i)
+        {
+            std::size_t found = findSegment(pName, pos, endLimit, m_segments[i]);
+            if (found==StringType::npos)
+            {
+                return false;
+            }
+
+            pos = found + m_segments[i].len;
+        }
+
+        return true;
+    }
+
+    // Имя без переводов строк
+    bool matchUnanchored(const CharType *pName, std::size_t nameLen) const
+    {
+        if (nameLen<m_minLen)
+        {
+            return false;
+        }
+
+        std::size_t pos = 0;
+        for(const auto &seg : m_segments)
+        {
+            std::size_t found = findSegment(pName, pos, nameLen, seg);
+            if (found==StringType::npos)
+            {
+                return false;
+            }
+
+            pos = found + seg.len;
+        }
+
+        return true;
+    }
+
+
+    void addSegment(std::size_t pos, std::size_t len)
+    {
+        if (!len)
+        {
+            return;
+        }
+
+        Segment seg;
+        seg.pos          = pos;
+        seg.len          = len;
+        seg.firstLiteral = len;
+
+        for(std::size_t i=0; i!=len; ++i)
+        {
+            if (m_pattern[pos+i]!=(CharType)'?')
+            {
+                seg.firstLiteral = i;
+                break;
+            }
+        }
+
+        m_segments.emplace_back(seg);
+        m_minLen += len;
+    }
+
+
+public:
+
+    //! Возвращает false, если маска не подходит для простого сопоставления (содержит переводы строк)
+    bool compile(const StringType &mask, bool bAnchored)
+    {
+        m_pattern.clear();
+        m_segments.clear();
+        m_anchored     = bAnchored;
+        m_leadingStar  = !mask.empty() && mask.front()==(CharType)'*';
+        m_trailingStar = !mask.empty() && mask.back ()==(CharType)'*';
+        m_minLen       = 0;
+
+        std::size_t segStart = 0;
+        for(std::size_t i=0; i<=mask.size(); ++i)
+        {
+            if (i==mask.size() || mask[i]==(CharType)'*')
+            {
+                addSegment(segStart, m_pattern.size()-segStart);
+                segStart = m_pattern.size();
+                continue;
+            }
+
+            if (isLineTerminator(mask[i]))
+            {
+                m_pattern.clear();
+                m_segments.clear();
+                return false;
+            }
+
+            m_pattern.push_back(mask[i]);
+        }
+
+        return true;
+    }
+
+    bool isAnchored() const
+    {
+        return m_anchored;
+    }
+
+    //! Самый длинный литеральный кусок маски (без '?') - для предварительного отбора
+    StringType getLongestLiteral() const
+    {
+        std::size_t bestPos = 0;
+        std::size_t bestLen = 0;
+
+        for(const auto &seg : m_segments)
+        {
+            std::size_t runStart = 0;
+            for(std::size_t i=0; i<=seg.len; ++i)
+            {
+                if (i==seg.len || m_pattern[seg.pos+i]==(CharType)'?')
+                {
+                    if (i-runStart>bestLen)
+                    {
+                        bestPos = seg.pos + runStart;
+                        bestLen = i - runStart;
+                    }
+
+                    runStart = i + 1;
+                }
+            }
+        }
+
+        return StringType(m_pattern, bestPos, bestLen);
+    }
+
+    bool match(const CharType *pName, std::size_t nameLen) const
+    {
+        // Маска переводов строк не содержит, а '*'/'?' с ними не совпадают -
+        // значит, совпадение возможно только внутри куска имени без переводов строк
+        std::size_t pieceStart = 0;
+        for(std::size_t i=0; i<=nameLen; ++i)
+        {
+            if (i!=nameLen && !isLineTerminator(pName[i]))
+            {
+                continue;
+            }
+
+            if (m_anchored)
+            {
+                return i==nameLen && matchAnchored(pName, nameLen);
+            }
+
+            if (matchUnanchored(pName+pieceStart, i-pieceStart))
+            {
+                return true;
+            }
+
+            pieceStart = i + 1;
+        }
+
+        return false;
+    }
+
+    bool match(const StringType &name) const
+    {
+        return match(name.data(), name.size());
+    }
+
+}; // class SimpleMaskMatcherT
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
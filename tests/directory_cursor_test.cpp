@@ -0,0 +1,363 @@
+/*! \file
+    \brief DirectoryCursorT paging with serialize/restore must give what slicing one full sorted listing gives
+
+    The directory is kept in memory (a vector of entries in read order) and the restore is done the way
+    FileSystemImpl::restoreDirectoryCursorImpl does it: parseState, acceptAfterResumeEntry while "reading",
+    sort the remainder, resume. Checked:
+    - an unchanged directory read page by page, with a serialize/restore round trip before every page,
+      gives exactly the full listing (stable_sort over IFileSystem::compareDirectoryEntries);
+    - if the directory changes between pages, the restored cursor continues in the new full listing right
+      after the last returned entry (or, if it was removed or changed, with the first entry that compares greater);
+    - serialize right after a restore gives the same state, proper prefixes of a state and numbers that
+      do not fit 64 bits are rejected.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/directory_cursor_test.cpp -o directory_cursor_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\directory_cursor_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../filesystem_impl.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static void check(bool bOk, const char *what, unsigned iteration)
+{
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf("FAIL (iteration %u): %s\n", iteration, what);
+        }
+    }
+}
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+template<typename StringType>
+static DirectoryEntryInfoT<StringType> makeRandomEntry(std::mt19937 &rng, const std::string &name)
+{
+    typedef typename StringType::value_type CharType;
+
+    DirectoryEntryInfoT<StringType> e;
+    e.entryName = widen<StringType>(name);
+
+    std::size_t dotPos = e.entryName.rfind((CharType)'.');
+    if (dotPos!=StringType::npos)
+    {
+        e.entryExt = e.entryName.substr(dotPos+1);
+    }
+
+    e.fileTypeFlags    = rng()%3==0 ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+    e.fileSize         = (FileSize)(rng()%4);
+    e.timeCreation     = (FileTime)(rng()%3);
+    e.timeLastModified = (FileTime)(rng()%3);
+    e.timeLastAccess   = (FileTime)(rng()%3);
+    e.validFields      = EntryFieldFlags::all;
+
+    return e;
+}
+
+// Каталог в памяти - записи в порядке чтения, имена уникальны (но при ignoreCase бывают равны)
+template<typename StringType>
+struct MemDir
+{
+    std::vector< DirectoryEntryInfoT<StringType> >  entries;
+
+    bool hasName(const std::string &name) const
+    {
+        StringType wname = widen<StringType>(name);
+        for(const auto &e : entries)
+        {
+            if (e.entryName==wname)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void addRandom(std::mt19937 &rng, std::size_t n)
+    {
+        const char* bases[] = { "a", "A", "b.txt", "B.TXT", "file1", "File1", "file10", "file02", "x.c", "X.C", "zz" };
+
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            std::string name = std::string(bases[rng()%(sizeof(bases)/sizeof(bases[0]))]);
+            if (rng()%2)
+            {
+                name += std::to_string(rng()%4);
+            }
+
+            if (!hasName(name))
+            {
+                entries.insert(entries.begin() + (std::ptrdiff_t)(rng()%(entries.size()+1)), makeRandomEntry<StringType>(rng, name));
+            }
+        }
+    }
+
+};
+
+template<typename StringType>
+static std::vector< DirectoryEntryInfoT<StringType> > fullListing(const IFileSystem &fs, const MemDir<StringType> &dir, SortFlags sortFlags)
+{
+    std::vector< DirectoryEntryInfoT<StringType> > res = dir.entries;
+    std::stable_sort( res.begin(), res.end()
+                    , [&](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2) { return fs.compareDirectoryEntries(e1, e2, sortFlags)<0; }
+                    );
+    return res;
+}
+
+// Как FileSystemImpl::restoreDirectoryCursorImpl, только каталог - в памяти
+template<typename StringType>
+static bool restoreCursor(const IFileSystem &fs, const MemDir<StringType> &dir, const std::string &state, DirectoryCursorT<StringType> &cursor)
+{
+    DirectoryCursorT<StringType> restored;
+    if (!restored.parseState(state))
+    {
+        return false;
+    }
+
+    const SortFlags sortFlags = restored.getSortFlags();
+    auto compare = [&](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2) { return fs.compareDirectoryEntries(e1, e2, sortFlags); };
+
+    std::vector< DirectoryEntryInfoT<StringType> > remainder;
+    for(const auto &e : dir.entries)
+    {
+        if (restored.acceptAfterResumeEntry(e, compare))
+        {
+            remainder.emplace_back(e);
+        }
+    }
+
+    std::stable_sort(remainder.begin(), remainder.end(), [&](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2) { return compare(e1, e2)<0; });
+    restored.resume(std::move(remainder));
+
+    cursor = std::move(restored);
+    return true;
+}
+
+template<typename StringType>
+static bool sameNames(const std::vector< DirectoryEntryInfoT<StringType> > &e1, std::size_t first1, const std::vector< DirectoryEntryInfoT<StringType> > &e2)
+{
+    if (first1>e1.size() || e1.size()-first1!=e2.size())
+    {
+        return false;
+    }
+
+    for(std::size_t i=0; i!=e2.size(); ++i)
+    {
+        if (e1[first1+i].entryName!=e2[i].entryName)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename StringType>
+static void run(const IFileSystem &fs, unsigned seed, unsigned numIterations)
+{
+    typedef DirectoryEntryInfoT<StringType> EntryType;
+
+    std::mt19937 rng(seed);
+
+    for(unsigned it=0; it!=numIterations; ++it)
+    {
+        SortFlags   sortFlags = (SortFlags)(rng()%512);
+        std::size_t pageSize  = 1 + (std::size_t)(rng()%7);
+
+        std::vector< FileMaskInfoT<StringType> > masks(1);
+        masks[0].mask = widen<StringType>("*");
+
+        MemDir<StringType> dir;
+        dir.addRandom(rng, (std::size_t)(rng()%40));
+
+        // Каталог не меняется - страницы через serialize/restore складываются в полный список
+        {
+            std::vector<EntryType> all = fullListing(fs, dir, sortFlags);
+
+            DirectoryCursorT<StringType> cursor;
+            cursor.open(widen<StringType>("/dir"), EnumerateFlags::none, sortFlags, masks, fullListing(fs, dir, sortFlags));
+
+            std::vector<EntryType> got, page;
+            for(std::size_t nPages=0; nPages<=all.size(); ++nPages)
+            {
+                std::string state = cursor.serialize();
+
+                DirectoryCursorT<StringType> restored;
+                bool bRestored = restoreCursor(fs, dir, state, restored);
+                check(bRestored, "restore of a serialized cursor failed", it);
+                check(!bRestored || restored.serialize()==state, "serialize after restore gives a different state", it);
+                if (!bRestored)
+                {
+                    break;
+                }
+
+                cursor = restored;
+                cursor.next(pageSize, page);
+                if (page.empty())
+                {
+                    break;
+                }
+
+                got.insert(got.end(), page.begin(), page.end());
+            }
+
+            check(sameNames(all, 0, got), "pages of an unchanged directory differ from the full listing", it);
+        }
+
+        // Каталог меняется между страницами - продолжаем в новом полном списке после последней отданной записи
+        if (!dir.entries.empty())
+        {
+            std::vector<EntryType> all = fullListing(fs, dir, sortFlags);
+
+            DirectoryCursorT<StringType> cursor;
+            cursor.open(widen<StringType>("/dir"), EnumerateFlags::none, sortFlags, masks, std::move(all));
+
+            std::vector<EntryType> page;
+            cursor.next(1 + (std::size_t)(rng()%dir.entries.size()), page);
+            EntryType last = page.back();
+
+            std::string state = cursor.serialize();
+
+            if (rng()%2) // Удаляем саму последнюю отданную запись
+            {
+                for(std::size_t i=0; i!=dir.entries.size(); ++i)
+                {
+                    if (dir.entries[i].entryName==last.entryName)
+                    {
+                        dir.entries.erase(dir.entries.begin()+(std::ptrdiff_t)i);
+                        break;
+                    }
+                }
+            }
+
+            for(std::size_t i=0; i!=dir.entries.size(); )
+            {
+                if (rng()%5==0)
+                {
+                    dir.entries.erase(dir.entries.begin()+(std::ptrdiff_t)i);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+            dir.addRandom(rng, (std::size_t)(rng()%10));
+
+            std::vector<EntryType> newAll = fullListing(fs, dir, sortFlags);
+
+            std::size_t expectedFirst = 0;
+            while(expectedFirst!=newAll.size() && (newAll[expectedFirst].entryName!=last.entryName || fs.compareDirectoryEntries(newAll[expectedFirst], last, sortFlags)!=0))
+            {
+                ++expectedFirst;
+            }
+
+            if (expectedFirst!=newAll.size())
+            {
+                ++expectedFirst; // Сразу за ней
+            }
+            else // Записи больше нет (или она изменилась) - с первой строго большей
+            {
+                expectedFirst = 0;
+                while(expectedFirst!=newAll.size() && fs.compareDirectoryEntries(newAll[expectedFirst], last, sortFlags)<=0)
+                {
+                    ++expectedFirst;
+                }
+            }
+
+            DirectoryCursorT<StringType> restored;
+            check(restoreCursor(fs, dir, state, restored), "restore of a serialized cursor failed", it);
+
+            std::vector<EntryType> rest;
+            restored.next((std::size_t)-1, rest);
+            check(sameNames(newAll, expectedFirst, rest), "restored cursor does not continue after the last returned entry", it);
+        }
+    }
+}
+
+template<typename StringType>
+static void checkMalformed(const IFileSystem &fs)
+{
+    std::mt19937 rng(3);
+
+    MemDir<StringType> dir;
+    dir.addRandom(rng, 20);
+
+    std::vector< FileMaskInfoT<StringType> > masks(2);
+    masks[0].mask = widen<StringType>("*.txt");
+    masks[1].mask = widen<StringType>("file*");
+
+    DirectoryCursorT<StringType> cursor;
+    cursor.open(widen<StringType>("/dir"), EnumerateFlags::none, SortFlags::ignoreCase, masks, fullListing(fs, dir, SortFlags::ignoreCase));
+
+    std::vector< DirectoryEntryInfoT<StringType> > page;
+    cursor.next(3, page);
+
+    const std::string state = cursor.serialize();
+
+    DirectoryCursorT<StringType> restored;
+    check(restored.parseState(state), "valid state rejected", 0);
+    check(restored.getMasks().size()==2 && restored.getMasks()[1].mask==masks[1].mask, "masks lost in serialize/restore", 0);
+
+    for(std::size_t len=0; len!=state.size(); ++len)
+    {
+        check(!restored.parseState(state.substr(0, len)), "proper prefix of a state accepted", (unsigned)len);
+    }
+
+    // Числа, не влезающие в 64 бита - и как значение, и как длина строки
+    // Путь "/c" - коды символов в hex шириной в размер символа
+    const std::string padding(sizeof(typename StringType::value_type)*2-2, '0');
+    const std::string sig     = state.substr(0, state.find(';')+1);
+    const std::string dirPath = "2:" + padding + "2F" + padding + "63;";
+
+    check(!restored.parseState(sig + dirPath + "99999999999999999999999;0;0;0;"), "number above 2^64 accepted", 0);
+    check(!restored.parseState(sig + "18446744073709551617:" + padding + "2F" + padding + "63;0;0;0;0;"), "string length above 2^64 accepted", 0);
+    check(!restored.parseState(sig + dirPath + "18446744073709551616;0;0;0;"), "2^64 accepted", 0);
+    check( restored.parseState(sig + dirPath + "0;0;0;0;"), "minimal valid state rejected", 0);
+    check( restored.parseState(sig + dirPath + "18446744073709551615;0;0;0;"), "2^64-1 rejected", 0);
+}
+
+
+int main()
+{
+    FileSystemImpl fsImpl;
+    const IFileSystem &fs = fsImpl;
+
+    run<std::string >(fs, 1, 2000);
+    run<std::wstring>(fs, 2, 2000);
+
+    checkMalformed<std::string >(fs);
+    checkMalformed<std::wstring>(fs);
+
+    std::printf("directory_cursor_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+/*! \file
+    \brief DirectoryListingT (columns + name arena) must agree with the plain vector of DirectoryEntryInfoT it replaces
+
+    Random entries go both into a DirectoryListingT and into a std::vector<DirectoryEntryInfoT>. Checked:
+    the round trip back to entries, the filters against std::copy_if style loops over the vector, and the sorted
+    order (also of a filtered subset) against std::stable_sort with IFileSystem::compareDirectoryEntries
+    over all sort flag combinations.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/directory_listing_test.cpp -o directory_listing_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\directory_listing_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../filesystem_impl.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static void check(bool bOk, const char *what, unsigned iteration)
+{
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf("FAIL (iteration %u): %s\n", iteration, what);
+        }
+    }
+}
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+template<typename StringType>
+static bool sameEntry(const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2)
+{
+    return e1.fileTypeFlags   ==e2.fileTypeFlags
+        && e1.fileSize        ==e2.fileSize
+        && e1.timeCreation    ==e2.timeCreation
+        && e1.timeLastModified==e2.timeLastModified
+        && e1.timeLastAccess  ==e2.timeLastAccess
+        && e1.entryName       ==e2.entryName
+        && e1.entryExt        ==e2.entryExt
+        && e1.path            ==e2.path
+        && e1.validFields     ==e2.validFields;
+}
+
+template<typename StringType>
+static DirectoryEntryInfoT<StringType> makeRandomEntry(std::mt19937 &rng, const StringType &path)
+{
+    typedef typename StringType::value_type CharType;
+
+    // Регистр, цифры разной длины, одинаковые имена, расширение не всегда хвост имени
+    const char* bases[] = { "a", "B", "file10", "File2", "file02", "x.TXT", "x.txt", "a.c", "Zeta.md", "v1.2.10", "v1.10.2", "" };
+
+    DirectoryEntryInfoT<StringType> e;
+    e.entryName = widen<StringType>(std::string(bases[rng()%(sizeof(bases)/sizeof(bases[0]))]) + std::to_string(rng()%5));
+
+    std::size_t dotPos = e.entryName.rfind((CharType)'.');
+    if (rng()%8==0)
+    {
+        e.entryExt = widen<StringType>("ext"); // Не совпадает с концом имени - хранится в арене отдельно
+    }
+    else if (dotPos!=StringType::npos)
+    {
+        e.entryExt = e.entryName.substr(dotPos+1);
+    }
+
+    e.fileTypeFlags    = rng()%3==0 ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+    e.fileSize         = (FileSize)(rng()%4);
+    e.timeCreation     = (FileTime)(rng()%3);
+    e.timeLastModified = (FileTime)(rng()%3);
+    e.timeLastAccess   = (FileTime)(rng()%3);
+    e.path             = path;
+    e.validFields      = rng()%2 ? EntryFieldFlags::all : (EntryFieldFlags::name|EntryFieldFlags::type|EntryFieldFlags::path);
+
+    return e;
+}
+
+template<typename StringType>
+static void run(const IFileSystem &fs, unsigned seed, unsigned numIterations)
+{
+    typedef DirectoryEntryInfoT<StringType>          EntryType;
+    typedef typename DirectoryListingT<StringType>::IndexVector  IndexVector;
+
+    std::mt19937 rng(seed);
+
+    auto keyMaker = [&](const StringType &name, SortFlags sortFlags) { return fs.getFilenameSortKey(name, sortFlags); };
+
+    for(unsigned it=0; it!=numIterations; ++it)
+    {
+        StringType path = widen<StringType>("/some/dir");
+
+        DirectoryListingT<StringType> listing(path);
+        std::vector<EntryType>        entries;
+
+        std::size_t n = (std::size_t)(rng() % (it%4==0 ? 700 : 40));
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            EntryType e = makeRandomEntry<StringType>(rng, path);
+            listing.append(e);
+            entries.emplace_back(e);
+        }
+
+        // Запись разворачивается обратно без потерь
+        std::vector<EntryType> back = listing.toEntries();
+        bool bSame = back.size()==entries.size();
+        for(std::size_t i=0; bSame && i!=n; ++i)
+        {
+            bSame = sameEntry(back[i], entries[i]);
+        }
+        check(bSame, "toEntries differs from appended entries", it);
+
+        // Фильтры
+        IndexVector all = listing.getIdentityOrder();
+
+        EnumerateFlags enumerateFlags = (EnumerateFlags)(rng()%4);
+        IndexVector expectedByType;
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            if (isDirectoryEntryTypeMatch(enumerateFlags, entries[i]))
+            {
+                expectedByType.emplace_back(i);
+            }
+        }
+        check(listing.filterByType(all, enumerateFlags)==expectedByType, "filterByType", it);
+
+        FileSize minSize = (FileSize)(rng()%4), maxSize = minSize + (FileSize)(rng()%3);
+        IndexVector expectedBySize;
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            if (entries[i].fileSize>=minSize && entries[i].fileSize<=maxSize)
+            {
+                expectedBySize.emplace_back(i);
+            }
+        }
+        check(listing.filterBySize(all, minSize, maxSize)==expectedBySize, "filterBySize", it);
+
+        FileTime timeFrom = (FileTime)(rng()%3), timeTo = timeFrom + (FileTime)(rng()%2);
+        IndexVector expectedByTime;
+        for(auto idx : expectedByType)
+        {
+            if (entries[idx].timeLastModified>=timeFrom && entries[idx].timeLastModified<=timeTo)
+            {
+                expectedByTime.emplace_back(idx);
+            }
+        }
+        IndexVector filtered = listing.filterByTimeLastModified(listing.filterByType(all, enumerateFlags), timeFrom, timeTo);
+        check(filtered==expectedByTime, "filterByType + filterByTimeLastModified", it);
+
+        // Сортировка - всех записей и отфильтрованного подмножества
+        SortFlags sortFlags = (SortFlags)(rng()%512);
+
+        auto referenceLess = [&](std::size_t i1, std::size_t i2) { return fs.compareDirectoryEntries(entries[i1], entries[i2], sortFlags)<0; };
+
+        IndexVector expectedSorted = all;
+        std::stable_sort(expectedSorted.begin(), expectedSorted.end(), referenceLess);
+        check(listing.getSortedOrder(sortFlags, keyMaker)==expectedSorted, "getSortedOrder differs from stable_sort over compareDirectoryEntries", it);
+
+        IndexVector expectedSubset = expectedByTime;
+        std::stable_sort(expectedSubset.begin(), expectedSubset.end(), referenceLess);
+        listing.sort(filtered, sortFlags, keyMaker);
+        check(filtered==expectedSubset, "sort of a filtered order differs from stable_sort over compareDirectoryEntries", it);
+    }
+}
+
+
+int main()
+{
+    FileSystemImpl fsImpl;
+    const IFileSystem &fs = fsImpl;
+
+    run<std::string >(fs, 1, 400);
+    run<std::wstring>(fs, 2, 400);
+
+    std::printf("directory_listing_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+/*! \file
+    \brief DirectoryEntrySorterT (precomputed keys, LSD radix sort, parallel merge) must give the order of the
+    std::stable_sort over IFileSystem::compareDirectoryEntries it replaces
+
+    Lists are generated below and above radixSortThreshold with many equal keys, so that both the comparison
+    and the radix paths run and stability is visible: every entry carries its original index in the path field,
+    which compareDirectoryEntries does not look at. Sorted: whole lists, random subsets of indices (sortOrder),
+    in-place sort(), and the same with the parallel sort forced on by a small threshold.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -pthread -I<path-to-umba-parent> tests/entry_sorter_test.cpp -o entry_sorter_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\entry_sorter_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../filesystem_impl.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static void check(bool bOk, const char *what, unsigned iteration, SortFlags sortFlags, std::size_t n)
+{
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf("FAIL (iteration %u, sortFlags 0x%03X, %u entries): %s\n", iteration, (unsigned)sortFlags, (unsigned)n, what);
+        }
+    }
+}
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+template<typename StringType>
+static std::vector< DirectoryEntryInfoT<StringType> > makeRandomEntries(std::mt19937 &rng, std::size_t n)
+{
+    typedef typename StringType::value_type CharType;
+
+    // Мало разных имён и значений - много равных ключей
+    const char* bases[] = { "a", "A", "b", "file10", "File2", "file02", "x.TXT", "x.txt", "a.c", "v1.2.10", "v1.10.2", "" };
+
+    std::vector< DirectoryEntryInfoT<StringType> > entries;
+    for(std::size_t i=0; i!=n; ++i)
+    {
+        DirectoryEntryInfoT<StringType> e;
+        e.entryName = widen<StringType>(bases[rng()%(sizeof(bases)/sizeof(bases[0]))]);
+        if (rng()%2)
+        {
+            e.entryName += widen<StringType>(std::to_string(rng()%3));
+        }
+
+        std::size_t dotPos = e.entryName.rfind((CharType)'.');
+        if (dotPos!=StringType::npos)
+        {
+            e.entryExt = e.entryName.substr(dotPos+1);
+        }
+
+        e.fileTypeFlags    = rng()%3==0 ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+        // Старшие байты тоже разные - все проходы поразрядной сортировки что-то делают
+        e.fileSize         = (FileSize)((rng()%2 ? (FileSize)0 : (FileSize)(rng()%3)<<40) + rng()%4);
+        e.timeCreation     = (FileTime)(rng()%3);
+        e.timeLastModified = (FileTime)((rng()%2 ? (FileTime)0 : (FileTime)(rng()%3)<<50) + rng()%3);
+        e.timeLastAccess   = (FileTime)(rng()%3);
+        e.path             = widen<StringType>(std::to_string(i)); // Исходный индекс - для проверки устойчивости
+        e.validFields      = EntryFieldFlags::all;
+
+        entries.emplace_back(e);
+    }
+
+    return entries;
+}
+
+template<typename StringType>
+static bool samePaths(const std::vector< DirectoryEntryInfoT<StringType> > &e1, const std::vector< DirectoryEntryInfoT<StringType> > &e2)
+{
+    if (e1.size()!=e2.size())
+    {
+        return false;
+    }
+
+    for(std::size_t i=0; i!=e1.size(); ++i)
+    {
+        if (e1[i].path!=e2[i].path)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template<typename StringType>
+static void run(const IFileSystem &fs, const std::shared_ptr<WorkStealingThreadPool> &pPool, unsigned seed, unsigned numIterations)
+{
+    typedef DirectoryEntryInfoT<StringType>                     EntryType;
+    typedef typename DirectoryEntrySorterT<StringType>::IndexVector  IndexVector;
+
+    std::mt19937 rng(seed);
+
+    auto keyMaker = [&](const StringType &name, SortFlags sortFlags) { return fs.getFilenameSortKey(name, sortFlags); };
+
+    // Флаги, при которых работает поразрядная сортировка - не больше одного числового ключа и без byType
+    const SortFlags numericKeys[] = { SortFlags::none, SortFlags::bySize, SortFlags::byTimeCreation, SortFlags::byTimeLastModified, SortFlags::byTimeLastAccess };
+    const SortFlags radixExtra  = SortFlags::directoriesFirst|SortFlags::directoriesLast|SortFlags::orderDescending|SortFlags::ignoreCase;
+
+    for(unsigned it=0; it!=numIterations; ++it)
+    {
+        SortFlags sortFlags = (SortFlags)(rng()%512);
+        if (it%2)
+        {
+            sortFlags = numericKeys[rng()%(sizeof(numericKeys)/sizeof(numericKeys[0]))] | (sortFlags&radixExtra);
+        }
+
+        const std::size_t threshold = DirectoryEntrySorterT<StringType>::radixSortThreshold;
+        std::size_t n = it%3==0 ? (std::size_t)(rng()%threshold) : threshold + (std::size_t)(rng()%(threshold*8));
+
+        std::vector<EntryType> entries = makeRandomEntries<StringType>(rng, n);
+
+        auto referenceLess = [&](std::size_t i1, std::size_t i2) { return fs.compareDirectoryEntries(entries[i1], entries[i2], sortFlags)<0; };
+
+        IndexVector expected(n);
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            expected[i] = i;
+        }
+        std::stable_sort(expected.begin(), expected.end(), referenceLess);
+
+        {
+            DirectoryEntrySorterT<StringType> sorter(sortFlags);
+            check(sorter.getSortedOrder(entries, keyMaker)==expected, "getSortedOrder differs from stable_sort over compareDirectoryEntries", it, sortFlags, n);
+        }
+
+        {
+            DirectoryEntrySorterT<StringType> sorter(sortFlags);
+            sorter.setParallelSort(2, 4, pPool); // Параллельно всё, что больше двух записей
+            check(sorter.getSortedOrder(entries, keyMaker)==expected, "parallel getSortedOrder differs from stable_sort over compareDirectoryEntries", it, sortFlags, n);
+        }
+
+        {
+            std::vector<EntryType> sortedEntries = entries;
+            DirectoryEntrySorterT<StringType> sorter(sortFlags);
+            sorter.sort(sortedEntries, keyMaker);
+
+            std::vector<EntryType> expectedEntries;
+            for(auto idx : expected)
+            {
+                expectedEntries.emplace_back(entries[idx]);
+            }
+            check(samePaths(sortedEntries, expectedEntries), "sort differs from stable_sort over compareDirectoryEntries", it, sortFlags, n);
+        }
+
+        // Подмножество индексов в перемешанном порядке - устойчивость относительно порядка в order
+        IndexVector subset;
+        for(std::size_t i=0; i!=n; ++i)
+        {
+            if (rng()%4)
+            {
+                subset.emplace_back(i);
+            }
+        }
+        std::shuffle(subset.begin(), subset.end(), rng);
+
+        IndexVector expectedSubset = subset;
+        std::stable_sort(expectedSubset.begin(), expectedSubset.end(), referenceLess);
+
+        DirectoryEntrySorterT<StringType> sorter(sortFlags);
+        sorter.sortOrder(subset, n, [&](std::size_t idx) -> const EntryType& { return entries[idx]; }, keyMaker);
+        check(subset==expectedSubset, "sortOrder of a subset differs from stable_sort over compareDirectoryEntries", it, sortFlags, n);
+    }
+}
+
+
+int main()
+{
+    FileSystemImpl fsImpl;
+    const IFileSystem &fs = fsImpl;
+
+    std::shared_ptr<WorkStealingThreadPool> pPool = std::make_shared<WorkStealingThreadPool>(4);
+
+    run<std::string >(fs, pPool, 1, 300);
+    run<std::wstring>(fs, pPool, 2, 300);
+
+    std::printf("entry_sorter_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,167 @@
+/*! \file
+    \brief DirectoryEntryTopSelectorT (heap of offset+limit entries) must return the same slice as a full
+    std::stable_sort over IFileSystem::compareDirectoryEntries followed by [offset, offset+limit)
+
+    Entries carry their original index in the path field (compareDirectoryEntries does not look at it),
+    and there are many equal keys, so the slice must also keep the order of equal entries. Covered: limit 0,
+    offset past the end, offset+limit overflowing size_t, and a selector reused after getResult.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/entry_top_selector_test.cpp -o entry_top_selector_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\entry_top_selector_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../filesystem_impl.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+template<typename StringType>
+static std::vector< DirectoryEntryInfoT<StringType> > makeRandomEntries(std::mt19937 &rng, std::size_t n)
+{
+    typedef typename StringType::value_type CharType;
+
+    const char* bases[] = { "a", "A", "b", "file10", "File2", "file02", "x.TXT", "x.txt", "a.c", "v1.2.10", "v1.10.2", "" };
+
+    std::vector< DirectoryEntryInfoT<StringType> > entries;
+    for(std::size_t i=0; i!=n; ++i)
+    {
+        DirectoryEntryInfoT<StringType> e;
+        e.entryName = widen<StringType>(bases[rng()%(sizeof(bases)/sizeof(bases[0]))]);
+
+        std::size_t dotPos = e.entryName.rfind((CharType)'.');
+        if (dotPos!=StringType::npos)
+        {
+            e.entryExt = e.entryName.substr(dotPos+1);
+        }
+
+        e.fileTypeFlags    = rng()%3==0 ? FileTypeFlags::directory : FileTypeFlags::normalFile;
+        e.fileSize         = (FileSize)(rng()%4);
+        e.timeCreation     = (FileTime)(rng()%3);
+        e.timeLastModified = (FileTime)(rng()%3);
+        e.timeLastAccess   = (FileTime)(rng()%3);
+        e.path             = widen<StringType>(std::to_string(i)); // Исходный индекс - для проверки устойчивости
+        e.validFields      = EntryFieldFlags::all;
+
+        entries.emplace_back(e);
+    }
+
+    return entries;
+}
+
+template<typename StringType>
+static void checkSlice( const std::vector< DirectoryEntryInfoT<StringType> > &expectedSorted
+                      , const std::vector< DirectoryEntryInfoT<StringType> > &actual
+                      , std::size_t offset, std::size_t limit, SortFlags sortFlags, unsigned iteration
+                      )
+{
+    std::size_t first = std::min(offset, expectedSorted.size());
+    std::size_t last  = limit>expectedSorted.size()-first ? expectedSorted.size() : first+limit;
+
+    bool bOk = actual.size()==last-first;
+    for(std::size_t i=0; bOk && i!=actual.size(); ++i)
+    {
+        bOk = actual[i].path==expectedSorted[first+i].path;
+    }
+
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf( "FAIL (iteration %u, sortFlags 0x%03X, %u entries, offset %u, limit %u): got %u entries, expected %u\n"
+                       , iteration, (unsigned)sortFlags, (unsigned)expectedSorted.size(), (unsigned)offset, (unsigned)limit
+                       , (unsigned)actual.size(), (unsigned)(last-first)
+                       );
+        }
+    }
+}
+
+template<typename StringType>
+static void run(const IFileSystem &fs, unsigned seed, unsigned numIterations)
+{
+    typedef DirectoryEntryInfoT<StringType> EntryType;
+
+    std::mt19937 rng(seed);
+
+    auto keyMaker = [&](const StringType &name, SortFlags sortFlags) { return fs.getFilenameSortKey(name, sortFlags); };
+
+    for(unsigned it=0; it!=numIterations; ++it)
+    {
+        SortFlags   sortFlags = (SortFlags)(rng()%512);
+        std::size_t n         = (std::size_t)(rng()%(it%5==0 ? 2000 : 60));
+
+        std::vector<EntryType> entries = makeRandomEntries<StringType>(rng, n);
+
+        std::vector<EntryType> expectedSorted = entries;
+        std::stable_sort( expectedSorted.begin(), expectedSorted.end()
+                        , [&](const EntryType &e1, const EntryType &e2) { return fs.compareDirectoryEntries(e1, e2, sortFlags)<0; }
+                        );
+
+        std::size_t offset = 0, limit = 0;
+        switch(rng()%6)
+        {
+            case 0 : offset = 0;                           limit = 1 + (std::size_t)(rng()%10); break;
+            case 1 : offset = (std::size_t)(rng()%(n+1));  limit = 1 + (std::size_t)(rng()%10); break;
+            case 2 : offset = n + (std::size_t)(rng()%3);  limit = 1 + (std::size_t)(rng()%10); break; // За концом
+            case 3 : offset = (std::size_t)(rng()%(n+1));  limit = 0;                           break; // Ничего
+            case 4 : offset = (std::size_t)(rng()%(n+1));  limit = (std::size_t)-1;             break; // offset+limit переполняется
+            default: offset = (std::size_t)(rng()%(n+1));  limit = (std::size_t)(rng()%(n+2));  break;
+        }
+
+        DirectoryEntryTopSelectorT<StringType> selector(sortFlags, offset, limit);
+
+        // Дважды - после getResult селектор должен быть пуст и готов к повторному использованию
+        for(unsigned pass=0; pass!=2; ++pass)
+        {
+            for(const auto &e : entries)
+            {
+                selector.push(e, keyMaker);
+            }
+
+            std::vector<EntryType> actual;
+            selector.getResult(actual);
+            checkSlice(expectedSorted, actual, offset, limit, sortFlags, it);
+        }
+    }
+}
+
+
+int main()
+{
+    FileSystemImpl fsImpl;
+    const IFileSystem &fs = fsImpl;
+
+    run<std::string >(fs, 1, 1500);
+    run<std::wstring>(fs, 2, 1500);
+
+    std::printf("entry_top_selector_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,277 @@
+/*! \file
+    \brief CompiledFileMaskSetT::findFirstMatch (Aho-Corasick prefilter) must return what a plain loop over the masks returns
+
+    The reference compiles every mask with FileMaskInfoT::compile() and checks the masks one by one with
+    CompiledFileMaskInfoT::matchEntry, in order - the first match wins, and if nothing matches the first
+    mask that failed to compile is reported.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/file_mask_set_test.cpp -o file_mask_set_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\file_mask_set_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../file_mask_set.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+template<typename StringType>
+static std::string narrow(const StringType &s)
+{
+    std::string res;
+    for(auto ch : s)
+    {
+        res.push_back((ch>=0x20 && ch<0x7F) ? (char)ch : '?');
+    }
+    return res;
+}
+
+template<typename StringType>
+static DirectoryEntryInfoT<StringType> makeEntry(const StringType &name)
+{
+    typedef typename StringType::value_type CharType;
+
+    DirectoryEntryInfoT<StringType> entry;
+    entry.entryName = name;
+
+    std::size_t dotPos = name.rfind((CharType)'.');
+    if (dotPos!=StringType::npos)
+    {
+        entry.entryExt = name.substr(dotPos+1);
+    }
+
+    return entry;
+}
+
+// Эталон - маски компилируются и проверяются по одной, по порядку
+template<typename StringType>
+struct ReferenceMaskList
+{
+    std::vector<bool>                               valid;
+    std::vector< CompiledFileMaskInfoT<StringType> > compiled;
+
+    explicit ReferenceMaskList(const std::vector< FileMaskInfoT<StringType> > &masks)
+    {
+        for(const auto &m : masks)
+        {
+            CompiledFileMaskInfoT<StringType> cm;
+            bool bValid = m.fileMaskFlags!=FileMaskFlags::invalid;
+            if (bValid)
+            {
+                try
+                {
+                    cm = m.compile();
+                }
+                catch(...)
+                {
+                    bValid = false;
+                }
+            }
+
+            valid.emplace_back(bValid);
+            compiled.emplace_back(cm);
+        }
+    }
+
+    int findFirstMatch(const DirectoryEntryInfoT<StringType> &entry) const
+    {
+        int firstInvalid = 0;
+
+        for(std::size_t i=0; i!=compiled.size(); ++i)
+        {
+            if (!valid[i])
+            {
+                if (!firstInvalid)
+                {
+                    firstInvalid = -((int)i + 1);
+                }
+                continue;
+            }
+
+            if (compiled[i].matchEntry(entry))
+            {
+                return (int)i + 1;
+            }
+        }
+
+        return firstInvalid;
+    }
+
+};
+
+template<typename StringType>
+static void checkSet(const std::vector< FileMaskInfoT<StringType> > &masks, const std::vector<StringType> &names)
+{
+    ReferenceMaskList<StringType>  reference(masks);
+    CompiledFileMaskSetT<StringType> maskSet(masks);
+
+    for(const auto &name : names)
+    {
+        DirectoryEntryInfoT<StringType> entry = makeEntry(name);
+
+        int expected = reference.findFirstMatch(entry);
+        int actual   = maskSet.findFirstMatch(entry);
+
+        ++g_checks;
+        if (expected!=actual)
+        {
+            ++g_failures;
+            if (g_failures<=50)
+            {
+                std::printf("FAIL (%u masks): name '%s': reference=%d, set=%d", (unsigned)masks.size(), narrow(name).c_str(), expected, actual);
+                if (expected>0)
+                {
+                    std::printf(", expected mask '%s'", narrow(masks[(std::size_t)expected-1].mask).c_str());
+                }
+                if (actual>0)
+                {
+                    std::printf(", got mask '%s'", narrow(masks[(std::size_t)actual-1].mask).c_str());
+                }
+                std::printf("\n");
+            }
+        }
+    }
+}
+
+template<typename StringType>
+static FileMaskInfoT<StringType> makeMask(const char *mask, FileMaskFlags flags)
+{
+    FileMaskInfoT<StringType> m;
+    m.fileMaskFlags = flags;
+    m.mask          = widen<StringType>(mask);
+    return m;
+}
+
+template<typename StringType>
+static void runFixed()
+{
+    const char* names[] = { "", "a", "abc", "a.txt", "b.txt", "main.cpp", "main.cpp.bak", "readme", "README.md"
+                          , "file.tar.gz", "makefile", "Makefile", "x.h", "x.hpp", ".hidden", "..", "abcabc", "cbacba"
+                          };
+
+    std::vector<StringType> nameList;
+    for(const char *n : names)
+    {
+        nameList.emplace_back(widen<StringType>(n));
+    }
+
+    std::vector< FileMaskInfoT<StringType> > masks;
+    checkSet(masks, nameList); // Пустой набор - совпадений нет
+
+    masks.emplace_back(makeMask<StringType>("*.cpp"    , FileMaskFlags::useAnchors));
+    masks.emplace_back(makeMask<StringType>("main*"    , FileMaskFlags::useAnchors));  // Совпадает с main.cpp, но позже
+    masks.emplace_back(makeMask<StringType>("txt"      , FileMaskFlags::useAnchors|FileMaskFlags::matchExtOnly));
+    masks.emplace_back(makeMask<StringType>("*"        , FileMaskFlags::useAnchors));  // Без литерала - проверяется всегда
+    checkSet(masks, nameList);
+
+    masks.insert(masks.begin(), makeMask<StringType>("("   , FileMaskFlags::matchRegex)); // Не компилируется
+    masks.insert(masks.begin(), makeMask<StringType>("abc" , FileMaskFlags::invalid));
+    checkSet(masks, nameList);
+
+    masks.pop_back(); // Без "*" часть имён не совпадает ни с чем - должна вернуться первая корявая маска
+    masks.emplace_back(makeMask<StringType>("^[Mm]ake" , FileMaskFlags::matchRegex));
+    masks.emplace_back(makeMask<StringType>("bc"       , FileMaskFlags::none));
+    masks.emplace_back(makeMask<StringType>("h?p"      , FileMaskFlags::matchExtOnly));
+    checkSet(masks, nameList);
+}
+
+// Случайные наборы масок над маленьким алфавитом - литералы масок часто перекрываются
+template<typename StringType>
+static void runRandom(unsigned seed, std::size_t numSets, std::size_t maxMasks, std::size_t numNames)
+{
+    std::mt19937 rng(seed);
+
+    auto randomString = [&](const char *alphabet, std::size_t minLen, std::size_t maxLen)
+    {
+        std::string s;
+        std::size_t alphabetSize = std::char_traits<char>::length(alphabet);
+        std::size_t len = minLen + (std::size_t)(rng() % (maxLen-minLen+1));
+        for(std::size_t i=0; i!=len; ++i)
+        {
+            s.push_back(alphabet[rng()%alphabetSize]);
+        }
+        return s;
+    };
+
+    std::vector<StringType> names;
+    for(std::size_t i=0; i!=numNames; ++i)
+    {
+        names.emplace_back(widen<StringType>(randomString("abc.", 0, 9)));
+    }
+
+    const char* regexMasks[] = { "a+b", "^c", "b$", "(ab|ba)", "[", "a{2}", "(" };
+
+    for(std::size_t s=0; s!=numSets; ++s)
+    {
+        std::size_t nMasks = 1 + (std::size_t)(rng() % maxMasks);
+
+        std::vector< FileMaskInfoT<StringType> > masks;
+        for(std::size_t i=0; i!=nMasks; ++i)
+        {
+            unsigned kind = (unsigned)(rng()%16);
+
+            FileMaskInfoT<StringType> m;
+            if (kind==0)
+            {
+                m.fileMaskFlags = FileMaskFlags::matchRegex;
+                m.mask          = widen<StringType>(regexMasks[rng()%(sizeof(regexMasks)/sizeof(regexMasks[0]))]);
+            }
+            else
+            {
+                m.fileMaskFlags = FileMaskFlags::none;
+                if (rng()%2)
+                {
+                    m.fileMaskFlags |= FileMaskFlags::useAnchors;
+                }
+                if (kind<4)
+                {
+                    m.fileMaskFlags |= FileMaskFlags::matchExtOnly;
+                }
+                m.mask = widen<StringType>(randomString("abc.*?", 1, 5));
+            }
+
+            masks.emplace_back(m);
+        }
+
+        checkSet(masks, names);
+    }
+}
+
+
+int main()
+{
+    runFixed<std::string >();
+    runFixed<std::wstring>();
+
+    runRandom<std::string >(1, 300, 40 , 200);
+    runRandom<std::wstring>(2, 300, 40 , 200);
+    runRandom<std::string >(3, 4  , 700, 300); // Больше 512 масок - битовая маска кандидатов уже не на стеке
+
+    std::printf("file_mask_set_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,266 @@
+/*! \file
+    \brief MountPointTree::findLongestPrefix must find what a linear scan over all mount point targets finds
+
+    The reference keeps the mount points in a std::map (key -> target, as VirtualFsImpl does), splits the
+    path and every target into components and picks the target with the most components that is a prefix
+    of the path by whole components; on ties - the smallest key. Random insert/remove sequences (with reused
+    nodes, several keys per target, relative and absolute targets, '/' and '\\' and repeated separators)
+    are checked against it, including the matched prefix length.
+
+    Build:
+        g++ -std=c++17 tests/mount_point_tree_test.cpp -o mount_point_tree_test
+        cl /std:c++17 /EHsc tests\mount_point_tree_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../mount_point_tree.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static std::string narrow(const std::wstring &s)
+{
+    std::string res;
+    for(auto ch : s)
+    {
+        res.push_back((ch>=0x20 && ch<0x7F) ? (char)ch : '?');
+    }
+    return res;
+}
+
+static bool isSep(wchar_t ch)
+{
+    return ch==L'/' || ch==L'\\';
+}
+
+struct PathComponent
+{
+    std::wstring    name;
+    std::size_t     endPos = 0; // Где кончается совпавшая часть пути, если совпадение до этого компонента
+};
+
+// Ведущий разделитель - отдельный пустой компонент (вместе со всеми разделителями за ним), повторные разделители пропускаются
+static std::vector<PathComponent> splitPath(const std::wstring &path)
+{
+    std::vector<PathComponent> res;
+
+    std::size_t pos = 0;
+    if (!path.empty() && isSep(path[0]))
+    {
+        while(pos<path.size() && isSep(path[pos]))
+        {
+            ++pos;
+        }
+
+        PathComponent c;
+        c.endPos = pos;
+        res.emplace_back(c);
+    }
+
+    while(pos<path.size())
+    {
+        if (isSep(path[pos]))
+        {
+            ++pos;
+            continue;
+        }
+
+        PathComponent c;
+        while(pos<path.size() && !isSep(path[pos]))
+        {
+            c.name.push_back(path[pos++]);
+        }
+        c.endPos = pos;
+        res.emplace_back(c);
+    }
+
+    return res;
+}
+
+// Один и тот же путь для дерева, хотя разделители могут быть записаны по-разному
+static bool sameComponents(const std::wstring &path1, const std::wstring &path2)
+{
+    std::vector<PathComponent> comps1 = splitPath(path1);
+    std::vector<PathComponent> comps2 = splitPath(path2);
+    if (comps1.size()!=comps2.size())
+    {
+        return false;
+    }
+
+    for(std::size_t i=0; i!=comps1.size(); ++i)
+    {
+        if (comps1[i].name!=comps2[i].name)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Эталон - перебор всех точек монтирования
+static bool referenceFind(const std::map<std::wstring, std::wstring> &mountPoints, const std::wstring &path, std::wstring &mountKey, std::size_t &prefixLen)
+{
+    std::vector<PathComponent> pathComps = splitPath(path);
+
+    bool        bFound    = false;
+    std::size_t bestDepth = 0;
+
+    for(const auto &kv : mountPoints)
+    {
+        std::vector<PathComponent> targetComps = splitPath(kv.second);
+        if (targetComps.size()>pathComps.size())
+        {
+            continue;
+        }
+
+        bool bPrefix = true;
+        for(std::size_t i=0; bPrefix && i!=targetComps.size(); ++i)
+        {
+            bPrefix = targetComps[i].name==pathComps[i].name; // Пустое имя - только у корня
+        }
+
+        if (!bPrefix)
+        {
+            continue;
+        }
+
+        if (!bFound || targetComps.size()>bestDepth) // Ключи идут по возрастанию - при равной глубине остаётся меньший
+        {
+            bFound    = true;
+            bestDepth = targetComps.size();
+            mountKey  = kv.first;
+            prefixLen = bestDepth ? pathComps[bestDepth-1].endPos : 0;
+        }
+    }
+
+    return bFound;
+}
+
+static std::wstring randomPath(std::mt19937 &rng, std::size_t maxComps)
+{
+    const wchar_t* comps[] = { L"a", L"b", L"ab", L"A", L"data", L"d" };
+    const wchar_t* seps [] = { L"/", L"\\", L"//" };
+
+    std::wstring path;
+    if (rng()%4) // Обычно - абсолютный
+    {
+        path = seps[rng()%3];
+    }
+
+    std::size_t n = (std::size_t)(rng()%(maxComps+1));
+    for(std::size_t i=0; i!=n; ++i)
+    {
+        if (i)
+        {
+            path += seps[rng()%3];
+        }
+        path += comps[rng()%(sizeof(comps)/sizeof(comps[0]))];
+    }
+
+    if (rng()%6==0)
+    {
+        path += seps[rng()%3];
+    }
+
+    return path;
+}
+
+static void checkFind(const MountPointTree &tree, const std::map<std::wstring, std::wstring> &mountPoints, const std::wstring &path, unsigned iteration)
+{
+    std::wstring expectedKey, actualKey;
+    std::size_t  expectedLen = 0, actualLen = 0;
+
+    bool bExpected = referenceFind(mountPoints, path, expectedKey, expectedLen);
+    bool bActual   = tree.findLongestPrefix(path, actualKey, actualLen);
+
+    ++g_checks;
+    if (bExpected!=bActual || (bExpected && (expectedKey!=actualKey || expectedLen!=actualLen)))
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf( "FAIL (iteration %u, %u mount points): path '%s': reference=%d '%s' %u, tree=%d '%s' %u\n"
+                       , iteration, (unsigned)mountPoints.size(), narrow(path).c_str()
+                       , bExpected ? 1 : 0, narrow(expectedKey).c_str(), (unsigned)expectedLen
+                       , bActual   ? 1 : 0, narrow(actualKey).c_str()  , (unsigned)actualLen
+                       );
+        }
+    }
+}
+
+
+int main()
+{
+    std::mt19937 rng(1);
+
+    for(unsigned it=0; it!=300; ++it)
+    {
+        MountPointTree                        tree;
+        std::map<std::wstring, std::wstring>  mountPoints;
+
+        std::size_t nOps = 1 + (std::size_t)(rng()%60);
+        for(std::size_t op=0; op!=nOps; ++op)
+        {
+            std::wstring key = L"m" + std::to_wstring(rng()%12);
+
+            auto mit = mountPoints.find(key);
+            if (mit==mountPoints.end())
+            {
+                // Часто - цель уже существующей точки монтирования
+                std::wstring target = (!mountPoints.empty() && rng()%3==0) ? std::next(mountPoints.begin(), (std::ptrdiff_t)(rng()%mountPoints.size()))->second : randomPath(rng, 3);
+                mountPoints[key] = target;
+                tree.insert(target, key);
+            }
+            else
+            {
+                tree.remove(mit->second, key);
+                mountPoints.erase(mit);
+            }
+
+            if (rng()%4==0) // Удаление того, чего нет, ничего не меняет
+            {
+                std::wstring missingTarget = randomPath(rng, 3);
+                std::wstring missingKey    = L"m" + std::to_wstring(rng()%12);
+                auto kit = mountPoints.find(missingKey);
+                if (kit==mountPoints.end() || !sameComponents(kit->second, missingTarget))
+                {
+                    tree.remove(missingTarget, missingKey);
+                }
+
+                if (!mountPoints.empty())
+                {
+                    auto rit = std::next(mountPoints.begin(), (std::ptrdiff_t)(rng()%mountPoints.size()));
+                    tree.remove(rit->second, L"missing");
+                }
+            }
+
+            for(unsigned k=0; k!=20; ++k)
+            {
+                checkFind(tree, mountPoints, randomPath(rng, 5), it);
+            }
+        }
+
+        tree.clear();
+        mountPoints.clear();
+        checkFind(tree, mountPoints, randomPath(rng, 5), it);
+    }
+
+    std::printf("mount_point_tree_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+/*! \file
+    \brief Byte order of makeNaturalSortKey keys must be exactly the order of naturalCompare
+
+    Random strings over a small alphabet with long digit runs (over 255 significant digits - the long length
+    encoding of the key), leading zeros and non-ASCII characters (signed char bytes, wide characters above
+    0xFFFF) are compared both ways, with and without a case mapping. naturalCompare itself is checked for
+    antisymmetry and for returning 0 only on equal (mapped) strings, and against a fixed expected order.
+
+    Build:
+        g++ -std=c++17 tests/natural_compare_test.cpp -o natural_compare_test
+        cl /std:c++17 /EHsc tests\natural_compare_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../natural_compare.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+template<typename StringType>
+static std::string narrow(const StringType &s)
+{
+    std::string res;
+    for(auto ch : s)
+    {
+        res.push_back((ch>=0x20 && ch<0x7F) ? (char)ch : '?');
+    }
+    return res;
+}
+
+template<typename StringType>
+static void check(bool bOk, const char *what, const StringType &s1, const StringType &s2)
+{
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf("FAIL: %s: '%s' vs '%s'\n", what, narrow(s1).substr(0, 60).c_str(), narrow(s2).substr(0, 60).c_str());
+        }
+    }
+}
+
+//! Приведение к нижнему регистру, только ASCII
+struct LowerAsciiMapper
+{
+    template<typename CharType>
+    CharType operator()(CharType ch) const
+    {
+        return (ch>=(CharType)'A' && ch<=(CharType)'Z') ? (CharType)(ch - (CharType)'A' + (CharType)'a') : ch;
+    }
+};
+
+static int sign(int v)
+{
+    return v<0 ? -1 : (v>0 ? 1 : 0);
+}
+
+static int compareKeys(const std::string &k1, const std::string &k2)
+{
+    return sign(k1.compare(k2)); // Побайтово, как memcmp, при равенстве - короче меньше
+}
+
+template<typename StringType, typename CharMapper>
+static void checkPair(const StringType &s1, const StringType &s2, CharMapper mapChar)
+{
+    int cmp12 = naturalCompare(s1, s2, mapChar);
+    int cmp21 = naturalCompare(s2, s1, mapChar);
+
+    check(cmp12==sign(cmp12), "naturalCompare returns not -1/0/1", s1, s2);
+    check(cmp12==-cmp21, "naturalCompare is not antisymmetric", s1, s2);
+
+    StringType m1 = s1, m2 = s2;
+    std::transform(m1.begin(), m1.end(), m1.begin(), mapChar);
+    std::transform(m2.begin(), m2.end(), m2.begin(), mapChar);
+    check((cmp12==0)==(m1==m2), "naturalCompare returns 0 for different strings (or not 0 for equal)", s1, s2);
+
+    check(compareKeys(makeNaturalSortKey(s1, mapChar), makeNaturalSortKey(s2, mapChar))==cmp12, "key order differs from naturalCompare", s1, s2);
+}
+
+template<typename StringType>
+static void runRandom(unsigned seed, std::size_t numStrings, const std::vector<typename StringType::value_type> &extraChars)
+{
+    typedef typename StringType::value_type CharType;
+
+    std::mt19937 rng(seed);
+
+    std::vector<CharType> alphabet;
+    for(char ch : std::string("aAbZ._-09000112"))
+    {
+        alphabet.emplace_back((CharType)(unsigned char)ch);
+    }
+    alphabet.insert(alphabet.end(), extraChars.begin(), extraChars.end());
+
+    std::vector<StringType> strings;
+    for(std::size_t i=0; i!=numStrings; ++i)
+    {
+        StringType s;
+        std::size_t len = (std::size_t)(rng()%8);
+        for(std::size_t k=0; k!=len; ++k)
+        {
+            if (rng()%40==0) // Длинное число - длина кодируется 9 байтами
+            {
+                std::size_t nDigits = 250 + (std::size_t)(rng()%10);
+                for(std::size_t d=0; d!=nDigits; ++d)
+                {
+                    s.push_back((CharType)('0' + (d==0 ? 1 + rng()%9 : rng()%10)));
+                }
+            }
+            else
+            {
+                s.push_back(alphabet[rng()%alphabet.size()]);
+            }
+        }
+
+        strings.emplace_back(s);
+    }
+
+    for(std::size_t i=0; i!=strings.size(); ++i)
+    {
+        for(std::size_t j=i; j!=strings.size(); ++j)
+        {
+            checkPair(strings[i], strings[j], NaturalIdentityCharMapper());
+            checkPair(strings[i], strings[j], LowerAsciiMapper());
+        }
+    }
+}
+
+template<typename StringType>
+static void runFixed()
+{
+    // Ожидаемый порядок без преобразования символов
+    const char* ordered[] = { "", "0", "00", "1", "01", "001", "2", "9", "10", "010", "99", "100", "a", "a0", "a1", "a01", "a1b", "a01b", "a2", "a10"
+                            , "file1.txt", "file01.txt", "file2.txt", "file10.txt", "frame_2", "frame_10", "x1y2", "x1y10", "x2y1"
+                            };
+
+    std::vector<StringType> strings;
+    for(const char *s : ordered)
+    {
+        strings.emplace_back(widen<StringType>(s));
+    }
+
+    for(std::size_t i=0; i+1<strings.size(); ++i)
+    {
+        check(naturalCompare(strings[i], strings[i+1])<0, "fixed order broken", strings[i], strings[i+1]);
+    }
+
+    for(std::size_t i=0; i!=strings.size(); ++i)
+    {
+        for(std::size_t j=0; j!=strings.size(); ++j)
+        {
+            checkPair(strings[i], strings[j], NaturalIdentityCharMapper());
+        }
+    }
+}
+
+
+int main()
+{
+    runFixed<std::string >();
+    runFixed<std::wstring>();
+
+    runRandom<std::string >(1, 700, std::vector<char>{ (char)0xE0, (char)0x7F });
+    runRandom<std::wstring>(2, 700, std::vector<wchar_t>{ (wchar_t)0x00E0, (wchar_t)0x0430, (wchar_t)0xFFFF });
+    runRandom<std::u32string>(3, 400, std::vector<char32_t>{ (char32_t)0x0430, (char32_t)0x10000, (char32_t)0x1F600 });
+
+    std::printf("natural_compare_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/*! \file
+    \brief parallelStableSort must give exactly what std::stable_sort gives
+
+    Items are compared by a small key only and carry their original position, so any difference in the order
+    of equal items shows up. Sizes are taken around the chunk boundaries (4096 items per chunk), including
+    odd numbers of runs, for several maxConcurrency values, on an own pool and on the default pool.
+    mergePathSplit is checked separately against the split that std::merge itself makes.
+
+    Build:
+        g++ -std=c++17 -pthread tests/parallel_sort_test.cpp -o parallel_sort_test
+        cl /std:c++17 /EHsc tests\parallel_sort_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../parallel_sort.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static void check(bool bOk, const char *what, std::size_t n, std::size_t maxConcurrency)
+{
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf("FAIL (%u items, maxConcurrency %u): %s\n", (unsigned)n, (unsigned)maxConcurrency, what);
+        }
+    }
+}
+
+struct Item
+{
+    unsigned        key     = 0;
+    std::size_t     origPos = 0;
+    std::string     payload ; // Не тривиально копируемый - проверяем и перемещения
+
+    bool operator==(const Item &other) const
+    {
+        return key==other.key && origPos==other.origPos && payload==other.payload;
+    }
+};
+
+static bool lessByKey(const Item &i1, const Item &i2)
+{
+    return i1.key<i2.key;
+}
+
+enum class Distribution
+{
+    random,
+    fewKeys,
+    allEqual,
+    sorted,
+    reversed
+};
+
+static std::vector<Item> makeItems(std::mt19937 &rng, std::size_t n, Distribution distribution)
+{
+    std::vector<Item> items(n);
+    for(std::size_t i=0; i!=n; ++i)
+    {
+        Item &item = items[i];
+        switch(distribution)
+        {
+            case Distribution::random  : item.key = (unsigned)rng();         break;
+            case Distribution::fewKeys : item.key = (unsigned)(rng()%7);     break;
+            case Distribution::allEqual: item.key = 0;                       break;
+            case Distribution::sorted  : item.key = (unsigned)(i/3);         break;
+            case Distribution::reversed: item.key = (unsigned)((n-i)/3);     break;
+        }
+
+        item.origPos = i;
+        item.payload = std::to_string(i);
+    }
+
+    return items;
+}
+
+static void checkSort(std::mt19937 &rng, WorkStealingThreadPool &pool, std::size_t n, std::size_t maxConcurrency, Distribution distribution)
+{
+    std::vector<Item> expected = makeItems(rng, n, distribution);
+    std::vector<Item> onPool   = expected;
+    std::vector<Item> onDefault= expected;
+
+    std::stable_sort(expected.begin(), expected.end(), lessByKey);
+
+    parallelStableSort(onPool, lessByKey, pool, maxConcurrency);
+    check(onPool==expected, "parallelStableSort on own pool differs from std::stable_sort", n, maxConcurrency);
+
+    parallelStableSort(onDefault, lessByKey, maxConcurrency);
+    check(onDefault==expected, "parallelStableSort on default pool differs from std::stable_sort", n, maxConcurrency);
+}
+
+// mergePathSplit против std::merge: сколько элементов первого диапазона среди первых d элементов слияния
+static void checkMergePathSplit(std::mt19937 &rng, std::size_t numIterations)
+{
+    for(std::size_t it=0; it!=numIterations; ++it)
+    {
+        std::size_t nA = (std::size_t)(rng()%20);
+        std::size_t nB = (std::size_t)(rng()%20);
+        unsigned    keyRange = 1 + (unsigned)(rng()%6);
+
+        std::vector<Item> a(nA), b(nB);
+        for(auto &item : a) { item.key = (unsigned)(rng()%keyRange); item.origPos = 0; }
+        for(auto &item : b) { item.key = (unsigned)(rng()%keyRange); item.origPos = 1; }
+        std::sort(a.begin(), a.end(), lessByKey);
+        std::sort(b.begin(), b.end(), lessByKey);
+
+        std::vector<Item> merged(nA+nB);
+        std::merge(a.begin(), a.end(), b.begin(), b.end(), merged.begin(), lessByKey);
+
+        auto comp = lessByKey;
+
+        std::size_t fromA = 0;
+        for(std::size_t d=0; d<=nA+nB; ++d)
+        {
+            std::size_t split = mergePathSplit(a.begin(), nA, b.begin(), nB, d, comp);
+            check(split==fromA, "mergePathSplit differs from std::merge", nA+nB, 0);
+
+            if (d!=nA+nB && merged[d].origPos==0)
+            {
+                ++fromA;
+            }
+        }
+    }
+}
+
+
+int main()
+{
+    std::mt19937 rng(1);
+
+    checkMergePathSplit(rng, 2000);
+
+    WorkStealingThreadPool pool(4);
+
+    const std::size_t chunk = 4096;
+    const std::size_t sizes[] = { 0, 1, 2, chunk, 2*chunk-1, 2*chunk, 2*chunk+1, 3*chunk+7, 5*chunk+1, 7*chunk+3, 9*chunk, 40000 };
+    const std::size_t concurrencies[] = { 0, 1, 2, 3, 4, 5, 7, 8, 16 };
+    const Distribution distributions[] = { Distribution::random, Distribution::fewKeys, Distribution::allEqual, Distribution::sorted, Distribution::reversed };
+
+    for(auto n : sizes)
+    {
+        for(auto maxConcurrency : concurrencies)
+        {
+            for(auto distribution : distributions)
+            {
+                checkSort(rng, pool, n, maxConcurrency, distribution);
+            }
+        }
+    }
+
+    std::printf("parallel_sort_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,270 @@
+/*! \file
+    \brief PathNormalizerT vs the split/merge normalization it replaced: equivalence check, time and heap allocations
+
+    The reference below splits a path into component strings and merges them back, like
+    umba::filename::makeCanonicalSimple/makeCanonicalSimpleParts did in normalizeFilenameImpl/makePathCanonicalImpl.
+    With MARTY_VFS_BENCH_UMBA defined the old routine itself (stripLastPathSep + makeCanonicalSimple) is timed too.
+
+    Build:
+        g++ -std=c++17 -O2 tests/path_normalizer_bench.cpp -o path_normalizer_bench
+        g++ -std=c++17 -O2 -DMARTY_VFS_BENCH_UMBA -I<path-to-umba-parent> tests/path_normalizer_bench.cpp -o path_normalizer_bench
+    Exit code 0 - normalizer matches the reference and does not allocate for ordinary paths.
+*/
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(MARTY_VFS_BENCH_UMBA)
+    #include "umba/filename.h"
+#endif
+
+//
+#include "../path_normalizer.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_allocs = 0;
+
+void* operator new(std::size_t n)
+{
+    ++g_allocs;
+    void *p = std::malloc(n ? n : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t n)
+{
+    return operator new(n);
+}
+
+// Все формы delete парные к new выше - память из malloc
+void operator delete  (void *p) noexcept                { std::free(p); }
+void operator delete  (void *p, std::size_t) noexcept   { std::free(p); }
+void operator delete[](void *p) noexcept                { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept   { std::free(p); }
+
+
+//----------------------------------------------------------------------------
+// Эталон - разбивка на строки-компоненты и склейка обратно
+
+template<typename StringType>
+static bool isRefSep(typename StringType::value_type ch)
+{
+    return ch==(typename StringType::value_type)'/' || ch==(typename StringType::value_type)'\\';
+}
+
+template<typename StringType>
+static std::vector<StringType> refSplitParts(const StringType &p)
+{
+    typedef typename StringType::value_type CharType;
+
+    std::vector<StringType> parts;
+    StringType cur;
+    for(auto ch : p)
+    {
+        if (isRefSep<StringType>(ch))
+        {
+            parts.push_back(cur);
+            cur.clear();
+        }
+        else
+        {
+            cur.push_back(ch);
+        }
+    }
+    parts.push_back(cur);
+
+    std::vector<StringType> res;
+    for(const auto &part : parts)
+    {
+        if (part.empty() || part==StringType(1, (CharType)'.'))
+        {
+            continue;
+        }
+
+        if (part==StringType(2, (CharType)'.'))
+        {
+            if (!res.empty())
+            {
+                res.pop_back();
+            }
+            continue;
+        }
+
+        res.push_back(part);
+    }
+
+    return res;
+}
+
+template<typename StringType>
+static StringType refNormalize(const StringType &p)
+{
+    typedef typename StringType::value_type CharType;
+
+    std::vector<StringType> parts = refSplitParts(p);
+
+    StringType res;
+    if (!p.empty() && isRefSep<StringType>(p[0]))
+    {
+        res.push_back((CharType)'/');
+    }
+
+    for(std::size_t i=0; i!=parts.size(); ++i)
+    {
+        if (i)
+        {
+            res.push_back((CharType)'/');
+        }
+        res.append(parts[i]);
+    }
+
+    return res;
+}
+
+#if defined(MARTY_VFS_BENCH_UMBA)
+template<typename StringType>
+static StringType umbaNormalize(StringType p)
+{
+    typedef typename StringType::value_type CharType;
+
+    if (p.size()>1)
+    {
+        umba::filename::stripLastPathSep(p);
+    }
+
+    return umba::filename::makeCanonicalSimple(p, StringType(1, (CharType)'.'), StringType(2, (CharType)'.'), (CharType)'/');
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+// Случайные пути, нормализатор (строкой, на месте и по компонентам) против эталона
+static std::size_t checkEquivalence(std::mt19937 &rng, std::size_t numCases)
+{
+    const char* pieces[] = { "a", "b", "cc", ".", "..", "/", "\\", "//", "x.y", "..." };
+    const std::size_t numPieces = sizeof(pieces)/sizeof(pieces[0]);
+
+    std::size_t failures = 0;
+
+    PathNormalizerA normalizer;
+
+    for(std::size_t n=0; n!=numCases; ++n)
+    {
+        std::string path;
+        std::size_t len = rng()%20;
+        if (rng()%50==0)
+        {
+            len += 400; // Длинные пути - с выходом за встроенные буферы
+        }
+
+        for(std::size_t i=0; i!=len; ++i)
+        {
+            path += pieces[rng()%numPieces];
+        }
+
+        std::string expected = refNormalize(path);
+        std::vector<std::string> expectedParts = refSplitParts(path);
+
+        normalizer.normalize(path);
+        std::string got = normalizer.str<std::string>();
+
+        std::string inPlace = path;
+        normalizePathInPlace(inPlace);
+
+        bool bOk = got==expected && inPlace==expected && normalizer.getComponentsCount()==expectedParts.size();
+        for(std::size_t i=0; bOk && i!=expectedParts.size(); ++i)
+        {
+            bOk = normalizer.getComponentString<std::string>(i)==expectedParts[i];
+        }
+
+        if (!bOk)
+        {
+            if (failures<10)
+            {
+                std::printf("FAIL: '%s': expected '%s', got '%s', in place '%s'\n", path.c_str(), expected.c_str(), got.c_str(), inPlace.c_str());
+            }
+            ++failures;
+        }
+    }
+
+    return failures;
+}
+
+template<typename Func>
+static void runTimed(const char *name, const std::vector<std::string> &paths, std::size_t reps, Func func)
+{
+    std::size_t sink    = 0;
+    std::size_t allocs0 = g_allocs;
+    auto        t0      = std::chrono::steady_clock::now();
+
+    for(std::size_t r=0; r!=reps; ++r)
+    {
+        for(const auto &p : paths)
+        {
+            sink += func(p);
+        }
+    }
+
+    auto        t1      = std::chrono::steady_clock::now();
+    std::size_t allocs  = g_allocs - allocs0;
+
+    std::printf( "%-24s %8.1f ms, %9u allocations (%u)\n", name
+               , std::chrono::duration<double, std::milli>(t1-t0).count(), (unsigned)allocs, (unsigned)(sink&0xFF)
+               );
+}
+
+
+int main()
+{
+    std::mt19937 rng(1);
+
+    std::size_t failures = checkEquivalence(rng, 200000);
+    std::printf("equivalence: %u failures\n", (unsigned)failures);
+
+    // Пути, похожие на настоящие: шесть уровней, иногда ".." и двойные разделители
+    std::vector<std::string> paths;
+    for(std::size_t i=0; i!=20000; ++i)
+    {
+        std::string p = "/data/";
+        for(std::size_t j=0; j!=6; ++j)
+        {
+            p += (rng()%5==0 ? ".." : "dir") + std::to_string(rng()%100);
+            p += (rng()%3) ? "/" : "//";
+        }
+        p += "file.txt";
+        paths.emplace_back(p);
+    }
+
+    const std::size_t reps = 10;
+
+    PathNormalizerA normalizer;
+    std::size_t normalizerAllocs0 = g_allocs;
+    runTimed("PathNormalizerT", paths, reps, [&](const std::string &p) { normalizer.normalize(p); return normalizer.size(); });
+    std::size_t normalizerAllocs = g_allocs - normalizerAllocs0;
+
+    runTimed("split/merge reference", paths, reps, [&](const std::string &p) { return refNormalize(p).size(); });
+
+#if defined(MARTY_VFS_BENCH_UMBA)
+    runTimed("umba makeCanonicalSimple", paths, reps, [&](const std::string &p) { return umbaNormalize(p).size(); });
+#endif
+
+    if (normalizerAllocs)
+    {
+        std::printf("FAIL: PathNormalizerT allocated %u times on short paths\n", (unsigned)normalizerAllocs);
+    }
+
+    return (failures || normalizerAllocs) ? 1 : 0;
+}
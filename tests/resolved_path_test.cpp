@@ -0,0 +1,234 @@
+/*! \file
+    \brief Operations on ResolvedPath handles must behave as the same operations on the virtual path string,
+    and handles must go stale whenever the mount table changes
+
+    For FileSystemImpl and VfsOnVfsFileSystemImpl, random virtual paths (mount point name case, '.', '..',
+    both separators, repeated separators) are resolved and compared with the string API they replace:
+    resolvePath fails exactly when mapVirtualPath fails, the native path of FileSystemImpl handles is the one
+    mapVirtualPath gives, and readTextFile/readDataFile/isFileExistAndReadable/isDirectory give the same
+    results through the handle and through the string. Mount targets do not exist on disk, nothing is written.
+
+    Stale handles: after a successful addMountPoint, removeMountPoint or clearMounts, for a handle taken from
+    another (or copied) file system, and for a default-constructed handle, checkResolvedPath and every handle
+    operation report ErrorCode::invalidMountPoint. Failed mount table changes do not invalidate handles.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/resolved_path_test.cpp -o resolved_path_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\resolved_path_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../filesystem_impl.h"
+#include "../vfs_on_vfs_filesystem_impl.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static void check(bool bOk, const char *fsName, const char *what, const std::string &vPath)
+{
+    ++g_checks;
+    if (!bOk)
+    {
+        ++g_failures;
+        if (g_failures<=50)
+        {
+            std::printf("FAIL (%s): %s: '%s'\n", fsName, what, vPath.c_str());
+        }
+    }
+}
+
+template<typename StringType>
+static StringType widen(const std::string &s)
+{
+    StringType res;
+    for(char ch : s)
+    {
+        res.push_back((typename StringType::value_type)(unsigned char)ch);
+    }
+    return res;
+}
+
+static std::string randomVirtualPath(std::mt19937 &rng)
+{
+    const char* comps[] = { "m", "M", "n", "x", "a.txt", "sub", "..", ".", "" };
+    const char* seps [] = { "/", "\\" };
+
+    std::string path;
+    if (rng()%5)
+    {
+        path = seps[rng()%2];
+    }
+
+    std::size_t n = (std::size_t)(rng()%5);
+    for(std::size_t i=0; i!=n; ++i)
+    {
+        if (i)
+        {
+            path += seps[rng()%2];
+        }
+        path += comps[rng()%(sizeof(comps)/sizeof(comps[0]))];
+    }
+
+    return path;
+}
+
+// Через разрешённый путь - то же, что и через строку
+template<typename StringType>
+static void checkSameAsString(const IFileSystem &fs, const char *fsName, const std::string &vPathA)
+{
+    const StringType vPath = widen<StringType>(vPathA);
+
+    ResolvedPathT<StringType> resolved;
+    ErrorCode resolveErr = fs.resolvePath(vPath, resolved);
+
+    StringType realPath;
+    ErrorCode mapErr = fs.mapVirtualPath(vPath, realPath);
+
+    // Виртуальный корень разрешается, хотя родного пути у него нет
+    check((resolveErr==ErrorCode::ok)==(mapErr==ErrorCode::ok || resolved.isVirtualRoot()), fsName, "resolvePath and mapVirtualPath disagree", vPathA);
+    if (resolveErr!=ErrorCode::ok)
+    {
+        return;
+    }
+
+    check(resolved.isValid() && fs.checkResolvedPath(resolved)==ErrorCode::ok, fsName, "fresh handle rejected", vPathA);
+
+    StringType textByHandle, textByString;
+    check(fs.readTextFile(resolved, textByHandle)==fs.readTextFile(vPath, textByString), fsName, "readTextFile differs", vPathA);
+
+    std::vector<std::uint8_t> dataByHandle, dataByString;
+    check(fs.readDataFile(resolved, dataByHandle)==fs.readDataFile(vPath, dataByString), fsName, "readDataFile differs", vPathA);
+
+    check(fs.isFileExistAndReadable(resolved)==fs.isFileExistAndReadable(vPath), fsName, "isFileExistAndReadable differs", vPathA);
+    check(fs.isDirectory(resolved)==fs.isDirectory(vPath), fsName, "isDirectory differs", vPathA);
+}
+
+template<typename StringType>
+static void checkStale(const IFileSystem &fs, const char *fsName, const char *what, const ResolvedPathT<StringType> &resolved)
+{
+    StringType                text;
+    std::vector<std::uint8_t> data;
+    std::shared_ptr<IFileHandle> pHandle;
+
+    bool bStale = fs.checkResolvedPath(resolved)==ErrorCode::invalidMountPoint
+               && fs.readTextFile(resolved, text)==ErrorCode::invalidMountPoint
+               && fs.readDataFile(resolved, data)==ErrorCode::invalidMountPoint
+               && fs.openFile(resolved, OpenMode::read, pHandle)==ErrorCode::invalidMountPoint
+               && fs.createDirectory(resolved, true)==ErrorCode::invalidMountPoint
+               && !fs.isFileExistAndReadable(resolved)
+               && !fs.isDirectory(resolved);
+
+    check(bStale, fsName, what, std::string());
+}
+
+// FS - FileSystemImpl или VfsOnVfsFileSystemImpl с точками монтирования "m" и "n"
+template<typename FS>
+static void checkGenerations(FS &fs, const char *fsName, const std::string &newTarget)
+{
+    const IFileSystem &ifs = fs;
+
+    ResolvedPathA resolvedA;
+    ResolvedPathW resolvedW;
+    check(ifs.resolvePath(std::string("/m/a.txt"), resolvedA)==ErrorCode::ok, fsName, "resolvePath failed", "/m/a.txt");
+    check(ifs.resolvePath(std::wstring(L"/n/sub"), resolvedW)==ErrorCode::ok, fsName, "resolvePath failed", "/n/sub");
+
+    // Неудачные изменения таблицы монтирования ничего не меняют
+    check(fs.addMountPoint(std::string("m"), newTarget)==ErrorCode::alreadyExist, fsName, "duplicate mount point accepted", "m");
+    check(fs.removeMountPoint(std::string("missing"))!=ErrorCode::ok, fsName, "missing mount point removed", "missing");
+    check(ifs.checkResolvedPath(resolvedA)==ErrorCode::ok && ifs.checkResolvedPath(resolvedW)==ErrorCode::ok, fsName, "handle invalidated by a failed mount table change", std::string());
+
+    // Чужая ФС - в том числе копия этой
+    FS copy = fs;
+    checkStale<std::string>(copy, fsName, "handle accepted by a copy of the file system", resolvedA);
+
+    checkStale<std::string>(ifs, fsName, "default-constructed handle accepted", ResolvedPathA());
+
+    check(fs.addMountPoint(std::string("k"), newTarget)==ErrorCode::ok, fsName, "addMountPoint failed", "k");
+    checkStale<std::string >(ifs, fsName, "handle still valid after addMountPoint", resolvedA);
+    checkStale<std::wstring>(ifs, fsName, "handle still valid after addMountPoint", resolvedW);
+
+    check(ifs.resolvePath(std::string("/m/a.txt"), resolvedA)==ErrorCode::ok && ifs.checkResolvedPath(resolvedA)==ErrorCode::ok, fsName, "handle resolved again rejected", "/m/a.txt");
+
+    check(fs.removeMountPoint(std::string("k"))==ErrorCode::ok, fsName, "removeMountPoint failed", "k");
+    checkStale<std::string>(ifs, fsName, "handle still valid after removeMountPoint", resolvedA);
+
+    check(ifs.resolvePath(std::string("/m/a.txt"), resolvedA)==ErrorCode::ok, fsName, "resolvePath failed", "/m/a.txt");
+    check(fs.clearMounts()==ErrorCode::ok, fsName, "clearMounts failed", std::string());
+    checkStale<std::string>(ifs, fsName, "handle still valid after clearMounts", resolvedA);
+}
+
+template<typename FS>
+static void run(FS &fs, const char *fsName, const std::string &newTarget)
+{
+    std::mt19937 rng(1);
+
+    for(unsigned it=0; it!=3000; ++it)
+    {
+        std::string vPath = randomVirtualPath(rng);
+        checkSameAsString<std::string >(fs, fsName, vPath);
+        checkSameAsString<std::wstring>(fs, fsName, vPath);
+    }
+
+    checkGenerations(fs, fsName, newTarget);
+}
+
+
+int main()
+{
+    // Таких каталогов нет - разрешение путей на диск не смотрит, а чтение просто не находит файлов
+    const std::string root = "/nonexistent_mvfs_resolved_path_test";
+
+    {
+        FileSystemImpl fs;
+        fs.addMountPoint(std::string("m"), root + "/m");
+        fs.addMountPoint(std::string("n"), root + "/n/sub");
+
+        // Родной путь в разрешённом пути - тот же, что даёт mapVirtualPath
+        typedef ResolvedPathA::NativeStringType NativeStringType;
+
+        std::mt19937 rng(2);
+        for(unsigned it=0; it!=3000; ++it)
+        {
+            std::string      vPathA = randomVirtualPath(rng);
+            NativeStringType vPath  = widen<NativeStringType>(vPathA);
+
+            ResolvedPathT<NativeStringType> resolved;
+            NativeStringType                realPath;
+            if (fs.resolvePath(vPath, resolved)==ErrorCode::ok && !resolved.isVirtualRoot())
+            {
+                check(fs.mapVirtualPath(vPath, realPath)==ErrorCode::ok && resolved.getNativePath()==realPath, "fs", "native path differs from mapVirtualPath", vPathA);
+            }
+        }
+
+        run(fs, "fs", root + "/k");
+    }
+
+    {
+        auto pParent = std::make_shared<FileSystemImpl>();
+        pParent->addMountPoint(std::string("root"), root);
+
+        VfsOnVfsFileSystemImpl fs(pParent);
+        fs.addMountPoint(std::string("m"), std::string("/root/m"));
+        fs.addMountPoint(std::string("n"), std::string("/root/n/sub"));
+
+        run(fs, "vfs-on-vfs", "/root/k");
+    }
+
+    std::printf("resolved_path_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+/*! \file
+    \brief FileMaskInfoT::compile() (SimpleMaskMatcherT) must match exactly what the regex path matches
+
+    The oracle is the production regex path: FileMaskInfoT::compileRegex() (umba::regex_helpers::expandSimpleMaskToEcmaRegex)
+    and CompiledFileMaskInfoT::matchName (umba::regex_helpers::regexMatch).
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/simple_mask_matcher_test.cpp -o simple_mask_matcher_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\simple_mask_matcher_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+//
+#include "../vfs_types.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+static void printStr(const std::string &s)
+{
+    for(char ch : s)
+    {
+        if (ch=='\n')       std::printf("\\n");
+        else if (ch=='\r')  std::printf("\\r");
+        else                std::printf("%c", ch);
+    }
+}
+
+static void printStr(const std::wstring &s)
+{
+    for(wchar_t ch : s)
+    {
+        if (ch==L'\n')          std::printf("\\n");
+        else if (ch==L'\r')     std::printf("\\r");
+        else if (ch<0x80)       std::printf("%c", (char)ch);
+        else                    std::printf("\\x{%X}", (unsigned)ch);
+    }
+}
+
+template<typename StringType>
+static StringType widen(const char *p)
+{
+    StringType s;
+    for(; *p; ++p)
+    {
+        s.push_back((typename StringType::value_type)(unsigned char)*p);
+    }
+    return s;
+}
+
+// Сравнивает простой матчер с regex'ом, который для маски строит и проверяет umba (как в FileMaskInfoT::compileRegex)
+template<typename StringType>
+static void checkMask(const StringType &mask, bool bAnchors, const std::vector<StringType> &names)
+{
+    typedef typename StringType::value_type CharType;
+
+    FileMaskInfoT<StringType> maskInfo;
+    maskInfo.fileMaskFlags = bAnchors ? FileMaskFlags::matchSimple|FileMaskFlags::useAnchors : FileMaskFlags::matchSimple;
+    maskInfo.mask          = mask;
+
+    CompiledFileMaskInfoT<StringType> simpleCompiled = maskInfo.compile();
+    if (!simpleCompiled.useSimpleMatcher)
+    {
+        // Маски с переводами строк идут через regex, для остальных compile не должен отказываться
+        bool bHasLineTerminator = mask.find((CharType)'\n')!=StringType::npos || mask.find((CharType)'\r')!=StringType::npos;
+        ++g_checks;
+        if (!bHasLineTerminator)
+        {
+            ++g_failures;
+            std::printf("FAIL: compile rejected mask '"); printStr(mask); std::printf("'\n");
+        }
+        return;
+    }
+
+    StringType regexStr = umba::regex_helpers::expandSimpleMaskToEcmaRegex(mask, bAnchors, false);
+    CompiledFileMaskInfoT<StringType> regexCompiled = maskInfo.compileRegex();
+
+    for(const auto &name : names)
+    {
+        bool bExpected = regexCompiled.matchName(name);
+        bool bActual   = simpleCompiled.matchName(name);
+
+        ++g_checks;
+        if (bExpected!=bActual)
+        {
+            ++g_failures;
+            if (g_failures<=50)
+            {
+                std::printf("FAIL (%s, %s): mask '", sizeof(CharType)==1 ? "narrow" : "wide", bAnchors ? "anchored" : "unanchored");
+                printStr(mask);
+                std::printf("', regex '");
+                printStr(regexStr);
+                std::printf("', name '");
+                printStr(name);
+                std::printf("': regex=%d, simple=%d\n", (int)bExpected, (int)bActual);
+            }
+        }
+    }
+}
+
+template<typename StringType>
+static std::vector<StringType> makeFixedNames()
+{
+    const char* names[] = { "", "a", "ab", "abc", "a.b", "a.txt", "b.txt", "readme", "README.md", "file.tar.gz"
+                          , "x.cpp", "x.cpp.bak", "main.c", "main.cc", "a+b", "(a)", "[ab]", "{1,2}", "a^b", "a$b"
+                          , "a|b", "a\\b", "a/b", ".hidden", "..", "aaa", "aaaa", "abab", "abcabc", "name with spaces"
+                          , "a\nb", "a\rb", "\n", "\r\n", "a.txt\n", "\na.txt", "x\ny.txt", "foo\rbar.cpp"
+                          };
+
+    std::vector<StringType> res;
+    for(const char *p : names)
+    {
+        res.emplace_back(widen<StringType>(p));
+    }
+    return res;
+}
+
+template<typename StringType>
+static void runFixed()
+{
+    const char* masks[] = { "", "*", "?", "??", "*.*", "*.txt", "a*", "*a", "a*b", "*a*", "a?c", "?.txt", "*.cpp"
+                          , "*.c?", "a*b*c", "*ab*ab*", "a**b", "**", "*?", "?*", "?*?", "a+b", "(a)", "[ab]", "{1,2}"
+                          , "a^b", "a$b", "a|b", "a\\b", "a.b", ".*", "*.", "*.tar.*", "*(*)*", "[*]", "$*", "*^"
+                          , "a\nb", "*\r*"
+                          };
+
+    std::vector<StringType> names = makeFixedNames<StringType>();
+
+    for(const char *m : masks)
+    {
+        checkMask(widen<StringType>(m), false, names);
+        checkMask(widen<StringType>(m), true , names);
+    }
+}
+
+// Случайные маски и имена над маленьким алфавитом, чтобы совпадения были частыми
+template<typename StringType>
+static void runRandom(unsigned seed, std::size_t numMasks, std::size_t numNames)
+{
+    typedef typename StringType::value_type CharType;
+
+    const StringType maskAlphabet = widen<StringType>("ab.*?*?+()[]^$|\\");
+    const StringType nameAlphabet = widen<StringType>("ab.+()[]^$|\\\n\r");
+
+    std::mt19937 rng(seed);
+
+    auto randomString = [&](const StringType &alphabet, std::size_t maxLen)
+    {
+        StringType s;
+        std::size_t len = (std::size_t)(rng() % (maxLen+1));
+        for(std::size_t i=0; i!=len; ++i)
+        {
+            s.push_back(alphabet[rng()%alphabet.size()]);
+        }
+        return s;
+    };
+
+    std::vector<StringType> names;
+    for(std::size_t i=0; i!=numNames; ++i)
+    {
+        names.emplace_back(randomString(nameAlphabet, 10));
+    }
+
+    for(std::size_t i=0; i!=numMasks; ++i)
+    {
+        StringType mask = randomString(maskAlphabet, 7);
+        checkMask(mask, false, names);
+        checkMask(mask, true , names);
+    }
+
+    // Не-ASCII символы в широких строках
+    if (sizeof(CharType)>1)
+    {
+        StringType wideName;
+        wideName.push_back((CharType)0x0444);
+        wideName.push_back((CharType)'.');
+        wideName.push_back((CharType)0x0445);
+
+        std::vector<StringType> wideNames(1, wideName);
+        checkMask(widen<StringType>("?.?"), true , wideNames);
+        checkMask(widen<StringType>("*.*"), false, wideNames);
+        checkMask(wideName, true, wideNames);
+    }
+}
+
+
+int main()
+{
+    runFixed<std::string>();
+    runFixed<std::wstring>();
+
+    runRandom<std::string >(1, 600, 300);
+    runRandom<std::wstring>(2, 600, 300);
+
+    std::printf("simple_mask_matcher_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/*! \file
+    \brief Heap allocations per call of the string_view overloads of FileSystemImpl
+
+    Counts operator new calls per call of isFileExistAndReadable(string_view) and mapVirtualPath(string_view, out)
+    with a reused output string, and fails if the count grows. Allocations made inside umba::filesys::isFileReadable
+    are measured separately and subtracted, so only the VFS part is checked.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -I<path-to-umba-parent> tests/string_view_alloc_test.cpp -o string_view_alloc_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\string_view_alloc_test.cpp
+    Exit code 0 - no allocation count exceeds its limit.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+//
+#include "../filesystem_impl.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_allocs = 0;
+
+void* operator new(std::size_t n)
+{
+    ++g_allocs;
+    void *p = std::malloc(n ? n : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t n)
+{
+    return operator new(n);
+}
+
+// Все формы delete парные к new выше - память из malloc
+void operator delete  (void *p) noexcept                { std::free(p); }
+void operator delete  (void *p, std::size_t) noexcept   { std::free(p); }
+void operator delete[](void *p) noexcept                { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept   { std::free(p); }
+
+
+#if !defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+int main()
+{
+    std::printf("string_view_alloc_test: string_view overloads are not available, nothing to check\n");
+    return 0;
+}
+
+#else
+
+static const std::size_t numCalls = 1000;
+
+template<typename Func>
+static std::size_t countAllocsPerCall(Func func)
+{
+    func(); // Прогрев - ленивые инициализации не считаем
+
+    std::size_t allocs0 = g_allocs;
+    for(std::size_t i=0; i!=numCalls; ++i)
+    {
+        func();
+    }
+
+    return (g_allocs - allocs0) / numCalls;
+}
+
+static bool checkLimit(const char *name, std::size_t allocs, std::size_t limit)
+{
+    std::printf("%-56s: %u allocation(s) per call, limit %u\n", name, (unsigned)allocs, (unsigned)limit);
+
+    if (allocs>limit)
+    {
+        std::printf("FAIL: %s allocates more than before\n", name);
+        return false;
+    }
+
+    if (allocs<limit)
+    {
+        std::printf("NOTE: %s allocates less than the limit, the limit can be lowered\n", name);
+    }
+
+    return true;
+}
+
+// Родной тип символов: под Windows - wchar_t, иначе - char. Для него путь не перекодируется,
+// и число выделений одинаково на всех платформах
+template<typename CharType>
+static bool runChecks(FileSystemImpl &fs, const CharType *pPath)
+{
+    typedef std::basic_string<CharType>       StringType;
+    typedef std::basic_string_view<CharType>  StringViewType;
+
+    const StringViewType vPath(pPath);
+
+    StringType nativePath;
+    if (fs.mapVirtualPath(vPath, nativePath)!=ErrorCode::ok)
+    {
+        std::printf("FAIL: mapVirtualPath failed\n");
+        return false;
+    }
+
+    // Выделения внутри umba - не наши
+    std::size_t umbaAllocs = countAllocsPerCall([&]() { umba::filesys::isFileReadable(nativePath); });
+
+    // Ключ точки монтирования и родной путь
+    std::size_t existAllocs = countAllocsPerCall([&]() { fs.isFileExistAndReadable(vPath); });
+    existAllocs = existAllocs>umbaAllocs ? existAllocs-umbaAllocs : 0;
+
+    // Только ключ точки монтирования - выходная строка уже достаточной ёмкости
+    StringType reusedOut;
+    std::size_t mapAllocs = countAllocsPerCall([&]() { fs.mapVirtualPath(vPath, reusedOut); });
+
+    bool bOk = true;
+    bOk = checkLimit("isFileExistAndReadable(string_view) without umba", existAllocs, 2) && bOk;
+    bOk = checkLimit("mapVirtualPath(string_view, reused output)"      , mapAllocs  , 1) && bOk;
+
+    return bOk;
+}
+
+int main()
+{
+    std::shared_ptr<FileSystemImpl> pFs = std::make_shared<FileSystemImpl>();
+
+#if defined(WIN32) || defined(_WIN32)
+    if (pFs->addMountPoint(std::wstring(L"data"), std::wstring(L"C:\\marty_vfs_test\\storage\\data"))!=ErrorCode::ok)
+    {
+        std::printf("FAIL: addMountPoint failed\n");
+        return 1;
+    }
+
+    bool bOk = runChecks(*pFs, L"/data/projects/some_project/src/module/file_name.cpp");
+#else
+    if (pFs->addMountPoint(std::string("data"), std::string("/marty_vfs_test/storage/data"))!=ErrorCode::ok)
+    {
+        std::printf("FAIL: addMountPoint failed\n");
+        return 1;
+    }
+
+    bool bOk = runChecks(*pFs, "/data/projects/some_project/src/module/file_name.cpp");
+#endif
+
+    return bOk ? 0 : 1;
+}
+
+#endif // MARTY_VFS_STRING_VIEW_AVAILABLE
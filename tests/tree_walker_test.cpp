@@ -0,0 +1,431 @@
+/*! \file
+    \brief TreeWalkerT (parallel, work-stealing) must visit what a plain sequential recursion visits
+
+    The tree is kept in memory: real directories with files, subdirectories and links to other directories,
+    including links to ancestors (cycles) and dangling links. Links are reported either as symlinks or,
+    like a lister that cannot tell them apart, as plain directories. The reference walker is a straightforward
+    recursion with the documented rules - descend into symlinks only with WalkTreeFlags::followSymlinks,
+    skip a directory whose id is already among its ancestors, respect maxDepth and the pruner.
+    Sorted walks must produce exactly the reference order, unsorted walks - the same multiset of paths.
+
+    Build (umba headers must be on the include path):
+        g++ -std=c++17 -pthread -I<path-to-umba-parent> tests/tree_walker_test.cpp -o tree_walker_test
+        cl /std:c++17 /EHsc /I<path-to-umba-parent> tests\tree_walker_test.cpp
+    Exit code 0 - all checks passed.
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+#include "../tree_walker.h"
+
+
+using namespace marty_virtual_fs;
+
+
+static std::size_t g_checks   = 0;
+static std::size_t g_failures = 0;
+
+
+typedef TreeWalkerT<std::string>  TreeWalker;
+
+
+// Дерево в памяти. Каталог 0 - корень
+struct MemTree
+{
+    enum class Kind { file, dir, link };
+
+    struct Item
+    {
+        std::string  name  ;
+        Kind         kind  = Kind::file;
+        int          target = -1; // Каталог для dir/link, -1 у link - висячая ссылка
+    };
+
+    std::vector< std::vector<Item> >  dirs;
+    bool                              bMarkLinks = true; // false - ссылки выглядят как обычные каталоги
+
+    // Путь "/a/b" -> индекс каталога, -1 - не найден
+    int resolve(const std::string &path) const
+    {
+        int cur = 0;
+
+        std::size_t pos = 0;
+        while(pos<path.size())
+        {
+            while(pos<path.size() && path[pos]=='/')
+            {
+                ++pos;
+            }
+
+            if (pos==path.size())
+            {
+                break;
+            }
+
+            std::size_t end = path.find('/', pos);
+            if (end==std::string::npos)
+            {
+                end = path.size();
+            }
+
+            std::string name = path.substr(pos, end-pos);
+            pos = end;
+
+            int next = -1;
+            for(const auto &item : dirs[(std::size_t)cur])
+            {
+                if (item.name==name && item.kind!=Kind::file)
+                {
+                    next = item.target;
+                    break;
+                }
+            }
+
+            if (next<0)
+            {
+                return -1;
+            }
+
+            cur = next;
+        }
+
+        return cur;
+    }
+
+    DirectoryEntryInfoA makeEntry(const Item &item) const
+    {
+        DirectoryEntryInfoA e;
+        e.entryName = item.name;
+
+        if (item.kind==Kind::file)
+        {
+            e.fileTypeFlags = FileTypeFlags::normalFile;
+        }
+        else if (item.kind==Kind::dir || !bMarkLinks)
+        {
+            e.fileTypeFlags = FileTypeFlags::directory;
+        }
+        else
+        {
+            e.fileTypeFlags = FileTypeFlags::directory|FileTypeFlags::symlink;
+        }
+
+        return e;
+    }
+
+    ErrorCode list(const std::string &path, const DirectoryEntryVisitorA &visitor) const
+    {
+        int idx = resolve(path);
+        if (idx<0)
+        {
+            return ErrorCode::notFound;
+        }
+
+        for(const auto &item : dirs[(std::size_t)idx])
+        {
+            if (!visitor(makeEntry(item)))
+            {
+                break;
+            }
+        }
+
+        return ErrorCode::ok;
+    }
+
+    bool getId(const std::string &path, TreeWalker::DirectoryId &id) const
+    {
+        int idx = resolve(path);
+        if (idx<0)
+        {
+            return false;
+        }
+
+        id = TreeWalker::DirectoryId(1, (std::uint64_t)idx);
+        return true;
+    }
+
+};
+
+
+static std::string childPath(const std::string &dirPath, const std::string &name)
+{
+    return dirPath=="/" ? dirPath + name : dirPath + "/" + name;
+}
+
+struct WalkParams
+{
+    EnumerateFlags  enumerateFlags = EnumerateFlags::none;
+    std::size_t     maxDepth       = 0;
+    WalkTreeFlags   walkFlags      = WalkTreeFlags::none;
+    bool            bUseDirIds     = true;
+    bool            bPrune         = false; // Не спускаться в каталоги с именем на 'p'
+};
+
+static bool isPruned(const WalkParams &params, const DirectoryEntryInfoA &e)
+{
+    return params.bPrune && !e.entryName.empty() && e.entryName[0]=='p';
+}
+
+// Эталон - последовательная рекурсия, записи каталога по возрастанию имени
+static void referenceWalk( const MemTree &tree, const WalkParams &params, const CompiledFileMaskSetA &maskSet
+                         , const std::string &dirPath, std::size_t depth, std::vector<int> ancestors
+                         , std::vector<std::string> &visited, ErrorCode &firstErr
+                         )
+{
+    if (params.bUseDirIds)
+    {
+        TreeWalker::DirectoryId id;
+        if (tree.getId(dirPath, id))
+        {
+            if (std::find(ancestors.begin(), ancestors.end(), (int)id.second)!=ancestors.end())
+            {
+                return;
+            }
+
+            ancestors.emplace_back((int)id.second);
+        }
+    }
+
+    std::vector<DirectoryEntryInfoA> entries;
+    ErrorCode err = tree.list(dirPath, [&](const DirectoryEntryInfoA &e) { entries.emplace_back(e); return true; });
+    if (err!=ErrorCode::ok)
+    {
+        if (firstErr==ErrorCode::ok)
+        {
+            firstErr = err;
+        }
+        return;
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const DirectoryEntryInfoA &e1, const DirectoryEntryInfoA &e2) { return e1.entryName<e2.entryName; });
+
+    for(const auto &e : entries)
+    {
+        if (isDirectoryEntryTypeMatch(params.enumerateFlags, e) && maskSet.findFirstMatch(e)>0)
+        {
+            visited.emplace_back(childPath(dirPath, e.entryName));
+        }
+
+        bool bDescend = (e.fileTypeFlags&FileTypeFlags::directory)!=0
+                     && ((e.fileTypeFlags&FileTypeFlags::symlink)==0 || (params.walkFlags&WalkTreeFlags::followSymlinks)!=0)
+                     && (!params.maxDepth || depth<params.maxDepth)
+                     && !isPruned(params, e);
+
+        if (bDescend)
+        {
+            referenceWalk(tree, params, maskSet, childPath(dirPath, e.entryName), depth+1, ancestors, visited, firstErr);
+        }
+    }
+}
+
+static void checkWalk( const char *what, const MemTree &tree, const WalkParams &params, const CompiledFileMaskSetA &maskSet
+                     , std::size_t maxConcurrency, const std::shared_ptr<WorkStealingThreadPool> &pPool
+                     )
+{
+    std::vector<std::string> expected;
+    ErrorCode expectedErr = ErrorCode::ok;
+    referenceWalk(tree, params, maskSet, "/", 1, std::vector<int>(), expected, expectedErr);
+
+    TreeWalker::DirectoryIdGetterType dirIdGetter;
+    if (params.bUseDirIds)
+    {
+        dirIdGetter = [&](const std::string &dirPath, TreeWalker::DirectoryId &id) { return tree.getId(dirPath, id); };
+    }
+
+    WalkTreePrunerA pruner;
+    if (params.bPrune)
+    {
+        pruner = [&](const DirectoryEntryInfoA &e, std::size_t) { return isPruned(params, e); };
+    }
+
+    // lister кладёт в запись путь каталога - по нему visitor собирает полный путь
+    TreeWalker walker( [&](const std::string &dirPath, const DirectoryEntryVisitorA &visitor)
+                       {
+                           return tree.list(dirPath, [&](const DirectoryEntryInfoA &e)
+                                                     {
+                                                         DirectoryEntryInfoA withPath = e;
+                                                         withPath.path = dirPath;
+                                                         return visitor(withPath);
+                                                     }
+                                           );
+                       }
+                     , params.enumerateFlags, maskSet, params.maxDepth, pruner, params.walkFlags, maxConcurrency, dirIdGetter, pPool
+                     );
+
+    std::vector<std::string> actual;
+    ErrorCode actualErr = walker.walk("/", [&](const DirectoryEntryInfoA &e) { actual.emplace_back(childPath(e.path, e.entryName)); return true; });
+
+    if ((params.walkFlags&WalkTreeFlags::sorted)==0)
+    {
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+    }
+
+    ++g_checks;
+    if (expected!=actual || expectedErr!=actualErr)
+    {
+        ++g_failures;
+        if (g_failures<=20)
+        {
+            std::printf( "FAIL (%s, flags=%u, maxDepth=%u, dirIds=%d, prune=%d, concurrency=%u): reference %u entries/err %d, walker %u entries/err %d\n"
+                       , what, (unsigned)params.walkFlags, (unsigned)params.maxDepth, (int)params.bUseDirIds, (int)params.bPrune, (unsigned)maxConcurrency
+                       , (unsigned)expected.size(), (int)expectedErr, (unsigned)actual.size(), (int)actualErr
+                       );
+            for(std::size_t i=0; i!=std::max(expected.size(), actual.size()); ++i)
+            {
+                const char *pExp = i<expected.size() ? expected[i].c_str() : "-";
+                const char *pAct = i<actual  .size() ? actual  [i].c_str() : "-";
+                if (std::string(pExp)!=pAct)
+                {
+                    std::printf("    first difference at %u: reference '%s', walker '%s'\n", (unsigned)i, pExp, pAct);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// visitor, вернувший false, больше не вызывается
+static void checkStop(const MemTree &tree, const CompiledFileMaskSetA &maskSet, WalkTreeFlags walkFlags, std::size_t maxConcurrency, const std::shared_ptr<WorkStealingThreadPool> &pPool)
+{
+    TreeWalker walker( [&](const std::string &dirPath, const DirectoryEntryVisitorA &visitor) { return tree.list(dirPath, visitor); }
+                     , EnumerateFlags::none, maskSet, 0, WalkTreePrunerA(), walkFlags, maxConcurrency
+                     , [&](const std::string &dirPath, TreeWalker::DirectoryId &id) { return tree.getId(dirPath, id); }
+                     , pPool
+                     );
+
+    std::vector<std::string> all;
+    ErrorCode err = ErrorCode::ok;
+    referenceWalk(tree, WalkParams(), maskSet, "/", 1, std::vector<int>(), all, err);
+
+    const std::size_t stopAfter = std::min<std::size_t>(5, all.size());
+    std::size_t numCalls = 0;
+    walker.walk("/", [&](const DirectoryEntryInfoA &) { return ++numCalls<stopAfter; });
+
+    ++g_checks;
+    if (numCalls!=stopAfter)
+    {
+        ++g_failures;
+        std::printf("FAIL (stop, flags=%u, concurrency=%u): visitor called %u times, expected %u\n", (unsigned)walkFlags, (unsigned)maxConcurrency, (unsigned)numCalls, (unsigned)stopAfter);
+    }
+}
+
+static MemTree makeRandomTree(std::mt19937 &rng, std::size_t numDirs)
+{
+    MemTree tree;
+    tree.dirs.resize(numDirs);
+
+    // Остов - каждый каталог, кроме корня, подкаталог одного из предыдущих
+    for(std::size_t d=1; d!=numDirs; ++d)
+    {
+        MemTree::Item item;
+        item.name   = "d" + std::to_string(d);
+        item.kind   = MemTree::Kind::dir;
+        item.target = (int)d;
+        if (rng()%8==0)
+        {
+            item.name = "p" + std::to_string(d); // Под обрезку pruner'ом
+        }
+        tree.dirs[rng()%d].emplace_back(item);
+    }
+
+    for(std::size_t d=0; d!=numDirs; ++d)
+    {
+        std::size_t numFiles = (std::size_t)(rng()%5);
+        for(std::size_t f=0; f!=numFiles; ++f)
+        {
+            MemTree::Item item;
+            item.name = "f" + std::to_string(f) + (rng()%2 ? ".txt" : ".bin");
+            tree.dirs[d].emplace_back(item);
+        }
+
+        // Ссылки на любой каталог - в том числе на предков (циклы) и на себя, иногда висячие
+        if (rng()%3==0)
+        {
+            MemTree::Item item;
+            item.name   = "l" + std::to_string(d);
+            item.kind   = MemTree::Kind::link;
+            item.target = rng()%10==0 ? -1 : (int)(rng()%numDirs);
+            tree.dirs[d].emplace_back(item);
+        }
+
+        std::shuffle(tree.dirs[d].begin(), tree.dirs[d].end(), rng);
+    }
+
+    return tree;
+}
+
+
+int main()
+{
+    std::shared_ptr<WorkStealingThreadPool> pPool = std::make_shared<WorkStealingThreadPool>(4);
+
+    std::vector<FileMaskInfoA> allMasks(1);
+    allMasks[0].mask = "*";
+    CompiledFileMaskSetA allMaskSet(allMasks);
+
+    std::vector<FileMaskInfoA> txtMasks(1);
+    txtMasks[0].mask          = "*.txt";
+    txtMasks[0].fileMaskFlags = FileMaskFlags::useAnchors;
+    CompiledFileMaskSetA txtMaskSet(txtMasks);
+
+    std::mt19937 rng(11);
+
+    for(unsigned t=0; t!=60; ++t)
+    {
+        MemTree tree = makeRandomTree(rng, 2 + (std::size_t)(rng()%40));
+
+        for(int markLinks=0; markLinks!=2; ++markLinks)
+        {
+            tree.bMarkLinks = markLinks!=0;
+
+            for(unsigned variant=0; variant!=8; ++variant)
+            {
+                WalkParams params;
+                params.walkFlags      = (variant&1) ? WalkTreeFlags::sorted : WalkTreeFlags::unsorted;
+                params.walkFlags     |= (variant&2) ? WalkTreeFlags::followSymlinks : WalkTreeFlags::none;
+                params.bPrune         = (variant&4)!=0;
+                params.enumerateFlags = (t%3==0) ? EnumerateFlags::enumerateFiles : EnumerateFlags::none;
+                params.maxDepth       = (t%4==0) ? 3 : 0;
+                params.bUseDirIds     = true;
+
+                const CompiledFileMaskSetA &maskSet = (t%5==0) ? txtMaskSet : allMaskSet;
+
+                bool bCanLoop = (params.walkFlags&WalkTreeFlags::followSymlinks)!=0 || !tree.bMarkLinks;
+
+                for(std::size_t concurrency : { (std::size_t)1, (std::size_t)4 })
+                {
+                    checkWalk("with dir ids", tree, params, maskSet, concurrency, pPool);
+
+                    // Без идентификаторов каталогов от циклов спасает только maxDepth
+                    params.bUseDirIds = false;
+                    std::size_t savedDepth = params.maxDepth;
+                    if (bCanLoop)
+                    {
+                        params.maxDepth = 6;
+                    }
+                    checkWalk("no dir ids", tree, params, maskSet, concurrency, pPool);
+                    params.maxDepth   = savedDepth;
+                    params.bUseDirIds = true;
+                }
+            }
+        }
+
+        tree.bMarkLinks = true;
+        checkStop(tree, allMaskSet, WalkTreeFlags::sorted  , 4, pPool);
+        checkStop(tree, allMaskSet, WalkTreeFlags::unsorted, 4, pPool);
+        checkStop(tree, allMaskSet, WalkTreeFlags::unsorted, 1, pPool);
+    }
+
+    std::printf("tree_walker_test: %u checks, %u failures\n", (unsigned)g_checks, (unsigned)g_failures);
+
+    return g_failures ? 1 : 0;
+}
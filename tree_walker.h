@@ -0,0 +1,461 @@
+/*! \file
+    \brief Recursive directory tree walker, parallel on a work-stealing pool
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+#include "file_mask_set.h"
+#include "vfs_types.h"
+#include "work_stealing_thread_pool.h"
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Рекурсивный обход дерева каталогов
+/*! Каталоги читаются через lister - функцию нерекурсивного потокового перечисления каталога
+    (в ФС - enumerateDirectoryVisitImpl или аналог), поэтому обходятся и точки монтирования, и виртуальный корень.
+
+    Каждый каталог - отдельная задача группы (ThreadPoolTaskGroup) на переданном пуле (обычно пул рабочих потоков ФС,
+    пустой - общий пул по умолчанию), не больше maxConcurrency потоков, включая вызывающий.
+
+    WalkTreeFlags::unsorted - записи отдаются visitor'у по мере чтения, порядок не определён.
+    WalkTreeFlags::sorted   - сначала параллельно читается всё дерево (в памяти остаются только
+    подходящие записи и каталоги, в которые спускаемся), затем дерево отдаётся visitor'у в прямом
+    порядке (каталог, потом его содержимое), записи каждого каталога - по возрастанию имени (бинарное сравнение).
+
+    visitor и pruner никогда не вызываются одновременно из разных потоков. Общий мьютекс берётся только
+    на время их вызова - pruner вызывается только для каталогов, в которые иначе спустились бы.
+    visitor возвращает false, чтобы прекратить обход. Ошибки чтения подкаталогов обход не прерывают,
+    возвращается первая из них.
+
+    maxDepth - глубина спуска, у записей стартового каталога глубина 1; 0 - без ограничений.
+
+    В каталоги-симлинки (FileTypeFlags::symlink) по умолчанию не спускаемся - ссылка на предка зациклила бы обход.
+    С WalkTreeFlags::followSymlinks спускаемся. Если задан dirIdGetter (устройство и inode или аналог),
+    каталог, который уже есть среди предков на текущем пути, не читается - так защищаемся от циклов, когда
+    следуем по ссылкам или когда lister не умеет помечать ссылки. Без dirIdGetter от циклов защищает только maxDepth.
+ */
+template<typename StringType>
+class TreeWalkerT
+{
+
+public:
+
+    typedef DirectoryEntryInfoT<StringType>                                                        EntryType;
+    typedef std::function<ErrorCode(const StringType &dirPath, const DirectoryEntryVisitorT<StringType> &visitor)>  DirectoryListerType;
+    typedef std::pair<std::uint64_t, std::uint64_t>                                                DirectoryId;
+    typedef std::function<bool(const StringType &dirPath, DirectoryId &id)>                        DirectoryIdGetterType; // false - идентификатор не получен
+
+
+protected:
+
+    typedef typename StringType::value_type  CharType;
+
+    // Идентификаторы каталогов от текущего до стартового, общие хвосты у соседних ветвей
+    struct DirIdChain
+    {
+        DirectoryId                        id     ;
+        std::shared_ptr<const DirIdChain>  pParent;
+
+        DirIdChain(const DirectoryId &i, const std::shared_ptr<const DirIdChain> &p) : id(i), pParent(p) {}
+    };
+
+    typedef std::shared_ptr<const DirIdChain>  DirIdChainPtr;
+
+    struct DirTask
+    {
+        StringType     path      ;
+        std::size_t    depth     = 0;
+        DirIdChainPtr  pParentIds;
+
+        DirTask(StringType p, std::size_t d, DirIdChainPtr ids) : path(std::move(p)), depth(d), pParentIds(std::move(ids)) {}
+    };
+
+    struct Node
+    {
+        StringType                                                   path    ;
+        DirIdChainPtr                                                pParentIds; // Предки, для защиты от циклов
+        std::size_t                                                  depth   = 0; // Глубина записей узла
+        std::vector<EntryType>                                       entries ;
+        std::vector<bool>                                            matched ; // Запись нужно отдать visitor'у
+        std::vector< std::pair<std::size_t, std::unique_ptr<Node> > >  children; // Индекс записи - узел подкаталога
+    };
+
+    DirectoryListerType                     m_lister        ;
+    EnumerateFlags                          m_enumerateFlags = EnumerateFlags::none;
+    const CompiledFileMaskSetT<StringType> &m_maskSet       ;
+    std::size_t                             m_maxDepth       = 0;
+    WalkTreePrunerT<StringType>             m_pruner        ;
+    WalkTreeFlags                           m_walkFlags      = WalkTreeFlags::none;
+    std::size_t                             m_maxConcurrency = 0;
+    DirectoryIdGetterType                   m_dirIdGetter   ;
+    std::shared_ptr<WorkStealingThreadPool> m_pPool         ;
+
+    DirectoryEntryVisitorT<StringType>      m_visitor       ;
+    std::mutex                              m_callbackMutex ; // visitor/pruner
+    std::mutex                              m_errMutex      ;
+    ErrorCode                               m_firstErr       = ErrorCode::ok;
+    std::atomic<bool>                       m_stop          { false };
+
+
+    static StringType makeChildPath(const StringType &dirPath, const StringType &name)
+    {
+        StringType res = dirPath;
+        if (res.empty() || res.back()!=(CharType)'/')
+        {
+            res.push_back((CharType)'/');
+        }
+
+        res.append(name);
+
+        return res;
+    }
+
+    void setError(ErrorCode err)
+    {
+        if (err==ErrorCode::ok)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_errMutex);
+        if (m_firstErr==ErrorCode::ok)
+        {
+            m_firstErr = err;
+        }
+    }
+
+    bool isEntryMatched(const EntryType &e) const
+    {
+        return isDirectoryEntryTypeMatch(m_enumerateFlags, e) && m_maskSet.findFirstMatch(e)>0;
+    }
+
+    bool needDescend(const EntryType &e, std::size_t depth)
+    {
+        if ((e.fileTypeFlags&FileTypeFlags::directory)==0)
+        {
+            return false;
+        }
+
+        if ((e.fileTypeFlags&FileTypeFlags::symlink)!=0 && (m_walkFlags&WalkTreeFlags::followSymlinks)==0)
+        {
+            return false;
+        }
+
+        if (m_maxDepth && depth>=m_maxDepth)
+        {
+            return false;
+        }
+
+        if (!m_pruner)
+        {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(m_callbackMutex);
+        return !m_pruner(e, depth);
+    }
+
+    // false - каталог уже есть среди предков (пришли в него по ссылке вверх по дереву)
+    bool enterDir(const StringType &dirPath, const DirIdChainPtr &pParentIds, DirIdChainPtr &pDirIds) const
+    {
+        pDirIds = pParentIds;
+
+        if (!m_dirIdGetter)
+        {
+            return true;
+        }
+
+        DirectoryId id;
+        if (!m_dirIdGetter(dirPath, id))
+        {
+            return true;
+        }
+
+        for(const DirIdChain *p=pParentIds.get(); p; p=p->pParent.get())
+        {
+            if (p->id==id)
+            {
+                return false;
+            }
+        }
+
+        pDirIds = std::make_shared<const DirIdChain>(id, pParentIds);
+
+        return true;
+    }
+
+
+    //------------------------------
+    // Без сортировки
+    void walkUnsortedDir(ThreadPoolTaskGroup *pGroup, const StringType &dirPath, std::size_t depth, const DirIdChainPtr &pParentIds, std::vector<DirTask> *pStack)
+    {
+        DirIdChainPtr pDirIds;
+        if (m_stop.load() || !enterDir(dirPath, pParentIds, pDirIds))
+        {
+            return;
+        }
+
+        std::vector<StringType> subdirs;
+
+        ErrorCode err = m_lister( dirPath
+                                , [&](const EntryType &e)
+                                  {
+                                      if (m_stop.load())
+                                      {
+                                          return false;
+                                      }
+
+                                      if (isEntryMatched(e))
+                                      {
+                                          std::lock_guard<std::mutex> lock(m_callbackMutex);
+                                          if (m_stop.load()) // Пока ждали мьютекс, visitor в другом потоке попросил остановиться
+                                          {
+                                              return false;
+                                          }
+
+                                          if (!m_visitor(e))
+                                          {
+                                              m_stop = true;
+                                              return false;
+                                          }
+                                      }
+
+                                      if (needDescend(e, depth))
+                                      {
+                                          subdirs.emplace_back(makeChildPath(dirPath, e.entryName));
+                                      }
+
+                                      return true;
+                                  }
+                                );
+        setError(err);
+
+        for(auto &subdir : subdirs)
+        {
+            if (pGroup)
+            {
+                pGroup->submit([this, pGroup, subdir, depth, pDirIds]() { walkUnsortedDir(pGroup, subdir, depth+1, pDirIds, 0); });
+            }
+            else
+            {
+                pStack->emplace_back(std::move(subdir), depth+1, pDirIds);
+            }
+        }
+    }
+
+    //------------------------------
+    // С сортировкой - чтение
+    void readSortedNode(ThreadPoolTaskGroup *pGroup, Node *pNode)
+    {
+        DirIdChainPtr pDirIds;
+        if (!enterDir(pNode->path, pNode->pParentIds, pDirIds))
+        {
+            return;
+        }
+
+        std::vector<EntryType>  entries;
+        std::vector<bool>       matched;
+        std::vector<bool>       descend;
+
+        ErrorCode err = m_lister( pNode->path
+                                , [&](const EntryType &e)
+                                  {
+                                      bool bMatched = isEntryMatched(e);
+                                      bool bDescend = needDescend(e, pNode->depth);
+
+                                      if (bMatched || bDescend)
+                                      {
+                                          entries.emplace_back(e);
+                                          matched.emplace_back(bMatched);
+                                          descend.emplace_back(bDescend);
+                                      }
+
+                                      return true;
+                                  }
+                                );
+        setError(err);
+
+        std::vector<std::size_t> order(entries.size());
+        for(std::size_t i=0; i!=order.size(); ++i)
+        {
+            order[i] = i;
+        }
+
+        std::sort( order.begin(), order.end()
+                 , [&](std::size_t i1, std::size_t i2)
+                   {
+                       return entries[i1].entryName < entries[i2].entryName;
+                   }
+                 );
+
+        pNode->entries.reserve(entries.size());
+        pNode->matched.reserve(entries.size());
+
+        for(auto idx : order)
+        {
+            if (descend[idx])
+            {
+                std::unique_ptr<Node> pChild = std::make_unique<Node>();
+                pChild->path  = makeChildPath(pNode->path, entries[idx].entryName);
+                pChild->depth = pNode->depth + 1;
+                pChild->pParentIds = pDirIds;
+                pNode->children.emplace_back(pNode->entries.size(), std::move(pChild));
+            }
+
+            pNode->entries.emplace_back(std::move(entries[idx]));
+            pNode->matched.emplace_back(matched[idx]);
+        }
+
+        for(auto &child : pNode->children)
+        {
+            Node *pChild = child.second.get();
+            if (pGroup)
+            {
+                pGroup->submit([this, pGroup, pChild]() { readSortedNode(pGroup, pChild); });
+            }
+            else
+            {
+                readSortedNode(pGroup, pChild);
+            }
+        }
+    }
+
+    // С сортировкой - выдача, false - visitor попросил остановиться
+    bool emitSortedNode(Node *pNode)
+    {
+        std::size_t childIdx = 0;
+
+        for(std::size_t i=0; i!=pNode->entries.size(); ++i)
+        {
+            if (pNode->matched[i] && !m_visitor(pNode->entries[i]))
+            {
+                return false;
+            }
+
+            if (childIdx<pNode->children.size() && pNode->children[childIdx].first==i)
+            {
+                std::unique_ptr<Node> pChild = std::move(pNode->children[childIdx].second);
+                ++childIdx;
+
+                if (!emitSortedNode(pChild.get()))
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+
+public:
+
+    TreeWalkerT( const DirectoryListerType              &lister
+               , EnumerateFlags                          enumerateFlags
+               , const CompiledFileMaskSetT<StringType> &maskSet
+               , std::size_t                             maxDepth
+               , const WalkTreePrunerT<StringType>      &pruner
+               , WalkTreeFlags                           walkFlags
+               , std::size_t                             maxConcurrency
+               , const DirectoryIdGetterType            &dirIdGetter = DirectoryIdGetterType()
+               , std::shared_ptr<WorkStealingThreadPool> pPool      = std::shared_ptr<WorkStealingThreadPool>()
+               )
+    : m_lister(lister)
+    , m_enumerateFlags(enumerateFlags)
+    , m_maskSet(maskSet)
+    , m_maxDepth(maxDepth)
+    , m_pruner(pruner)
+    , m_walkFlags(walkFlags)
+    , m_maxConcurrency(maxConcurrency ? maxConcurrency : WorkStealingThreadPool::getDefaultThreadsCount())
+    , m_dirIdGetter(dirIdGetter)
+    , m_pPool(std::move(pPool))
+    {}
+
+    TreeWalkerT(const TreeWalkerT &)            = delete;
+    TreeWalkerT& operator=(const TreeWalkerT &) = delete;
+
+    //! rootPath - нормализованный путь стартового каталога
+    ErrorCode walk(const StringType &rootPath, const DirectoryEntryVisitorT<StringType> &visitor)
+    {
+        if (!visitor)
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        m_visitor  = visitor;
+        m_firstErr = ErrorCode::ok;
+        m_stop     = false;
+
+        std::unique_ptr<ThreadPoolTaskGroup> pGroup;
+        if (m_maxConcurrency>1)
+        {
+            std::shared_ptr<WorkStealingThreadPool> pPool = m_pPool ? m_pPool : WorkStealingThreadPool::getDefaultPool();
+            pGroup = std::make_unique<ThreadPoolTaskGroup>(*pPool, m_maxConcurrency);
+        }
+
+        if ((m_walkFlags&WalkTreeFlags::sorted)==0)
+        {
+            if (pGroup)
+            {
+                walkUnsortedDir(pGroup.get(), rootPath, 1, DirIdChainPtr(), 0);
+                pGroup->wait();
+            }
+            else
+            {
+                std::vector<DirTask> stack;
+                stack.emplace_back(rootPath, 1, DirIdChainPtr());
+                while(!stack.empty())
+                {
+                    DirTask item = std::move(stack.back());
+                    stack.pop_back();
+                    walkUnsortedDir(0, item.path, item.depth, item.pParentIds, &stack);
+                }
+            }
+        }
+        else
+        {
+            Node root;
+            root.path  = rootPath;
+            root.depth = 1;
+
+            readSortedNode(pGroup.get(), &root);
+            if (pGroup)
+            {
+                pGroup->wait();
+            }
+
+            emitSortedNode(&root);
+        }
+
+        m_visitor = DirectoryEntryVisitorT<StringType>();
+
+        return m_firstErr;
+    }
+
+}; // class TreeWalkerT
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+
@@ -127,7 +127,8 @@ enum class FileTypeFlags : std::uint32_t
     invalid      = (std::uint32_t)(-1),
     normalFile   = 0x00,
     directory    = 0x01,
-    deviceFile   = 0x02
+    deviceFile   = 0x02,
+    symlink      = 0x04
 
 }; // enum class FileTypeFlags : std::uint32_t
 
@@ -138,6 +139,7 @@ MARTY_CPP_ENUM_FLAGS_SERIALIZE_BEGIN( FileTypeFlags, std::map, 1 )
     MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( FileTypeFlags::invalid      , "Invalid"    );
     MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( FileTypeFlags::normalFile   , "NormalFile" );
     MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( FileTypeFlags::deviceFile   , "DeviceFile" );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( FileTypeFlags::symlink      , "Symlink"    );
 MARTY_CPP_ENUM_FLAGS_SERIALIZE_END( FileTypeFlags, std::map, 1 )
 
 MARTY_CPP_ENUM_FLAGS_DESERIALIZE_BEGIN( FileTypeFlags, std::map, 1 )
@@ -145,6 +147,7 @@ MARTY_CPP_ENUM_FLAGS_DESERIALIZE_BEGIN( FileTypeFlags, std::map, 1 )
     MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( FileTypeFlags::invalid      , "invalid"    );
     MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( FileTypeFlags::normalFile   , "normalfile" );
     MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( FileTypeFlags::deviceFile   , "devicefile" );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( FileTypeFlags::symlink      , "symlink"    );
 MARTY_CPP_ENUM_FLAGS_DESERIALIZE_END( FileTypeFlags, std::map, 1 )
 
 MARTY_CPP_ENUM_FLAGS_SERIALIZE_SET(FileTypeFlags, std::set)
@@ -319,5 +322,157 @@ MARTY_CPP_ENUM_FLAGS_SERIALIZE_SET(FileMaskFlags, std::set)
 
 MARTY_CPP_ENUM_FLAGS_DESERIALIZE_SET(FileMaskFlags, std::set)
 
+enum class OpenMode : std::uint32_t
+{
+    invalid     = (std::uint32_t)(-1),
+    unknown     = (std::uint32_t)(-1),
+    none        = 0x0000,
+    read        = 0x0001,
+    write       = 0x0002,
+    readWrite   = 0x0003,
+    create      = 0x0004,
+    truncate    = 0x0008,
+    exclusive   = 0x0010
+
+}; // enum class OpenMode : std::uint32_t
+
+MARTY_CPP_MAKE_ENUM_FLAGS(OpenMode)
+
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_BEGIN( OpenMode, std::map, 1 )
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::invalid     , "Invalid"   );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::none        , "None"      );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::read        , "Read"      );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::write       , "Write"     );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::readWrite   , "ReadWrite" );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::create      , "Create"    );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::truncate    , "Truncate"  );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( OpenMode::exclusive   , "Exclusive" );
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_END( OpenMode, std::map, 1 )
+
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_BEGIN( OpenMode, std::map, 1 )
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::invalid     , "invalid"   );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::invalid     , "unknown"   );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::none        , "none"      );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::read        , "read"      );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::write       , "write"     );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::readWrite   , "readwrite" );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::create      , "create"    );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::truncate    , "truncate"  );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( OpenMode::exclusive   , "exclusive" );
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_END( OpenMode, std::map, 1 )
+
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_SET(OpenMode, std::set)
+
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_SET(OpenMode, std::set)
+
+
+enum class SeekOrigin : std::uint32_t
+{
+    invalid   = (std::uint32_t)(-1),
+    unknown   = (std::uint32_t)(-1),
+    begin     = 0x00,
+    current   = 0x01,
+    end       = 0x02
+
+}; // enum class SeekOrigin : std::uint32_t
+
+MARTY_CPP_MAKE_ENUM_IS_FLAGS_FOR_NON_FLAGS_ENUM(SeekOrigin)
+
+MARTY_CPP_ENUM_CLASS_SERIALIZE_BEGIN( SeekOrigin, std::map, 1 )
+    MARTY_CPP_ENUM_CLASS_SERIALIZE_ITEM( SeekOrigin::invalid   , "Invalid" );
+    MARTY_CPP_ENUM_CLASS_SERIALIZE_ITEM( SeekOrigin::begin     , "Begin"   );
+    MARTY_CPP_ENUM_CLASS_SERIALIZE_ITEM( SeekOrigin::current   , "Current" );
+    MARTY_CPP_ENUM_CLASS_SERIALIZE_ITEM( SeekOrigin::end       , "End"     );
+MARTY_CPP_ENUM_CLASS_SERIALIZE_END( SeekOrigin, std::map, 1 )
+
+MARTY_CPP_ENUM_CLASS_DESERIALIZE_BEGIN( SeekOrigin, std::map, 1 )
+    MARTY_CPP_ENUM_CLASS_DESERIALIZE_ITEM( SeekOrigin::invalid   , "invalid" );
+    MARTY_CPP_ENUM_CLASS_DESERIALIZE_ITEM( SeekOrigin::invalid   , "unknown" );
+    MARTY_CPP_ENUM_CLASS_DESERIALIZE_ITEM( SeekOrigin::begin     , "begin"   );
+    MARTY_CPP_ENUM_CLASS_DESERIALIZE_ITEM( SeekOrigin::current   , "current" );
+    MARTY_CPP_ENUM_CLASS_DESERIALIZE_ITEM( SeekOrigin::end       , "end"     );
+MARTY_CPP_ENUM_CLASS_DESERIALIZE_END( SeekOrigin, std::map, 1 )
+
+
+enum class WalkTreeFlags : std::uint32_t
+{
+    invalid          = (std::uint32_t)(-1),
+    unknown          = (std::uint32_t)(-1),
+    none             = 0x0000,
+    unsorted         = 0x0000,
+    sorted           = 0x0001,
+    followSymlinks   = 0x0002
+
+}; // enum class WalkTreeFlags : std::uint32_t
+
+MARTY_CPP_MAKE_ENUM_FLAGS(WalkTreeFlags)
+
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_BEGIN( WalkTreeFlags, std::map, 1 )
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( WalkTreeFlags::invalid          , "Invalid"        );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( WalkTreeFlags::none             , "None"           );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( WalkTreeFlags::sorted           , "Sorted"         );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( WalkTreeFlags::followSymlinks   , "FollowSymlinks" );
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_END( WalkTreeFlags, std::map, 1 )
+
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_BEGIN( WalkTreeFlags, std::map, 1 )
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( WalkTreeFlags::invalid          , "invalid"        );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( WalkTreeFlags::invalid          , "unknown"        );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( WalkTreeFlags::none             , "none"           );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( WalkTreeFlags::none             , "unsorted"       );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( WalkTreeFlags::sorted           , "sorted"         );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( WalkTreeFlags::followSymlinks   , "followsymlinks" );
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_END( WalkTreeFlags, std::map, 1 )
+
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_SET(WalkTreeFlags, std::set)
+
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_SET(WalkTreeFlags, std::set)
+
+
+enum class EntryFieldFlags : std::uint32_t
+{
+    invalid   = (std::uint32_t)(-1),
+    unknown   = (std::uint32_t)(-1),
+    none      = 0x0000,
+    name      = 0x0001,
+    ext       = 0x0002,
+    type      = 0x0004,
+    size      = 0x0008,
+    times     = 0x0010,
+    path      = 0x0020,
+    all       = 0x003F
+
+}; // enum class EntryFieldFlags : std::uint32_t
+
+MARTY_CPP_MAKE_ENUM_FLAGS(EntryFieldFlags)
+
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_BEGIN( EntryFieldFlags, std::map, 1 )
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::invalid   , "Invalid" );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::none      , "None"    );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::name      , "Name"    );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::ext       , "Ext"     );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::type      , "Type"    );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::size      , "Size"    );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::times     , "Times"   );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::path      , "Path"    );
+    MARTY_CPP_ENUM_FLAGS_SERIALIZE_ITEM( EntryFieldFlags::all       , "All"     );
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_END( EntryFieldFlags, std::map, 1 )
+
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_BEGIN( EntryFieldFlags, std::map, 1 )
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::invalid   , "invalid" );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::invalid   , "unknown" );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::none      , "none"    );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::name      , "name"    );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::ext       , "ext"     );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::type      , "type"    );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::size      , "size"    );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::times     , "times"   );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::path      , "path"    );
+    MARTY_CPP_ENUM_FLAGS_DESERIALIZE_ITEM( EntryFieldFlags::all       , "all"     );
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_END( EntryFieldFlags, std::map, 1 )
+
+MARTY_CPP_ENUM_FLAGS_SERIALIZE_SET(EntryFieldFlags, std::set)
+
+MARTY_CPP_ENUM_FLAGS_DESERIALIZE_SET(EntryFieldFlags, std::set)
+
 } // namespace marty_virtual_fs
 
@@ -10,16 +10,24 @@
 #include "umba/regex_helpers.h"
 
 // 
+#include "entry_sorter.h"
+#include "file_mask_cache.h"
+#include "file_mask_set.h"
 #include "filedata_encoder_impl.h"
 #include "filename_encoder_impl.h"
 #include "i_filesystem.h"
+#include "tree_walker.h"
 #include "virtual_fs_impl.h"
+#include "work_stealing_thread_pool.h"
 
 //
 #include "filesystem_impl.h"
 
 //
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 
 namespace marty_virtual_fs {
@@ -32,6 +40,13 @@ protected:
 
     std::shared_ptr<IFileSystem>   pParentFs;
 
+    // Пул потоков для readDataFilesParallel, создаётся при первом использовании
+    mutable std::shared_ptr<WorkStealingThreadPool>  m_pWorkerPool;
+
+    // Порог и число потоков параллельной сортировки списков каталогов
+    std::size_t                    m_parallelSortThreshold   = DirectoryEntrySorterT<std::string>::defaultParallelThreshold;
+    std::size_t                    m_parallelSortConcurrency = 0;
+
     void checkParentFs() const
     {
         if (!pParentFs)
@@ -45,6 +60,23 @@ protected:
         checkParentFs();
         return pParentFs.get();
     }
+
+    std::shared_ptr<WorkStealingThreadPool> getWorkerPool() const
+    {
+        std::shared_ptr<WorkStealingThreadPool> pPool = std::atomic_load(&m_pWorkerPool);
+        if (pPool)
+        {
+            return pPool;
+        }
+
+        std::shared_ptr<WorkStealingThreadPool> pNewPool = std::make_shared<WorkStealingThreadPool>();
+        if (std::atomic_compare_exchange_strong(&m_pWorkerPool, &pPool, pNewPool))
+        {
+            return pNewPool;
+        }
+
+        return pPool; // Кто-то успел раньше
+    }
     
 
 
@@ -59,6 +91,25 @@ public:
     VfsOnVfsFileSystemImpl& operator=(VfsOnVfsFileSystemImpl &&)      = default;
 
 
+    //! Списки от threshold записей enumerateDirectoryEx сортирует параллельно (0 - всегда в одном потоке).
+    //! maxConcurrency==0 - по числу ядер. Настраивается до начала использования ФС
+    void setParallelSort(std::size_t threshold, std::size_t maxConcurrency = 0)
+    {
+        m_parallelSortThreshold   = threshold;
+        m_parallelSortConcurrency = maxConcurrency;
+    }
+
+    std::size_t getParallelSortThreshold() const
+    {
+        return m_parallelSortThreshold;
+    }
+
+    std::size_t getParallelSortConcurrency() const
+    {
+        return m_parallelSortConcurrency;
+    }
+
+
     virtual std::uint8_t* swapByteOrder(std::uint8_t *pData, std::size_t dataSize) const override
     {
         return checkedPfs()->swapByteOrder(pData, dataSize);
@@ -158,13 +209,12 @@ protected:
     }
 
 
+    // Путь уже нормализован
     template<typename StringType>
-    bool isVirtualRoot(StringType p) const
+    static bool isNormalizedVirtualRoot(const StringType &p)
     {
         typedef typename StringType::value_type CharType;
 
-        p = normalizeFilenameImpl(p);
-
         if (p.empty())
         {
             return true;
@@ -179,327 +229,1108 @@ protected:
     }
 
 
-
+    // Нормализация и отображение на путь родительской ФС - один раз на путь.
+    // Операции с разрешённым путём отдают родительской ФС уже готовый родной путь
     template<typename StringType>
-    ErrorCode readDataFileImpl2(StringType fName, std::vector<std::uint8_t> &fData) const
+    ErrorCode resolvePathImpl(StringType vPath, ResolvedPathT<StringType> &resolvedPath) const
     {
-        fName = normalizeFilenameImpl(fName);
+        typedef typename ResolvedPathT<StringType>::NativeStringType NativeStringType;
+
+        resolvedPath = ResolvedPathT<StringType>();
 
-        if (isVirtualRoot(fName))
+        vPath = normalizeFilenameImpl(vPath);
+
+        NativeStringType nativePath;
+        bool bVirtualRoot = isNormalizedVirtualRoot(vPath);
+        if (!bVirtualRoot)
         {
-            return ErrorCode::notFound;
+            ErrorCode err = toNativePathName(filenameToStringType<NativeStringType>(vPath), nativePath);
+            if (err!=ErrorCode::ok)
+            {
+                return err;
+            }
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
-        if (err!=ErrorCode::ok)
+        resolvedPath.assign(this, getMountGeneration(), std::move(vPath), std::move(nativePath), bVirtualRoot);
+
+        return ErrorCode::ok;
+    }
+
+    // Разрешённый путь должен быть получен от этой ФС, и таблица монтирования с тех пор не должна меняться
+    template<typename StringType>
+    ErrorCode checkResolvedPathImpl(const ResolvedPathT<StringType> &resolvedPath) const
+    {
+        if (!resolvedPath.isResolvedBy(this, getMountGeneration()))
         {
-            return err;
+            return ErrorCode::invalidMountPoint;
         }
 
-        return checkedPfs()->readDataFile(nativePath, fData);
+        return ErrorCode::ok;
     }
 
 
+
     template<typename StringType>
-    ErrorCode readTextFileImpl2(StringType fName, std::wstring &fText) const
+    ErrorCode readDataFileImpl2(const ResolvedPathT<StringType> &resolvedPath, std::vector<std::uint8_t> &fData) const
     {
-        fName = normalizeFilenameImpl(fName);
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-        if (isVirtualRoot(fName))
+        if (resolvedPath.isVirtualRoot())
         {
             return ErrorCode::notFound;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        return checkedPfs()->readDataFile(resolvedPath.getNativePath(), fData);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileImpl2(const StringType &fName, std::vector<std::uint8_t> &fData) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        return checkedPfs()->readTextFile(nativePath, fText);
+        return readDataFileImpl2(resolvedPath, fData);
     }
 
     template<typename StringType>
-    ErrorCode readTextFileImpl2(StringType fName, std::string &fText) const
+    ErrorCode readDataFileImpl2(const ResolvedPathT<StringType> &resolvedPath, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
     {
-        std::wstring wText;
-        ErrorCode e = readTextFileImpl2(fName, wText);
-        if (e!=ErrorCode::ok)
+        if (pDataSize)
         {
-            return e;
+            *pDataSize = 0;
         }
 
-        fText = encodeText(wText);
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-        return ErrorCode::ok;
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
+
+        return checkedPfs()->readDataFile(resolvedPath.getNativePath(), pBuf, bufSize, pDataSize);
     }
 
     template<typename StringType>
-    ErrorCode writeTextFileImpl2(StringType fName, const std::string &fText, WriteFileFlags writeFlags) const
+    ErrorCode readDataFileImpl2(const StringType &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
     {
-        if (getVfsGlobalReadonly())
+        if (pDataSize)
         {
-            return ErrorCode::accessDenied;
+            *pDataSize = 0;
         }
 
-        fName = normalizeFilenameImpl(fName);
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return readDataFileImpl2(resolvedPath, pBuf, bufSize, pDataSize);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileImpl2(const ResolvedPathT<StringType> &resolvedPath, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-        if (isVirtualRoot(fName))
+        if (resolvedPath.isVirtualRoot())
         {
             return ErrorCode::notFound;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        return checkedPfs()->readDataFile(resolvedPath.getNativePath(), pPool, fData);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileImpl2(const StringType &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        return checkedPfs()->writeTextFile(nativePath, fText, writeFlags);
+        return readDataFileImpl2(resolvedPath, pPool, fData);
     }
 
-    template<typename StringType>
-    ErrorCode writeTextFileImpl2(StringType fName, const std::wstring &fText, WriteFileFlags writeFlags) const
+    // Первая ошибка из списка или ErrorCode::ok
+    static ErrorCode getFirstError(const std::vector<ErrorCode> &errors)
     {
-        return writeTextFileImpl(fName, encodeText(fText), writeFlags);
+        for(auto err : errors)
+        {
+            if (err!=ErrorCode::ok)
+            {
+                return err;
+            }
+        }
+
+        return ErrorCode::ok;
     }
 
+    // Для пакетных операций - имена, которые удалось отобразить, и их индексы в исходном списке
     template<typename StringType>
-    ErrorCode writeDataFileImpl2(StringType fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
+    void toNativePathNames(const std::vector<StringType> &fNames, std::vector<StringType> &nativeNames, std::vector<std::size_t> &nativeIdx, std::vector<ErrorCode> &errors) const
     {
-        if (getVfsGlobalReadonly())
+        nativeNames.clear(); nativeNames.reserve(fNames.size());
+        nativeIdx  .clear(); nativeIdx  .reserve(fNames.size());
+
+        for(std::size_t i=0; i!=fNames.size(); ++i)
         {
-            return ErrorCode::accessDenied;
+            StringType fName = normalizeFilenameImpl(fNames[i]);
+
+            if (isNormalizedVirtualRoot(fName))
+            {
+                errors[i] = ErrorCode::notFound;
+                continue;
+            }
+
+            StringType nativePath;
+            errors[i] = toNativePathName(fName, nativePath);
+            if (errors[i]==ErrorCode::ok)
+            {
+                nativeNames.emplace_back(nativePath);
+                nativeIdx  .emplace_back(i);
+            }
         }
+    }
 
-        fName = normalizeFilenameImpl(fName);
+    template<typename StringType>
+    ErrorCode readDataFileRangeImpl2(const ResolvedPathT<StringType> &resolvedPath, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-        if (isVirtualRoot(fName))
+        if (resolvedPath.isVirtualRoot())
         {
             return ErrorCode::notFound;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
+        return checkedPfs()->readDataFileRange(resolvedPath.getNativePath(), offset, length, fData);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFileRangeImpl2(const StringType &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        return checkedPfs()->writeDataFile(nativePath, fData, writeFlags);
+        return readDataFileRangeImpl2(resolvedPath, offset, length, fData);
     }
 
     template<typename StringType>
-    bool isFileExistAndReadableImpl(StringType fName) const
+    ErrorCode readDataFileRangesImpl2(const ResolvedPathT<StringType> &resolvedPath, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
     {
-        fName = normalizeFilenameImpl(fName);
-
-        if (isVirtualRoot(fName))
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            return false;
+            return err;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(fName, nativePath);
-        if (err!=ErrorCode::ok)
+        if (resolvedPath.isVirtualRoot())
         {
-            return false;
+            return ErrorCode::notFound;
         }
 
-        return checkedPfs()->isFileExistAndReadable(nativePath);
+        return checkedPfs()->readDataFileRanges(resolvedPath.getNativePath(), ranges, rangesData);
     }
 
     template<typename StringType>
-    bool isDirectoryImpl(StringType dName) const
+    ErrorCode readDataFileRangesImpl2(const StringType &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
     {
-        dName = normalizeFilenameImpl(dName);
-
-        if (isVirtualRoot(dName))
-        {
-            return true;
-        }
-
-        StringType nativePath;
-        ErrorCode err = toNativePathName(dName, nativePath);
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
         if (err!=ErrorCode::ok)
         {
-            return false;
+            return err;
         }
 
-        return checkedPfs()->isDirectory(nativePath);
+        return readDataFileRangesImpl2(resolvedPath, ranges, rangesData);
     }
 
-    //------------------------------
     template<typename StringType>
-    ErrorCode enumerateDirectoryImpl(StringType dirPath, std::vector< DirectoryEntryInfoT<StringType> > &entries) const
+    ErrorCode mapDataFileImpl(const ResolvedPathT<StringType> &resolvedPath, MappedView &mappedView) const
     {
-        entries.clear();
-
-        dirPath = normalizeFilenameImpl(dirPath);
-
-        if (isVirtualRoot(dirPath)) // Корень
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            // Перечисляем mount points
+            return err;
+        }
 
-            std::map<std::wstring, MountPointInfo>::const_iterator mit = m_mountPoints.begin();
-            for(; mit!=m_mountPoints.end(); ++mit)
-            {
-                DirectoryEntryInfoT<StringType> dirEntryInfo;
-                dirEntryInfo.entryName     = filenameToStringType<StringType, std::wstring>(mit->second.name);
-                dirEntryInfo.path          = dirPath;
-                dirEntryInfo.fileTypeFlags = mit->second.flags;
-                entries.emplace_back(dirEntryInfo);
-            }
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
 
-            return ErrorCode::ok;
+        const auto &nativePath = resolvedPath.getNativePath();
 
+        err = checkedPfs()->mapDataFile(nativePath, mappedView);
+        if (err!=ErrorCode::notSupported && err!=ErrorCode::notImplemented)
+        {
+            return err;
         }
 
-        StringType nativePath;
-        ErrorCode err = toNativePathName(dirPath, nativePath);
+        // Родительская ФС не умеет отображать файлы - читаем копию в кучу
+        std::vector<std::uint8_t> fData;
+        err = checkedPfs()->readDataFile(nativePath, fData);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        //if (!umba::filesys::isPathDirectory(nativePath))
-        if (!checkedPfs()->isDirectory(nativePath))
+        mappedView = MappedView::fromData(std::move(fData));
+
+        return ErrorCode::ok;
+    }
+
+    template<typename StringType>
+    ErrorCode mapDataFileImpl(const StringType &fName, MappedView &mappedView) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            return ErrorCode::notDirectory;
+            return err;
         }
 
-        // enumerate native directory
-        return checkedPfs()->enumerateDirectory(nativePath, entries);
-
+        return mapDataFileImpl(resolvedPath, mappedView);
     }
 
+
     template<typename StringType>
-    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    ErrorCode readTextFileImpl2(const ResolvedPathT<StringType> &resolvedPath, std::wstring &fText) const
     {
-        std::vector< DirectoryEntryInfoT<StringType> > entriesTmp;
-        ErrorCode err = enumerateDirectoryImpl(dirPath, entriesTmp);
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        std::vector< CompiledFileMaskInfoT<StringType> > compiledMasks;
-        for(const auto &m: masks)
+        if (resolvedPath.isVirtualRoot())
         {
-            try
-            {
-                compiledMasks.emplace_back(m.compileRegex());
-            }
-            catch(...)
-            {
-            }
+            return ErrorCode::notFound;
         }
 
-        entries.clear();
-
+        return checkedPfs()->readTextFile(resolvedPath.getNativePath(), fText);
+    }
 
-        for(const auto &e : entriesTmp)
+    template<typename StringType>
+    ErrorCode readTextFileImpl2(const StringType &fName, std::wstring &fText) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            if ((enumerateFlags&EnumerateFlags::enumerateFiles)!=0) // Перечисляем файлы
-            {
-                if ((e.fileTypeFlags&FileTypeFlags::directory)!=0) 
-                {
-                    // Найден каталог - пропускаем
-                    continue;
-                }
-            }
-
-            if ((enumerateFlags&EnumerateFlags::enumerateDirectories)!=0) // Перечисляем каталоги
-            {
-                if ((e.fileTypeFlags&FileTypeFlags::directory)==0) 
-                {
-                    // Найден файл - пропускаем
-                    continue;
-                }
-            }
+            return err;
+        }
 
+        return readTextFileImpl2(resolvedPath, fText);
+    }
 
-            for(const auto &cm: compiledMasks)
-            {
-                try
-                {
-                    if (umba::regex_helpers::regexMatch( ((cm.fileMaskFlags&FileMaskFlags::matchExtOnly)!=0) ? e.entryExt : e.entryName
-                                                       , cm.compiledMask
-                                                       , std::regex_constants::match_default
-                                                       ))
-                    {
-                        entries.emplace_back(e);
-                        break; // маска сработала, продолжать не нужно
-                    }
-                }
-                catch(...)
-                {
-                }
-            }
+    // fName - виртуальное имя или ResolvedPathT
+    template<typename StringType>
+    ErrorCode readTextFileImpl2(const StringType &fName, std::string &fText) const
+    {
+        std::wstring wText;
+        ErrorCode e = readTextFileImpl2(fName, wText);
+        if (e!=ErrorCode::ok)
+        {
+            return e;
         }
-        //entries
 
-        std::stable_sort( entries.begin(), entries.end()
-                        , [&](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2)
-                          {
-                              return compareDirectoryEntries(e1, e2, sortFlags) > 0;
-                          }
-                        );
+        fText = encodeText(wText);
 
         return ErrorCode::ok;
     }
 
-
-    //------------------------------
     template<typename StringType>
-    std::vector<DirectoryEntryInfoT<StringType> > enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, ErrorCode *pErr) const
+    ErrorCode writeTextFileImpl2(const ResolvedPathT<StringType> &resolvedPath, const std::string &fText, WriteFileFlags writeFlags) const
     {
-        std::vector<DirectoryEntryInfoT<StringType> > entries;
-        ErrorCode err = enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
-        if (pErr)
+        if (getVfsGlobalReadonly())
         {
-            *pErr = err;
+            return ErrorCode::accessDenied;
         }
 
-        return entries;
-    }
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
 
-    //------------------------------
-    ErrorCode readDataFileImpl(const std::wstring &fName, std::vector<std::uint8_t> &fData) const
-    {
-        return readDataFileImpl2(fName, fData);
+        return checkedPfs()->writeTextFile(resolvedPath.getNativePath(), fText, writeFlags);
     }
 
-    ErrorCode readDataFileImpl(const std::string  &fName, std::vector<std::uint8_t> &fData) const
+    template<typename StringType>
+    ErrorCode writeTextFileImpl2(const StringType &fName, const std::string &fText, WriteFileFlags writeFlags) const
     {
-        return readDataFileImpl2(fName, fData);
-    }
+        if (getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
 
-    //------------------------------
-    ErrorCode readTextFileImpl(const std::wstring & fName, std::wstring &fText) const
-    {
-        return readTextFileImpl2(fName, fText);
-    }
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
 
-    ErrorCode readTextFileImpl(const std::string & fName, std::wstring &fText) const
-    {
-        return readTextFileImpl2(fName, fText);
+        return writeTextFileImpl2(resolvedPath, fText, writeFlags);
     }
 
-    //------------------------------
-    ErrorCode readTextFileImpl(const std::wstring &fName, std::string &fText) const
+    // fName - виртуальное имя или ResolvedPathT
+    template<typename StringType>
+    ErrorCode writeTextFileImpl2(const StringType &fName, const std::wstring &fText, WriteFileFlags writeFlags) const
     {
-        return readTextFileImpl2(fName, fText);
+        return writeTextFileImpl2(fName, encodeText(fText), writeFlags);
     }
 
-    ErrorCode readTextFileImpl(const std::string &fName, std::string &fText) const
+    template<typename StringType>
+    ErrorCode writeDataFileImpl2(const ResolvedPathT<StringType> &resolvedPath, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
     {
-        return readTextFileImpl2(fName, fText);
-    }
+        if (getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
+
+        return checkedPfs()->writeDataFile(resolvedPath.getNativePath(), fData, writeFlags);
+    }
+
+    template<typename StringType>
+    ErrorCode writeDataFileImpl2(const StringType &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const
+    {
+        if (getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return writeDataFileImpl2(resolvedPath, fData, writeFlags);
+    }
+
+    template<typename StringType>
+    ErrorCode openFileImpl(const ResolvedPathT<StringType> &resolvedPath, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        if ((openMode&(OpenMode::write|OpenMode::create|OpenMode::truncate))!=0 && getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (resolvedPath.isVirtualRoot())
+        {
+            return ErrorCode::notFound;
+        }
+
+        return checkedPfs()->openFile(resolvedPath.getNativePath(), openMode, pFileHandle);
+    }
+
+    template<typename StringType>
+    ErrorCode openFileImpl(const StringType &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const
+    {
+        if ((openMode&(OpenMode::write|OpenMode::create|OpenMode::truncate))!=0 && getVfsGlobalReadonly())
+        {
+            return ErrorCode::accessDenied;
+        }
+
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(fName, resolvedPath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        return openFileImpl(resolvedPath, openMode, pFileHandle);
+    }
+
+    template<typename StringType>
+    bool isFileExistAndReadableImpl(const ResolvedPathT<StringType> &resolvedPath) const
+    {
+        if (checkResolvedPathImpl(resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        if (resolvedPath.isVirtualRoot())
+        {
+            return false;
+        }
+
+        return checkedPfs()->isFileExistAndReadable(resolvedPath.getNativePath());
+    }
+
+    template<typename StringType>
+    bool isFileExistAndReadableImpl(const StringType &fName) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        if (resolvePathImpl(fName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isFileExistAndReadableImpl(resolvedPath);
+    }
+
+    template<typename StringType>
+    bool isDirectoryImpl(const ResolvedPathT<StringType> &resolvedPath) const
+    {
+        if (checkResolvedPathImpl(resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        if (resolvedPath.isVirtualRoot())
+        {
+            return true;
+        }
+
+        return checkedPfs()->isDirectory(resolvedPath.getNativePath());
+    }
+
+    template<typename StringType>
+    bool isDirectoryImpl(const StringType &dName) const
+    {
+        ResolvedPathT<StringType> resolvedPath;
+        if (resolvePathImpl(dName, resolvedPath)!=ErrorCode::ok)
+        {
+            return false;
+        }
+
+        return isDirectoryImpl(resolvedPath);
+    }
+
+    //------------------------------
+    template<typename StringType>
+    ErrorCode enumerateDirectoryImpl(StringType dirPath, std::vector< DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        entries.clear();
+
+        dirPath = normalizeFilenameImpl(dirPath);
+
+        if (isNormalizedVirtualRoot(dirPath)) // Корень
+        {
+            // Перечисляем mount points
+
+            std::map<std::wstring, MountPointInfo>::const_iterator mit = m_mountPoints.begin();
+            for(; mit!=m_mountPoints.end(); ++mit)
+            {
+                DirectoryEntryInfoT<StringType> dirEntryInfo;
+                dirEntryInfo.entryName     = filenameToStringType<StringType, std::wstring>(mit->second.name);
+                dirEntryInfo.path          = dirPath;
+                dirEntryInfo.fileTypeFlags = mit->second.flags;
+                entries.emplace_back(dirEntryInfo);
+            }
+
+            return ErrorCode::ok;
+
+        }
+
+        StringType nativePath;
+        ErrorCode err = toNativePathName(dirPath, nativePath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        //if (!umba::filesys::isPathDirectory(nativePath))
+        if (!checkedPfs()->isDirectory(nativePath))
+        {
+            return ErrorCode::notDirectory;
+        }
+
+        // enumerate native directory
+        err = checkedPfs()->enumerateDirectory(nativePath, entries);
+
+        // Путь в записях - наш, а не родительской ФС
+        for(auto &e : entries)
+        {
+            e.path = dirPath;
+        }
+
+        return err;
+
+    }
+
+    //! Записи отбираются по типу и маскам по мере чтения каталога, отбор в каталогах родительской ФС делает она сама
+    //! entryFields - поля, нужные вызывающему, поля для отбора добавляются сами
+    template<typename StringType>
+    ErrorCode enumerateDirectoryFilteredImpl(StringType dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetT<StringType> &maskSet, const DirectoryEntryVisitorT<StringType> &visitor, EntryFieldFlags entryFields = EntryFieldFlags::all) const
+    {
+        dirPath = normalizeFilenameImpl(dirPath);
+
+        entryFields |= maskSet.getRequiredEntryFields() | getEntryFieldsRequiredForTypeFilter(enumerateFlags);
+
+        const bool bNeedPath = (entryFields&EntryFieldFlags::path)!=0;
+
+        if (isNormalizedVirtualRoot(dirPath)) // Корень
+        {
+            // Перечисляем mount points
+
+            std::map<std::wstring, MountPointInfo>::const_iterator mit = m_mountPoints.begin();
+            for(; mit!=m_mountPoints.end(); ++mit)
+            {
+                DirectoryEntryInfoT<StringType> dirEntryInfo;
+                dirEntryInfo.entryName     = filenameToStringType<StringType, std::wstring>(mit->second.name);
+                dirEntryInfo.fileTypeFlags = mit->second.flags;
+                dirEntryInfo.validFields   = EntryFieldFlags::name | EntryFieldFlags::type;
+                if ((entryFields&EntryFieldFlags::ext)!=0)
+                {
+                    dirEntryInfo.entryExt     = getExt(dirEntryInfo.entryName);
+                    dirEntryInfo.validFields |= EntryFieldFlags::ext;
+                }
+                if (bNeedPath)
+                {
+                    dirEntryInfo.path         = dirPath;
+                    dirEntryInfo.validFields |= EntryFieldFlags::path;
+                }
+
+                if (!isDirectoryEntryTypeMatch(enumerateFlags, dirEntryInfo) || maskSet.findFirstMatch(dirEntryInfo)<=0)
+                {
+                    continue;
+                }
+
+                if (!visitor(dirEntryInfo))
+                {
+                    break;
+                }
+            }
+
+            return ErrorCode::ok;
+
+        }
+
+        StringType nativePath;
+        ErrorCode err = toNativePathName(dirPath, nativePath);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        if (!checkedPfs()->isDirectory(nativePath))
+        {
+            return ErrorCode::notDirectory;
+        }
+
+        if (!bNeedPath) // Путь не нужен - отдаём записи родительской ФС как есть
+        {
+            return checkedPfs()->enumerateDirectoryStream(nativePath, enumerateFlags, entryFields, maskSet, visitor);
+        }
+
+        return checkedPfs()->enumerateDirectoryStream( nativePath, enumerateFlags, entryFields, maskSet
+                                                     , [&](const DirectoryEntryInfoT<StringType> &e)
+                                                       {
+                                                           DirectoryEntryInfoT<StringType> eCopy = e;
+                                                           eCopy.path = dirPath;
+                                                           return visitor(eCopy);
+                                                       }
+                                                     );
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryStreamImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, const DirectoryEntryVisitorT<StringType> &visitor) const
+    {
+        if (!visitor)
+        {
+            return ErrorCode::invalidArgument;
+        }
+
+        return enumerateDirectoryFilteredImpl(dirPath, enumerateFlags, maskSet, visitor, entryFields);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryStreamImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetT<StringType> &maskSet, const DirectoryEntryVisitorT<StringType> &visitor) const
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, EntryFieldFlags::all, maskSet, visitor);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryStreamImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoT<StringType> > &masks, const DirectoryEntryVisitorT<StringType> &visitor) const
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, EntryFieldFlags::all, CompiledFileMaskSetT<StringType>(masks), visitor);
+    }
+
+    //! Путь каталога - один на весь список, поэтому в записях его не заполняем
+    template<typename StringType>
+    ErrorCode enumerateDirectoryListingImpl(StringType dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, DirectoryListingT<StringType> &listing) const
+    {
+        dirPath = normalizeFilenameImpl(dirPath);
+
+        listing.clear();
+        listing.setPath(dirPath);
+
+        ErrorCode err = enumerateDirectoryFilteredImpl( dirPath, enumerateFlags, maskSet
+                                                      , DirectoryEntryVisitorT<StringType>( [&](const DirectoryEntryInfoT<StringType> &e)
+                                                                                            {
+                                                                                                listing.append(e);
+                                                                                                return true;
+                                                                                            }
+                                                                                          )
+                                                      , entryFields & ~EntryFieldFlags::path
+                                                      );
+        if (err!=ErrorCode::ok)
+        {
+            listing.clear();
+        }
+
+        return err;
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryListingImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, DirectoryListingT<StringType> &listing) const
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), listing);
+    }
+
+    //! Рекурсивный обход, каталоги читаются параллельно (см. TreeWalkerT)
+    template<typename StringType>
+    ErrorCode walkTreeImpl(StringType rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorT<StringType> &visitor, const WalkTreePrunerT<StringType> &pruner, WalkTreeFlags walkFlags, std::size_t maxConcurrency) const
+    {
+        rootPath = normalizeFilenameImpl(rootPath);
+
+        // Обходчику нужны все записи каталога - и подходящие, и каталоги для спуска
+        FileMaskInfoT<StringType> anyMask;
+        anyMask.mask.push_back((typename StringType::value_type)'*');
+        const CompiledFileMaskSetT<StringType> anySet(std::vector< FileMaskInfoT<StringType> >(1, anyMask));
+
+        // Имя и тип нужны обходчику всегда (тип - чтобы спускаться в каталоги), остальное - только то, что просили и что нужно маскам
+        const EntryFieldFlags listFields = entryFields | EntryFieldFlags::name | EntryFieldFlags::type | maskSet.getRequiredEntryFields();
+
+        TreeWalkerT<StringType> walker( [this, &anySet, listFields](const StringType &dirPath, const DirectoryEntryVisitorT<StringType> &dirVisitor)
+                                        {
+                                            return enumerateDirectoryFilteredImpl(dirPath, EnumerateFlags::none, anySet, dirVisitor, listFields);
+                                        }
+                                      , enumerateFlags, maskSet, maxDepth, pruner, walkFlags, maxConcurrency
+                                      , typename TreeWalkerT<StringType>::DirectoryIdGetterType(), getWorkerPool()
+                                      );
+
+        return walker.walk(rootPath, visitor);
+    }
+
+    template<typename StringType>
+    ErrorCode walkTreeImpl(const StringType &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, std::size_t maxDepth, const DirectoryEntryVisitorT<StringType> &visitor, const WalkTreePrunerT<StringType> &pruner, WalkTreeFlags walkFlags, std::size_t maxConcurrency) const
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    //! Ключи сортировки имён берутся у родительской ФС, порядок - как у её compareDirectoryEntries
+    template<typename StringType>
+    void sortDirectoryEntriesImpl(std::vector<DirectoryEntryInfoT<StringType> > &entries, SortFlags sortFlags) const
+    {
+        IFileSystem *pfs = checkedPfs();
+
+        DirectoryEntrySorterT<StringType> sorter(sortFlags);
+        if (m_parallelSortThreshold && entries.size()>=m_parallelSortThreshold)
+        {
+            sorter.setParallelSort(m_parallelSortThreshold, m_parallelSortConcurrency, getWorkerPool()); // Пул создаём, только если он нужен
+        }
+        sorter.sort( entries
+                   , [pfs](const StringType &name, SortFlags flags)
+                     {
+                         return pfs->getFilenameSortKey(name, flags);
+                     }
+                   );
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, CompiledFileMaskSetT<StringType>(masks), entries);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoT<StringType> > &compiledMasks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, CompiledFileMaskSetT<StringType>(compiledMasks), entries);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const CompiledFileMaskSetT<StringType> &maskSet, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, EntryFieldFlags::all, maskSet, entries);
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), entries);
+    }
+
+    // Все маски проверяются за один проход по имени.
+    // Заполняются только запрошенные поля и поля, нужные для отбора и сортировки
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        entries.clear();
+
+        ErrorCode err = enumerateDirectoryFilteredImpl( dirPath, enumerateFlags, maskSet
+                                                      , DirectoryEntryVisitorT<StringType>( [&](const DirectoryEntryInfoT<StringType> &e)
+                                                                                            {
+                                                                                                entries.emplace_back(e);
+                                                                                                return true;
+                                                                                            }
+                                                                                          )
+                                                      , entryFields | getEntryFieldsRequiredForSort(sortFlags)
+                                                      );
+        if (err!=ErrorCode::ok)
+        {
+            entries.clear();
+            return err;
+        }
+
+        sortDirectoryEntriesImpl(entries, sortFlags);
+
+        return ErrorCode::ok;
+    }
+
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoT<StringType> > &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, CompiledFileMaskSetT<StringType>(masks), offset, limit, entries);
+    }
+
+    // Кусок [offset, offset+limit) отсортированного списка, limit==0 - до конца списка.
+    // При заданном limit полный список не собирается и не сортируется - лучшие offset+limit записей отбираются кучей
+    template<typename StringType>
+    ErrorCode enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetT<StringType> &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoT<StringType> > &entries) const
+    {
+        if (!limit)
+        {
+            ErrorCode err = enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, entries);
+            if (err!=ErrorCode::ok)
+            {
+                return err;
+            }
+
+            entries.erase(entries.begin(), entries.begin() + (std::ptrdiff_t)std::min(offset, entries.size()));
+            return ErrorCode::ok;
+        }
+
+        entries.clear();
+
+        IFileSystem *pfs = checkedPfs();
+
+        DirectoryEntryTopSelectorT<StringType> selector(sortFlags, offset, limit);
+        auto keyMaker = [pfs](const StringType &name, SortFlags flags)
+                        {
+                            return pfs->getFilenameSortKey(name, flags);
+                        };
+
+        ErrorCode err = enumerateDirectoryFilteredImpl( dirPath, enumerateFlags, maskSet
+                                                      , DirectoryEntryVisitorT<StringType>( [&](const DirectoryEntryInfoT<StringType> &e)
+                                                                                            {
+                                                                                                selector.push(e, keyMaker);
+                                                                                                return true;
+                                                                                            }
+                                                                                          )
+                                                      , entryFields | getEntryFieldsRequiredForSort(sortFlags)
+                                                      );
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        selector.getResult(entries);
+
+        return ErrorCode::ok;
+    }
+
+    template<typename StringType>
+    ErrorCode openDirectoryCursorImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoT<StringType> > &masks, DirectoryCursorT<StringType> &cursor) const
+    {
+        std::vector<DirectoryEntryInfoT<StringType> > entries;
+        ErrorCode err = enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        cursor.open(dirPath, enumerateFlags, sortFlags, masks, std::move(entries));
+
+        return ErrorCode::ok;
+    }
+
+    //! Каталог перечитывается один раз. Записи до сохранённой отбрасываются по мере чтения, сортируется только остаток
+    template<typename StringType>
+    ErrorCode restoreDirectoryCursorImpl(const std::string &state, DirectoryCursorT<StringType> &cursor) const
+    {
+        DirectoryCursorT<StringType> restored;
+        if (!restored.parseState(state))
+        {
+            return ErrorCode::invalidFormat;
+        }
+
+        IFileSystem *pfs = checkedPfs();
+
+        const SortFlags sortFlags = restored.getSortFlags();
+        auto compare = [pfs, sortFlags](const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2)
+                       {
+                           return pfs->compareDirectoryEntries(e1, e2, sortFlags);
+                       };
+
+        std::vector<DirectoryEntryInfoT<StringType> > entries;
+        ErrorCode err = enumerateDirectoryFilteredImpl( restored.getDirPath(), restored.getEnumerateFlags(), CompiledFileMaskSetT<StringType>(restored.getMasks())
+                                                      , DirectoryEntryVisitorT<StringType>( [&](const DirectoryEntryInfoT<StringType> &e)
+                                                                                            {
+                                                                                                if (restored.acceptAfterResumeEntry(e, compare))
+                                                                                                {
+                                                                                                    entries.emplace_back(e);
+                                                                                                }
+                                                                                                return true;
+                                                                                            }
+                                                                                          )
+                                                      );
+        if (err!=ErrorCode::ok)
+        {
+            return err;
+        }
+
+        sortDirectoryEntriesImpl(entries, sortFlags);
+        restored.resume(std::move(entries));
+
+        cursor = std::move(restored);
+
+        return ErrorCode::ok;
+    }
+
+
+    //------------------------------
+    template<typename StringType, typename MaskInfoType>
+    std::vector<DirectoryEntryInfoT<StringType> > enumerateDirectoryExImpl(const StringType &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<MaskInfoType> &masks, ErrorCode *pErr) const
+    {
+        std::vector<DirectoryEntryInfoT<StringType> > entries;
+        ErrorCode err = enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+        if (pErr)
+        {
+            *pErr = err;
+        }
+
+        return entries;
+    }
+
+
+    //------------------------------
+    ErrorCode readDataFileImpl(const std::wstring &fName, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileImpl2(fName, fData);
+    }
+
+    ErrorCode readDataFileImpl(const std::string  &fName, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileImpl2(fName, fData);
+    }
+
+    ErrorCode readDataFileImpl(const std::wstring &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        return readDataFileImpl2(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFileImpl(const std::string  &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const
+    {
+        return readDataFileImpl2(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFileImpl(const std::wstring &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        return readDataFileImpl2(fName, pPool, fData);
+    }
+
+    ErrorCode readDataFileImpl(const std::string  &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const
+    {
+        return readDataFileImpl2(fName, pPool, fData);
+    }
+
+    ErrorCode readDataFileRangeImpl(const std::wstring &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileRangeImpl2(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRangeImpl(const std::string  &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const
+    {
+        return readDataFileRangeImpl2(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRangesImpl(const std::wstring &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        return readDataFileRangesImpl2(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFileRangesImpl(const std::string  &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const
+    {
+        return readDataFileRangesImpl2(fName, ranges, rangesData);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFilesImpl(const std::vector<StringType> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const
+    {
+        fData.clear();
+        fData.resize(fNames.size());
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        std::vector<StringType>   nativeNames;
+        std::vector<std::size_t>  nativeIdx  ;
+        toNativePathNames(fNames, nativeNames, nativeIdx, errors);
+
+        std::vector< std::vector<std::uint8_t> > nativeData;
+        std::vector<ErrorCode>                   nativeErrors;
+        checkedPfs()->readDataFiles(nativeNames, nativeData, nativeErrors);
+
+        for(std::size_t i=0; i!=nativeIdx.size() && i!=nativeErrors.size(); ++i)
+        {
+            errors[nativeIdx[i]] = nativeErrors[i];
+            if (i<nativeData.size())
+            {
+                fData[nativeIdx[i]] = std::move(nativeData[i]);
+            }
+        }
+
+        return getFirstError(errors);
+    }
+
+    template<typename StringType>
+    ErrorCode writeDataFilesImpl(const std::vector<StringType> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const
+    {
+        if (fNames.size()!=fData.size())
+        {
+            errors.assign(fNames.size(), ErrorCode::invalidArgument);
+            return ErrorCode::invalidArgument;
+        }
+
+        if (getVfsGlobalReadonly())
+        {
+            errors.assign(fNames.size(), ErrorCode::accessDenied);
+            return fNames.empty() ? ErrorCode::ok : ErrorCode::accessDenied;
+        }
+
+        errors.assign(fNames.size(), ErrorCode::ok);
+
+        std::vector<StringType>   nativeNames;
+        std::vector<std::size_t>  nativeIdx  ;
+        toNativePathNames(fNames, nativeNames, nativeIdx, errors);
+
+        std::vector< std::vector<std::uint8_t> > nativeDataTmp;
+        const std::vector< std::vector<std::uint8_t> > *pNativeData = &fData;
+        if (nativeIdx.size()!=fNames.size())
+        {
+            nativeDataTmp.reserve(nativeIdx.size());
+            for(auto idx : nativeIdx)
+            {
+                nativeDataTmp.emplace_back(fData[idx]);
+            }
+
+            pNativeData = &nativeDataTmp;
+        }
+
+        std::vector<ErrorCode> nativeErrors;
+        checkedPfs()->writeDataFiles(nativeNames, *pNativeData, writeFlags, nativeErrors);
+
+        for(std::size_t i=0; i!=nativeIdx.size() && i!=nativeErrors.size(); ++i)
+        {
+            errors[nativeIdx[i]] = nativeErrors[i];
+        }
+
+        return getFirstError(errors);
+    }
+
+    template<typename StringType>
+    ErrorCode readDataFilesParallelImpl(const std::vector<StringType> &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackT<StringType> &callback) const
+    {
+        std::vector<ErrorCode> errors(fNames.size(), ErrorCode::ok);
+        std::mutex             callbackMutex; // Файлы читаются параллельно, а callback вызывается по одному, как visitor в walkTree
+
+        auto readOne = [&](std::size_t idx)
+        {
+            std::vector<std::uint8_t> fData;
+            errors[idx] = readDataFileImpl(fNames[idx], fData);
+            if (callback)
+            {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                callback(idx, fNames[idx], errors[idx], fData);
+            }
+        };
+
+        if (maxConcurrency==1 || fNames.size()<=1)
+        {
+            parallelForEachIndex(fNames.size(), 1, readOne); // В вызывающем потоке, пул не нужен
+        }
+        else
+        {
+            parallelForEachIndex(*getWorkerPool(), fNames.size(), maxConcurrency, readOne);
+        }
+
+        return getFirstError(errors);
+    }
+
+    //------------------------------
+    ErrorCode readTextFileImpl(const std::wstring & fName, std::wstring &fText) const
+    {
+        return readTextFileImpl2(fName, fText);
+    }
+
+    ErrorCode readTextFileImpl(const std::string & fName, std::wstring &fText) const
+    {
+        return readTextFileImpl2(fName, fText);
+    }
+
+    //------------------------------
+    ErrorCode readTextFileImpl(const std::wstring &fName, std::string &fText) const
+    {
+        return readTextFileImpl2(fName, fText);
+    }
+
+    ErrorCode readTextFileImpl(const std::string &fName, std::string &fText) const
+    {
+        return readTextFileImpl2(fName, fText);
+    }
 
     //------------------------------
     ErrorCode writeTextFileImpl(const std::wstring &fName, const std::string &fText, WriteFileFlags writeFlags) const
@@ -544,6 +1375,16 @@ protected:
         return checkedPfs()->compareFilenames(n1, n2, sortFlags);
     }
 
+    virtual std::string getFilenameSortKey(const std::string  &name, SortFlags sortFlags) const override
+    {
+        return checkedPfs()->getFilenameSortKey(name, sortFlags);
+    }
+
+    virtual std::string getFilenameSortKey(const std::wstring &name, SortFlags sortFlags) const override
+    {
+        return checkedPfs()->getFilenameSortKey(name, sortFlags);
+    }
+
     template<typename StringType>
     int compareDirectoryEntriesImpl(const DirectoryEntryInfoT<StringType> &e1, const DirectoryEntryInfoT<StringType> &e2, SortFlags sortFlags) const
     {
@@ -554,49 +1395,67 @@ protected:
     template<typename StringType>
     bool testMaskMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const FileMaskInfoT<StringType> &mask) const
     {
-        if (mask.fileMaskFlags==FileMaskFlags::invalid)
+        // Маски компилируются один раз и берутся из кэша
+        std::shared_ptr<const CompiledFileMaskInfoT<StringType> > pCompiled = CompiledFileMaskCacheT<StringType>::instance().getCompiled(mask);
+        return pCompiled ? pCompiled->matchEntry(entry) : false;
+    }
+
+    template<typename StringType>
+    bool testMaskMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const CompiledFileMaskInfoT<StringType> &mask) const
+    {
+        return mask.matchEntry(entry);
+    }
+
+    template<typename StringType>
+    int testMasksMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const std::vector<FileMaskInfoT<StringType> > &masks) const
+    {
+        return CompiledFileMaskSetT<StringType>(masks).findFirstMatch(entry);
+    }
+
+    template<typename StringType>
+    int testMasksMatchImpl(const DirectoryEntryInfoT<StringType> &entry, const CompiledFileMaskSetT<StringType> &maskSet) const
+    {
+        return maskSet.findFirstMatch(entry);
+    }
+
+    template<typename StringType>
+    ErrorCode createDirectoryImpl(const ResolvedPathT<StringType> &resolvedPath, bool bForce ) const
+    {
+        if (getVfsGlobalReadonly())
         {
-            return false;
+            return ErrorCode::accessDenied;
         }
 
-        try
+        ErrorCode err = checkResolvedPathImpl(resolvedPath);
+        if (err!=ErrorCode::ok)
         {
-            CompiledFileMaskInfoT<StringType>  compiledFileMaskInfo = mask.compileRegex();
-            return umba::regex_helpers::regexMatch( ((compiledFileMaskInfo.fileMaskFlags&FileMaskFlags::matchExtOnly)!=0) ? entry.entryExt : entry.entryName
-                                                  , compiledFileMaskInfo.compiledMask
-                                                  , std::regex_constants::match_default
-                                                  );
+            return err;
         }
-        catch(...)
+
+        if (resolvedPath.isVirtualRoot())
         {
-            return false;
+            return ErrorCode::accessDenied;
         }
 
+        return checkedPfs()->createDirectory(resolvedPath.getNativePath(), bForce);
     }
 
     template<typename StringType>
-    ErrorCode createDirectoryImpl(StringType dirPath, bool bForce ) const
+    ErrorCode createDirectoryImpl(const StringType &dirPath, bool bForce ) const
     {
         if (getVfsGlobalReadonly())
         {
             return ErrorCode::accessDenied;
         }
 
-        dirPath = normalizeFilenameImpl(dirPath);
-
-        if (isVirtualRoot(dirPath))
-        {
-            return ErrorCode::accessDenied;
-        }
-
-        StringType nativePath;
-        ErrorCode err = toNativePathName(dirPath, nativePath);
+        ResolvedPathT<StringType> resolvedPath;
+        ErrorCode err = resolvePathImpl(dirPath, resolvedPath);
         if (err!=ErrorCode::ok)
         {
             return err;
         }
 
-        return checkedPfs()->createDirectory(nativePath, bForce);
+        return createDirectoryImpl(resolvedPath, bForce);
     }
 
 
@@ -850,6 +1709,76 @@ public:
         return readDataFileImpl(fName, fData);
     }
 
+    ErrorCode readDataFile(const std::string  &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const override
+    {
+        return readDataFileImpl(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFile(const std::wstring &fName, void *pBuf, std::size_t bufSize, std::size_t *pDataSize) const override
+    {
+        return readDataFileImpl(fName, pBuf, bufSize, pDataSize);
+    }
+
+    ErrorCode readDataFile(const std::string  &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const override
+    {
+        return readDataFileImpl(fName, pPool, fData);
+    }
+
+    ErrorCode readDataFile(const std::wstring &fName, const std::shared_ptr<IDataBufferPool> &pPool, PooledDataBuffer &fData) const override
+    {
+        return readDataFileImpl(fName, pPool, fData);
+    }
+
+    ErrorCode mapDataFile(const std::string  &fName, MappedView &mappedView) const override
+    {
+        return mapDataFileImpl(fName, mappedView);
+    }
+
+    ErrorCode mapDataFile(const std::wstring &fName, MappedView &mappedView) const override
+    {
+        return mapDataFileImpl(fName, mappedView);
+    }
+
+    ErrorCode readDataFileRange(const std::string  &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileRangeImpl(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRange(const std::wstring &fName, FileSize offset, std::size_t length, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileRangeImpl(fName, offset, length, fData);
+    }
+
+    ErrorCode readDataFileRanges(const std::string  &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const override
+    {
+        return readDataFileRangesImpl(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFileRanges(const std::wstring &fName, const std::vector<FileRange> &ranges, std::vector< std::vector<std::uint8_t> > &rangesData) const override
+    {
+        return readDataFileRangesImpl(fName, ranges, rangesData);
+    }
+
+    ErrorCode readDataFiles(const std::vector<std::string>  &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const override
+    {
+        return readDataFilesImpl(fNames, fData, errors);
+    }
+
+    ErrorCode readDataFiles(const std::vector<std::wstring> &fNames, std::vector< std::vector<std::uint8_t> > &fData, std::vector<ErrorCode> &errors) const override
+    {
+        return readDataFilesImpl(fNames, fData, errors);
+    }
+
+    ErrorCode readDataFilesParallel(const std::vector<std::string>  &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackA &callback) const override
+    {
+        return readDataFilesParallelImpl(fNames, maxConcurrency, callback);
+    }
+
+    ErrorCode readDataFilesParallel(const std::vector<std::wstring> &fNames, std::size_t maxConcurrency, const ReadDataFileCallbackW &callback) const override
+    {
+        return readDataFilesParallelImpl(fNames, maxConcurrency, callback);
+    }
+
 
     ErrorCode writeTextFile(const std::string  &fName, const std::string  &fText, WriteFileFlags writeFlags) const override
     {
@@ -882,6 +1811,133 @@ public:
         return writeDataFileImpl(fName, fData, writeFlags);
     }
 
+    ErrorCode writeDataFiles(const std::vector<std::string>  &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const override
+    {
+        return writeDataFilesImpl(fNames, fData, writeFlags, errors);
+    }
+
+    ErrorCode writeDataFiles(const std::vector<std::wstring> &fNames, const std::vector< std::vector<std::uint8_t> > &fData, WriteFileFlags writeFlags, std::vector<ErrorCode> &errors) const override
+    {
+        return writeDataFilesImpl(fNames, fData, writeFlags, errors);
+    }
+
+
+    ErrorCode openFile(const std::string  &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const override
+    {
+        return openFileImpl(fName, openMode, pFileHandle);
+    }
+
+    ErrorCode openFile(const std::wstring &fName, OpenMode openMode, std::shared_ptr<IFileHandle> &pFileHandle) const override
+    {
+        return openFileImpl(fName, openMode, pFileHandle);
+    }
+
+
+    // Разрешённые пути.
+    // using - чтобы не были скрыты обёртки IFileSystem для остальных операций с ResolvedPath (и для const char*/const wchar_t*)
+    using IFileSystem::resolvePath;
+    using IFileSystem::isFileExistAndReadable;
+    using IFileSystem::isDirectory;
+    using IFileSystem::createDirectory;
+    using IFileSystem::readTextFile;
+    using IFileSystem::readDataFile;
+    using IFileSystem::mapDataFile;
+    using IFileSystem::readDataFileRange;
+    using IFileSystem::readDataFileRanges;
+    using IFileSystem::writeTextFile;
+    using IFileSystem::writeDataFile;
+    using IFileSystem::openFile;
+
+    ErrorCode checkResolvedPath(const ResolvedPathA &resolvedPath) const override
+    {
+        return checkResolvedPathImpl(resolvedPath);
+    }
+
+    ErrorCode checkResolvedPath(const ResolvedPathW &resolvedPath) const override
+    {
+        return checkResolvedPathImpl(resolvedPath);
+    }
+
+    ErrorCode resolvePath(const std::string  &vPath, ResolvedPathA &resolvedPath) const override
+    {
+        return resolvePathImpl(vPath, resolvedPath);
+    }
+
+    ErrorCode resolvePath(const std::wstring &vPath, ResolvedPathW &resolvedPath) const override
+    {
+        return resolvePathImpl(vPath, resolvedPath);
+    }
+
+    bool isFileExistAndReadable(const ResolvedPathA &fName) const override
+    {
+        return isFileExistAndReadableImpl(fName);
+    }
+
+    bool isFileExistAndReadable(const ResolvedPathW &fName) const override
+    {
+        return isFileExistAndReadableImpl(fName);
+    }
+
+    bool isDirectory(const ResolvedPathA &dName) const override
+    {
+        return isDirectoryImpl(dName);
+    }
+
+    bool isDirectory(const ResolvedPathW &dName) const override
+    {
+        return isDirectoryImpl(dName);
+    }
+
+    ErrorCode readDataFile(const ResolvedPathA &fName, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileImpl2(fName, fData);
+    }
+
+    ErrorCode readDataFile(const ResolvedPathW &fName, std::vector<std::uint8_t> &fData) const override
+    {
+        return readDataFileImpl2(fName, fData);
+    }
+
+    ErrorCode writeDataFile(const ResolvedPathA &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const override
+    {
+        return writeDataFileImpl2(fName, fData, writeFlags);
+    }
+
+    ErrorCode writeDataFile(const ResolvedPathW &fName, const std::vector<std::uint8_t> &fData, WriteFileFlags writeFlags) const override
+    {
+        return writeDataFileImpl2(fName, fData, writeFlags);
+    }
+
+
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+    // Пути в виде string_view. Нормализацию имён делает родительская ФС (normalizeFilename принимает std::string),
+    // поэтому здесь путь копируется в строку один раз и дальше идёт обычным путём.
+    // using IFileSystem::mapVirtualPath - чтобы не были скрыты перегрузки IFileSystem для const char*/const wchar_t*
+    using IFileSystem::mapVirtualPath;
+
+    ErrorCode mapVirtualPath(std::string_view  vPath, std::string &realPath) const override
+    {
+        return VirtualFsImpl::mapVirtualPath(vPath, realPath);
+    }
+
+    ErrorCode mapVirtualPath(std::wstring_view vPath, std::wstring &realPath) const override
+    {
+        return VirtualFsImpl::mapVirtualPath(vPath, realPath);
+    }
+
+    bool isFileExistAndReadable(std::string_view  fName) const override
+    {
+        return isFileExistAndReadable(std::string(fName));
+    }
+
+    bool isFileExistAndReadable(std::wstring_view fName) const override
+    {
+        return isFileExistAndReadable(std::wstring(fName));
+    }
+
+#endif // MARTY_VFS_STRING_VIEW_AVAILABLE
+
 
     // std::string formatFiletime<std::string>( filetime_t t, const std::string &fmt )
     // Описание форматной строки тут - https://man7.org/linux/man-pages/man3/strftime.3.html
@@ -917,7 +1973,6 @@ public:
     }
 
 
-    // Возвращает 0, если совпадения не найдено, >0 - индекс маски, по которой найдено совпадение, <0 - индекс маски, на которой произошла какая-то ошибка (например, корявый regex)
     virtual bool testMaskMatch(const DirectoryEntryInfoA &entry, const FileMaskInfoA &mask) const override
     {
         return testMaskMatchImpl(entry, mask);
@@ -928,6 +1983,48 @@ public:
         return testMaskMatchImpl(entry, mask);
     }
 
+    virtual bool testMaskMatch(const DirectoryEntryInfoA &entry, const CompiledFileMaskInfoA &mask) const override
+    {
+        return testMaskMatchImpl(entry, mask);
+    }
+
+    virtual bool testMaskMatch(const DirectoryEntryInfoW &entry, const CompiledFileMaskInfoW &mask) const override
+    {
+        return testMaskMatchImpl(entry, mask);
+    }
+
+    // Возвращает 0, если совпадения не найдено, >0 - индекс маски, по которой найдено совпадение, <0 - индекс маски, на которой произошла какая-то ошибка (например, корявый regex)
+    // Индексы считаются с единицы
+    virtual int testMasksMatch(const DirectoryEntryInfoA &entry, const std::vector<FileMaskInfoA> &masks) const override
+    {
+        return testMasksMatchImpl(entry, masks);
+    }
+
+    virtual int testMasksMatch(const DirectoryEntryInfoW &entry, const std::vector<FileMaskInfoW> &masks) const override
+    {
+        return testMasksMatchImpl(entry, masks);
+    }
+
+    virtual int testMasksMatch(const DirectoryEntryInfoA &entry, const CompiledFileMaskSetA &maskSet) const override
+    {
+        return testMasksMatchImpl(entry, maskSet);
+    }
+
+    virtual int testMasksMatch(const DirectoryEntryInfoW &entry, const CompiledFileMaskSetW &maskSet) const override
+    {
+        return testMasksMatchImpl(entry, maskSet);
+    }
+
+    virtual ErrorCode compileFileMask(const FileMaskInfoA &mask, CompiledFileMaskInfoA &compiledMask) const override
+    {
+        return compileFileMaskCached(mask, compiledMask);
+    }
+
+    virtual ErrorCode compileFileMask(const FileMaskInfoW &mask, CompiledFileMaskInfoW &compiledMask) const override
+    {
+        return compileFileMaskCached(mask, compiledMask);
+    }
+
 
     // Нерекурсивный обзор содержимого каталога, расширенная версия
     virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const override
@@ -951,6 +2048,159 @@ public:
         return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, pErr);
     }
 
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, entries);
+    }
+
+    virtual std::vector<DirectoryEntryInfoA> enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoA> &masks, ErrorCode *pErr = 0) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, pErr);
+    }
+
+    virtual std::vector<DirectoryEntryInfoW> enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<CompiledFileMaskInfoW> &masks, ErrorCode *pErr = 0) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, masks, pErr);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, offset, limit, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, masks, offset, limit, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoA> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, offset, limit, entries);
+    }
+
+    virtual ErrorCode enumerateDirectoryEx(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::size_t offset, std::size_t limit, std::vector<DirectoryEntryInfoW> &entries) const override
+    {
+        return enumerateDirectoryExImpl(dirPath, enumerateFlags, sortFlags, entryFields, maskSet, offset, limit, entries);
+    }
+
+    // Постраничный обзор каталога через курсор
+    virtual ErrorCode openDirectoryCursor(const std::string  &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoA> &masks, DirectoryCursorA &cursor) const override
+    {
+        return openDirectoryCursorImpl(dirPath, enumerateFlags, sortFlags, masks, cursor);
+    }
+
+    virtual ErrorCode openDirectoryCursor(const std::wstring &dirPath, EnumerateFlags enumerateFlags, SortFlags sortFlags, const std::vector<FileMaskInfoW> &masks, DirectoryCursorW &cursor) const override
+    {
+        return openDirectoryCursorImpl(dirPath, enumerateFlags, sortFlags, masks, cursor);
+    }
+
+    virtual ErrorCode restoreDirectoryCursor(const std::string &state, DirectoryCursorA &cursor) const override
+    {
+        return restoreDirectoryCursorImpl(state, cursor);
+    }
+
+    virtual ErrorCode restoreDirectoryCursor(const std::string &state, DirectoryCursorW &cursor) const override
+    {
+        return restoreDirectoryCursorImpl(state, cursor);
+    }
+
+    // Потоковый нерекурсивный обзор каталога, без сортировки
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoA> &masks, const DirectoryEntryVisitorA &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, masks, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, const std::vector<FileMaskInfoW> &masks, const DirectoryEntryVisitorW &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, masks, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetA &maskSet, const DirectoryEntryVisitorA &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, const CompiledFileMaskSetW &maskSet, const DirectoryEntryVisitorW &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, const DirectoryEntryVisitorA &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, entryFields, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryStream(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, const DirectoryEntryVisitorW &visitor) const override
+    {
+        return enumerateDirectoryStreamImpl(dirPath, enumerateFlags, entryFields, maskSet, visitor);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, DirectoryListingA &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, masks, listing);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, DirectoryListingW &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, masks, listing);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::string  &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, DirectoryListingA &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, maskSet, listing);
+    }
+
+    virtual ErrorCode enumerateDirectoryListing(const std::wstring &dirPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, DirectoryListingW &listing) const override
+    {
+        return enumerateDirectoryListingImpl(dirPath, enumerateFlags, entryFields, maskSet, listing);
+    }
+
+    // Рекурсивный обход дерева каталогов
+    virtual ErrorCode walkTree(const std::string  &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoA> &masks, std::size_t maxDepth, const DirectoryEntryVisitorA &visitor, const WalkTreePrunerA &pruner = WalkTreePrunerA(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, masks, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    virtual ErrorCode walkTree(const std::wstring &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const std::vector<FileMaskInfoW> &masks, std::size_t maxDepth, const DirectoryEntryVisitorW &visitor, const WalkTreePrunerW &pruner = WalkTreePrunerW(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, masks, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    virtual ErrorCode walkTree(const std::string  &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetA &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorA &visitor, const WalkTreePrunerA &pruner = WalkTreePrunerA(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, maskSet, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
+    virtual ErrorCode walkTree(const std::wstring &rootPath, EnumerateFlags enumerateFlags, EntryFieldFlags entryFields, const CompiledFileMaskSetW &maskSet, std::size_t maxDepth, const DirectoryEntryVisitorW &visitor, const WalkTreePrunerW &pruner = WalkTreePrunerW(), WalkTreeFlags walkFlags = WalkTreeFlags::unsorted, std::size_t maxConcurrency = 0) const override
+    {
+        return walkTreeImpl(rootPath, enumerateFlags, entryFields, maskSet, maxDepth, visitor, pruner, walkFlags, maxConcurrency);
+    }
+
 
     virtual ErrorCode createDirectory(const std::string  &dirPath, bool bForce ) const override
     {
@@ -4,10 +4,15 @@
 //
 #include "vfs_enums.h"
 //
+#include "simple_mask_matcher.h"
+//
 #include "umba/filesys.h"
 //
 #include "umba/regex_helpers.h"
 #include "umba/string_plus.h"
+//
+#include <functional>
+#include <vector>
 
 
 //----------------------------------------------------------------------------
@@ -19,6 +24,34 @@ namespace marty_virtual_fs{
 //----------------------------------------------------------------------------
 typedef umba::filesys::filesize_t  FileSize;
 typedef umba::filesys::filetime_t  FileTime;
+typedef std::int64_t               FileOffset; // Смещение для seek, может быть отрицательным
+
+//----------------------------------------------------------------------------
+//! Диапазон байт файла - [offset, offset+length)
+struct FileRange
+{
+    FileSize         offset = 0;
+    std::size_t      length = 0;
+
+    FileRange() = default;
+    FileRange(FileSize o, std::size_t l) : offset(o), length(l) {}
+
+};
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Обработчик результата чтения файла при пакетном параллельном чтении. Вызывается из рабочих потоков.
+/*! Вызовы сериализованы - одновременно обработчик не вызывается.
+    idx - индекс файла в исходном списке. fData можно забрать себе (std::move)
+ */
+template<typename StringType>
+using ReadDataFileCallbackT = std::function<void(std::size_t idx, const StringType &fName, ErrorCode err, std::vector<std::uint8_t> &fData)>;
+
+typedef ReadDataFileCallbackT<std::string>   ReadDataFileCallbackA;
+typedef ReadDataFileCallbackT<std::wstring>  ReadDataFileCallbackW;
 
 //----------------------------------------------------------------------------
 
@@ -36,7 +69,9 @@ struct DirectoryEntryInfoT
 
     StringType       entryName       ;
     StringType       entryExt        ;
-    StringType       path            ; // Имеет ли смысл сделать shared_ptr<StringType>, чтобы память экономить и лишнее не копировать тудым сюдым?
+    StringType       path            ; // Копия пути в каждой записи. Для больших каталогов есть DirectoryListingT - там путь общий на весь список
+
+    EntryFieldFlags  validFields      = EntryFieldFlags::all; // Какие поля заполнены (при перечислении можно запросить не все)
 
 };
 
@@ -44,6 +79,82 @@ struct DirectoryEntryInfoT
 typedef DirectoryEntryInfoT<std::string>   DirectoryEntryInfoA;
 typedef DirectoryEntryInfoT<std::wstring>  DirectoryEntryInfoW;
 
+//------------------------------
+//! Обработчик записей каталога при потоковом перечислении. Возвращает false, чтобы прекратить перечисление
+template<typename StringType>
+using DirectoryEntryVisitorT = std::function<bool(const DirectoryEntryInfoT<StringType> &entry)>;
+
+typedef DirectoryEntryVisitorT<std::string>   DirectoryEntryVisitorA;
+typedef DirectoryEntryVisitorT<std::wstring>  DirectoryEntryVisitorW;
+
+//------------------------------
+//! Отсечение поддеревьев при обходе дерева каталогов. Возвращает true, если в каталог dirEntry спускаться не надо.
+//! depth - глубина dirEntry (у записей стартового каталога - 1)
+template<typename StringType>
+using WalkTreePrunerT = std::function<bool(const DirectoryEntryInfoT<StringType> &dirEntry, std::size_t depth)>;
+
+typedef WalkTreePrunerT<std::string>   WalkTreePrunerA;
+typedef WalkTreePrunerT<std::wstring>  WalkTreePrunerW;
+
+//------------------------------
+//! Отбор записи по типу (файл/каталог). EnumerateFlags::none - берём всё
+template<typename StringType> inline
+bool isDirectoryEntryTypeMatch(EnumerateFlags enumerateFlags, const DirectoryEntryInfoT<StringType> &e)
+{
+    if ((enumerateFlags&EnumerateFlags::enumerateAll)==0)
+    {
+        return true;
+    }
+
+    if ((e.fileTypeFlags&FileTypeFlags::directory)!=0)
+    {
+        return (enumerateFlags&EnumerateFlags::enumerateDirectories)!=0;
+    }
+
+    return (enumerateFlags&EnumerateFlags::enumerateFiles)!=0;
+}
+
+//------------------------------
+//! Поля записей, которые нужны для отбора по типу (только файлы или только каталоги)
+inline
+EntryFieldFlags getEntryFieldsRequiredForTypeFilter(EnumerateFlags enumerateFlags)
+{
+    EnumerateFlags typeFlags = enumerateFlags&EnumerateFlags::enumerateAll;
+    return (typeFlags==EnumerateFlags::enumerateFiles || typeFlags==EnumerateFlags::enumerateDirectories)
+         ? EntryFieldFlags::type
+         : EntryFieldFlags::none;
+}
+
+//------------------------------
+//! Поля записей, которые нужны для сортировки с заданными флагами (имя нужно всегда)
+inline
+EntryFieldFlags getEntryFieldsRequiredForSort(SortFlags sortFlags)
+{
+    EntryFieldFlags fields = EntryFieldFlags::name;
+
+    if ((sortFlags&(SortFlags::directoriesFirst|SortFlags::directoriesLast))!=0)
+    {
+        fields |= EntryFieldFlags::type;
+    }
+
+    if ((sortFlags&SortFlags::byType)!=0)
+    {
+        fields |= EntryFieldFlags::ext;
+    }
+
+    if ((sortFlags&SortFlags::bySize)!=0)
+    {
+        fields |= EntryFieldFlags::size;
+    }
+
+    if ((sortFlags&(SortFlags::byTimeCreation|SortFlags::byTimeLastModified|SortFlags::byTimeLastAccess))!=0)
+    {
+        fields |= EntryFieldFlags::times;
+    }
+
+    return fields;
+}
+
 //------------------------------
 template<typename StringType> inline
 void fillDirectoryEntryInfoFromUmbaFilesysFileStat(const umba::filesys::FileStat &fileStat, DirectoryEntryInfoT<StringType> &dirInfo)
@@ -66,6 +177,7 @@ DirectoryEntryInfoA fromOppositeDirectoryEntryInfo(const DirectoryEntryInfoW &in
     infoA.timeCreation     = infoW.timeCreation    ;
     infoA.timeLastModified = infoW.timeLastModified;
     infoA.timeLastAccess   = infoW.timeLastAccess  ;
+    infoA.validFields      = infoW.validFields     ;
     return infoA;
 }
 
@@ -79,6 +191,7 @@ DirectoryEntryInfoW fromOppositeDirectoryEntryInfo(const DirectoryEntryInfoA &in
     infoW.timeCreation     = infoA.timeCreation    ;
     infoW.timeLastModified = infoA.timeLastModified;
     infoW.timeLastAccess   = infoA.timeLastAccess  ;
+    infoW.validFields      = infoA.validFields     ;
     return infoW;
 }
 
@@ -91,9 +204,41 @@ template<typename StringType>
 struct CompiledFileMaskInfoT
 {
     FileMaskFlags                                         fileMaskFlags = FileMaskFlags::matchSimple;
-    std::basic_regex<typename StringType::value_type>     compiledMask  ;
+    std::basic_regex<typename StringType::value_type>     compiledMask  ; // Не заполняется, если useSimpleMatcher
+    bool                                                  useSimpleMatcher = false;
+    SimpleMaskMatcherT<StringType>                        simpleMatcher ;
 
-}; // struct FileMaskInfoT
+
+    //! Проверка имени (или расширения - для matchExtOnly - тут это не проверяется)
+    bool matchName(const StringType &name) const
+    {
+        if (useSimpleMatcher)
+        {
+            return simpleMatcher.match(name);
+        }
+
+        try
+        {
+            return umba::regex_helpers::regexMatch(name, compiledMask, std::regex_constants::match_default);
+        }
+        catch(...)
+        {
+            return false;
+        }
+    }
+
+    //! Проверка элемента каталога - по имени или по расширению, в зависимости от флагов маски
+    bool matchEntry(const DirectoryEntryInfoT<StringType> &entry) const
+    {
+        if (fileMaskFlags==FileMaskFlags::invalid)
+        {
+            return false;
+        }
+
+        return matchName(((fileMaskFlags&FileMaskFlags::matchExtOnly)!=0) ? entry.entryExt : entry.entryName);
+    }
+
+}; // struct CompiledFileMaskInfoT
 
 //------------------------------
 typedef CompiledFileMaskInfoT<std::string>   CompiledFileMaskInfoA;
@@ -111,6 +256,25 @@ struct FileMaskInfoT
     StringType         mask;
 
 
+    //! Компиляция с выбором способа сопоставления - простые маски обходятся без regex'ов
+    // requires wrapping into try/catch
+    CompiledFileMaskInfoT<StringType> compile() const
+    {
+        if ((fileMaskFlags&FileMaskFlags::matchRegex)==0)
+        {
+            CompiledFileMaskInfoT<StringType> compiledFileMaskInfoMask;
+            compiledFileMaskInfoMask.fileMaskFlags = fileMaskFlags;
+
+            if (compiledFileMaskInfoMask.simpleMatcher.compile(mask, (fileMaskFlags&FileMaskFlags::useAnchors)!=0))
+            {
+                compiledFileMaskInfoMask.useSimpleMatcher = true;
+                return compiledFileMaskInfoMask;
+            }
+        }
+
+        return compileRegex();
+    }
+
     // requires wrapping into try/catch
     CompiledFileMaskInfoT<StringType> compileRegex() const
     {
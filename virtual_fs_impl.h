@@ -12,10 +12,16 @@
 #include "filedata_encoder_impl.h"
 #include "filename_encoder_impl.h"
 #include "i_virtual_fs.h"
+#include "mount_point_tree.h"
+#include "path_normalizer.h"
 
 //
 #include "utils.h"
 
+//
+#include <atomic>
+#include <cstdint>
+
 namespace marty_virtual_fs {
 
 
@@ -42,15 +48,9 @@ protected:
     template<typename StringType>
     StringType makePathCanonicalImpl(StringType p) const
     {
-        typedef typename StringType::value_type CharType;
-
-        // Хвостовой слэш не должен нас путать, но только если он не единственный символ, а то скушаем корневой слэш
-        if (p.size()>1)
-        {
-            umba::filename::stripLastPathSep(p);
-        }
-
-        return umba::filename::makeCanonicalSimple(p, StringType(1, (CharType)'.'), StringType(2, (CharType)'.'), (CharType)'/');
+        // Разделители, "."/".." и хвостовой слэш (кроме единственного корневого) - за один проход, на месте
+        normalizePathInPlace(p);
+        return p;
     }
 
     template<typename StringType>
@@ -84,6 +84,19 @@ protected:
 
 protected:
 
+    static char nativePathSep()
+    {
+        #if defined(WIN32) || defined(_WIN32)
+
+            return '\\';
+
+        #else // Generic POSIX - Linups etc
+
+            return '/';
+
+        #endif
+    }
+
     std::wstring prepareMountPointKey(const std::wstring &k) const
     {
         #if defined(WIN32) || defined(_WIN32)
@@ -97,6 +110,18 @@ protected:
         #endif
     }
 
+    // Временную строку (результат decodeFilename, компонент пути) не копируем
+    std::wstring prepareMountPointKey(std::wstring &&k) const
+    {
+        #if defined(WIN32) || defined(_WIN32)
+
+            umba::string_plus::toupper(k);
+
+        #endif
+
+        return std::move(k);
+    }
+
     std::wstring prepareMountPointKey(const std::string &k) const
     {
         return prepareMountPointKey(decodeFilename(k));
@@ -117,12 +142,38 @@ protected:
         std::wstring target;
         FileTypeFlags flags;
 
+        // Формы цели считаются один раз в addMountPointExImpl - при разрешении путей
+        // ничего не перекодируется и не приводится к каноническому виду
+        std::string  targetA      ; // target в кодировке имён файлов
+        std::wstring targetNative ; // Канонический родной путь - makeNativePathCanonical(target)
+        std::string  targetNativeA;
+        std::wstring targetCmp    ; // Ключ сравнения для virtualizeRealPath - prepareVirtualizeCmp(target)
+
+        const std::string & getTarget(const std::string  *) const { return targetA; }
+        const std::wstring& getTarget(const std::wstring *) const { return target; }
+
+        const std::string & getTargetNative(const std::string  *) const { return targetNativeA; }
+        const std::wstring& getTargetNative(const std::wstring *) const { return targetNative; }
+
     }; // struct MountPointInfo
 
 
     // Это конечно медленнее, чем unordered_map, но сортировка автоматом. Да и mount points будут в таком количестве, что вряд ли будут сильно влиять на что-то
     std::map<std::wstring, MountPointInfo> m_mountPoints;
 
+    // Цели точек монтирования (в виде для сравнения, см. prepareVirtualizeCmp) по компонентам - для virtualizeRealPath
+    MountPointTree                         m_mountTree;
+
+    // Меняется при каждом изменении таблицы монтирования - по нему отличаются устаревшие ResolvedPath.
+    // Значения берутся из общего счётчика, так что после присваивания ФС они тоже не совпадут со старыми
+    std::uint64_t                          m_mountGeneration = 0;
+
+    static std::uint64_t nextMountGeneration()
+    {
+        static std::atomic<std::uint64_t> generation(0);
+        return ++generation;
+    }
+
 
     template<typename StringType>
     ErrorCode removeMountPointImpl(const StringType &k)
@@ -134,7 +185,9 @@ protected:
             return ErrorCode::invalidMountPoint;
         }
 
+        m_mountTree.remove(it->second.targetCmp, key);
         m_mountPoints.erase(it);
+        m_mountGeneration = nextMountGeneration();
 
         return ErrorCode::ok;
     }
@@ -162,40 +215,64 @@ protected:
         mntInfo.target = prepareMountTarget(decodeFilename(mntPointTarget));
         mntInfo.flags  = flags;
 
+        mntInfo.targetA       = encodeFilename(mntInfo.target);
+        mntInfo.targetNative  = this->makeNativePathCanonical(mntInfo.target);
+        mntInfo.targetNativeA = encodeFilename(mntInfo.targetNative);
+        mntInfo.targetCmp     = prepareVirtualizeCmp(mntInfo.target);
+
         m_mountPoints[key] = mntInfo;
+        m_mountTree.insert(mntInfo.targetCmp, key);
+        m_mountGeneration = nextMountGeneration();
 
         return ErrorCode::ok;
     }
 
-    template<typename StringType>
-    std::vector< StringType > splitVirtualPath(const StringType &vp) const
+    // Явные специализации в области класса понимает только MSVC, поэтому выбор - перегрузкой по типу-метке
+    std::string  filenameToStringTypeImpl(const std::string  * /* tag */, const std::string  &src) const { return src; }
+    std::string  filenameToStringTypeImpl(const std::string  * /* tag */, const std::wstring &src) const { return encodeFilename(src); }
+    std::wstring filenameToStringTypeImpl(const std::wstring * /* tag */, const std::string  &src) const { return decodeFilename(src); }
+    std::wstring filenameToStringTypeImpl(const std::wstring * /* tag */, const std::wstring &src) const { return src; }
+
+    template<typename StringType, typename StringTypeSrc> StringType filenameToStringType(const StringTypeSrc &src) const
     {
-        typedef typename StringType::value_type CharType;
-        return umba::filename::makeCanonicalSimpleParts( vp, StringType(1, (CharType)'.'), StringType(2, (CharType)'.'), (CharType)'/');
+        return filenameToStringTypeImpl((const StringType*)0, src);
     }
 
-    template<typename StringType, typename StringTypeSrc> StringType filenameToStringType(const StringTypeSrc &src) const;
-    template<> std::string  filenameToStringType<std::string ,std::string >(const std::string  &src) const { return src; }
-    template<> std::string  filenameToStringType<std::string ,std::wstring>(const std::wstring &src) const { return encodeFilename(src); }
-    template<> std::wstring filenameToStringType<std::wstring,std::string >(const std::string  &src) const { return decodeFilename(src); }
-    template<> std::wstring filenameToStringType<std::wstring,std::wstring>(const std::wstring &src) const { return src; }
-
     
-    template<typename StringType>
-    ErrorCode mapVirtualPathImpl( const StringType &vPath, StringType &realPath) const
+    // Приклеивание остатка нормализованного виртуального пути к родному пути, '/' заменяется на родной разделитель
+    template<typename CharType>
+    void appendPathTail(std::basic_string<CharType> &realPath, const CharType *pTail, std::size_t tailLen, CharType sep) const
     {
-        typedef typename StringType::value_type CharType;
-
-        std::vector< StringType > vpParts = splitVirtualPath(vPath);
-        if (vpParts.empty())
+        for(std::size_t i=0; i!=tailLen; ++i)
         {
-            return ErrorCode::invalidName; // invalidMountPoint?
+            realPath.append(1, pTail[i]==(CharType)'/' ? sep : pTail[i]);
         }
+    }
+
+    void appendPathTail(std::wstring &realPath, const char *pTail, std::size_t tailLen, wchar_t sep) const
+    {
+        std::wstring tail = decodeFilename(std::string(pTail, tailLen));
+        appendPathTail(realPath, tail.data(), tail.size(), sep);
+    }
+
+    void appendPathTail(std::string &realPath, const wchar_t *pTail, std::size_t tailLen, char sep) const
+    {
+        std::string tail = encodeFilename(std::wstring(pTail, tailLen));
+        appendPathTail(realPath, tail.data(), tail.size(), sep);
+    }
 
+    //! Отображение уже нормализованного виртуального пути. Тип результата может отличаться от типа символов пути
+    template<typename CharType, typename ResultStringType>
+    ErrorCode mapNormalizedVirtualPathImpl(const PathNormalizerT<CharType> &vpNormalizer, ResultStringType &realPath) const
+    {
+        typedef typename ResultStringType::value_type ResultCharType;
 
-        std::vector<StringType>::const_iterator vpIt = vpParts.begin();
+        if (vpNormalizer.isRoot())
+        {
+            return ErrorCode::invalidName; // invalidMountPoint?
+        }
 
-        std::wstring key = prepareMountPointKey(*vpIt++);
+        std::wstring key = prepareMountPointKey(vpNormalizer.template getComponentString< std::basic_string<CharType> >(0));
         std::map<std::wstring, MountPointInfo>::const_iterator mit = m_mountPoints.find(key);
         if (mit==m_mountPoints.end())
         {
@@ -207,30 +284,53 @@ protected:
         if ((mntInfo.flags&FileTypeFlags::directory)==0)
         {
             // Mount point is a file entry
-            //if (vpParts.size()>1)
-            if (vpIt!=vpParts.end())
+            if (vpNormalizer.getComponentsCount()>1)
             {
                 // У нас файл задан как точка монтирования, но почему-то в виртуальном пути задан дополнительный путь
                 return ErrorCode::invalidMountTarget;
             }
 
-            realPath = filenameToStringType<StringType,std::wstring>(mntInfo.target);
+            realPath = mntInfo.getTarget((const ResultStringType*)0);
 
             return ErrorCode::ok;
         }
         else
         {
-            //using namespace umba::filename;
+            // Остаток виртуального пути уже канонический и лежит в буфере нормализатора одним куском,
+            // приклеиваем его к заранее подготовленной цели, заменяя '/' на родной разделитель
+            const ResultStringType &mntTargetPath = mntInfo.getTargetNative((const ResultStringType*)0);
+            const ResultCharType    sep           = (ResultCharType)nativePathSep();
+
+            std::size_t tailOffset = vpNormalizer.getComponentsCount()>1 ? vpNormalizer.getComponent(1).offset : vpNormalizer.size();
+            std::size_t tailLen    = vpNormalizer.size() - tailOffset;
+
+            realPath.clear();
+            realPath.reserve(mntTargetPath.size() + tailLen + 1);
+            realPath.append(mntTargetPath);
+
+            if (tailLen)
+            {
+                if (!realPath.empty() && realPath.back()!=sep)
+                {
+                    realPath.append(1, sep);
+                }
+
+                appendPathTail(realPath, vpNormalizer.data() + tailOffset, tailLen, sep);
+            }
 
-            //std::vector<StringType>::const_iterator vpEnd = vpParts.end(); // cend чот не работает
-            StringType vPathRestMerged = umba::string_plus::merge<StringType,std::vector<StringType>::const_iterator>(vpIt, vpParts.end(), (CharType)'/' /* , [](const StringType &str) { return str; } */ );
-            StringType mntTargetPath   = filenameToStringType<StringType,std::wstring>(mntInfo.target);
-            //realPath = makeCanonical( appendPath(mntTargetPath, vPathRestMerged) );
-            realPath = this->makeNativePathCanonical(appendPath(mntTargetPath, vPathRestMerged));
             return ErrorCode::ok;
         }
     }
 
+    //! VPathType - std::string/std::wstring или (C++17) std::string_view/std::wstring_view
+    template<typename VPathType, typename StringType>
+    ErrorCode mapVirtualPathImpl( const VPathType &vPath, StringType &realPath) const
+    {
+        PathNormalizerT<typename VPathType::value_type> vpNormalizer;
+        vpNormalizer.normalize(vPath);
+        return mapNormalizedVirtualPathImpl(vpNormalizer, realPath);
+    }
+
     std::wstring prepareVirtualizeCmp(const std::wstring &k) const
     {
         #if defined(WIN32) || defined(_WIN32)
@@ -272,32 +372,29 @@ protected:
         // StringType 
         std::wstring realPathCmp = prepareVirtualizeCmp(realPath);
 
-        std::map<std::wstring, MountPointInfo>::const_iterator mit = m_mountPoints.begin();
-        for(; mit!=m_mountPoints.end(); ++mit)
+        // Самая глубокая точка монтирования, цель которой - префикс пути (по целым компонентам)
+        std::wstring mountKey;
+        std::size_t  prefixLen = 0;
+        if (!m_mountTree.findLongestPrefix(realPathCmp, mountKey, prefixLen))
         {
-            // auto 
-            std::wstring cmp = prepareVirtualizeCmp(mit->second.target);
-            if (!umba::string_plus::starts_with(realPathCmp, cmp ))
-            {
-                continue;
-            }
-
-            // Тут есть нюанс. Если у нас есть несколько mount points, некоторые из которых указывают куда-то 
-            // вглубь других, то будет выбрана первая найденная, а не самая длинная версия
+            return ErrorCode::notFound;
+        }
 
-            realPath.erase(0, cmp.size()); // Удаляем из исходного имени кусок, соответствующий по длине таргету текущей mount point
-            umba::filename::stripFirstPathSep(realPath);
+        std::map<std::wstring, MountPointInfo>::const_iterator mit = m_mountPoints.find(mountKey);
+        if (mit==m_mountPoints.end())
+        {
+            return ErrorCode::notFound;
+        }
 
-            auto vpCandy = this->makePathCanonical(vrpImplAppendPath(mit->second.name, realPath)); //umba::filename::makeCanonical( vrpImplAppendPath(mit->second.name, realPath), L'/' );
-            
-            umba::filename::stripFirstPathSep(vpCandy);
-            vPath = filenameToStringType<StringType,std::wstring>(std::wstring(1, L'/') + vpCandy);
+        realPath.erase(0, prefixLen); // Удаляем из исходного имени кусок, соответствующий таргету mount point
+        umba::filename::stripFirstPathSep(realPath);
 
-            return ErrorCode::ok;
+        auto vpCandy = this->makePathCanonical(vrpImplAppendPath(mit->second.name, realPath)); //umba::filename::makeCanonical( vrpImplAppendPath(mit->second.name, realPath), L'/' );
 
-        } // for
+        umba::filename::stripFirstPathSep(vpCandy);
+        vPath = filenameToStringType<StringType,std::wstring>(std::wstring(1, L'/') + vpCandy);
 
-        return ErrorCode::notFound;
+        return ErrorCode::ok;
 
     }
 
@@ -377,6 +474,12 @@ protected:
 
 public:
 
+    //! Состояние таблицы монтирования - меняется при добавлении/удалении точек монтирования
+    std::uint64_t getMountGeneration() const
+    {
+        return m_mountGeneration;
+    }
+
     virtual bool getErrorCodeString(ErrorCode e, std::string  &errStr) const override
     {
         try
@@ -520,6 +623,8 @@ public:
     virtual ErrorCode clearMounts( ) override
     {
         m_mountPoints.clear();
+        m_mountTree.clear();
+        m_mountGeneration = nextMountGeneration();
         return ErrorCode::ok;
     }
 
@@ -567,6 +672,22 @@ public:
         return mapVirtualPathImpl(vPath, realPath);
     }
 
+#if defined(MARTY_VFS_STRING_VIEW_AVAILABLE)
+
+    using IVirtualFs::mapVirtualPath;
+
+    virtual ErrorCode mapVirtualPath(std::string_view  vPath, std::string  &realPath) const override
+    {
+        return mapVirtualPathImpl(vPath, realPath);
+    }
+
+    virtual ErrorCode mapVirtualPath(std::wstring_view vPath, std::wstring &realPath) const override
+    {
+        return mapVirtualPathImpl(vPath, realPath);
+    }
+
+#endif
+
 
     virtual ErrorCode virtualizeRealPath( const std::string  &realPath, std::string  &vPath) const override
     {
@@ -0,0 +1,510 @@
+/*! \file
+    \brief Simple work-stealing thread pool
+*/
+
+#pragma once
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//
+#include "warnings_disable.h"
+
+
+
+namespace marty_virtual_fs {
+
+
+//! Пул потоков с перехватом задач
+/*! У каждого потока своя очередь. Свои задачи поток берёт с конца очереди (LIFO),
+    а когда своя очередь пуста - ворует из начала чужих (FIFO).
+    Задачи, поставленные из рабочего потока, попадают в его же очередь.
+    Исключение из задачи перехватывается, первое из них перевыбрасывается из waitAll().
+ */
+class WorkStealingThreadPool
+{
+
+public:
+
+    typedef std::function<void()>  Task;
+
+
+protected:
+
+    struct WorkerQueue
+    {
+        std::mutex         mutex;
+        std::deque<Task>   tasks;
+    };
+
+    std::vector< std::unique_ptr<WorkerQueue> >   m_queues      ;
+    std::vector<std::thread>                      m_threads     ;
+
+    std::mutex                                    m_mutex       ; // Для засыпания/пробуждения
+    std::condition_variable                       m_taskCv      ;
+    std::condition_variable                       m_doneCv      ;
+    bool                                          m_stop        = false;
+
+    std::atomic<std::size_t>                      m_queued      { 0 }; // Лежат в очередях
+    std::atomic<std::size_t>                      m_unfinished  { 0 }; // Поставлены, но ещё не выполнены
+    std::atomic<std::size_t>                      m_nextQueue   { 0 };
+
+    std::exception_ptr                            m_firstException;
+
+
+    // Пул и индекс рабочего потока, в котором мы находимся
+    static std::pair<const WorkStealingThreadPool*, std::size_t>& currentWorker()
+    {
+        static thread_local std::pair<const WorkStealingThreadPool*, std::size_t> w = { 0, 0 };
+        return w;
+    }
+
+    bool tryPopTask(std::size_t workerIdx, Task &task)
+    {
+        {
+            WorkerQueue &q = *m_queues[workerIdx];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty())
+            {
+                task = std::move(q.tasks.back());
+                q.tasks.pop_back();
+                --m_queued;
+                return true;
+            }
+        }
+
+        for(std::size_t k=1; k!=m_queues.size(); ++k)
+        {
+            WorkerQueue &q = *m_queues[(workerIdx+k)%m_queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty())
+            {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                --m_queued;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void runTask(Task &task)
+    {
+        try
+        {
+            task();
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_firstException)
+            {
+                m_firstException = std::current_exception();
+            }
+        }
+
+        task = Task();
+
+        if (--m_unfinished==0)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_doneCv.notify_all();
+        }
+    }
+
+    void workerProc(std::size_t workerIdx)
+    {
+        currentWorker() = std::make_pair((const WorkStealingThreadPool*)this, workerIdx);
+
+        Task task;
+        for(;;)
+        {
+            if (tryPopTask(workerIdx, task))
+            {
+                runTask(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskCv.wait(lock, [&]() { return m_stop || m_queued.load()!=0; });
+            if (m_stop && m_queued.load()==0)
+            {
+                break;
+            }
+        }
+    }
+
+
+public:
+
+    //! numThreads==0 - по числу ядер
+    explicit WorkStealingThreadPool(std::size_t numThreads = 0)
+    {
+        if (!numThreads)
+        {
+            numThreads = getDefaultThreadsCount();
+        }
+
+        m_queues.reserve(numThreads);
+        for(std::size_t i=0; i!=numThreads; ++i)
+        {
+            m_queues.emplace_back(std::make_unique<WorkerQueue>());
+        }
+
+        m_threads.reserve(numThreads);
+        for(std::size_t i=0; i!=numThreads; ++i)
+        {
+            m_threads.emplace_back([this, i]() { workerProc(i); });
+        }
+    }
+
+    WorkStealingThreadPool(const WorkStealingThreadPool &)            = delete;
+    WorkStealingThreadPool& operator=(const WorkStealingThreadPool &) = delete;
+
+    //! Дожидается выполнения всех задач
+    ~WorkStealingThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_taskCv.notify_all();
+
+        for(auto &t : m_threads)
+        {
+            t.join();
+        }
+    }
+
+    static std::size_t getDefaultThreadsCount()
+    {
+        std::size_t n = (std::size_t)std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    //! Общий пул по числу ядер - для параллельных алгоритмов, которым пул не передали. Создаётся при первом использовании
+    static std::shared_ptr<WorkStealingThreadPool> getDefaultPool()
+    {
+        static std::shared_ptr<WorkStealingThreadPool> pPool = std::make_shared<WorkStealingThreadPool>();
+        return pPool;
+    }
+
+    std::size_t getThreadsCount() const
+    {
+        return m_threads.size();
+    }
+
+    //! Вызывающий поток - рабочий поток этого пула
+    bool isCurrentThreadWorker() const
+    {
+        return currentWorker().first==this;
+    }
+
+    void submit(Task task)
+    {
+        std::size_t queueIdx = 0;
+
+        const auto &w = currentWorker();
+        if (w.first==this)
+        {
+            queueIdx = w.second;
+        }
+        else
+        {
+            queueIdx = m_nextQueue++ % m_queues.size();
+        }
+
+        ++m_unfinished;
+
+        {
+            WorkerQueue &q = *m_queues[queueIdx];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.emplace_back(std::move(task));
+            ++m_queued;
+        }
+
+        {
+            // Захват мьютекса не даёт потеряться пробуждению между проверкой предиката и засыпанием
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+
+        m_taskCv.notify_one();
+    }
+
+    //! Дожидается выполнения всех поставленных задач (включая поставленные из задач).
+    /*! Нельзя вызывать из рабочего потока пула.
+        Если какая-то задача выбросила исключение, то первое из них перевыбрасывается.
+     */
+    void waitAll()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCv.wait(lock, [&]() { return m_unfinished.load()==0; });
+
+        if (m_firstException)
+        {
+            std::exception_ptr e = m_firstException;
+            m_firstException = std::exception_ptr();
+            std::rethrow_exception(e);
+        }
+    }
+
+}; // class WorkStealingThreadPool
+
+
+
+//! Группа задач на общем пуле - своё ожидание и своё ограничение числа потоков
+/*! Задачи группы лежат в её собственной очереди, в пул ставится не больше maxConcurrency-1 задач-разборщиков,
+    ещё одним разборщиком в wait() становится вызывающий поток. Поэтому пулом одновременно могут пользоваться
+    несколько групп, и wait() можно вызывать из рабочего потока того же пула - без взаимной блокировки.
+    Задачи можно ставить и из задач группы. Свои задачи группа берёт с конца очереди (LIFO),
+    так что дерево задач обходится в основном в глубину.
+    Первое исключение из задач перевыбрасывается из wait(), оставшиеся задачи при этом не выполняются.
+ */
+class ThreadPoolTaskGroup
+{
+
+public:
+
+    typedef WorkStealingThreadPool::Task  Task;
+
+
+protected:
+
+    // Разборщики, поставленные в пул, могут начать работу уже после wait() - состояние живёт, пока они его держат
+    struct State
+    {
+        std::mutex               mutex        ;
+        std::condition_variable  cv           ;
+        std::deque<Task>         tasks        ;
+        std::size_t              unfinished   = 0; // Поставлены, но ещё не выполнены
+        std::size_t              runners      = 0; // Разборщики в пуле, которые ещё не завершились
+        std::size_t              maxRunners   = 0;
+        std::exception_ptr       firstException;
+    };
+
+    WorkStealingThreadPool  &m_pool  ;
+    std::shared_ptr<State>   m_pState;
+
+
+    // Выполняет задачи группы, пока они есть. bRunner - разборщик из пула (иначе - поток из wait())
+    static void runTasks(State &st, bool bRunner)
+    {
+        for(;;)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(st.mutex);
+                if (st.tasks.empty())
+                {
+                    if (bRunner)
+                    {
+                        --st.runners;
+                    }
+                    return;
+                }
+
+                task = std::move(st.tasks.back());
+                st.tasks.pop_back();
+            }
+
+            try
+            {
+                task();
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(st.mutex);
+                if (!st.firstException)
+                {
+                    st.firstException = std::current_exception();
+                }
+
+                st.unfinished -= st.tasks.size(); // Остальное не выполняем
+                st.tasks.clear();
+            }
+
+            task = Task();
+
+            std::lock_guard<std::mutex> lock(st.mutex);
+            if (--st.unfinished==0)
+            {
+                st.cv.notify_all();
+            }
+        }
+    }
+
+
+public:
+
+    //! maxConcurrency==0 - по числу потоков пула (и ещё вызывающий поток в wait())
+    ThreadPoolTaskGroup(WorkStealingThreadPool &pool, std::size_t maxConcurrency = 0)
+    : m_pool(pool)
+    , m_pState(std::make_shared<State>())
+    {
+        m_pState->maxRunners = maxConcurrency ? maxConcurrency-1 : pool.getThreadsCount();
+    }
+
+    ThreadPoolTaskGroup(const ThreadPoolTaskGroup &)            = delete;
+    ThreadPoolTaskGroup& operator=(const ThreadPoolTaskGroup &) = delete;
+
+    //! Дожидается своих задач, исключения при этом не перевыбрасываются
+    ~ThreadPoolTaskGroup()
+    {
+        try
+        {
+            wait();
+        }
+        catch(...)
+        {
+        }
+    }
+
+    void submit(Task task)
+    {
+        bool bNewRunner = false;
+        {
+            std::lock_guard<std::mutex> lock(m_pState->mutex);
+            m_pState->tasks.emplace_back(std::move(task));
+            ++m_pState->unfinished;
+
+            if (m_pState->runners<m_pState->maxRunners && m_pState->runners<m_pState->tasks.size())
+            {
+                ++m_pState->runners;
+                bNewRunner = true;
+            }
+
+            m_pState->cv.notify_all(); // Ждущий в wait() поток тоже разбирает задачи
+        }
+
+        if (bNewRunner)
+        {
+            std::shared_ptr<State> pState = m_pState;
+            m_pool.submit([pState]() { runTasks(*pState, true); });
+        }
+    }
+
+    //! Выполняет задачи группы в вызывающем потоке и дожидается остальных
+    void wait()
+    {
+        State &st = *m_pState;
+
+        for(;;)
+        {
+            runTasks(st, false);
+
+            std::unique_lock<std::mutex> lock(st.mutex);
+            st.cv.wait(lock, [&]() { return st.unfinished==0 || !st.tasks.empty(); });
+            if (st.unfinished==0)
+            {
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(st.mutex);
+        if (st.firstException)
+        {
+            std::exception_ptr e = st.firstException;
+            st.firstException = std::exception_ptr();
+            std::rethrow_exception(e);
+        }
+    }
+
+}; // class ThreadPoolTaskGroup
+
+
+
+//! Вызывает func(idx) для всех idx из [0, count), не более чем в maxConcurrency потоков (включая вызывающий)
+/*! maxConcurrency==0 - по числу потоков пула. Индексы разбирают сами задачи, поэтому их не больше maxConcurrency.
+    Ждём только свои задачи (не waitAll), так что пулом одновременно могут пользоваться несколько вызывающих,
+    в том числе задачи, выполняющиеся в самом пуле.
+    Первое исключение из func перевыбрасывается, оставшиеся индексы при этом не обрабатываются.
+ */
+template<typename Func> inline
+void parallelForEachIndex(WorkStealingThreadPool &pool, std::size_t count, std::size_t maxConcurrency, Func func)
+{
+    if (!maxConcurrency)
+    {
+        maxConcurrency = pool.getThreadsCount()+1;
+    }
+
+    std::size_t nRunners = std::min(maxConcurrency, count);
+
+    if (nRunners<=1)
+    {
+        for(std::size_t i=0; i!=count; ++i)
+        {
+            func(i);
+        }
+
+        return;
+    }
+
+    std::atomic<std::size_t>  nextIdx{ 0 };
+    ThreadPoolTaskGroup       group(pool, nRunners);
+
+    for(std::size_t r=0; r!=nRunners; ++r)
+    {
+        group.submit([&]()
+        {
+            try
+            {
+                for(std::size_t i=nextIdx++; i<count; i=nextIdx++)
+                {
+                    func(i);
+                }
+            }
+            catch(...)
+            {
+                nextIdx = count;
+                throw;
+            }
+        });
+    }
+
+    group.wait();
+}
+
+
+//! То же на общем пуле (WorkStealingThreadPool::getDefaultPool()) - потоки не создаются на каждый вызов
+/*! maxConcurrency==0 - по числу ядер. При maxConcurrency==1 или count<=1 всё выполняется в вызывающем потоке.
+ */
+template<typename Func> inline
+void parallelForEachIndex(std::size_t count, std::size_t maxConcurrency, Func func)
+{
+    if (!maxConcurrency)
+    {
+        maxConcurrency = WorkStealingThreadPool::getDefaultThreadsCount();
+    }
+
+    if (maxConcurrency==1 || count<=1)
+    {
+        for(std::size_t i=0; i!=count; ++i)
+        {
+            func(i);
+        }
+
+        return;
+    }
+
+    parallelForEachIndex(*WorkStealingThreadPool::getDefaultPool(), count, maxConcurrency, std::move(func));
+}
+
+
+} // namespace marty_virtual_fs
+
+
+#include "warnings_restore.h"
+